@@ -217,8 +217,8 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
         if (!ctx->stub_mem_pool)
                 return -1;
 
-        INIT_LIST_HEAD (&pool->all_frames);
-        LOCK_INIT (&pool->lock);
+        if (call_pool_init (pool) != 0)
+                return -1;
         ctx->pool = pool;
 
         pthread_mutex_init (&(ctx->lock), NULL);
@@ -0,0 +1,159 @@
+#!/bin/python
+"""
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+"""
+
+# Decodes the dump written by a glusterfs process traced with --fop-trace or
+# the io-stats 'fop-trace' option (see libglusterfs/src/fop-trace.h) into
+# time spent per translator and fop.
+#
+# 'total' is the time from wind to unwind of a frame. 'self' is what is left
+# of it once the time covered by the frames it wound itself is taken out,
+# i.e. the time spent in the translator proper (or, for protocol/client, on
+# the network and in the server).
+#
+# usage: fop-trace-decode.py <dump> [--by-xlator]
+
+import struct
+import sys
+
+HDR = "=IIIIII"
+NAME = "=Q64s"
+RING_HDR = "=QQ"
+REC = "=QQQQii"
+
+MAGIC = 0x47465452
+VERSION = 1
+
+EV_WIND = 1
+EV_UNWIND = 2
+
+
+def read_struct (fp, fmt):
+        size = struct.calcsize (fmt)
+        buf = fp.read (size)
+        if len (buf) != size:
+                raise EOFError ("truncated trace dump")
+        return struct.unpack (fmt, buf)
+
+
+def read_names (fp, count):
+        names = {}
+        for i in range (count):
+                (ident, name) = read_struct (fp, NAME)
+                names[ident] = name.split (b"\0")[0].decode ("ascii",
+                                                             "replace")
+        return names
+
+
+def load (path):
+        fp = open (path, "rb")
+        (magic, version, rec_size, xl_count, fop_count,
+         ring_count) = read_struct (fp, HDR)
+        if magic != MAGIC or version != VERSION:
+                raise ValueError ("%s: not a fop trace dump" % path)
+        if rec_size != struct.calcsize (REC):
+                raise ValueError ("%s: unexpected record size %d" %
+                                  (path, rec_size))
+
+        xlators = read_names (fp, xl_count)
+        fops = read_names (fp, fop_count)
+
+        records = []
+        for i in range (ring_count):
+                (tid, count) = read_struct (fp, RING_HDR)
+                for j in range (count):
+                        records.append (read_struct (fp, REC))
+        fp.close ()
+
+        records.sort (key=lambda rec: rec[0])
+        return (xlators, fops, records)
+
+
+def covered (start, end, intervals):
+        """ time within [start, end] covered by any of the intervals """
+        total = 0
+        last = start
+        for (s, e) in sorted (intervals):
+                s = max (s, last)
+                e = min (e, end)
+                if e > s:
+                        total += e - s
+                        last = e
+        return total
+
+
+def decode (records):
+        pending = {}
+        stats = {}
+
+        for (ns, frame, parent, xl, fop, event) in records:
+                if event == EV_WIND:
+                        pending[frame] = [ns, parent, xl, fop, []]
+                        continue
+
+                if event != EV_UNWIND or frame not in pending:
+                        # wound before the oldest record still in the ring
+                        continue
+
+                (begin, parent, xl, fop, children) = pending.pop (frame)
+                total = ns - begin
+                own = total - covered (begin, ns, children)
+
+                entry = stats.setdefault ((xl, fop), [0, 0, 0])
+                entry[0] += 1
+                entry[1] += total
+                entry[2] += own
+
+                if parent in pending:
+                        pending[parent][4].append ((begin, ns))
+
+        return stats
+
+
+def main (argv):
+        if len (argv) < 2:
+                sys.stderr.write ("usage: %s <dump> [--by-xlator]\n" % argv[0])
+                return 1
+
+        (xlators, fops, records) = load (argv[1])
+        stats = decode (records)
+
+        if "--by-xlator" in argv[2:]:
+                merged = {}
+                for ((xl, fop), entry) in stats.items ():
+                        m = merged.setdefault ((xl, -1), [0, 0, 0])
+                        for i in range (3):
+                                m[i] += entry[i]
+                stats = merged
+
+        print ("%-32s %-12s %10s %14s %14s %12s" %
+               ("xlator", "fop", "calls", "total(ms)", "self(ms)",
+                "avg-self(us)"))
+
+        rows = sorted (stats.items (), key=lambda item: -item[1][2])
+        for ((xl, fop), (calls, total, own)) in rows:
+                print ("%-32s %-12s %10d %14.3f %14.3f %12.3f" %
+                       (xlators.get (xl, "0x%x" % xl),
+                        fops.get (fop, "-"), calls, total / 1e6, own / 1e6,
+                        own / 1e3 / calls))
+        return 0
+
+
+if __name__ == "__main__":
+        sys.exit (main (sys.argv))
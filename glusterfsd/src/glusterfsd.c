@@ -69,6 +69,7 @@
 #include "globals.h"
 #include "statedump.h"
 #include "latency.h"
+#include "fop-trace.h"
 #include "glusterfsd-mem-types.h"
 #include "syscall.h"
 #include "call-stub.h"
@@ -178,6 +179,10 @@ static struct argp_option gf_options[] = {
         {"volfile-check", ARGP_VOLFILE_CHECK_KEY, 0, 0,
          "Enable strict volume file checking"},
         {0, 0, 0, 0, "Miscellaneous Options:"},
+        {"fop-trace", ARGP_FOP_TRACE_KEY, "PATH", OPTION_ARG_OPTIONAL,
+         "Record every wind and unwind from startup, the records are "
+         "written to PATH when tracing stops [default: "
+         GF_FOP_TRACE_FILE_ROOT ".<pid>]"},
         {0, }
 };
 
@@ -682,6 +687,12 @@ parse_opts (int key, char *arg, struct argp_state *state)
         case ARGP_DUMP_FUSE_KEY:
                 cmd_args->dump_fuse = gf_strdup (arg);
                 break;
+
+        case ARGP_FOP_TRACE_KEY:
+                cmd_args->fop_trace = 1;
+                if (arg)
+                        cmd_args->fop_trace_file = gf_strdup (arg);
+                break;
         case ARGP_BRICK_NAME_KEY:
                 cmd_args->brick_name = gf_strdup (arg);
                 break;
@@ -746,6 +757,9 @@ cleanup_and_exit (int signum)
 
         glusterfs_pidfile_cleanup (ctx);
 
+        if (ctx->fop_trace)
+                gf_fop_trace_dump ();
+
         exit (0);
 #if 0
         /* TODO: Properly do cleanup_and_exit(), with synchronisations */
@@ -980,8 +994,11 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
                 return -1;
         }
 
-        INIT_LIST_HEAD (&pool->all_frames);
-        LOCK_INIT (&pool->lock);
+        if (call_pool_init (pool) != 0) {
+                gf_log ("", GF_LOG_CRITICAL,
+                        "ERROR: glusterfs call pool init failed");
+                return -1;
+        }
         ctx->pool = pool;
 
         pthread_mutex_init (&(ctx->lock), NULL);
@@ -1109,6 +1126,8 @@ parse_cmdline (int argc, char *argv[], glusterfs_ctx_t *ctx)
                 }
         }
 
+        ctx->fop_trace = cmd_args->fop_trace;
+
         return ret;
 }
 
@@ -355,20 +355,25 @@ gf_print_trace (int32_t signum)
         ret = write (fd, "pending frames:\n", 16);
         {
                 glusterfs_ctx_t *ctx = glusterfs_ctx_get ();
-                struct list_head *trav = ((call_pool_t *)ctx->pool)->all_frames.next;
-                while (trav != (&((call_pool_t *)ctx->pool)->all_frames)) {
-                        call_frame_t *tmp = (call_frame_t *)(&((call_stack_t *)trav)->frames);
-                        if (tmp->root->type == GF_OP_TYPE_FOP)
-                                sprintf (msg,"frame : type(%d) op(%s)\n",
-                                         tmp->root->type,
-                                         gf_fop_list[tmp->root->op]);
-                        if (tmp->root->type == GF_OP_TYPE_MGMT)
-                                sprintf (msg,"frame : type(%d) op(%s)\n",
-                                         tmp->root->type,
-                                         gf_mgmt_list[tmp->root->op]);
-
-                        ret = write (fd, msg, strlen (msg));
-                        trav = trav->next;
+                call_pool_t *pool = ctx->pool;
+                call_pool_thread_t *thread = NULL;
+                call_stack_t *stack = NULL;
+
+                list_for_each_entry (thread, &pool->threads, threads) {
+                        list_for_each_entry (stack, &thread->all_stacks,
+                                             all_frames) {
+                                call_frame_t *tmp = &stack->frames;
+                                if (tmp->root->type == GF_OP_TYPE_FOP)
+                                        sprintf (msg, "frame : type(%d) "
+                                                 "op(%s)\n", tmp->root->type,
+                                                 gf_fop_list[tmp->root->op]);
+                                if (tmp->root->type == GF_OP_TYPE_MGMT)
+                                        sprintf (msg, "frame : type(%d) "
+                                                 "op(%s)\n", tmp->root->type,
+                                                 gf_mgmt_list[tmp->root->op]);
+
+                                ret = write (fd, msg, strlen (msg));
+                        }
                 }
                 ret = write (fd, "\n", 1);
         }
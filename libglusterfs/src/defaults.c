@@ -1201,6 +1201,185 @@ default_getspec (call_frame_t *frame, xlator_t *this, const char *key,
         return 0;
 }
 
+/* Compound operation: translators which do not look into the individual
+   operations pass it on as a whole, the others get it split into plain fops
+   wound on themselves, one after another in the order given.
+*/
+
+typedef struct {
+        fd_t            *fd;
+        compound_args_t *args;
+        int32_t          next;
+        int32_t          create_errno; /* fails the rest when non-zero */
+} default_compound_local_t;
+
+static int32_t
+default_compound_resume_next (call_frame_t *frame, xlator_t *this);
+
+int32_t
+default_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, compound_args_t *args)
+{
+        STACK_UNWIND_STRICT (compound, frame, op_ret, op_errno, args);
+        return 0;
+}
+
+static int32_t
+default_compound_fop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                          int32_t op_ret, int32_t op_errno,
+                          struct iatt *prebuf, struct iatt *postbuf)
+{
+        default_compound_local_t *local = NULL;
+        compound_fop_t           *cfop  = NULL;
+
+        local = frame->local;
+        cfop = &local->args->fops[local->next];
+
+        cfop->op_ret = op_ret;
+        cfop->op_errno = op_errno;
+        if (prebuf)
+                cfop->prebuf = *prebuf;
+        if (postbuf)
+                cfop->postbuf = *postbuf;
+
+        local->next++;
+        default_compound_resume_next (frame, this);
+        return 0;
+}
+
+static int32_t
+default_compound_flush_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno)
+{
+        return default_compound_fop_cbk (frame, cookie, this, op_ret,
+                                         op_errno, NULL, NULL);
+}
+
+static int32_t
+default_compound_create_cbk (call_frame_t *frame, void *cookie,
+                             xlator_t *this, int32_t op_ret, int32_t op_errno,
+                             fd_t *fd, inode_t *inode, struct iatt *buf,
+                             struct iatt *preparent, struct iatt *postparent)
+{
+        default_compound_local_t *local = NULL;
+        compound_fop_t           *cfop  = NULL;
+
+        local = frame->local;
+        cfop = &local->args->fops[local->next];
+
+        if (op_ret == -1)
+                local->create_errno = op_errno;
+        else if (buf)
+                cfop->buf = *buf;
+
+        return default_compound_fop_cbk (frame, cookie, this, op_ret,
+                                         op_errno, preparent, postparent);
+}
+
+static int32_t
+default_compound_resume_next (call_frame_t *frame, xlator_t *this)
+{
+        default_compound_local_t *local = NULL;
+        compound_args_t          *args  = NULL;
+        compound_fop_t           *cfop  = NULL;
+
+        local = frame->local;
+        args = local->args;
+
+        while (local->next < args->count) {
+                cfop = &args->fops[local->next];
+
+                if (local->create_errno) {
+                        cfop->op_ret = -1;
+                        cfop->op_errno = local->create_errno;
+                        local->next++;
+                        continue;
+                }
+
+                switch (cfop->fop) {
+                case GF_FOP_CREATE:
+                        STACK_WIND (frame, default_compound_create_cbk, this,
+                                    this->fops->create, &cfop->loc,
+                                    cfop->flags, cfop->mode, local->fd,
+                                    cfop->params);
+                        return 0;
+                case GF_FOP_WRITE:
+                        STACK_WIND (frame, default_compound_fop_cbk, this,
+                                    this->fops->writev, local->fd,
+                                    cfop->vector, cfop->count, cfop->offset,
+                                    args->iobref);
+                        return 0;
+                case GF_FOP_FLUSH:
+                        STACK_WIND (frame, default_compound_flush_cbk, this,
+                                    this->fops->flush, local->fd);
+                        return 0;
+                case GF_FOP_FSYNC:
+                        STACK_WIND (frame, default_compound_fop_cbk, this,
+                                    this->fops->fsync, local->fd,
+                                    cfop->datasync);
+                        return 0;
+                default:
+                        cfop->op_ret = -1;
+                        cfop->op_errno = ENOTSUP;
+                        local->next++;
+                        break;
+                }
+        }
+
+        frame->local = NULL;
+        fd_unref (local->fd);
+        GF_FREE (local);
+
+        STACK_UNWIND_STRICT (compound, frame, 0, 0, args);
+        return 0;
+}
+
+/* whether the translator implements any of the operations of the list */
+static gf_boolean_t
+default_compound_intercepted (xlator_t *this, compound_args_t *args)
+{
+        int32_t i = 0;
+
+        if ((this->fops->writev != default_writev)
+            || (this->fops->flush != default_flush)
+            || (this->fops->fsync != default_fsync))
+                return _gf_true;
+
+        for (i = 0; i < args->count; i++) {
+                if ((args->fops[i].fop == GF_FOP_CREATE)
+                    && (this->fops->create != default_create))
+                        return _gf_true;
+        }
+
+        return _gf_false;
+}
+
+int32_t
+default_compound (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                  compound_args_t *args)
+{
+        default_compound_local_t *local = NULL;
+
+        if (!default_compound_intercepted (this, args)) {
+                STACK_WIND (frame, default_compound_cbk, FIRST_CHILD(this),
+                            FIRST_CHILD(this)->fops->compound, fd, args);
+                return 0;
+        }
+
+        local = GF_CALLOC (1, sizeof (*local), gf_common_mt_compound_local_t);
+        if (!local) {
+                STACK_UNWIND_STRICT (compound, frame, -1, ENOMEM, args);
+                return 0;
+        }
+
+        local->fd = fd_ref (fd);
+        local->args = args;
+        frame->local = local;
+
+        default_compound_resume_next (frame, this);
+        return 0;
+}
+
 /* notify */
 int
 default_notify (xlator_t *this, int32_t event, void *data, ...)
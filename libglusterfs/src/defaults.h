@@ -43,6 +43,11 @@ int32_t default_rchecksum (call_frame_t *frame,
                            fd_t *fd, off_t offset,
                            int32_t len);
 
+int32_t default_compound (call_frame_t *frame,
+                          xlator_t *this,
+                          fd_t *fd,
+                          compound_args_t *args);
+
 /* FileSystem operations */
 int32_t default_lookup (call_frame_t *frame,
                         xlator_t *this,
@@ -674,6 +679,10 @@ int32_t
 default_getspec_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                      int32_t op_ret, int32_t op_errno, char *spec_data);
 
+int32_t
+default_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, compound_args_t *args);
+
 int32_t
 default_mem_acct_init (xlator_t *this);
 
@@ -0,0 +1,420 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * Per-thread rings of wind/unwind events, see fop-trace.h.
+ */
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "glusterfs.h"
+#include "stack.h"
+#include "xlator.h"
+#include "common-utils.h"
+#include "fop-trace.h"
+
+
+/* where each fop lives in struct xlator_fops */
+static struct {
+        size_t           offset;
+        glusterfs_fop_t  fop;
+} gf_fop_slots[] = {
+        { offsetof (struct xlator_fops, lookup),      GF_FOP_LOOKUP },
+        { offsetof (struct xlator_fops, stat),        GF_FOP_STAT },
+        { offsetof (struct xlator_fops, fstat),       GF_FOP_FSTAT },
+        { offsetof (struct xlator_fops, truncate),    GF_FOP_TRUNCATE },
+        { offsetof (struct xlator_fops, ftruncate),   GF_FOP_FTRUNCATE },
+        { offsetof (struct xlator_fops, access),      GF_FOP_ACCESS },
+        { offsetof (struct xlator_fops, readlink),    GF_FOP_READLINK },
+        { offsetof (struct xlator_fops, mknod),       GF_FOP_MKNOD },
+        { offsetof (struct xlator_fops, mkdir),       GF_FOP_MKDIR },
+        { offsetof (struct xlator_fops, unlink),      GF_FOP_UNLINK },
+        { offsetof (struct xlator_fops, rmdir),       GF_FOP_RMDIR },
+        { offsetof (struct xlator_fops, symlink),     GF_FOP_SYMLINK },
+        { offsetof (struct xlator_fops, rename),      GF_FOP_RENAME },
+        { offsetof (struct xlator_fops, link),        GF_FOP_LINK },
+        { offsetof (struct xlator_fops, create),      GF_FOP_CREATE },
+        { offsetof (struct xlator_fops, open),        GF_FOP_OPEN },
+        { offsetof (struct xlator_fops, readv),       GF_FOP_READ },
+        { offsetof (struct xlator_fops, writev),      GF_FOP_WRITE },
+        { offsetof (struct xlator_fops, flush),       GF_FOP_FLUSH },
+        { offsetof (struct xlator_fops, fsync),       GF_FOP_FSYNC },
+        { offsetof (struct xlator_fops, opendir),     GF_FOP_OPENDIR },
+        { offsetof (struct xlator_fops, readdir),     GF_FOP_READDIR },
+        { offsetof (struct xlator_fops, readdirp),    GF_FOP_READDIRP },
+        { offsetof (struct xlator_fops, fsyncdir),    GF_FOP_FSYNCDIR },
+        { offsetof (struct xlator_fops, statfs),      GF_FOP_STATFS },
+        { offsetof (struct xlator_fops, setxattr),    GF_FOP_SETXATTR },
+        { offsetof (struct xlator_fops, getxattr),    GF_FOP_GETXATTR },
+        { offsetof (struct xlator_fops, fsetxattr),   GF_FOP_FSETXATTR },
+        { offsetof (struct xlator_fops, fgetxattr),   GF_FOP_FGETXATTR },
+        { offsetof (struct xlator_fops, removexattr), GF_FOP_REMOVEXATTR },
+        { offsetof (struct xlator_fops, lk),          GF_FOP_LK },
+        { offsetof (struct xlator_fops, inodelk),     GF_FOP_INODELK },
+        { offsetof (struct xlator_fops, finodelk),    GF_FOP_FINODELK },
+        { offsetof (struct xlator_fops, entrylk),     GF_FOP_ENTRYLK },
+        { offsetof (struct xlator_fops, fentrylk),    GF_FOP_FENTRYLK },
+        { offsetof (struct xlator_fops, rchecksum),   GF_FOP_RCHECKSUM },
+        { offsetof (struct xlator_fops, xattrop),     GF_FOP_XATTROP },
+        { offsetof (struct xlator_fops, fxattrop),    GF_FOP_FXATTROP },
+        { offsetof (struct xlator_fops, setattr),     GF_FOP_SETATTR },
+        { offsetof (struct xlator_fops, fsetattr),    GF_FOP_FSETATTR },
+        { offsetof (struct xlator_fops, getspec),     GF_FOP_GETSPEC },
+        { offsetof (struct xlator_fops, compound),    GF_FOP_COMPOUND },
+        { 0, GF_FOP_NULL }
+};
+
+#define GF_FOP_SLOT_COUNT (sizeof (struct xlator_fops) / sizeof (void *))
+
+static glusterfs_fop_t   gf_fop_by_slot[GF_FOP_SLOT_COUNT];
+
+static pthread_key_t     gf_fop_trace_key;
+static pthread_mutex_t   gf_fop_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct list_head  gf_fop_trace_rings = {&gf_fop_trace_rings,
+                                               &gf_fop_trace_rings};
+
+
+/* a thread going away hands its ring over to the next new thread, records
+   and all, so that they still make it into the dump */
+static void
+gf_fop_trace_ring_release (void *ptr)
+{
+        struct gf_fop_trace_ring *ring = ptr;
+
+        pthread_mutex_lock (&gf_fop_trace_lock);
+        {
+                ring->tid = 0;
+        }
+        pthread_mutex_unlock (&gf_fop_trace_lock);
+}
+
+
+int
+gf_fop_trace_init (void)
+{
+        int i = 0;
+
+        for (i = 0; i < GF_FOP_SLOT_COUNT; i++)
+                gf_fop_by_slot[i] = -1;
+
+        for (i = 0; gf_fop_slots[i].fop != GF_FOP_NULL; i++)
+                gf_fop_by_slot[gf_fop_slots[i].offset / sizeof (void *)] =
+                        gf_fop_slots[i].fop;
+
+        return pthread_key_create (&gf_fop_trace_key,
+                                   gf_fop_trace_ring_release);
+}
+
+
+glusterfs_fop_t
+gf_fop_from_fn_pointer (struct xlator_fops *fops, void *fn)
+{
+        int i = 0;
+
+        for (i = 0; gf_fop_slots[i].fop != GF_FOP_NULL; i++) {
+                if (*(void **)((char *)fops + gf_fop_slots[i].offset) == fn)
+                        return gf_fop_slots[i].fop;
+        }
+
+        return -1;
+}
+
+
+/* STACK_WIND hands over the address of the fop it calls, which normally is
+   a member of the callee's fops: its position tells the fop right away */
+static glusterfs_fop_t
+gf_fop_from_member (struct xlator_fops *fops, void *member)
+{
+        uintptr_t offset = 0;
+
+        offset = (uintptr_t)member - (uintptr_t)fops;
+        if ((offset < sizeof (*fops)) && !(offset % sizeof (void *)))
+                return gf_fop_by_slot[offset / sizeof (void *)];
+
+        /* called by name, not through the fops table */
+        return gf_fop_from_fn_pointer (fops, member);
+}
+
+
+static uint64_t
+gf_fop_trace_now (void)
+{
+#ifdef CLOCK_MONOTONIC
+        struct timespec ts = {0, };
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+
+        return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#else
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+
+        return ((uint64_t)tv.tv_sec * 1000000000) + (tv.tv_usec * 1000);
+#endif
+}
+
+
+static struct gf_fop_trace_ring *
+gf_fop_trace_ring_get (void)
+{
+        struct gf_fop_trace_ring *ring = NULL;
+        struct gf_fop_trace_ring *tmp  = NULL;
+
+        ring = pthread_getspecific (gf_fop_trace_key);
+        if (ring)
+                return ring;
+
+        pthread_mutex_lock (&gf_fop_trace_lock);
+        {
+                list_for_each_entry (tmp, &gf_fop_trace_rings, list) {
+                        if (!tmp->tid) {
+                                ring = tmp;
+                                break;
+                        }
+                }
+
+                if (!ring) {
+                        ring = CALLOC (1, sizeof (*ring));
+                        if (ring)
+                                list_add_tail (&ring->list,
+                                               &gf_fop_trace_rings);
+                }
+
+                if (ring)
+                        ring->tid = (uint64_t) pthread_self ();
+        }
+        pthread_mutex_unlock (&gf_fop_trace_lock);
+
+        if (ring)
+                pthread_setspecific (gf_fop_trace_key, ring);
+
+        return ring;
+}
+
+
+static void
+gf_fop_trace_record (call_frame_t *frame, glusterfs_fop_t fop, int event)
+{
+        struct gf_fop_trace_ring *ring = NULL;
+        struct gf_fop_trace_rec  *rec  = NULL;
+
+        ring = gf_fop_trace_ring_get ();
+        if (!ring)
+                return;
+
+        /* only this thread writes to the ring, no locking needed */
+        rec = &ring->recs[ring->head % GF_FOP_TRACE_RING_SIZE];
+        rec->ns     = gf_fop_trace_now ();
+        rec->frame  = (uint64_t)(long) frame;
+        rec->parent = (uint64_t)(long) frame->parent;
+        rec->xl     = (uint64_t)(long) frame->this;
+        rec->fop    = fop;
+        rec->event  = event;
+
+        ring->head++;
+}
+
+
+void
+gf_fop_trace_wind (call_frame_t *frame, void *member)
+{
+        frame->op = gf_fop_from_member (frame->this->fops, member);
+
+        gf_fop_trace_record (frame, frame->op, GF_FOP_TRACE_WIND);
+}
+
+
+void
+gf_fop_trace_unwind (call_frame_t *frame)
+{
+        gf_fop_trace_record (frame, frame->op, GF_FOP_TRACE_UNWIND);
+}
+
+
+static int
+gf_fop_trace_write_name (FILE *fp, uint64_t id, const char *name)
+{
+        struct gf_fop_trace_name entry = {0, };
+
+        entry.id = id;
+        if (name)
+                strncpy (entry.name, name, GF_FOP_TRACE_NAME_LEN - 1);
+
+        return (fwrite (&entry, sizeof (entry), 1, fp) == 1) ? 0 : -1;
+}
+
+
+/*
+ * The rings are read while their threads may still be finishing a record,
+ * so the last few entries of a ring can be torn. That is fine for what the
+ * dump is used for.
+ */
+int
+gf_fop_trace_dump (void)
+{
+        glusterfs_ctx_t              *ctx      = NULL;
+        xlator_t                     *trav     = NULL;
+        struct gf_fop_trace_ring     *ring     = NULL;
+        struct gf_fop_trace_hdr       hdr      = {0, };
+        struct gf_fop_trace_ring_hdr  ring_hdr = {0, };
+        char                          path[PATH_MAX] = {0, };
+        FILE                         *fp       = NULL;
+        uint64_t                      start    = 0;
+        uint64_t                      idx      = 0;
+        int                           i        = 0;
+        int                           ret      = -1;
+
+        ctx = glusterfs_ctx_get ();
+        if (!ctx)
+                goto out;
+
+        if (ctx->cmd_args.fop_trace_file)
+                snprintf (path, sizeof (path), "%s",
+                          ctx->cmd_args.fop_trace_file);
+        else
+                snprintf (path, sizeof (path), "%s.%d",
+                          GF_FOP_TRACE_FILE_ROOT, getpid ());
+
+        fp = fopen (path, "w");
+        if (!fp) {
+                gf_log ("", GF_LOG_ERROR, "failed to open %s: %s",
+                        path, strerror (errno));
+                goto out;
+        }
+
+        hdr.magic     = GF_FOP_TRACE_MAGIC;
+        hdr.version   = GF_FOP_TRACE_VERSION;
+        hdr.rec_size  = sizeof (struct gf_fop_trace_rec);
+        hdr.fop_count = GF_FOP_MAXVALUE;
+
+        if (ctx->active)
+                hdr.xl_count = ctx->active->xl_count;
+
+        pthread_mutex_lock (&gf_fop_trace_lock);
+        {
+                list_for_each_entry (ring, &gf_fop_trace_rings, list)
+                        hdr.ring_count++;
+
+                ret = -1;
+                if (fwrite (&hdr, sizeof (hdr), 1, fp) != 1)
+                        goto unlock;
+
+                i = 0;
+                if (ctx->active)
+                        trav = ctx->active->first;
+                for (; trav && (i < hdr.xl_count); trav = trav->next, i++) {
+                        if (gf_fop_trace_write_name (fp, (uint64_t)(long) trav,
+                                                     trav->name))
+                                goto unlock;
+                }
+                /* keep the header honest if the graph was shorter */
+                for (; i < hdr.xl_count; i++) {
+                        if (gf_fop_trace_write_name (fp, 0, NULL))
+                                goto unlock;
+                }
+
+                for (i = 0; i < GF_FOP_MAXVALUE; i++) {
+                        if (gf_fop_trace_write_name (fp, i, gf_fop_list[i]))
+                                goto unlock;
+                }
+
+                list_for_each_entry (ring, &gf_fop_trace_rings, list) {
+                        ring_hdr.tid   = ring->tid;
+                        ring_hdr.count = min (ring->head,
+                                              GF_FOP_TRACE_RING_SIZE);
+                        start = ring->head - ring_hdr.count;
+
+                        if (fwrite (&ring_hdr, sizeof (ring_hdr), 1, fp) != 1)
+                                goto unlock;
+
+                        for (idx = start; idx < (start + ring_hdr.count);
+                             idx++) {
+                                if (fwrite (&ring->recs[idx %
+                                                 GF_FOP_TRACE_RING_SIZE],
+                                            sizeof (struct gf_fop_trace_rec),
+                                            1, fp) != 1)
+                                        goto unlock;
+                        }
+                }
+
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&gf_fop_trace_lock);
+
+        if (fclose (fp))
+                ret = -1;
+
+        if (ret)
+                gf_log ("", GF_LOG_ERROR, "failed to write fop trace to %s",
+                        path);
+        else
+                gf_log ("", GF_LOG_INFO, "wrote fop trace to %s", path);
+out:
+        return ret;
+}
+
+
+static void
+gf_fop_trace_reset (void)
+{
+        struct gf_fop_trace_ring *ring = NULL;
+
+        pthread_mutex_lock (&gf_fop_trace_lock);
+        {
+                list_for_each_entry (ring, &gf_fop_trace_rings, list)
+                        ring->head = 0;
+        }
+        pthread_mutex_unlock (&gf_fop_trace_lock);
+}
+
+
+/*
+ * Switching tracing on starts from empty rings; switching it off writes
+ * the rings out.
+ */
+void
+gf_fop_trace_set (int on)
+{
+        glusterfs_ctx_t *ctx = NULL;
+
+        ctx = glusterfs_ctx_get ();
+        if (!ctx || (!!ctx->fop_trace == !!on))
+                return;
+
+        if (on)
+                gf_fop_trace_reset ();
+
+        ctx->fop_trace = !!on;
+
+        gf_log ("[core]", GF_LOG_INFO, "Fop tracing turned %s",
+                ctx->fop_trace ? "on" : "off");
+
+        if (!ctx->fop_trace)
+                gf_fop_trace_dump ();
+}
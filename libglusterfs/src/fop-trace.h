@@ -0,0 +1,100 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __FOP_TRACE_H__
+#define __FOP_TRACE_H__
+
+#include <stdint.h>
+
+#include "list.h"
+
+/*
+ * Wind/unwind tracing: every STACK_WIND and STACK_UNWIND appends a record
+ * to a fixed size ring owned by the calling thread. The rings are written
+ * out in binary when tracing is switched off, and extras/fop-trace-decode.py
+ * turns the dump into per-translator self-time. Tracing is started either
+ * with --fop-trace or at runtime through the io-stats 'fop-trace' option.
+ */
+
+#define GF_FOP_TRACE_RING_SIZE  16384     /* records per thread */
+
+#define GF_FOP_TRACE_FILE_ROOT  "/tmp/glusterfs-fop-trace"
+
+#define GF_FOP_TRACE_MAGIC      0x47465452  /* "GFTR" */
+#define GF_FOP_TRACE_VERSION    1
+#define GF_FOP_TRACE_NAME_LEN   64
+
+typedef enum {
+        GF_FOP_TRACE_WIND = 1,
+        GF_FOP_TRACE_UNWIND,
+} gf_fop_trace_event_t;
+
+/* All the integers in the dump are in host byte order. */
+struct gf_fop_trace_rec {
+        uint64_t ns;            /* CLOCK_MONOTONIC */
+        uint64_t frame;
+        uint64_t parent;        /* frame that wound it */
+        uint64_t xl;            /* translator the frame was wound to */
+        int32_t  fop;
+        int32_t  event;
+};
+
+struct gf_fop_trace_ring {
+        struct list_head         list;
+        uint64_t                 tid;
+        uint64_t                 head;  /* records ever written */
+        struct gf_fop_trace_rec  recs[GF_FOP_TRACE_RING_SIZE];
+};
+
+/*
+ * Dump layout:
+ *   struct gf_fop_trace_hdr
+ *   hdr.xl_count  x struct gf_fop_trace_name  (id is the xlator)
+ *   hdr.fop_count x struct gf_fop_trace_name  (id is the fop)
+ *   hdr.ring_count x { struct gf_fop_trace_ring_hdr, count records }
+ */
+struct gf_fop_trace_hdr {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t rec_size;
+        uint32_t xl_count;
+        uint32_t fop_count;
+        uint32_t ring_count;
+};
+
+struct gf_fop_trace_name {
+        uint64_t id;
+        char     name[GF_FOP_TRACE_NAME_LEN];
+};
+
+struct gf_fop_trace_ring_hdr {
+        uint64_t tid;
+        uint64_t count;
+};
+
+int
+gf_fop_trace_init (void);
+
+void
+gf_fop_trace_set (int on);
+
+int
+gf_fop_trace_dump (void);
+
+#endif /* __FOP_TRACE_H__ */
@@ -28,6 +28,7 @@
 #include "globals.h"
 #include "xlator.h"
 #include "mem-pool.h"
+#include "fop-trace.h"
 
 
 /* gf_*_list[] */
@@ -81,6 +82,7 @@ gf_op_list_init()
         gf_fop_list[GF_FOP_FSETATTR]    = "FSETATTR";
         gf_fop_list[GF_FOP_READDIRP]    = "READDIRP";
         gf_fop_list[GF_FOP_GETSPEC]     = "GETSPEC";
+        gf_fop_list[GF_FOP_COMPOUND]    = "COMPOUND";
         gf_fop_list[GF_FOP_FORGET]      = "FORGET";
         gf_fop_list[GF_FOP_RELEASE]     = "RELEASE";
         gf_fop_list[GF_FOP_RELEASEDIR]  = "RELEASEDIR";
@@ -328,6 +330,13 @@ glusterfs_globals_init ()
                         "ERROR: glusterfs synctask init failed");
                 goto out;
         }
+
+        ret = gf_fop_trace_init ();
+        if (ret) {
+                gf_log ("", GF_LOG_CRITICAL,
+                        "ERROR: glusterfs fop trace init failed");
+                goto out;
+        }
 out:
         return ret;
 }
@@ -154,6 +154,7 @@ typedef enum {
         GF_FOP_RELEASE,
         GF_FOP_RELEASEDIR,
         GF_FOP_GETSPEC,
+        GF_FOP_COMPOUND,
         GF_FOP_MAXVALUE,
 } glusterfs_fop_t;
 
@@ -299,6 +300,10 @@ struct _cmd_args {
         int             brick_port;
         char           *brick_name;
         int             brick_port2;
+
+        /* wind/unwind tracing */
+        int             fop_trace;
+        char           *fop_trace_file;
 };
 typedef struct _cmd_args cmd_args_t;
 
@@ -336,6 +341,7 @@ struct _glusterfs_ctx {
         void               *mgmt;   /* xlator implementing MOPs for centralized logging, volfile server */
         void               *listener; /* listener of the commands from glusterd */
         unsigned char       measure_latency; /* toggle switch for latency measurement */
+        unsigned char       fop_trace; /* toggle switch for wind/unwind tracing */
         pthread_t           sigwaiter;
         struct mem_pool    *stub_mem_pool;
         unsigned char       cleanup_started;
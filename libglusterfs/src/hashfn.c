@@ -194,3 +194,94 @@ gf_dm_hashfn (const char *msg, int len)
 
         return h0 ^ h1;
 }
+
+
+/*
+  xxHash32, by Yann Collet <http://code.google.com/p/xxhash/>.
+
+  Four independent lanes over 16 byte stripes, so the main loop pipelines
+  well, and far fewer rounds than Davies-Meyer for short names. Input words
+  are read little-endian whatever the host, as the hash ends up in layouts
+  stored on disk.
+*/
+
+#define XXH_PRIME32_1 2654435761U
+#define XXH_PRIME32_2 2246822519U
+#define XXH_PRIME32_3 3266489917U
+#define XXH_PRIME32_4  668265263U
+#define XXH_PRIME32_5  374761393U
+
+#define xxh_rotl32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+static inline uint32_t
+xxh_read32 (const unsigned char *p)
+{
+        return ((uint32_t) p[0]) | ((uint32_t) p[1] << 8)
+                | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint32_t
+xxh_round (uint32_t acc, uint32_t input)
+{
+        acc += input * XXH_PRIME32_2;
+        acc  = xxh_rotl32 (acc, 13);
+        acc *= XXH_PRIME32_1;
+
+        return acc;
+}
+
+uint32_t
+gf_xxh32_hashfn (const char *msg, int len)
+{
+        const unsigned char *p = (const unsigned char *) msg;
+        const unsigned char *end = p + len;
+        const unsigned char *limit = NULL;
+        uint32_t             v1 = 0;
+        uint32_t             v2 = 0;
+        uint32_t             v3 = 0;
+        uint32_t             v4 = 0;
+        uint32_t             hash = 0;
+
+        if (len >= 16) {
+                limit = end - 16;
+                v1 = XXH_PRIME32_1 + XXH_PRIME32_2;
+                v2 = XXH_PRIME32_2;
+                v3 = 0;
+                v4 = -XXH_PRIME32_1;
+
+                do {
+                        v1 = xxh_round (v1, xxh_read32 (p));
+                        v2 = xxh_round (v2, xxh_read32 (p + 4));
+                        v3 = xxh_round (v3, xxh_read32 (p + 8));
+                        v4 = xxh_round (v4, xxh_read32 (p + 12));
+                        p += 16;
+                } while (p <= limit);
+
+                hash = xxh_rotl32 (v1, 1) + xxh_rotl32 (v2, 7)
+                        + xxh_rotl32 (v3, 12) + xxh_rotl32 (v4, 18);
+        } else {
+                hash = XXH_PRIME32_5;
+        }
+
+        hash += (uint32_t) len;
+
+        while (p + 4 <= end) {
+                hash += xxh_read32 (p) * XXH_PRIME32_3;
+                hash  = xxh_rotl32 (hash, 17) * XXH_PRIME32_4;
+                p += 4;
+        }
+
+        while (p < end) {
+                hash += (*p) * XXH_PRIME32_5;
+                hash  = xxh_rotl32 (hash, 11) * XXH_PRIME32_1;
+                p++;
+        }
+
+        hash ^= hash >> 15;
+        hash *= XXH_PRIME32_2;
+        hash ^= hash >> 13;
+        hash *= XXH_PRIME32_3;
+        hash ^= hash >> 16;
+
+        return hash;
+}
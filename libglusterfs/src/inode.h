@@ -170,10 +170,18 @@ inode_ctx_get (inode_t *inode, xlator_t *xlator, uint64_t *value);
 int
 inode_ctx_del (inode_t *inode, xlator_t *xlator, uint64_t *value);
 
+int
+__inode_ctx_put2 (inode_t *inode, xlator_t *xlator, uint64_t value1,
+                  uint64_t value2);
+
 int
 inode_ctx_put2 (inode_t *inode, xlator_t *xlator, uint64_t value1,
                 uint64_t value2);
 
+int
+__inode_ctx_get2 (inode_t *inode, xlator_t *xlator, uint64_t *value1,
+                  uint64_t *value2);
+
 int
 inode_ctx_get2 (inode_t *inode, xlator_t *xlator, uint64_t *value1,
                 uint64_t *value2);
@@ -99,6 +99,13 @@ enum gf_common_mem_types_ {
         gf_common_mt_rpcclnt_cb_program_t = 74,
         gf_common_mt_libxl_marker_local   = 75,
         gf_common_mt_int32_t              = 76,
-        gf_common_mt_end                  = 77
+        gf_common_mt_compound_local_t     = 77,
+        gf_common_mt_compound_fop_t       = 78,
+        gf_common_mt_rpcsvc_drc_t         = 79,
+        gf_common_mt_rpcsvc_drc_entry_t   = 80,
+        gf_common_mt_rpcsvc_addr_auth_t   = 81,
+        gf_common_mt_rpcsvc_addr_rules_t  = 82,
+        gf_common_mt_rpcsvc_addr_rule_t   = 83,
+        gf_common_mt_end                  = 84
 };
 #endif
@@ -151,9 +151,11 @@ void
 gf_proc_dump_pending_frames (call_pool_t *call_pool)
 {
 
-        call_stack_t     *trav = NULL;
-        int              i = 1;
-        int              ret = -1;
+        call_pool_thread_t *thread = NULL;
+        call_stack_t       *trav = NULL;
+        int64_t             cnt = 0;
+        int                 i = 1;
+        int                 ret = -1;
 
         if (!call_pool)
                 return;
@@ -165,20 +167,155 @@ gf_proc_dump_pending_frames (call_pool_t *call_pool)
                 return;
         }
 
+        list_for_each_entry (thread, &call_pool->threads, threads)
+                cnt += thread->cnt;
 
         gf_proc_dump_add_section("global.callpool");
         gf_proc_dump_write("global.callpool","%p", call_pool);
-        gf_proc_dump_write("global.callpool.cnt","%d", call_pool->cnt);
+        gf_proc_dump_write("global.callpool.cnt","%"PRId64, cnt);
 
 
-        list_for_each_entry (trav, &call_pool->all_frames, all_frames) {
-                gf_proc_dump_add_section("global.callpool.stack.%d",i);
-                gf_proc_dump_call_stack(trav, "global.callpool.stack.%d", i);
-                i++;
+        list_for_each_entry (thread, &call_pool->threads, threads) {
+                ret = TRY_LOCK (&thread->lock);
+                if (ret) {
+                        gf_log ("", GF_LOG_WARNING, "Unable to dump call "
+                                "stacks of thread list %p errno: %d",
+                                thread, errno);
+                        continue;
+                }
+
+                list_for_each_entry (trav, &thread->all_stacks, all_frames) {
+                        gf_proc_dump_add_section("global.callpool.stack.%d",i);
+                        gf_proc_dump_call_stack(trav,
+                                                "global.callpool.stack.%d", i);
+                        i++;
+                }
+                UNLOCK (&thread->lock);
         }
         UNLOCK (&(call_pool->lock));
 }
 
+
+static void
+call_pool_thread_init (call_pool_t *pool, call_pool_thread_t *thread)
+{
+        INIT_LIST_HEAD (&thread->all_stacks);
+        INIT_LIST_HEAD (&thread->threads);
+        LOCK_INIT (&thread->lock);
+        thread->pool = pool;
+}
+
+
+/* called at thread exit: give the cached frames and stacks back to the
+   mem_pools and leave the list for the next thread to take over */
+static void
+call_pool_thread_release (void *data)
+{
+        call_pool_thread_t *thread = data;
+        call_pool_t        *pool = NULL;
+        call_frame_t       *frame = NULL;
+        call_stack_t       *stack = NULL;
+
+        if (!thread)
+                return;
+
+        pool = thread->pool;
+
+        while ((frame = thread->frame_cache)) {
+                thread->frame_cache = frame->next;
+                mem_put (pool->frame_mem_pool, frame);
+        }
+        thread->frame_cache_cnt = 0;
+
+        while ((stack = thread->stack_cache)) {
+                thread->stack_cache = stack->next_call;
+                mem_put (pool->stack_mem_pool, stack);
+        }
+        thread->stack_cache_cnt = 0;
+
+        LOCK (&pool->lock);
+        {
+                thread->in_use = _gf_false;
+        }
+        UNLOCK (&pool->lock);
+}
+
+
+int
+call_pool_init (call_pool_t *pool)
+{
+        int ret = -1;
+
+        INIT_LIST_HEAD (&pool->threads);
+        LOCK_INIT (&pool->lock);
+
+        ret = pthread_key_create (&pool->thread_key,
+                                  call_pool_thread_release);
+        if (ret) {
+                gf_log ("stack", GF_LOG_ERROR,
+                        "failed to create the call pool thread key");
+                goto out;
+        }
+
+        call_pool_thread_init (pool, &pool->shared);
+        pool->shared.in_use = _gf_true;
+        list_add (&pool->shared.threads, &pool->threads);
+out:
+        return ret;
+}
+
+
+/* slow path of call_pool_thread_get(): first stack created by this thread */
+call_pool_thread_t *
+call_pool_thread_new (call_pool_t *pool)
+{
+        call_pool_thread_t *thread = NULL;
+        call_pool_thread_t *trav = NULL;
+        int                 ret = -1;
+
+        LOCK (&pool->lock);
+        {
+                list_for_each_entry (trav, &pool->threads, threads) {
+                        if (!trav->in_use) {
+                                trav->in_use = _gf_true;
+                                thread = trav;
+                                break;
+                        }
+                }
+        }
+        UNLOCK (&pool->lock);
+
+        if (!thread) {
+                /* never freed, stacks may outlive the thread */
+                thread = CALLOC (1, sizeof (*thread));
+                if (!thread)
+                        return &pool->shared;
+
+                call_pool_thread_init (pool, thread);
+                thread->in_use = _gf_true;
+
+                LOCK (&pool->lock);
+                {
+                        list_add_tail (&thread->threads, &pool->threads);
+                }
+                UNLOCK (&pool->lock);
+        }
+
+        ret = pthread_setspecific (pool->thread_key, thread);
+        if (ret) {
+                LOCK (&pool->lock);
+                {
+                        thread->in_use = _gf_false;
+                }
+                UNLOCK (&pool->lock);
+
+                return &pool->shared;
+        }
+
+        return thread;
+}
+
+
 gf_boolean_t
 __is_fuse_call (call_frame_t *frame)
 {
@@ -36,6 +36,8 @@ struct _call_frame_t;
 typedef struct _call_frame_t call_frame_t;
 struct _call_pool_t;
 typedef struct _call_pool_t call_pool_t;
+struct _call_pool_thread_t;
+typedef struct _call_pool_thread_t call_pool_thread_t;
 
 #include <sys/time.h>
 
@@ -53,16 +55,36 @@ typedef int32_t (*ret_fn_t) (call_frame_t *frame,
                              int32_t op_errno,
                              ...);
 
-struct _call_pool_t {
-        union {
-                struct list_head   all_frames;
-                struct {
-                        call_stack_t *next_call;
-                        call_stack_t *prev_call;
-                } all_stacks;
-        };
+/* number of freed frames/stacks a thread keeps for its own reuse before
+   handing them back to the pool's mem_pools */
+#define GF_CALL_POOL_FRAME_CACHE 128
+#define GF_CALL_POOL_STACK_CACHE 32
+
+/* The stacks created by one thread of a call pool. A stack stays on the
+   list of the thread which created it and is unlinked under that list's
+   lock, which is contended only when another thread destroys it. The
+   frame and stack caches are touched by the owning thread alone. Once
+   the thread exits the structure is left on pool->threads (stacks may
+   still point to it) and is taken over by the next new thread.
+*/
+struct _call_pool_thread_t {
+        struct list_head            all_stacks;
+        struct list_head            threads;    /* in pool->threads */
         int64_t                     cnt;
         gf_lock_t                   lock;
+        call_pool_t                *pool;
+        gf_boolean_t                in_use;
+        call_frame_t               *frame_cache;
+        int                         frame_cache_cnt;
+        call_stack_t               *stack_cache;
+        int                         stack_cache_cnt;
+};
+
+struct _call_pool_t {
+        struct list_head            threads;
+        gf_lock_t                   lock;       /* protects threads */
+        pthread_key_t               thread_key;
+        call_pool_thread_t          shared;     /* when a thread has none */
         struct mem_pool             *frame_mem_pool;
         struct mem_pool             *stack_mem_pool;
 };
@@ -98,6 +120,7 @@ struct _call_stack_t {
                 };
         };
         call_pool_t                  *pool;
+        call_pool_thread_t           *thread; /* list the stack is on */
         void                         *trans;
         uint64_t                      unique;
         void                         *state;  /* pointer to request state */
@@ -134,6 +157,124 @@ gf_set_fop_from_fn_pointer (call_frame_t *frame, struct xlator_fops *fops,
 void
 gf_update_latency (call_frame_t *frame);
 
+glusterfs_fop_t
+gf_fop_from_fn_pointer (struct xlator_fops *fops, void *fn);
+
+void
+gf_fop_trace_wind (call_frame_t *frame, void *member);
+
+void
+gf_fop_trace_unwind (call_frame_t *frame);
+
+#define FOP_TRACE_ON(xl) ((xl)->ctx && (xl)->ctx->fop_trace)
+
+int
+call_pool_init (call_pool_t *pool);
+
+call_pool_thread_t *
+call_pool_thread_new (call_pool_t *pool);
+
+static inline call_pool_thread_t *
+call_pool_thread_get (call_pool_t *pool)
+{
+        call_pool_thread_t *thread = NULL;
+
+        thread = pthread_getspecific (pool->thread_key);
+        if (!thread)
+                thread = call_pool_thread_new (pool);
+
+        return thread;
+}
+
+
+static inline call_frame_t *
+call_frame_get (call_pool_t *pool)
+{
+        call_pool_thread_t *thread = NULL;
+        call_frame_t       *frame = NULL;
+
+        thread = call_pool_thread_get (pool);
+        if (thread == &pool->shared || !thread->frame_cache)
+                return mem_get0 (pool->frame_mem_pool);
+
+        frame = thread->frame_cache;
+        thread->frame_cache = frame->next;
+        thread->frame_cache_cnt--;
+
+        memset (frame, 0, sizeof (*frame));
+
+        return frame;
+}
+
+
+static inline void
+call_frame_put (call_pool_t *pool, call_frame_t *frame)
+{
+        call_pool_thread_t *thread = NULL;
+
+        thread = call_pool_thread_get (pool);
+        if (thread == &pool->shared
+            || thread->frame_cache_cnt >= GF_CALL_POOL_FRAME_CACHE) {
+                mem_put (pool->frame_mem_pool, frame);
+                return;
+        }
+
+        frame->next = thread->frame_cache;
+        thread->frame_cache = frame;
+        thread->frame_cache_cnt++;
+}
+
+
+static inline call_stack_t *
+call_stack_get (call_pool_t *pool, call_pool_thread_t *thread)
+{
+        call_stack_t *stack = NULL;
+
+        if (thread == &pool->shared || !thread->stack_cache)
+                return mem_get0 (pool->stack_mem_pool);
+
+        stack = thread->stack_cache;
+        thread->stack_cache = stack->next_call;
+        thread->stack_cache_cnt--;
+
+        memset (stack, 0, sizeof (*stack));
+
+        return stack;
+}
+
+
+static inline void
+call_stack_put (call_pool_t *pool, call_stack_t *stack)
+{
+        call_pool_thread_t *thread = NULL;
+
+        thread = call_pool_thread_get (pool);
+        if (thread == &pool->shared
+            || thread->stack_cache_cnt >= GF_CALL_POOL_STACK_CACHE) {
+                mem_put (pool->stack_mem_pool, stack);
+                return;
+        }
+
+        stack->next_call = thread->stack_cache;
+        thread->stack_cache = stack;
+        thread->stack_cache_cnt++;
+}
+
+
+static inline void
+call_stack_link (call_pool_thread_t *thread, call_stack_t *stack)
+{
+        stack->thread = thread;
+
+        LOCK (&thread->lock);
+        {
+                list_add (&stack->all_frames, &thread->all_stacks);
+                thread->cnt++;
+        }
+        UNLOCK (&thread->lock);
+}
+
+
 static inline void
 FRAME_DESTROY (call_frame_t *frame)
 {
@@ -149,7 +290,7 @@ FRAME_DESTROY (call_frame_t *frame)
         }
 
         LOCK_DESTROY (&frame->lock);
-        mem_put (frame->root->pool->frame_mem_pool, frame);
+        call_frame_put (frame->root->pool, frame);
 
         if (local)
                 GF_FREE (local);
@@ -161,12 +302,12 @@ STACK_DESTROY (call_stack_t *stack)
 {
         void *local = NULL;
 
-        LOCK (&stack->pool->lock);
+        LOCK (&stack->thread->lock);
         {
                 list_del_init (&stack->all_frames);
-                stack->pool->cnt--;
+                stack->thread->cnt--;
         }
-        UNLOCK (&stack->pool->lock);
+        UNLOCK (&stack->thread->lock);
 
         if (stack->frames.local) {
                 local = stack->frames.local;
@@ -178,7 +319,7 @@ STACK_DESTROY (call_stack_t *stack)
         while (stack->frames.next) {
                 FRAME_DESTROY (stack->frames.next);
         }
-        mem_put (stack->pool->stack_mem_pool, stack);
+        call_stack_put (stack->pool, stack);
 
         if (local)
                 GF_FREE (local);
@@ -210,7 +351,7 @@ STACK_DESTROY (call_stack_t *stack)
                 call_frame_t *_new = NULL;                              \
                 xlator_t     *old_THIS = NULL;                          \
                                                                         \
-                _new = mem_get0 (frame->root->pool->frame_mem_pool);    \
+                _new = call_frame_get (frame->root->pool);              \
                 if (!_new) {                                            \
                         gf_log ("stack", GF_LOG_ERROR, "alloc failed"); \
                         break;                                          \
@@ -231,6 +372,8 @@ STACK_DESTROY (call_stack_t *stack)
                 _new->wind_to = #fn;                                    \
                 _new->unwind_to = #rfn;                                 \
                 frame->ref_count++;                                     \
+                if (FOP_TRACE_ON (_new->this))                          \
+                        gf_fop_trace_wind (_new, (void *)&(fn));        \
                 old_THIS = THIS;                                        \
                 THIS = obj;                                             \
                 fn (_new, obj, params);                                 \
@@ -244,7 +387,7 @@ STACK_DESTROY (call_stack_t *stack)
                 call_frame_t *_new = NULL;                              \
                 xlator_t     *old_THIS = NULL;                          \
                                                                         \
-                _new = mem_get0 (frame->root->pool->frame_mem_pool);    \
+                _new = call_frame_get (frame->root->pool);              \
                 if (!_new) {                                            \
                         gf_log ("stack", GF_LOG_ERROR, "alloc failed"); \
                         break;                                          \
@@ -266,6 +409,8 @@ STACK_DESTROY (call_stack_t *stack)
                 _new->unwind_to = #rfn;                                 \
                 frame->ref_count++;                                     \
                 fn##_cbk = rfn;                                         \
+                if (FOP_TRACE_ON (_new->this))                          \
+                        gf_fop_trace_wind (_new, (void *)&(fn));        \
                 old_THIS = THIS;                                        \
                 THIS = obj;                                             \
                 fn (_new, obj, params);                                 \
@@ -290,6 +435,8 @@ STACK_DESTROY (call_stack_t *stack)
                 THIS = _parent->this;                                   \
                 frame->complete = _gf_true;                             \
                 frame->unwind_from = __FUNCTION__;                      \
+                if (FOP_TRACE_ON (frame->this))                         \
+                        gf_fop_trace_unwind (frame);                    \
                 fn (_parent, frame->cookie, _parent->this, params);     \
                 THIS = old_THIS;                                        \
         } while (0)
@@ -313,6 +460,8 @@ STACK_DESTROY (call_stack_t *stack)
                 THIS = _parent->this;                                   \
                 frame->complete = _gf_true;                             \
                 frame->unwind_from = __FUNCTION__;                      \
+                if (FOP_TRACE_ON (frame->this))                         \
+                        gf_fop_trace_unwind (frame);                    \
                 fn (_parent, frame->cookie, _parent->this, params);     \
                 THIS = old_THIS;                                        \
         } while (0)
@@ -321,14 +470,16 @@ STACK_DESTROY (call_stack_t *stack)
 static inline call_frame_t *
 copy_frame (call_frame_t *frame)
 {
-        call_stack_t *newstack = NULL;
-        call_stack_t *oldstack = NULL;
+        call_stack_t       *newstack = NULL;
+        call_stack_t       *oldstack = NULL;
+        call_pool_thread_t *thread = NULL;
 
         if (!frame) {
                 return NULL;
         }
 
-        newstack = mem_get0 (frame->root->pool->stack_mem_pool);
+        thread = call_pool_thread_get (frame->root->pool);
+        newstack = call_stack_get (frame->root->pool, thread);
         if (newstack == NULL) {
                 return NULL;
         }
@@ -352,12 +503,7 @@ copy_frame (call_frame_t *frame)
 
         LOCK_INIT (&newstack->frames.lock);
 
-        LOCK (&oldstack->pool->lock);
-        {
-                list_add (&newstack->all_frames, &oldstack->all_frames);
-                newstack->pool->cnt++;
-        }
-        UNLOCK (&oldstack->pool->lock);
+        call_stack_link (thread, newstack);
 
         return &newstack->frames;
 }
@@ -366,13 +512,15 @@ copy_frame (call_frame_t *frame)
 static inline call_frame_t *
 create_frame (xlator_t *xl, call_pool_t *pool)
 {
-        call_stack_t    *stack = NULL;
+        call_stack_t       *stack = NULL;
+        call_pool_thread_t *thread = NULL;
 
         if (!xl || !pool) {
                 return NULL;
         }
 
-        stack = mem_get0 (pool->stack_mem_pool);
+        thread = call_pool_thread_get (pool);
+        stack = call_stack_get (pool, thread);
         if (!stack)
                 return NULL;
 
@@ -380,15 +528,10 @@ create_frame (xlator_t *xl, call_pool_t *pool)
         stack->frames.root = stack;
         stack->frames.this = xl;
 
-        LOCK (&pool->lock);
-        {
-                list_add (&stack->all_frames, &pool->all_frames);
-                pool->cnt++;
-        }
-        UNLOCK (&pool->lock);
-
         LOCK_INIT (&stack->frames.lock);
 
+        call_stack_link (thread, stack);
+
         return &stack->frames;
 }
 
@@ -91,6 +91,7 @@ fill_defaults (xlator_t *xl)
         SET_DEFAULT_FOP (fsetattr);
 
         SET_DEFAULT_FOP (getspec);
+        SET_DEFAULT_FOP (compound);
 
 	SET_DEFAULT_CBK (release);
 	SET_DEFAULT_CBK (releasedir);
@@ -1710,6 +1711,53 @@ loc_wipe (loc_t *loc)
 }
 
 
+compound_args_t *
+compound_args_new (int32_t count)
+{
+        compound_args_t *args = NULL;
+
+        args = GF_CALLOC (1, sizeof (*args), gf_common_mt_compound_fop_t);
+        if (!args)
+                goto out;
+
+        args->fops = GF_CALLOC (count, sizeof (*args->fops),
+                                gf_common_mt_compound_fop_t);
+        if (!args->fops) {
+                GF_FREE (args);
+                args = NULL;
+                goto out;
+        }
+
+        args->count = count;
+out:
+        return args;
+}
+
+
+void
+compound_args_destroy (compound_args_t *args)
+{
+        int32_t i = 0;
+
+        if (!args)
+                return;
+
+        for (i = 0; i < args->count; i++) {
+                if (args->fops[i].vector)
+                        GF_FREE (args->fops[i].vector);
+                if (args->fops[i].params)
+                        dict_unref (args->fops[i].params);
+                loc_wipe (&args->fops[i].loc);
+        }
+
+        if (args->iobref)
+                iobref_unref (args->iobref);
+
+        GF_FREE (args->fops);
+        GF_FREE (args);
+}
+
+
 int
 loc_copy (loc_t *dst, loc_t *src)
 {
@@ -94,6 +94,41 @@ struct _loc {
 };
 
 
+/* A compound fop carries an ordered list of fd based operations (writes,
+ * flushes and fsyncs on the same fd) which a translator may execute in one
+ * go, e.g. protocol/client sends them to the brick in a single RPC. The
+ * list may start with a create, which opens the compound's fd on the new
+ * file; when the create fails, so does everything after it. The
+ * per-operation results are filled in place; the fop itself fails only when
+ * the list could not be carried out at all.
+ */
+typedef struct _compound_fop {
+        glusterfs_fop_t  fop;
+        off_t            offset;
+        struct iovec    *vector;
+        int32_t          count;
+        int32_t          datasync;
+
+        /* create only */
+        loc_t            loc;
+        int32_t          flags;
+        mode_t           mode;
+        dict_t          *params;
+
+        int32_t          op_ret;
+        int32_t          op_errno;
+        struct iatt      prebuf;  /* preparent for create */
+        struct iatt      postbuf; /* postparent for create */
+        struct iatt      buf;     /* the new file, for create */
+} compound_fop_t;
+
+typedef struct _compound_args {
+        int32_t          count;
+        compound_fop_t  *fops;
+        struct iobref   *iobref;
+} compound_args_t;
+
+
 typedef int32_t (*fop_getspec_cbk_t) (call_frame_t *frame,
                                       void *cookie,
                                       xlator_t *this,
@@ -109,6 +144,13 @@ typedef int32_t (*fop_rchecksum_cbk_t) (call_frame_t *frame,
                                         uint32_t weak_checksum,
                                         uint8_t *strong_checksum);
 
+typedef int32_t (*fop_compound_cbk_t) (call_frame_t *frame,
+                                       void *cookie,
+                                       xlator_t *this,
+                                       int32_t op_ret,
+                                       int32_t op_errno,
+                                       compound_args_t *args);
+
 
 typedef int32_t (*fop_getspec_t) (call_frame_t *frame,
                                   xlator_t *this,
@@ -120,6 +162,11 @@ typedef int32_t (*fop_rchecksum_t) (call_frame_t *frame,
                                     fd_t *fd, off_t offset,
                                     int32_t len);
 
+typedef int32_t (*fop_compound_t) (call_frame_t *frame,
+                                   xlator_t *this,
+                                   fd_t *fd,
+                                   compound_args_t *args);
+
 
 typedef int32_t (*fop_lookup_cbk_t) (call_frame_t *frame,
                                      void *cookie,
@@ -676,6 +723,7 @@ struct xlator_fops {
         fop_setattr_t        setattr;
         fop_fsetattr_t       fsetattr;
         fop_getspec_t        getspec;
+        fop_compound_t       compound;
 
         /* these entries are used for a typechecking hack in STACK_WIND _only_ */
         fop_lookup_cbk_t         lookup_cbk;
@@ -719,6 +767,7 @@ struct xlator_fops {
         fop_setattr_cbk_t        setattr_cbk;
         fop_fsetattr_cbk_t       fsetattr_cbk;
         fop_getspec_cbk_t        getspec_cbk;
+        fop_compound_cbk_t       compound_cbk;
 };
 
 typedef int32_t (*cbk_forget_t) (xlator_t *this,
@@ -869,6 +918,8 @@ void inode_destroy_notify (inode_t *inode, const char *xlname);
 int loc_copy (loc_t *dst, loc_t *src);
 #define loc_dup(src, dst) loc_copy(dst, src)
 void loc_wipe (loc_t *loc);
+compound_args_t *compound_args_new (int32_t count);
+void compound_args_destroy (compound_args_t *args);
 int xlator_mem_acct_init (xlator_t *xl, int num_types);
 int xlator_tree_reconfigure (xlator_t *old_xl, xlator_t *new_xl);
 int is_gf_log_command (xlator_t *trans, const char *name, char *value);
@@ -64,6 +64,7 @@ enum gf_fop_procnum {
         GFS3_OP_READDIRP,
         GFS3_OP_RELEASE,
         GFS3_OP_RELEASEDIR,
+        GFS3_OP_COMPOUND,
         GFS3_OP_MAXVALUE,
 } ;
 
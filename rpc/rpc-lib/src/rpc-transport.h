@@ -209,6 +209,8 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        uint64_t                   total_read_calls;
+        uint64_t                   total_records_read;
 
         struct list_head           list;
         int                        client_bind_insecure;
@@ -143,6 +143,77 @@ int socket_init (rpc_transport_t *this);
  * > 0 = incomplete
  */
 
+/* readv() replacement for the receive side. Bytes left in the receive
+ * buffer by an earlier read are handed out first. Otherwise a small read
+ * also asks the socket for whatever follows it, into the receive buffer,
+ * while large reads (write payloads, read replies) go straight into the
+ * caller's buffers.
+ */
+static int
+__socket_rdbuf_readv (rpc_transport_t *this, struct iovec *opvector,
+                      int opcount)
+{
+        socket_private_t *priv                  = NULL;
+        struct iovec      vector[MAX_IOVEC + 1];
+        size_t            wanted                = 0;
+        size_t            avail                 = 0;
+        size_t            copied                = 0;
+        size_t            len                   = 0;
+        int               idx                   = 0;
+        int               ret                   = -1;
+
+        priv = this->private;
+
+        for (idx = 0; idx < opcount; idx++)
+                wanted += opvector[idx].iov_len;
+
+        avail = priv->incoming.rdbuf_end - priv->incoming.rdbuf_start;
+        if (avail && wanted) {
+                for (idx = 0; (idx < opcount) && (copied < avail); idx++) {
+                        len = min (opvector[idx].iov_len, avail - copied);
+                        memcpy (opvector[idx].iov_base,
+                                priv->rdbuf + priv->incoming.rdbuf_start
+                                + copied, len);
+                        copied += len;
+                }
+
+                priv->incoming.rdbuf_start += copied;
+                if (priv->incoming.rdbuf_start == priv->incoming.rdbuf_end) {
+                        priv->incoming.rdbuf_start = 0;
+                        priv->incoming.rdbuf_end = 0;
+                }
+
+                return copied;
+        }
+
+        if (avail || (wanted >= GF_SOCKET_RDBUF_SIZE)
+            || (opcount >= MAX_IOVEC)) {
+                ret = readv (priv->sock, opvector, opcount);
+        } else {
+                memcpy (vector, opvector, opcount * sizeof (*opvector));
+                vector[opcount].iov_base = priv->rdbuf;
+                vector[opcount].iov_len  = GF_SOCKET_RDBUF_SIZE;
+
+                ret = readv (priv->sock, vector, opcount + 1);
+        }
+
+        this->total_read_calls++;
+
+        if (ret <= 0)
+                return ret;
+
+        this->total_bytes_read += ret;
+
+        if (ret > wanted) {
+                priv->incoming.rdbuf_start = 0;
+                priv->incoming.rdbuf_end = ret - wanted;
+                ret = wanted;
+        }
+
+        return ret;
+}
+
+
 int
 __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
               struct iovec **pending_vector, int *pending_count, size_t *bytes,
@@ -178,12 +249,11 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                         }
                         this->total_bytes_write += ret;
                 } else {
-                        ret = readv (sock, opvector, opcount);
+                        ret = __socket_rdbuf_readv (this, opvector, opcount);
                         if (ret == -1 && errno == EAGAIN) {
                                 /* done for now */
                                 break;
                         }
-                        this->total_bytes_read += ret;
                 }
 
                 if (ret == 0) {
@@ -843,6 +913,8 @@ __socket_read_vectored_request (rpc_transport_t *this)
         uint32_t          remaining_size         = 0;
         uint32_t          gluster_write_proc_len = 0;
         gfs3_write_req    write_req              = {{0,},};
+        struct iobuf_pool *iobuf_pool            = NULL;
+        size_t            payload_size           = 0;
 
         GF_VALIDATE_OR_GOTO ("socket", this, out);
         GF_VALIDATE_OR_GOTO ("socket", this->private, out);
@@ -908,6 +980,12 @@ __socket_read_vectored_request (rpc_transport_t *this)
                 /* fall through */
 
         case SP_STATE_READ_VERFBYTES:
+                /* the payload is read straight into the start of a fresh
+                 * iobuf. iobufs are carved out of an mmap'd arena at
+                 * page_size strides, so the write data lands page aligned
+                 * and posix can hand it to pwrite, even on O_DIRECT fds,
+                 * without copying it again.
+                 */
                 if (priv->incoming.payload_vector.iov_base == NULL) {
                         iobuf = iobuf_get (this->ctx->iobuf_pool);
                         if (!iobuf) {
@@ -943,6 +1021,23 @@ __socket_read_vectored_request (rpc_transport_t *this)
                  * fragcurrent
                  */
 
+                remaining_size = RPC_FRAGSIZE (priv->incoming.fraghdr)
+                        - priv->incoming.frag.bytes_read;
+
+                iobuf_pool = this->ctx->iobuf_pool;
+                payload_size = (unsigned long)priv->incoming.frag.fragcurrent
+                        - (unsigned long)priv->incoming.payload_vector.iov_base
+                        + remaining_size;
+
+                if (payload_size > iobpool_pagesize (iobuf_pool)) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "write payload of %"GF_PRI_SIZET" bytes from "
+                                "peer (%s) does not fit in an iobuf",
+                                payload_size, this->peerinfo.identifier);
+                        ret = -1;
+                        goto out;
+                }
+
                 ret = __socket_read_simple_msg (this);
 
                 remaining_size = RPC_FRAGSIZE (priv->incoming.fraghdr)
@@ -1624,6 +1719,7 @@ __socket_proto_state_machine (rpc_transport_t *this,
         }
 
         if (priv->incoming.record_state == SP_STATE_COMPLETE) {
+                this->total_records_read++;
                 priv->incoming.record_state = SP_STATE_NADA;
                 __socket_reset_priv (priv);
         }
@@ -1664,15 +1760,34 @@ socket_event_poll_in (rpc_transport_t *this)
 {
         int                     ret    = -1;
         rpc_transport_pollin_t *pollin = NULL;
+        socket_private_t       *priv   = NULL;
+        char                    more   = 0;
+
+        priv = this->private;
 
-        ret = socket_proto_state_machine (this, &pollin);
+        /* records already sitting in the receive buffer will not raise
+         * another POLLIN once the socket itself is drained, so keep
+         * parsing until the buffer is empty
+         */
+        do {
+                pollin = NULL;
+
+                ret = socket_proto_state_machine (this, &pollin);
+                if (pollin == NULL)
+                        break;
 
-        if (pollin != NULL) {
                 ret = rpc_transport_notify (this, RPC_TRANSPORT_MSG_RECEIVED,
                                             pollin);
 
                 rpc_transport_pollin_destroy (pollin);
-        }
+
+                pthread_mutex_lock (&priv->lock);
+                {
+                        more = (priv->incoming.rdbuf_start
+                                < priv->incoming.rdbuf_end);
+                }
+                pthread_mutex_unlock (&priv->lock);
+        } while (more && (ret >= 0));
 
         return ret;
 }
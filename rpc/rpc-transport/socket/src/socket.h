@@ -56,6 +56,14 @@
 #define GF_MIN_SOCKET_WINDOW_SIZE       (128 * GF_UNIT_KB)
 #define GF_USE_DEFAULT_KEEPALIVE        (-1)
 
+/* Small reads of the record state machine also pull in whatever follows
+ * them on the wire, up to this many bytes, so that a burst of small rpcs
+ * is taken off the socket with a handful of readv calls instead of
+ * several per record. Reads of this size or more go straight into their
+ * target buffers.
+ */
+#define GF_SOCKET_RDBUF_SIZE            (4 * GF_UNIT_KB)
+
 typedef enum {
         SP_STATE_NADA = 0,
         SP_STATE_COMPLETE,
@@ -186,7 +194,10 @@ typedef struct {
                 char                 complete_record;
                 msg_type_t           msg_type;
                 size_t               total_bytes_read;
+                uint32_t             rdbuf_start;
+                uint32_t             rdbuf_end;
         } incoming;
+        char                   rdbuf[GF_SOCKET_RDBUF_SIZE];
         pthread_mutex_t        lock;
         int                    windowsize;
         char                   lowlat;
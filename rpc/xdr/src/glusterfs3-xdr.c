@@ -1515,3 +1515,71 @@ xdr_gfs3_readdirp_rsp (XDR *xdrs, gfs3_readdirp_rsp *objp)
 		 return FALSE;
 	return TRUE;
 }
+
+bool_t
+xdr_gfs3_compound_op (XDR *xdrs, gfs3_compound_op *objp)
+{
+	 if (!xdr_u_int (xdrs, &objp->fop))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->offset))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->size))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->flags))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_req (XDR *xdrs, gfs3_compound_req *objp)
+{
+	 if (!xdr_opaque (xdrs, objp->gfid, 16))
+		 return FALSE;
+	 if (!xdr_quad_t (xdrs, &objp->fd))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->ops.ops_val, (u_int *) &objp->ops.ops_len, ~0,
+		sizeof (gfs3_compound_op), (xdrproc_t) xdr_gfs3_compound_op))
+		 return FALSE;
+	 if (!xdr_opaque (xdrs, objp->pargfid, 16))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->mode))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->path, ~0))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->bname, ~0))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->dict.dict_val, (u_int *) &objp->dict.dict_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_op_rsp (XDR *xdrs, gfs3_compound_op_rsp *objp)
+{
+	 if (!xdr_int (xdrs, &objp->op_ret))
+		 return FALSE;
+	 if (!xdr_int (xdrs, &objp->op_errno))
+		 return FALSE;
+	 if (!xdr_gf_iatt (xdrs, &objp->prestat))
+		 return FALSE;
+	 if (!xdr_gf_iatt (xdrs, &objp->poststat))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_rsp (XDR *xdrs, gfs3_compound_rsp *objp)
+{
+	 if (!xdr_int (xdrs, &objp->op_ret))
+		 return FALSE;
+	 if (!xdr_int (xdrs, &objp->op_errno))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->replies.replies_val, (u_int *) &objp->replies.replies_len, ~0,
+		sizeof (gfs3_compound_op_rsp), (xdrproc_t) xdr_gfs3_compound_op_rsp))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->fd))
+		 return FALSE;
+	 if (!xdr_gf_iatt (xdrs, &objp->stat))
+		 return FALSE;
+	return TRUE;
+}
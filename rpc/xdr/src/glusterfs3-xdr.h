@@ -780,6 +780,52 @@ struct gfs3_readdirp_rsp {
 };
 typedef struct gfs3_readdirp_rsp gfs3_readdirp_rsp;
 
+struct gfs3_compound_op {
+	u_int fop;
+	u_quad_t offset;
+	u_int size;
+	u_int flags;
+};
+typedef struct gfs3_compound_op gfs3_compound_op;
+
+struct gfs3_compound_req {
+	char gfid[16];
+	quad_t fd;
+	struct {
+		u_int ops_len;
+		gfs3_compound_op *ops_val;
+	} ops;
+	char pargfid[16];
+	u_int mode;
+	char *path;
+	char *bname;
+	struct {
+		u_int dict_len;
+		char *dict_val;
+	} dict;
+};
+typedef struct gfs3_compound_req gfs3_compound_req;
+
+struct gfs3_compound_op_rsp {
+	int op_ret;
+	int op_errno;
+	struct gf_iatt prestat;
+	struct gf_iatt poststat;
+};
+typedef struct gfs3_compound_op_rsp gfs3_compound_op_rsp;
+
+struct gfs3_compound_rsp {
+	int op_ret;
+	int op_errno;
+	struct {
+		u_int replies_len;
+		gfs3_compound_op_rsp *replies_val;
+	} replies;
+	u_quad_t fd;
+	struct gf_iatt stat;
+};
+typedef struct gfs3_compound_rsp gfs3_compound_rsp;
+
 /* the xdr functions */
 
 #if defined(__STDC__) || defined(__cplusplus)
@@ -868,6 +914,10 @@ extern  bool_t xdr_gfs3_dirlist (XDR *, gfs3_dirlist*);
 extern  bool_t xdr_gfs3_readdir_rsp (XDR *, gfs3_readdir_rsp*);
 extern  bool_t xdr_gfs3_dirplist (XDR *, gfs3_dirplist*);
 extern  bool_t xdr_gfs3_readdirp_rsp (XDR *, gfs3_readdirp_rsp*);
+extern  bool_t xdr_gfs3_compound_op (XDR *, gfs3_compound_op*);
+extern  bool_t xdr_gfs3_compound_req (XDR *, gfs3_compound_req*);
+extern  bool_t xdr_gfs3_compound_op_rsp (XDR *, gfs3_compound_op_rsp*);
+extern  bool_t xdr_gfs3_compound_rsp (XDR *, gfs3_compound_rsp*);
 
 #else /* K&R C */
 extern bool_t xdr_gf_statfs ();
@@ -955,6 +1005,10 @@ extern bool_t xdr_gfs3_dirlist ();
 extern bool_t xdr_gfs3_readdir_rsp ();
 extern bool_t xdr_gfs3_dirplist ();
 extern bool_t xdr_gfs3_readdirp_rsp ();
+extern bool_t xdr_gfs3_compound_op ();
+extern bool_t xdr_gfs3_compound_req ();
+extern bool_t xdr_gfs3_compound_op_rsp ();
+extern bool_t xdr_gfs3_compound_rsp ();
 
 #endif /* K&R C */
 
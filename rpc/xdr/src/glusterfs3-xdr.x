@@ -614,3 +614,35 @@ struct gfs3_readdirp_rsp {
        struct gfs3_dirplist *reply;
 };
 
+struct gfs3_compound_op {
+       unsigned int fop;
+       unsigned hyper offset;
+       unsigned int size;
+       unsigned int flags;
+};
+
+struct gfs3_compound_req {
+       opaque gfid[16];
+       hyper fd;
+       struct gfs3_compound_op ops<>;
+       opaque pargfid[16];
+       unsigned int mode;
+       string path<>;
+       string bname<>;
+       opaque dict<>;
+};
+
+struct gfs3_compound_op_rsp {
+       int op_ret;
+       int op_errno;
+       struct gf_iatt prestat;
+       struct gf_iatt poststat;
+};
+
+struct gfs3_compound_rsp {
+       int op_ret;
+       int op_errno;
+       struct gfs3_compound_op_rsp replies<>;
+       unsigned hyper fd;
+       struct gf_iatt stat;
+};
@@ -148,6 +148,12 @@ xdr_serialize_readdirp_rsp (struct iovec outmsg, void *rsp)
                                       (xdrproc_t)xdr_gfs3_readdirp_rsp);
 }
 ssize_t
+xdr_serialize_compound_rsp (struct iovec outmsg, void *rsp)
+{
+        return xdr_serialize_generic (outmsg, (void *)rsp,
+                                      (xdrproc_t)xdr_gfs3_compound_rsp);
+}
+ssize_t
 xdr_serialize_rchecksum_rsp (struct iovec outmsg, void *rsp)
 {
         return xdr_serialize_generic (outmsg, (void *)rsp,
@@ -540,6 +546,12 @@ xdr_to_readdirp_req (struct iovec inmsg, void *args)
                                (xdrproc_t)xdr_gfs3_readdirp_req);
 }
 ssize_t
+xdr_to_compound_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gfs3_compound_req);
+}
+ssize_t
 xdr_to_truncate_req (struct iovec inmsg, void *args)
 {
         return xdr_to_generic (inmsg, (void *)args,
@@ -670,6 +682,14 @@ xdr_from_readdirp_req (struct iovec outmsg, void *req)
 
 }
 
+ssize_t
+xdr_from_compound_req (struct iovec outmsg, void *req)
+{
+        return xdr_serialize_generic (outmsg, (void *)req,
+                                      (xdrproc_t)xdr_gfs3_compound_req);
+
+}
+
 ssize_t
 xdr_from_fsyncdir_req (struct iovec outmsg, void *req)
 {
@@ -993,6 +1013,13 @@ xdr_to_readdirp_rsp (struct iovec outmsg, void *rsp)
         return xdr_to_generic (outmsg, (void *)rsp,
                                       (xdrproc_t)xdr_gfs3_readdirp_rsp);
 
+}
+ssize_t
+xdr_to_compound_rsp (struct iovec outmsg, void *rsp)
+{
+        return xdr_to_generic (outmsg, (void *)rsp,
+                                      (xdrproc_t)xdr_gfs3_compound_rsp);
+
 }
 ssize_t
 xdr_to_lk_rsp (struct iovec outmsg, void *rsp)
@@ -312,6 +312,9 @@ xdr_serialize_readdir_rsp (struct iovec outmsg, void *rsp);
 ssize_t
 xdr_serialize_readdirp_rsp (struct iovec outmsg, void *rsp);
 
+ssize_t
+xdr_serialize_compound_rsp (struct iovec outmsg, void *rsp);
+
 ssize_t
 xdr_serialize_opendir_rsp (struct iovec outmsg, void *rsp);
 
@@ -479,6 +482,9 @@ xdr_to_opendir_req (struct iovec inmsg, void *args);
 ssize_t
 xdr_to_readdirp_req (struct iovec inmsg, void *args);
 
+ssize_t
+xdr_to_compound_req (struct iovec inmsg, void *args);
+
 ssize_t
 xdr_to_readdir_req (struct iovec inmsg, void *args);
 
@@ -606,6 +612,9 @@ xdr_from_readdir_req (struct iovec outmsg, void *args);
 ssize_t
 xdr_from_readdirp_req (struct iovec outmsg, void *args);
 
+ssize_t
+xdr_from_compound_req (struct iovec outmsg, void *args);
+
 ssize_t
 xdr_from_setattr_req (struct iovec outmsg, void *args);
 
@@ -737,6 +746,9 @@ xdr_to_lk_rsp (struct iovec inmsg, void *args);
 ssize_t
 xdr_to_readdirp_rsp (struct iovec inmsg, void *args);
 
+ssize_t
+xdr_to_compound_rsp (struct iovec inmsg, void *args);
+
 ssize_t
 xdr_to_readdir_rsp (struct iovec inmsg, void *args);
 ssize_t
@@ -957,8 +957,11 @@ dht_lookup_linkfile_cbk (call_frame_t *frame, void *cookie,
                         prev->this->name);
                 op_ret   = -1;
                 op_errno = EINVAL;
+                goto unwind;
         }
 
+        dht_linkcache_put (this, loc, subvol, stbuf->ia_gfid);
+
 unwind:
         WIPE (postparent);
 
@@ -1153,6 +1156,82 @@ err:
 }
 
 
+int
+dht_lookup_linkcache_cbk (call_frame_t *frame, void *cookie,
+                          xlator_t *this, int op_ret, int op_errno,
+                          inode_t *inode, struct iatt *stbuf, dict_t *xattr,
+                          struct iatt *postparent)
+{
+        call_frame_t *prev          = NULL;
+        dht_local_t  *local         = NULL;
+        xlator_t     *subvol        = NULL;
+        dht_conf_t   *conf          = NULL;
+        int           ret           = 0;
+
+        GF_VALIDATE_OR_GOTO ("dht", frame, out);
+        GF_VALIDATE_OR_GOTO ("dht", this, unwind);
+        GF_VALIDATE_OR_GOTO ("dht", frame->local, unwind);
+        GF_VALIDATE_OR_GOTO ("dht", this->private, unwind);
+        GF_VALIDATE_OR_GOTO ("dht", cookie, unwind);
+
+        prev   = cookie;
+        subvol = prev->this;
+        conf   = this->private;
+        local  = frame->local;
+
+        if (op_ret == -1)
+                goto miss;
+
+        if (check_is_dir (inode, stbuf, xattr)
+            || check_is_linkfile (inode, stbuf, xattr))
+                goto miss;
+
+        if (uuid_compare (local->gfid, stbuf->ia_gfid))
+                goto miss;
+
+        if ((stbuf->ia_nlink == 1)
+            && (conf && conf->unhashed_sticky_bit)) {
+                stbuf->ia_prot.sticky = 1;
+        }
+        dht_itransform (this, prev->this, stbuf->ia_ino, &stbuf->ia_ino);
+        if (local->loc.parent)
+                postparent->ia_ino = local->loc.parent->ino;
+
+        ret = dht_layout_preset (this, prev->this, inode);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "failed to set layout for subvolume %s",
+                        prev->this->name);
+                op_ret   = -1;
+                op_errno = EINVAL;
+        }
+
+unwind:
+        WIPE (postparent);
+
+        DHT_STACK_UNWIND (lookup, frame, op_ret, op_errno, inode, stbuf, xattr,
+                          postparent);
+
+        return 0;
+
+miss:
+        /* the hint is stale, do the lookup the long way */
+        gf_log (this->name, GF_LOG_TRACE,
+                "cached location of %s on %s is stale",
+                local->loc.path, subvol->name);
+
+        dht_linkcache_del (this, &local->loc);
+        uuid_clear (local->gfid);
+
+        subvol = local->hashed_subvol;
+        STACK_WIND (frame, dht_lookup_cbk,
+                    subvol, subvol->fops->lookup,
+                    &local->loc, local->xattr_req);
+out:
+        return 0;
+}
+
+
 int
 dht_lookup (call_frame_t *frame, xlator_t *this,
             loc_t *loc, dict_t *xattr_req)
@@ -1160,6 +1239,7 @@ dht_lookup (call_frame_t *frame, xlator_t *this,
         xlator_t     *subvol = NULL;
         xlator_t     *hashed_subvol = NULL;
         xlator_t     *cached_subvol = NULL;
+        xlator_t     *linked_subvol = NULL;
         dht_local_t  *local  = NULL;
         dht_conf_t   *conf = NULL;
         int           ret    = -1;
@@ -1287,6 +1367,17 @@ dht_lookup (call_frame_t *frame, xlator_t *this,
                         return 0;
                 }
 
+                linked_subvol = dht_linkcache_get (this, &local->loc,
+                                                   local->gfid);
+                if (linked_subvol && (linked_subvol != hashed_subvol)) {
+                        STACK_WIND (frame, dht_lookup_linkcache_cbk,
+                                    linked_subvol,
+                                    linked_subvol->fops->lookup,
+                                    &local->loc, local->xattr_req);
+                        return 0;
+                }
+                uuid_clear (local->gfid);
+
                 STACK_WIND (frame, dht_lookup_cbk,
                             hashed_subvol, hashed_subvol->fops->lookup,
                             loc, local->xattr_req);
@@ -2182,9 +2273,14 @@ dht_getxattr (call_frame_t *frame, xlator_t *this,
                                 break;
                         }
                 }
-                if ((layout->cnt < conf->subvolume_cnt) || flag) {
+                /* with weights the ranges follow the capacities, which
+                   may have changed since the layout was written */
+                if ((layout->cnt < conf->subvolume_cnt) || flag
+                    || (conf->weighted_layout
+                        && dht_selfheal_layout_changed (frame, loc,
+                                                        layout))) {
                         gf_log (this->name, GF_LOG_INFO,
-                                "expanding layout of %s from %d to %d",
+                                "fixing layout of %s (%d of %d subvolumes)",
                                 loc->path, layout->cnt, conf->subvolume_cnt);
                         local = dht_local_init (frame);
                         if (!local) {
@@ -2805,6 +2901,126 @@ err:
 }
 
 
+int
+dht_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                  int op_ret, int op_errno, compound_args_t *args)
+{
+        dht_local_t    *local = NULL;
+        call_frame_t   *prev  = NULL;
+        compound_fop_t *cfop  = NULL;
+        int             ret   = 0;
+        int             i     = 0;
+
+        local = frame->local;
+        prev = cookie;
+
+        for (i = 0; (op_ret == 0) && (i < args->count); i++) {
+                cfop = &args->fops[i];
+                if (cfop->op_ret == -1)
+                        continue;
+
+                if (cfop->fop == GF_FOP_CREATE) {
+                        /* as dht_create_cbk */
+                        dht_itransform (this, prev->this, cfop->buf.ia_ino,
+                                        &cfop->buf.ia_ino);
+                        local->ia_ino = cfop->buf.ia_ino;
+
+                        WIPE (&cfop->prebuf);
+                        WIPE (&cfop->postbuf);
+                        cfop->prebuf.ia_ino = cfop->loc.parent->ino;
+                        cfop->postbuf.ia_ino = cfop->loc.parent->ino;
+
+                        ret = dht_layout_preset (this, prev->this,
+                                                 local->fd->inode);
+                        if (ret != 0) {
+                                gf_log (this->name, GF_LOG_DEBUG,
+                                        "could not set preset layout for "
+                                        "subvol %s", prev->this->name);
+                                op_ret = -1;
+                                op_errno = EINVAL;
+                        }
+                        continue;
+                }
+
+                cfop->prebuf.ia_ino = local->ia_ino;
+                cfop->postbuf.ia_ino = local->ia_ino;
+        }
+
+        DHT_STACK_UNWIND (compound, frame, op_ret, op_errno, args);
+
+        return 0;
+}
+
+
+int
+dht_compound (call_frame_t *frame, xlator_t *this, fd_t *fd,
+              compound_args_t *args)
+{
+        xlator_t       *subvol = NULL;
+        int             op_errno = -1;
+        dht_local_t    *local = NULL;
+        compound_fop_t *cfop = NULL;
+
+
+        VALIDATE_OR_GOTO (frame, err);
+        VALIDATE_OR_GOTO (this, err);
+        VALIDATE_OR_GOTO (fd, err);
+
+        cfop = &args->fops[0];
+        if (cfop->fop == GF_FOP_CREATE) {
+                /* a new file goes to the subvolume its name hashes to; when
+                   the create of this translator (nufa and switch have their
+                   own) would place it anywhere else, the compound is split
+                   up and the create goes through it */
+                VALIDATE_OR_GOTO (cfop->loc.parent, err);
+
+                if (this->fops->create != dht_create)
+                        return default_compound (frame, this, fd, args);
+
+                dht_get_du_info (frame, this, &cfop->loc);
+
+                subvol = dht_subvol_get_hashed (this, &cfop->loc);
+                if (!subvol
+                    || dht_filter_loc_subvol_key (this, &cfop->loc, NULL,
+                                                  &subvol)
+                    || dht_is_subvol_filled (this, subvol))
+                        return default_compound (frame, this, fd, args);
+        } else {
+                subvol = dht_subvol_get_cached (this, fd->inode);
+        }
+
+        if (!subvol) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "no cached subvolume for fd=%p", fd);
+                op_errno = EINVAL;
+                goto err;
+        }
+
+        local = dht_local_init (frame);
+        if (!local) {
+                op_errno = ENOMEM;
+
+                goto err;
+        }
+
+        local->fd = fd_ref (fd);
+        local->ia_ino = fd->inode->ino;
+
+        /* all operations of a compound are on the same file, which lives
+           on one subvolume */
+        STACK_WIND (frame, dht_compound_cbk,
+                    subvol, subvol->fops->compound, fd, args);
+
+        return 0;
+
+err:
+        op_errno = (op_errno == -1) ? errno : op_errno;
+        DHT_STACK_UNWIND (compound, frame, -1, op_errno, args);
+
+        return 0;
+}
+
+
 int
 dht_lk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
             int op_ret, int op_errno, struct gf_flock *flock)
@@ -3241,6 +3457,11 @@ dht_do_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 
         conf = this->private;
 
+        if (conf->parallel_readdir
+            && (dht_parallel_readdir (frame, this, fd, size, yoff,
+                                      whichop) == 0))
+                return 0;
+
         local = dht_local_init (frame);
         if (!local) {
 
@@ -3656,6 +3877,8 @@ dht_unlink (call_frame_t *frame, xlator_t *this, loc_t *loc)
                 goto err;
         }
 
+        dht_linkcache_del (this, loc);
+
         if (hashed_subvol != cached_subvol) {
                 STACK_WIND (frame, dht_unlink_linkfile_cbk,
                             hashed_subvol, hashed_subvol->fops->unlink, loc);
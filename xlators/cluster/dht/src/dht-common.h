@@ -62,6 +62,8 @@ typedef struct dht_layout dht_layout_t;
 
 typedef enum {
         DHT_HASH_TYPE_DM,
+        DHT_HASH_TYPE_XXH32,
+        DHT_HASH_TYPE_MAX,
 } dht_hashfn_type_t;
 
 
@@ -88,6 +90,7 @@ struct dht_local {
         dict_t                  *xattr_req;
         dht_layout_t            *layout;
         size_t                   size;
+        uint32_t                 readdir_gen;
         ino_t                    ia_ino;
         xlator_t                *src_hashed, *src_cached;
         xlator_t                *dst_hashed, *dst_cached;
@@ -140,10 +143,20 @@ typedef struct dht_local dht_local_t;
 struct dht_du {
         double   avail_percent;
         uint64_t avail_space;
+        uint64_t total_space;
         uint32_t log;
 };
 typedef struct dht_du dht_du_t;
 
+/* linkfile cache: where the data of a name found behind a linkfile lives */
+struct dht_linkcache_entry {
+        uuid_t         pargfid;
+        char          *name;
+        xlator_t      *subvol;
+        uuid_t         gfid;
+};
+typedef struct dht_linkcache_entry dht_linkcache_entry_t;
+
 struct dht_conf {
         gf_lock_t      subvolume_lock;
         int            subvolume_cnt;
@@ -167,10 +180,41 @@ struct dht_conf {
         gf_boolean_t   use_readdirp;
         char           vol_uuid[UUID_SIZE + 1];
         gf_boolean_t   assert_no_child_down;
+        int            hash_type;   /* of layouts written from now on */
+        gf_boolean_t   weighted_layout;
+        gf_boolean_t   parallel_readdir;
+        gf_boolean_t   linkfile_cache;
+        gf_lock_t      linkcache_lock;
+        dht_linkcache_entry_t *linkcache;
+        int            linkcache_size;
+        uint64_t       linkcache_hits;
+        uint64_t       linkcache_misses;
 };
 typedef struct dht_conf dht_conf_t;
 
 
+/* parallel readdir: what one subvolume has returned ahead of the reader */
+struct dht_readdir_subvol {
+        gf_dirent_t    entries;     /* filtered, offsets transformed */
+        int            count;
+        off_t          offset;      /* to read the subvolume from next */
+        char           pending;     /* a readdirp is in flight */
+        char           eof;
+};
+
+struct dht_readdir_ctx {
+        gf_lock_t      lock;
+        uint32_t       gen;         /* bumped on every seek */
+        char           started;
+        off_t          next_off;    /* d_off of the last entry served */
+        call_frame_t  *waiting;     /* reader waiting on a subvolume */
+        int            waiting_op;
+        size_t         waiting_size;
+        struct dht_readdir_subvol subvols[0];
+};
+typedef struct dht_readdir_ctx dht_readdir_ctx_t;
+
+
 struct dht_disk_layout {
         uint32_t           cnt;
         uint32_t           type;
@@ -268,6 +312,7 @@ xlator_t *dht_subvol_next (xlator_t *this, xlator_t *prev);
 int dht_subvol_cnt (xlator_t *this, xlator_t *subvol);
 
 int dht_hash_compute (int type, const char *name, uint32_t *hash_p);
+int dht_hash_type_from_str (const char *str, int *type_p);
 
 int dht_linkfile_create (call_frame_t *frame, fop_mknod_cbk_t linkfile_cbk,
                          xlator_t *tovol, xlator_t *fromvol, loc_t *loc);
@@ -280,6 +325,9 @@ int
 dht_selfheal_new_directory (call_frame_t *frame, dht_selfheal_dir_cbk_t cbk,
                             dht_layout_t *layout);
 int
+dht_selfheal_layout_changed (call_frame_t *frame, loc_t *loc,
+                             dht_layout_t *layout);
+int
 dht_selfheal_restore (call_frame_t *frame, dht_selfheal_dir_cbk_t cbk,
                       loc_t *loc, dht_layout_t *layout);
 int
@@ -287,6 +335,8 @@ dht_layout_sort_volname (dht_layout_t *layout);
 
 int dht_rename (call_frame_t *frame, xlator_t *this,
                 loc_t *oldloc, loc_t *newloc);
+int dht_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                int32_t flags, mode_t mode, fd_t *fd, dict_t *params);
 
 int dht_get_du_info (call_frame_t *frame, xlator_t *this, loc_t *loc);
 
@@ -306,6 +356,17 @@ int dht_build_child_loc (xlator_t *this, loc_t *child, loc_t *parent, char *name
 int dht_filter_loc_subvol_key (xlator_t *this, loc_t *loc, loc_t *new_loc,
                                xlator_t **subvol);
 
+int dht_parallel_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                          size_t size, off_t yoff, int whichop);
+int dht_releasedir (xlator_t *this, fd_t *fd);
+
+int dht_linkcache_init (xlator_t *this, dht_conf_t *conf);
+void dht_linkcache_fini (xlator_t *this, dht_conf_t *conf);
+void dht_linkcache_put (xlator_t *this, loc_t *loc, xlator_t *subvol,
+                        uuid_t gfid);
+xlator_t *dht_linkcache_get (xlator_t *this, loc_t *loc, uuid_t gfid);
+void dht_linkcache_del (xlator_t *this, loc_t *loc);
+
 int dht_rename_cleanup (call_frame_t *frame);
 int dht_rename_links_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                       int32_t op_ret, int32_t op_errno,
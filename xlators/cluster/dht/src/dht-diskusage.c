@@ -43,6 +43,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         int            i = 0;
         double         percent = 0;
         uint64_t       bytes = 0;
+        uint64_t       total = 0;
 
         conf = this->private;
         prev = cookie;
@@ -56,6 +57,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (statvfs && statvfs->f_blocks) {
                 percent = (statvfs->f_bfree * 100) / statvfs->f_blocks;
                 bytes = (statvfs->f_bfree * statvfs->f_frsize);
+                total = (statvfs->f_blocks * statvfs->f_frsize);
         }
 
         LOCK (&conf->subvolume_lock);
@@ -64,6 +66,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         if (prev->this == conf->subvolumes[i]) {
                                 conf->du_stats[i].avail_percent = percent;
                                 conf->du_stats[i].avail_space   = bytes;
+                                conf->du_stats[i].total_space   = total;
                                 gf_log (this->name, GF_LOG_DEBUG,
                                         "on subvolume '%s': avail_percent is: "
                                         "%.2f and avail_space is: %"PRIu64"",
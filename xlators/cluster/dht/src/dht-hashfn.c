@@ -39,6 +39,9 @@ dht_hash_compute_internal (int type, const char *name, uint32_t *hash_p)
         case DHT_HASH_TYPE_DM:
                 hash = gf_dm_hashfn (name, strlen (name));
                 break;
+        case DHT_HASH_TYPE_XXH32:
+                hash = gf_xxh32_hashfn (name, strlen (name));
+                break;
         default:
                 ret = -1;
                 break;
@@ -79,3 +82,19 @@ dht_hash_compute (int type, const char *name, uint32_t *hash_p)
 
         return dht_hash_compute_internal (type, rsync_friendly_name, hash_p);
 }
+
+
+int
+dht_hash_type_from_str (const char *str, int *type_p)
+{
+        int ret = 0;
+
+        if (strcasecmp (str, "dm") == 0)
+                *type_p = DHT_HASH_TYPE_DM;
+        else if (strcasecmp (str, "xxh32") == 0)
+                *type_p = DHT_HASH_TYPE_XXH32;
+        else
+                ret = -1;
+
+        return ret;
+}
@@ -292,6 +292,7 @@ dht_disk_layout_merge (xlator_t *this, dht_layout_t *layout,
         int      type = 0;
         int      start_off = 0;
         int      stop_off = 0;
+        int      i = 0;
         int      disk_layout[4];
 
         /* TODO: assert disk_layout_ptr is of required length */
@@ -305,11 +306,35 @@ dht_disk_layout_merge (xlator_t *this, dht_layout_t *layout,
                 return -1;
         }
 
-        /* TODO: assert type is compatible */
         type      = ntoh32 (disk_layout[1]);
         start_off = ntoh32 (disk_layout[2]);
         stop_off  = ntoh32 (disk_layout[3]);
 
+        if (type < 0 || type >= DHT_HASH_TYPE_MAX) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "disk layout has invalid hash type %d", type);
+                return -1;
+        }
+
+        /* the first subvolume merged decides the hash type. ranges
+           written with another type cannot be used together with it, so
+           such a subvolume is treated as missing its layout and the
+           directory gets a fresh one from selfheal */
+        for (i = 0; i < layout->cnt; i++) {
+                if ((i != pos) && layout->list[i].xlator
+                    && (layout->list[i].err == 0))
+                        break;
+        }
+
+        if (i == layout->cnt) {
+                layout->type = type;
+        } else if (layout->type != type) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "disk layout of %s has hash type %d, expected %d",
+                        layout->list[pos].xlator->name, type, layout->type);
+                return 1;
+        }
+
         layout->list[pos].start = start_off;
         layout->list[pos].stop  = stop_off;
 
@@ -365,6 +390,11 @@ dht_layout_merge (xlator_t *this, dht_layout_t *layout, xlator_t *subvol,
         }
 
         ret = dht_disk_layout_merge (this, layout, i, disk_layout_raw);
+        if (ret == 1) {
+                layout->list[i].err = -1;
+                ret = 0;
+                goto out;
+        }
         if (ret != 0) {
                 gf_log (this->name, GF_LOG_DEBUG,
                         "layout merge from subvolume %s failed",
@@ -669,6 +699,16 @@ dht_layout_dir_mismatch (xlator_t *this, dht_layout_t *layout, xlator_t *subvol,
                 goto out;
         }
 
+        if (ntoh32 (disk_layout[1]) != layout->type) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "subvol: %s; inode layout hash type - %d; "
+                        "disk layout hash type - %d",
+                        layout->list[pos].xlator->name, layout->type,
+                        ntoh32 (disk_layout[1]));
+                ret = 1;
+                goto out;
+        }
+
         start_off = ntoh32 (disk_layout[2]);
         stop_off  = ntoh32 (disk_layout[3]);
 
@@ -0,0 +1,218 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+/* Linkfile cache.
+
+   A fresh lookup of a file which does not live on its hashed subvolume
+   costs two round trips: one to find the linkfile on the hashed subvolume
+   and one to the subvolume it points to. Every time a linkfile is followed
+   successfully, the (parent gfid, name) it was found under is remembered
+   here along with the subvolume holding the data and the gfid of the file.
+   The next fresh lookup of that name goes to the data subvolume straight
+   away, and is accepted only if it finds a regular file with that gfid
+   there; anything else drops the hint and the lookup starts over on the
+   hashed subvolume.
+
+   The table is direct mapped, so a new hint simply replaces whatever was
+   in its slot, and its size is fixed at DHT_LINKCACHE_SIZE entries.
+*/
+
+#include "glusterfs.h"
+#include "xlator.h"
+#include "hashfn.h"
+#include "dht-common.h"
+
+#define DHT_LINKCACHE_SIZE 4096
+
+
+static dht_linkcache_entry_t *
+__dht_linkcache_slot (dht_conf_t *conf, loc_t *loc)
+{
+        uint32_t hash = 0;
+        uint32_t seed = 0;
+
+        memcpy (&seed, loc->parent->gfid, sizeof (seed));
+        hash = gf_xxh32_hashfn (loc->name, strlen (loc->name)) ^ seed;
+
+        return &conf->linkcache[hash % conf->linkcache_size];
+}
+
+
+static int
+__dht_linkcache_match (dht_linkcache_entry_t *entry, loc_t *loc)
+{
+        if (!entry->name)
+                return 0;
+
+        if (uuid_compare (entry->pargfid, loc->parent->gfid))
+                return 0;
+
+        return (strcmp (entry->name, loc->name) == 0);
+}
+
+
+static int
+dht_linkcache_usable (dht_conf_t *conf, loc_t *loc)
+{
+        if (!conf->linkcache || !conf->linkfile_cache)
+                return 0;
+
+        if (!loc->parent || !loc->name)
+                return 0;
+
+        if (uuid_is_null (loc->parent->gfid))
+                return 0;
+
+        return 1;
+}
+
+
+int
+dht_linkcache_init (xlator_t *this, dht_conf_t *conf)
+{
+        conf->linkcache = GF_CALLOC (DHT_LINKCACHE_SIZE,
+                                     sizeof (dht_linkcache_entry_t),
+                                     gf_dht_mt_dht_linkcache_entry_t);
+        if (!conf->linkcache) {
+                gf_log (this->name, GF_LOG_ERROR, "Out of memory");
+                return -1;
+        }
+
+        conf->linkcache_size = DHT_LINKCACHE_SIZE;
+        LOCK_INIT (&conf->linkcache_lock);
+
+        return 0;
+}
+
+
+void
+dht_linkcache_fini (xlator_t *this, dht_conf_t *conf)
+{
+        int i = 0;
+
+        if (!conf->linkcache)
+                return;
+
+        for (i = 0; i < conf->linkcache_size; i++) {
+                if (conf->linkcache[i].name)
+                        GF_FREE (conf->linkcache[i].name);
+        }
+
+        LOCK_DESTROY (&conf->linkcache_lock);
+        GF_FREE (conf->linkcache);
+        conf->linkcache = NULL;
+}
+
+
+void
+dht_linkcache_put (xlator_t *this, loc_t *loc, xlator_t *subvol, uuid_t gfid)
+{
+        dht_conf_t            *conf = NULL;
+        dht_linkcache_entry_t *entry = NULL;
+        char                  *name = NULL;
+
+        conf = this->private;
+
+        if (!dht_linkcache_usable (conf, loc))
+                return;
+
+        LOCK (&conf->linkcache_lock);
+        {
+                entry = __dht_linkcache_slot (conf, loc);
+
+                if (!__dht_linkcache_match (entry, loc)) {
+                        name = gf_strdup (loc->name);
+                        if (!name)
+                                goto unlock;
+
+                        if (entry->name)
+                                GF_FREE (entry->name);
+                        entry->name = name;
+                        uuid_copy (entry->pargfid, loc->parent->gfid);
+                }
+
+                entry->subvol = subvol;
+                uuid_copy (entry->gfid, gfid);
+        }
+unlock:
+        UNLOCK (&conf->linkcache_lock);
+}
+
+
+xlator_t *
+dht_linkcache_get (xlator_t *this, loc_t *loc, uuid_t gfid)
+{
+        dht_conf_t            *conf = NULL;
+        dht_linkcache_entry_t *entry = NULL;
+        xlator_t              *subvol = NULL;
+
+        conf = this->private;
+
+        if (!dht_linkcache_usable (conf, loc))
+                return NULL;
+
+        LOCK (&conf->linkcache_lock);
+        {
+                entry = __dht_linkcache_slot (conf, loc);
+
+                if (__dht_linkcache_match (entry, loc)) {
+                        subvol = entry->subvol;
+                        uuid_copy (gfid, entry->gfid);
+                        conf->linkcache_hits++;
+                } else {
+                        conf->linkcache_misses++;
+                }
+        }
+        UNLOCK (&conf->linkcache_lock);
+
+        return subvol;
+}
+
+
+void
+dht_linkcache_del (xlator_t *this, loc_t *loc)
+{
+        dht_conf_t            *conf = NULL;
+        dht_linkcache_entry_t *entry = NULL;
+
+        conf = this->private;
+
+        if (!conf || !conf->linkcache)
+                return;
+
+        if (!loc->parent || !loc->name || uuid_is_null (loc->parent->gfid))
+                return;
+
+        LOCK (&conf->linkcache_lock);
+        {
+                entry = __dht_linkcache_slot (conf, loc);
+
+                if (__dht_linkcache_match (entry, loc)) {
+                        GF_FREE (entry->name);
+                        memset (entry, 0, sizeof (*entry));
+                }
+        }
+        UNLOCK (&conf->linkcache_lock);
+}
@@ -31,6 +31,9 @@ enum gf_dht_mem_types_ {
         gf_dht_mt_dht_local_t,
         gf_dht_mt_xlator_t,
         gf_dht_mt_dht_layout_t,
+        gf_dht_mt_double_t,
+        gf_dht_mt_dht_readdir_ctx_t,
+        gf_dht_mt_dht_linkcache_entry_t,
         gf_switch_mt_dht_conf_t,
         gf_switch_mt_dht_du_t,
         gf_switch_mt_switch_sched_array,
@@ -0,0 +1,538 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+/* Parallel readdir.
+
+   The serial readdir in dht-common.c reads the subvolumes one after the
+   other. Here readdirp is sent to all of them at once and what comes back
+   is kept per subvolume in the fd context, to be served to the reader in
+   the same order the serial code would: all of subvolume 0, then all of
+   subvolume 1 and so on. Offsets are transformed the same way too, so a
+   reader can seek to any offset handed out by either code, and the two
+   can take over from each other at any point.
+
+   Every subvolume is read ahead until DHT_READDIR_AHEAD entries are
+   buffered for it. A seek (an offset other than the one following the last
+   entry served) drops the buffers and starts over from that offset.
+*/
+
+#include "glusterfs.h"
+#include "xlator.h"
+#include "dht-common.h"
+
+#define DHT_READDIR_AHEAD 128
+
+
+static dht_readdir_ctx_t *
+dht_readdir_ctx_get (xlator_t *this, fd_t *fd)
+{
+        dht_conf_t        *conf = NULL;
+        dht_readdir_ctx_t *ctx = NULL;
+        uint64_t           tmp_ctx = 0;
+        int                i = 0;
+        int                ret = -1;
+
+        conf = this->private;
+
+        LOCK (&fd->lock);
+        {
+                ret = __fd_ctx_get (fd, this, &tmp_ctx);
+                if (ret == 0) {
+                        ctx = (dht_readdir_ctx_t *)(long) tmp_ctx;
+                        goto unlock;
+                }
+
+                ctx = GF_CALLOC (1, sizeof (*ctx) + (conf->subvolume_cnt
+                                                     * sizeof (ctx->subvols[0])),
+                                 gf_dht_mt_dht_readdir_ctx_t);
+                if (!ctx)
+                        goto unlock;
+
+                LOCK_INIT (&ctx->lock);
+                for (i = 0; i < conf->subvolume_cnt; i++)
+                        INIT_LIST_HEAD (&ctx->subvols[i].entries.list);
+
+                ret = __fd_ctx_set (fd, this, (uint64_t)(long) ctx);
+                if (ret) {
+                        LOCK_DESTROY (&ctx->lock);
+                        GF_FREE (ctx);
+                        ctx = NULL;
+                }
+        }
+unlock:
+        UNLOCK (&fd->lock);
+
+        return ctx;
+}
+
+
+static void
+__dht_readdir_ctx_reset (xlator_t *this, dht_readdir_ctx_t *ctx, off_t yoff)
+{
+        dht_conf_t                *conf = NULL;
+        struct dht_readdir_subvol *sv = NULL;
+        xlator_t                  *xvol = NULL;
+        uint64_t                   xoff = 0;
+        int                        idx = 0;
+        int                        i = 0;
+
+        conf = this->private;
+
+        dht_deitransform (this, yoff, &xvol, &xoff);
+        idx = dht_subvol_cnt (this, xvol);
+
+        /* replies to what was asked before this are dropped */
+        ctx->gen++;
+
+        for (i = 0; i < conf->subvolume_cnt; i++) {
+                sv = &ctx->subvols[i];
+
+                gf_dirent_free (&sv->entries);
+                sv->count   = 0;
+                sv->pending = 0;
+                sv->eof     = (i < idx);
+                sv->offset  = (i == idx) ? xoff : 0;
+        }
+
+        ctx->next_off = yoff;
+        ctx->started  = 1;
+}
+
+
+/* moves up to @size worth of buffered entries, in subvolume order, to
+   @entries. returns how many were moved, or -1 when nothing can be served
+   until a subvolume replies */
+static int
+__dht_readdir_serve (xlator_t *this, dht_readdir_ctx_t *ctx, size_t size,
+                     gf_dirent_t *entries, int *op_errno_p)
+{
+        dht_conf_t                *conf = NULL;
+        struct dht_readdir_subvol *sv = NULL;
+        gf_dirent_t               *entry = NULL;
+        gf_dirent_t               *tmp = NULL;
+        size_t                     filled = 0;
+        size_t                     this_size = 0;
+        int                        count = 0;
+        int                        i = 0;
+
+        conf = this->private;
+        *op_errno_p = 0;
+
+        for (i = 0; i < conf->subvolume_cnt; i++) {
+                sv = &ctx->subvols[i];
+
+                list_for_each_entry_safe (entry, tmp, &sv->entries.list,
+                                          list) {
+                        this_size = sizeof (gf_dirent_t)
+                                + strlen (entry->d_name) + 1;
+                        if (count && (this_size + filled > size))
+                                goto out;
+
+                        list_move_tail (&entry->list, &entries->list);
+                        sv->count--;
+                        ctx->next_off = entry->d_off;
+
+                        filled += this_size;
+                        count++;
+                }
+
+                if (!sv->eof) {
+                        if (!count)
+                                count = -1;
+                        goto out;
+                }
+        }
+
+        /* every subvolume has been read to its end */
+        *op_errno_p = ENOENT;
+out:
+        return count;
+}
+
+
+/* picks the subvolumes to read ahead from; @offsets[i] is -1 for the ones
+   to leave alone */
+static void
+__dht_readdir_prefetch (xlator_t *this, dht_readdir_ctx_t *ctx,
+                        off_t *offsets)
+{
+        dht_conf_t                *conf = NULL;
+        struct dht_readdir_subvol *sv = NULL;
+        int                        i = 0;
+
+        conf = this->private;
+
+        for (i = 0; i < conf->subvolume_cnt; i++) {
+                sv = &ctx->subvols[i];
+                offsets[i] = -1;
+
+                if (sv->eof || sv->pending || sv->count >= DHT_READDIR_AHEAD)
+                        continue;
+
+                sv->pending = 1;
+                offsets[i] = sv->offset;
+        }
+}
+
+
+static void
+dht_readdir_unwind (call_frame_t *frame, int whichop, int op_ret,
+                    int op_errno, gf_dirent_t *entries)
+{
+        if (whichop == GF_FOP_READDIR)
+                DHT_STACK_UNWIND (readdir, frame, op_ret, op_errno, entries);
+        else
+                DHT_STACK_UNWIND (readdirp, frame, op_ret, op_errno, entries);
+}
+
+
+/* buffers, under ctx->lock, the entries of one reply, filtered the way
+   dht_readdirp_cbk does it */
+static void
+__dht_readdir_buffer (xlator_t *this, dht_readdir_ctx_t *ctx, int idx,
+                      dht_layout_t *layout, int op_ret, int op_errno,
+                      gf_dirent_t *orig_entries)
+{
+        dht_conf_t                *conf = NULL;
+        struct dht_readdir_subvol *sv = NULL;
+        gf_dirent_t               *orig_entry = NULL;
+        gf_dirent_t               *entry = NULL;
+        xlator_t                  *subvol = NULL;
+        xlator_t                  *first_up = NULL;
+
+        conf = this->private;
+        sv = &ctx->subvols[idx];
+        subvol = conf->subvolumes[idx];
+
+        if (op_ret < 0) {
+                /* the serial readdir moves on to the next subvolume too */
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "readdirp on %s failed (%s)", subvol->name,
+                        strerror (op_errno));
+                sv->eof = 1;
+                return;
+        }
+
+        if (op_ret == 0) {
+                sv->eof = 1;
+                return;
+        }
+
+        first_up = dht_first_up_subvol (this);
+
+        list_for_each_entry (orig_entry, (&orig_entries->list), list) {
+                if (check_is_linkfile (NULL, (&orig_entry->d_stat), NULL)
+                    || (check_is_dir (NULL, (&orig_entry->d_stat), NULL)
+                        && (subvol != first_up))) {
+                        sv->offset = orig_entry->d_off;
+                        continue;
+                }
+
+                entry = gf_dirent_for_name (orig_entry->d_name);
+                if (!entry) {
+                        /* read again from here on the next prefetch */
+                        return;
+                }
+
+                if (layout
+                    && (conf->search_unhashed == GF_DHT_LOOKUP_UNHASHED_AUTO)
+                    && (dht_layout_search (this, layout,
+                                           orig_entry->d_name) != subvol))
+                        layout->search_unhashed++;
+
+                entry->d_stat = orig_entry->d_stat;
+
+                dht_itransform (this, subvol, orig_entry->d_ino,
+                                &entry->d_ino);
+                dht_itransform (this, subvol, orig_entry->d_off,
+                                &entry->d_off);
+
+                entry->d_stat.ia_ino = entry->d_ino;
+                entry->d_type = orig_entry->d_type;
+                entry->d_len  = orig_entry->d_len;
+
+                list_add_tail (&entry->list, &sv->entries.list);
+                sv->count++;
+                sv->offset = orig_entry->d_off;
+        }
+
+        if (op_errno == ENOENT)
+                sv->eof = 1;
+}
+
+
+static void
+dht_readdir_fetch (xlator_t *this, fd_t *fd, off_t *offsets, size_t size,
+                   uint32_t gen);
+
+/* a reply from subvolume @idx, or (!@sent) the request could not be sent */
+static void
+dht_readdir_fetch_done (xlator_t *this, fd_t *fd, int idx, uint32_t fetch_gen,
+                        size_t size, dht_layout_t *layout, gf_boolean_t sent,
+                        int op_ret, int op_errno, gf_dirent_t *orig_entries)
+{
+        dht_conf_t        *conf = NULL;
+        dht_readdir_ctx_t *ctx = NULL;
+        call_frame_t      *waiting = NULL;
+        int                waiting_op = 0;
+        int                count = 0;
+        int                serve_errno = 0;
+        uint32_t           gen = 0;
+        off_t             *offsets = NULL;
+        uint64_t           tmp_ctx = 0;
+        gf_dirent_t        entries;
+
+        conf = this->private;
+        INIT_LIST_HEAD (&entries.list);
+
+        fd_ctx_get (fd, this, &tmp_ctx);
+        ctx = (dht_readdir_ctx_t *)(long) tmp_ctx;
+        if (!ctx)
+                return;
+
+        offsets = alloca (conf->subvolume_cnt * sizeof (*offsets));
+
+        LOCK (&ctx->lock);
+        {
+                if (fetch_gen != ctx->gen) {
+                        offsets = NULL;
+                        goto unlock;
+                }
+
+                ctx->subvols[idx].pending = 0;
+
+                if (!sent) {
+                        /* trying again right away would most likely fail
+                           the same way, let the reader see the error */
+                        offsets = NULL;
+                        if (ctx->waiting) {
+                                waiting = ctx->waiting;
+                                waiting_op = ctx->waiting_op;
+                                ctx->waiting = NULL;
+                                count = -1;
+                                serve_errno = op_errno;
+                        }
+                        goto unlock;
+                }
+
+                __dht_readdir_buffer (this, ctx, idx, layout, op_ret,
+                                      op_errno, orig_entries);
+
+                if (ctx->waiting) {
+                        count = __dht_readdir_serve (this, ctx,
+                                                     ctx->waiting_size,
+                                                     &entries, &serve_errno);
+                        if (count >= 0) {
+                                waiting = ctx->waiting;
+                                waiting_op = ctx->waiting_op;
+                                ctx->waiting = NULL;
+                        }
+                }
+
+                __dht_readdir_prefetch (this, ctx, offsets);
+                gen = ctx->gen;
+        }
+unlock:
+        UNLOCK (&ctx->lock);
+
+        if (offsets)
+                dht_readdir_fetch (this, fd, offsets, size, gen);
+
+        if (waiting) {
+                dht_readdir_unwind (waiting, waiting_op, count, serve_errno,
+                                    &entries);
+                gf_dirent_free (&entries);
+        }
+}
+
+
+static int
+dht_readdir_fetch_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int op_ret, int op_errno, gf_dirent_t *orig_entries)
+{
+        dht_local_t *local = NULL;
+
+        local = frame->local;
+
+        dht_readdir_fetch_done (this, local->fd, (long) cookie,
+                                local->readdir_gen, local->size,
+                                local->layout, _gf_true, op_ret, op_errno,
+                                orig_entries);
+
+        DHT_STACK_DESTROY (frame);
+
+        return 0;
+}
+
+
+static void
+dht_readdir_fetch (xlator_t *this, fd_t *fd, off_t *offsets, size_t size,
+                   uint32_t gen)
+{
+        dht_conf_t   *conf = NULL;
+        call_frame_t *frame = NULL;
+        dht_local_t  *local = NULL;
+        xlator_t     *subvol = NULL;
+        int           i = 0;
+
+        conf = this->private;
+
+        for (i = 0; i < conf->subvolume_cnt; i++) {
+                if (offsets[i] == -1)
+                        continue;
+
+                subvol = conf->subvolumes[i];
+
+                frame = create_frame (this, this->ctx->pool);
+                if (!frame)
+                        goto fail;
+
+                local = dht_local_init (frame);
+                if (!local) {
+                        STACK_DESTROY (frame->root);
+                        goto fail;
+                }
+
+                local->fd = fd_ref (fd);
+                local->size = size;
+                local->readdir_gen = gen;
+                local->layout = dht_layout_get (this, fd->inode);
+
+                STACK_WIND_COOKIE (frame, dht_readdir_fetch_cbk,
+                                   (void *)(long) i, subvol,
+                                   subvol->fops->readdirp, fd, size,
+                                   offsets[i]);
+                continue;
+fail:
+                gf_log (this->name, GF_LOG_ERROR,
+                        "could not read ahead from %s", subvol->name);
+                dht_readdir_fetch_done (this, fd, i, gen, size, NULL,
+                                        _gf_false, -1, ENOMEM, NULL);
+        }
+}
+
+
+/* returns -1 when the request is to go the serial way */
+int
+dht_parallel_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                      size_t size, off_t yoff, int whichop)
+{
+        dht_conf_t        *conf = NULL;
+        dht_local_t       *local = NULL;
+        dht_readdir_ctx_t *ctx = NULL;
+        off_t             *offsets = NULL;
+        int                count = 0;
+        int                op_errno = 0;
+        int                busy = 0;
+        uint32_t           gen = 0;
+        gf_dirent_t        entries;
+
+        conf = this->private;
+        INIT_LIST_HEAD (&entries.list);
+
+        ctx = dht_readdir_ctx_get (this, fd);
+        if (!ctx)
+                return -1;
+
+        local = dht_local_init (frame);
+        if (!local)
+                return -1;
+
+        local->fd = fd_ref (fd);
+        local->size = size;
+
+        offsets = alloca (conf->subvolume_cnt * sizeof (*offsets));
+
+        LOCK (&ctx->lock);
+        {
+                /* another reader of this fd is already waiting */
+                if (ctx->waiting) {
+                        busy = 1;
+                        goto unlock;
+                }
+
+                if (!ctx->started || (yoff != ctx->next_off))
+                        __dht_readdir_ctx_reset (this, ctx, yoff);
+
+                count = __dht_readdir_serve (this, ctx, size, &entries,
+                                             &op_errno);
+                if (count < 0) {
+                        ctx->waiting = frame;
+                        ctx->waiting_op = whichop;
+                        ctx->waiting_size = size;
+                }
+
+                __dht_readdir_prefetch (this, ctx, offsets);
+                gen = ctx->gen;
+        }
+unlock:
+        UNLOCK (&ctx->lock);
+
+        if (busy) {
+                frame->local = NULL;
+                dht_local_wipe (this, local);
+                return -1;
+        }
+
+        /* the reply may unwind the frame and take local->fd with it */
+        fd_ref (fd);
+
+        if (count >= 0) {
+                dht_readdir_unwind (frame, whichop, count, op_errno,
+                                    &entries);
+                gf_dirent_free (&entries);
+        }
+
+        dht_readdir_fetch (this, fd, offsets, size, gen);
+
+        fd_unref (fd);
+
+        return 0;
+}
+
+
+int
+dht_releasedir (xlator_t *this, fd_t *fd)
+{
+        dht_conf_t        *conf = NULL;
+        dht_readdir_ctx_t *ctx = NULL;
+        uint64_t           tmp_ctx = 0;
+        int                i = 0;
+
+        conf = this->private;
+
+        fd_ctx_del (fd, this, &tmp_ctx);
+        ctx = (dht_readdir_ctx_t *)(long) tmp_ctx;
+        if (!ctx)
+                goto out;
+
+        for (i = 0; i < conf->subvolume_cnt; i++)
+                gf_dirent_free (&ctx->subvols[i].entries);
+
+        LOCK_DESTROY (&ctx->lock);
+        GF_FREE (ctx);
+out:
+        return 0;
+}
@@ -389,19 +389,105 @@ dht_selfheal_layout_alloc_start (xlator_t *this, loc_t *loc,
 }
 
 
+/* capacity of each subvolume getting a range, in MB, as last seen by
+   statfs. NULL if weights are off or some capacity is not known yet, in
+   which case every subvolume gets an equal share */
+static double *
+dht_selfheal_layout_weights (xlator_t *this, dht_layout_t *layout,
+                             double *total_p)
+{
+        dht_conf_t  *conf = NULL;
+        double      *weights = NULL;
+        double       total = 0;
+        int          i = 0;
+        int          j = 0;
+
+        conf = this->private;
+
+        if (!conf->weighted_layout)
+                goto out;
+
+        weights = GF_CALLOC (layout->cnt, sizeof (*weights),
+                             gf_dht_mt_double_t);
+        if (!weights)
+                goto out;
+
+        LOCK (&conf->subvolume_lock);
+        {
+                for (i = 0; i < layout->cnt; i++) {
+                        if (layout->list[i].err != -1)
+                                continue;
+
+                        for (j = 0; j < conf->subvolume_cnt; j++) {
+                                if (conf->subvolumes[j]
+                                    == layout->list[i].xlator)
+                                        break;
+                        }
+
+                        if (j == conf->subvolume_cnt
+                            || !conf->du_stats[j].total_space) {
+                                total = 0;
+                                break;
+                        }
+
+                        weights[i] = conf->du_stats[j].total_space
+                                / (double) GF_UNIT_MB;
+                        total += weights[i];
+                }
+        }
+        UNLOCK (&conf->subvolume_lock);
+
+        if (total == 0) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "capacity of some subvolume not known, giving "
+                        "out equal ranges");
+                GF_FREE (weights);
+                weights = NULL;
+                goto out;
+        }
+
+        /* equal capacities get the integer split, rounding the weighted
+           ranges could move their boundaries */
+        for (i = 0, j = -1; i < layout->cnt; i++) {
+                if (layout->list[i].err != -1)
+                        continue;
+                if ((j != -1) && (weights[i] != weights[j]))
+                        break;
+                j = i;
+        }
+
+        if (i == layout->cnt) {
+                GF_FREE (weights);
+                weights = NULL;
+        }
+out:
+        *total_p = total;
+        return weights;
+}
+
+
 void
 dht_selfheal_layout_new_directory (call_frame_t *frame, loc_t *loc,
                                    dht_layout_t *layout)
 {
         xlator_t    *this = NULL;
+        dht_conf_t  *conf = NULL;
         uint32_t     chunk = 0;
         int          i = 0;
+        int          j = 0;
         uint32_t     start = 0;
         int          cnt = 0;
         int          err = 0;
         int          start_subvol = 0;
+        double      *weights = NULL;
+        double       total_weight = 0;
 
         this = frame->this;
+        conf = this->private;
+
+        /* every range is handed out afresh, so the directory can move to
+           the configured hash type */
+        layout->type = conf->hash_type;
 
         for (i = 0; i < layout->cnt; i++) {
                 err = layout->list[i].err;
@@ -424,45 +510,89 @@ dht_selfheal_layout_new_directory (call_frame_t *frame, loc_t *loc,
 
         chunk = ((unsigned long) 0xffffffff) / ((cnt) ? cnt : 1);
 
+        weights = dht_selfheal_layout_weights (this, layout, &total_weight);
+
         start_subvol = dht_selfheal_layout_alloc_start (this, loc, layout);
 
-        for (i = start_subvol; i < layout->cnt; i++) {
+        for (j = 0; j < layout->cnt; j++) {
+                i = (start_subvol + j) % layout->cnt;
+
                 err = layout->list[i].err;
-                if (err == -1) {
-                        layout->list[i].start = start;
-                        layout->list[i].stop  = start + chunk - 1;
+                if (err != -1)
+                        continue;
 
-                        start = start + chunk;
+                if (weights) {
+                        chunk = (uint32_t) (((double) 0xffffffff)
+                                            * weights[i] / total_weight);
+                        if (!chunk)
+                                chunk = 1;
+                }
 
-                        gf_log (this->name, GF_LOG_TRACE,
-                                "gave fix: %u - %u on %s for %s",
-                                layout->list[i].start, layout->list[i].stop,
-                                layout->list[i].xlator->name, loc->path);
-                        if (--cnt == 0) {
-                                layout->list[i].stop = 0xffffffff;
-                                break;
-                        }
+                layout->list[i].start = start;
+                layout->list[i].stop  = start + chunk - 1;
+
+                start = start + chunk;
+
+                gf_log (this->name, GF_LOG_TRACE,
+                        "gave fix: %u - %u on %s for %s",
+                        layout->list[i].start, layout->list[i].stop,
+                        layout->list[i].xlator->name, loc->path);
+                if (--cnt == 0) {
+                        layout->list[i].stop = 0xffffffff;
+                        break;
                 }
         }
 
-        for (i = 0; i < start_subvol; i++) {
-                err = layout->list[i].err;
-                if (err == -1) {
-                        layout->list[i].start = start;
-                        layout->list[i].stop  = start + chunk - 1;
+        if (weights)
+                GF_FREE (weights);
+}
 
-                        start = start + chunk;
 
-                        gf_log (this->name, GF_LOG_TRACE,
-                                "gave fix: %u - %u on %s for %s",
-                                layout->list[i].start, layout->list[i].stop,
-                                layout->list[i].xlator->name, loc->path);
-                        if (--cnt == 0) {
-                                layout->list[i].stop = 0xffffffff;
+/* whether handing out the ranges of @layout afresh would change any of
+   them, i.e. whether a fix-layout has anything to write */
+int
+dht_selfheal_layout_changed (call_frame_t *frame, loc_t *loc,
+                             dht_layout_t *layout)
+{
+        xlator_t     *this = NULL;
+        dht_layout_t *fresh = NULL;
+        int           changed = 1;
+        int           i = 0;
+        int           j = 0;
+
+        this = frame->this;
+
+        fresh = dht_layout_new (this, layout->cnt);
+        if (!fresh)
+                goto out;
+
+        fresh->type = layout->type;
+        memcpy (fresh->list, layout->list,
+                layout->cnt * sizeof (layout->list[0]));
+
+        dht_layout_sort_volname (fresh);
+        dht_selfheal_layout_new_directory (frame, loc, fresh);
+
+        if (fresh->type != layout->type)
+                goto out;
+
+        for (i = 0; i < fresh->cnt; i++) {
+                for (j = 0; j < layout->cnt; j++) {
+                        if (layout->list[j].xlator == fresh->list[i].xlator)
                                 break;
-                        }
                 }
+
+                if ((layout->list[j].start != fresh->list[i].start)
+                    || (layout->list[j].stop != fresh->list[i].stop))
+                        goto out;
         }
+
+        changed = 0;
+out:
+        if (fresh)
+                dht_layout_unref (this, fresh);
+
+        return changed;
 }
 
 
@@ -159,6 +159,12 @@ dht_priv_dump (xlator_t *this)
         }
         gf_proc_dump_build_key(key, key_prefix, "last_stat_fetch");
         gf_proc_dump_write(key, "%s", ctime(&conf->last_stat_fetch.tv_sec));
+        if (conf->linkcache) {
+                gf_proc_dump_build_key(key, key_prefix, "linkcache_hits");
+                gf_proc_dump_write(key, "%"PRIu64, conf->linkcache_hits);
+                gf_proc_dump_build_key(key, key_prefix, "linkcache_misses");
+                gf_proc_dump_write(key, "%"PRIu64, conf->linkcache_misses);
+        }
 
         UNLOCK(&conf->subvolume_lock);
 
@@ -235,6 +241,8 @@ fini (xlator_t *this)
                 if (conf->subvolume_status)
                         GF_FREE (conf->subvolume_status);
 
+                dht_linkcache_fini (this, conf);
+
                 GF_FREE (conf);
         }
 out:
@@ -346,6 +354,48 @@ reconfigure (xlator_t *this, dict_t *options)
                        " min-free-disk reconfigured to %s",
                        temp_str);
         }
+
+        if (dict_get_str (options, "weighted-layout", &temp_str) == 0) {
+                if (gf_string2boolean (temp_str, &conf->weighted_layout)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfigure:"
+                                " weighted-layout should be boolean, not (%s)",
+                                temp_str);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        if (dict_get_str (options, "parallel-readdir", &temp_str) == 0) {
+                if (gf_string2boolean (temp_str, &conf->parallel_readdir)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfigure:"
+                                " parallel-readdir should be boolean, not (%s)",
+                                temp_str);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        if (dict_get_str (options, "linkfile-cache", &temp_str) == 0) {
+                if (gf_string2boolean (temp_str, &conf->linkfile_cache)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfigure:"
+                                " linkfile-cache should be boolean, not (%s)",
+                                temp_str);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        if (dict_get_str (options, "hash-type", &temp_str) == 0) {
+                if (dht_hash_type_from_str (temp_str, &conf->hash_type)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfigure:"
+                                " invalid hash-type (%s)", temp_str);
+                        ret = -1;
+                        goto out;
+                }
+
+                gf_log (this->name, GF_LOG_DEBUG, "Reconfigure:"
+                        " hash-type reconfigured to %s", temp_str);
+        }
         ret = 0;
 out:
         return ret;
@@ -439,6 +489,33 @@ init (xlator_t *this)
                 }
         }
 
+        conf->weighted_layout = _gf_false;
+        if (dict_get_str (this->options, "weighted-layout",
+                          &temp_str) == 0) {
+                gf_string2boolean (temp_str, &conf->weighted_layout);
+        }
+
+        conf->parallel_readdir = 0;
+        if (dict_get_str (this->options, "parallel-readdir",
+                          &temp_str) == 0) {
+                gf_string2boolean (temp_str, &conf->parallel_readdir);
+        }
+
+        conf->linkfile_cache = _gf_true;
+        if (dict_get_str (this->options, "linkfile-cache",
+                          &temp_str) == 0) {
+                gf_string2boolean (temp_str, &conf->linkfile_cache);
+        }
+
+        conf->hash_type = DHT_HASH_TYPE_DM;
+        if (dict_get_str (this->options, "hash-type", &temp_str) == 0) {
+                if (dht_hash_type_from_str (temp_str, &conf->hash_type)) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid hash-type (%s)", temp_str);
+                        goto err;
+                }
+        }
+
         conf->assert_no_child_down = 0;
 
         ret = dict_get_str_boolean (this->options, "assert-no-child-down", 0);
@@ -470,6 +547,11 @@ init (xlator_t *this)
                 goto err;
         }
 
+        ret = dht_linkcache_init (this, conf);
+        if (ret == -1) {
+                goto err;
+        }
+
         LOCK_INIT (&conf->subvolume_lock);
         LOCK_INIT (&conf->layout_lock);
 
@@ -527,6 +609,7 @@ struct xlator_fops fops = {
         .writev      = dht_writev,
         .flush       = dht_flush,
         .fsync       = dht_fsync,
+        .compound    = dht_compound,
         .statfs      = dht_statfs,
         .lk          = dht_lk,
         .opendir     = dht_opendir,
@@ -557,7 +640,7 @@ struct xlator_dumpops dumpops = {
 
 struct xlator_cbks cbks = {
 //      .release    = dht_release,
-//      .releasedir = dht_releasedir,
+        .releasedir = dht_releasedir,
         .forget     = dht_forget
 };
 
@@ -583,5 +666,35 @@ struct volume_options options[] = {
         { .key = {"assert-no-child-down"},
           .type = GF_OPTION_TYPE_BOOL
         },
+        { .key = {"weighted-layout"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Size the hash ranges of new and fixed directory "
+                         "layouts in proportion to the capacity of each "
+                         "subvolume. Off by default, so that existing "
+                         "layouts keep their even split."
+        },
+        { .key = {"parallel-readdir"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Read directories from all subvolumes at once, "
+                         "keeping a few entries of each buffered per fd."
+        },
+        { .key = {"linkfile-cache"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "on",
+          .description = "Remember which subvolume holds the data of files "
+                         "found behind a linkfile, and look them up there "
+                         "directly the next time."
+        },
+        { .key  = {"hash-type"},
+          .value = {"dm", "xxh32"},
+          .type = GF_OPTION_TYPE_STR,
+          .default_value = "dm",
+          .description = "Hash function used in the layouts of new "
+                         "directories and of directories whose layout is "
+                         "fixed. Existing layouts keep the hash they were "
+                         "written with."
+        },
         { .key  = {NULL} },
 };
@@ -703,6 +703,7 @@ struct xlator_fops fops = {
         .writev      = dht_writev,
         .flush       = dht_flush,
         .fsync       = dht_fsync,
+        .compound    = dht_compound,
         .statfs      = dht_statfs,
         .lk          = dht_lk,
         .opendir     = dht_opendir,
@@ -101,6 +101,150 @@ out:
 }
 
 
+/**
+ * stripe_child_index - Position of @subvol among the children, which is
+ *     also the stripe-index it was given when the file was created.
+ */
+int32_t
+stripe_child_index (xlator_t *this, xlator_t *subvol)
+{
+        stripe_private_t *priv = NULL;
+        int32_t           i    = 0;
+
+        priv = this->private;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if (priv->xl_array[i] == subvol)
+                        return i;
+        }
+
+        return -1;
+}
+
+/*
+ * Files created with 'option coalesce on' keep their stripe blocks back to
+ * back on each child instead of at their logical offsets: logical block 'b'
+ * lives on child (b % count) at offset (b / count) * stripe_size. All the
+ * blocks a child holds for a given range are then contiguous in its file,
+ * so a read or write needs only one call per child.
+ */
+off_t
+stripe_coalesced_offset (off_t offset, uint64_t stripe_size,
+                         int32_t stripe_count)
+{
+        off_t size = stripe_size;
+
+        return ((offset / (size * stripe_count)) * size) + (offset % size);
+}
+
+/**
+ * stripe_coalesced_first - First byte at or after @offset that child @index
+ *     holds.
+ */
+off_t
+stripe_coalesced_first (off_t offset, uint64_t stripe_size,
+                        int32_t stripe_count, int32_t index)
+{
+        off_t block = 0;
+        off_t skip  = 0;
+
+        block = offset / (off_t)stripe_size;
+        skip  = (index - (block % stripe_count) + stripe_count) % stripe_count;
+        if (!skip)
+                return offset;
+
+        return (block + skip) * (off_t)stripe_size;
+}
+
+/**
+ * stripe_coalesced_size - Size of the file on child @index once the whole
+ *     file is @size bytes long.
+ */
+off_t
+stripe_coalesced_size (off_t size, uint64_t stripe_size,
+                       int32_t stripe_count, int32_t index)
+{
+        off_t block = stripe_size;
+        off_t rem   = 0;
+
+        rem = (size % (block * stripe_count)) - (index * block);
+        if (rem < 0)
+                rem = 0;
+        if (rem > block)
+                rem = block;
+
+        return ((size / (block * stripe_count)) * block) + rem;
+}
+
+/**
+ * stripe_uncoalesced_size - Logical file size implied by child @index
+ *     holding @size bytes.
+ */
+off_t
+stripe_uncoalesced_size (off_t size, uint64_t stripe_size,
+                         int32_t stripe_count, int32_t index)
+{
+        off_t block = stripe_size;
+
+        if ((size <= 0) || (index < 0))
+                return size;
+
+        return (((size - 1) / block) * block * stripe_count) +
+                (index * block) + ((size - 1) % block) + 1;
+}
+
+/* The inode context holds the stripe-size of files using the coalesced
+ * layout, learnt from the 'stripe-coalesce' xattr. */
+uint64_t
+stripe_coalesce_ctx_get (xlator_t *this, inode_t *inode)
+{
+        uint64_t stripe_size = 0;
+
+        if (inode)
+                inode_ctx_get (inode, this, &stripe_size);
+
+        return stripe_size;
+}
+
+uint64_t
+stripe_coalesce_xattr_get (xlator_t *this, dict_t *dict)
+{
+        char     key[256]    = {0,};
+        uint64_t stripe_size = 0;
+        int      ret         = 0;
+
+        if (!dict)
+                goto out;
+
+        sprintf (key, "trusted.%s.stripe-coalesce", this->name);
+        ret = dict_get_uint64 (dict, key, &stripe_size);
+        if (ret)
+                stripe_size = 0;
+out:
+        return stripe_size;
+}
+
+/**
+ * stripe_coalesce_iatt - Convert the size a child reported for a coalesced
+ *     file into the logical size it implies.
+ */
+void
+stripe_coalesce_iatt (xlator_t *this, stripe_local_t *local,
+                      xlator_t *subvol, struct iatt *buf)
+{
+        stripe_private_t *priv = NULL;
+
+        if (!local->coalesce || !buf)
+                return;
+
+        priv = this->private;
+        buf->ia_size = stripe_uncoalesced_size (buf->ia_size, local->coalesce,
+                                                priv->child_count,
+                                                stripe_child_index (this,
+                                                                    subvol));
+}
+
+
 
 int32_t
 stripe_sh_chown_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
@@ -328,6 +472,11 @@ stripe_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 if (op_ret >= 0) {
                         local->op_ret = 0;
 
+                        if (!local->coalesce)
+                                local->coalesce =
+                                        stripe_coalesce_xattr_get (this, dict);
+                        stripe_coalesce_iatt (this, local, prev->this, buf);
+
                         if (FIRST_CHILD(this) == prev->this) {
                                 local->stbuf      = *buf;
                                 local->postparent = *postparent;
@@ -381,6 +530,10 @@ stripe_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         local->stbuf.ia_size        = local->stbuf_size;
                         local->postparent.ia_blocks = local->postparent_blocks;
                         local->postparent.ia_size   = local->postparent_size;
+
+                        if (local->coalesce && local->inode)
+                                inode_ctx_put (local->inode, this,
+                                               local->coalesce);
                 }
 
                 STRIPE_STACK_UNWIND (lookup, frame, local->op_ret,
@@ -402,6 +555,8 @@ stripe_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
         int32_t           op_errno = EINVAL;
         int64_t           filesize = 0;
         int               ret = 0;
+        dict_t           *dict = NULL;
+        char              key[256] = {0,};
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -429,6 +584,28 @@ stripe_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
                         dict_del (xattr_req, GF_CONTENT_KEY);
         }
 
+        local->coalesce = stripe_coalesce_ctx_get (this, loc->inode);
+
+        /* The sizes of files with the coalesced layout can only be
+           interpreted once it is known they are coalesced */
+        if (priv->xattr_supported && !local->coalesce) {
+                if (xattr_req)
+                        dict = dict_ref (xattr_req);
+                else
+                        dict = dict_new ();
+
+                if (dict) {
+                        sprintf (key, "trusted.%s.stripe-coalesce",
+                                 this->name);
+                        ret = dict_set_int64 (dict, key, 8);
+                        if (ret)
+                                gf_log (this->name, GF_LOG_WARNING,
+                                        "failed to set %s in xattr_req dict",
+                                        key);
+                        xattr_req = dict;
+                }
+        }
+
         /* Everytime in stripe lookup, all child nodes
            should be looked up */
         local->call_count = priv->child_count;
@@ -439,6 +616,9 @@ stripe_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 trav = trav->next;
         }
 
+        if (dict)
+                dict_unref (dict);
+
         return 0;
 err:
         STRIPE_STACK_UNWIND (lookup, frame, -1, op_errno, NULL, NULL, NULL, NULL);
@@ -477,6 +657,7 @@ stripe_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
                 if (op_ret == 0) {
                         local->op_ret = 0;
+                        stripe_coalesce_iatt (this, local, prev->this, buf);
 
                         if (FIRST_CHILD(this) == prev->this) {
                                 local->stbuf = *buf;
@@ -536,6 +717,7 @@ stripe_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, loc->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
@@ -672,6 +854,9 @@ stripe_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
                 if (op_ret == 0) {
                         local->op_ret = 0;
+                        stripe_coalesce_iatt (this, local, prev->this, prebuf);
+                        stripe_coalesce_iatt (this, local, prev->this, postbuf);
+
                         if (FIRST_CHILD(this) == prev->this) {
                                 local->pre_buf  = *prebuf;
                                 local->post_buf = *postbuf;
@@ -715,6 +900,8 @@ stripe_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
         stripe_local_t   *local = NULL;
         stripe_private_t *priv = NULL;
         int32_t           op_errno = EINVAL;
+        int32_t           idx = 0;
+        off_t             child_offset = 0;
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -739,12 +926,20 @@ stripe_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, loc->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
+                child_offset = offset;
+                if (local->coalesce)
+                        child_offset = stripe_coalesced_size (offset,
+                                                              local->coalesce,
+                                                              priv->child_count,
+                                                              idx);
                 STACK_WIND (frame, stripe_truncate_cbk, trav->xlator,
-                            trav->xlator->fops->truncate, loc, offset);
+                            trav->xlator->fops->truncate, loc, child_offset);
                 trav = trav->next;
+                idx++;
         }
 
         return 0;
@@ -787,6 +982,8 @@ stripe_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
                 if (op_ret == 0) {
                         local->op_ret = 0;
+                        stripe_coalesce_iatt (this, local, prev->this, preop);
+                        stripe_coalesce_iatt (this, local, prev->this, postop);
 
                         if (FIRST_CHILD(this) == prev->this) {
                                 local->pre_buf  = *preop;
@@ -856,6 +1053,7 @@ stripe_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, loc->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
@@ -898,6 +1096,7 @@ stripe_fsetattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, fd->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
@@ -1474,6 +1673,10 @@ stripe_mknod_ifreg_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         local->postparent.ia_size   = local->postparent_size;
                         local->stbuf.ia_size        = local->stbuf_size;
                         local->stbuf.ia_blocks      = local->stbuf_blocks;
+
+                        if (local->coalesce)
+                                inode_ctx_put (local->inode, this,
+                                               local->coalesce);
                 }
 
                 /* Create itself has failed.. so return
@@ -1511,6 +1714,7 @@ stripe_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
         char              size_key[256]  = {0,};
         char              index_key[256] = {0,};
         char              count_key[256] = {0,};
+        char              coalesce_key[256] = {0,};
         dict_t           *dict           = NULL;
         int               ret            = 0;
         int               need_unref     = 0;
@@ -1568,6 +1772,10 @@ stripe_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
                          "trusted.%s.stripe-count", this->name);
                 sprintf (index_key,
                          "trusted.%s.stripe-index", this->name);
+                sprintf (coalesce_key,
+                         "trusted.%s.stripe-coalesce", this->name);
+                if (priv->coalesce && priv->xattr_supported)
+                        local->coalesce = local->stripe_size;
 
                 while (trav) {
                         if (priv->xattr_supported) {
@@ -1596,6 +1804,17 @@ stripe_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
                                         gf_log (this->name, GF_LOG_ERROR,
                                                 "%s: set stripe-index failed",
                                                 loc->path);
+                                if (local->coalesce) {
+                                        ret = dict_set_uint64 (dict,
+                                                               coalesce_key,
+                                                               local->coalesce);
+                                        if (ret)
+                                                gf_log (this->name,
+                                                        GF_LOG_ERROR,
+                                                        "%s: set stripe-"
+                                                        "coalesce failed",
+                                                        loc->path);
+                                }
                         } else {
                                 dict = params;
                         }
@@ -2006,9 +2225,14 @@ stripe_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         fctx->stripe_size  = local->stripe_size;
                         fctx->stripe_count = priv->child_count;
                         fctx->static_array = 1;
+                        fctx->coalesce     = !!local->coalesce;
                         fctx->xl_array = priv->xl_array;
                         fd_ctx_set (local->fd, this,
                                     (uint64_t)(long)fctx);
+
+                        if (local->coalesce)
+                                inode_ctx_put (local->inode, this,
+                                               local->coalesce);
                 }
 
         unwind:
@@ -2045,6 +2269,7 @@ stripe_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
         char              size_key[256]  = {0,};
         char              index_key[256] = {0,};
         char              count_key[256] = {0,};
+        char              coalesce_key[256] = {0,};
         dict_t           *dict           = NULL;
 
         VALIDATE_OR_GOTO (frame, err);
@@ -2088,6 +2313,9 @@ stripe_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
         sprintf (size_key, "trusted.%s.stripe-size", this->name);
         sprintf (count_key, "trusted.%s.stripe-count", this->name);
         sprintf (index_key, "trusted.%s.stripe-index", this->name);
+        sprintf (coalesce_key, "trusted.%s.stripe-coalesce", this->name);
+        if (priv->coalesce && priv->xattr_supported)
+                local->coalesce = local->stripe_size;
 
         trav = this->children;
         while (trav) {
@@ -2117,6 +2345,14 @@ stripe_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
                                 gf_log (this->name, GF_LOG_ERROR,
                                         "%s: set stripe-index failed",
                                         loc->path);
+                        if (local->coalesce) {
+                                ret = dict_set_uint64 (dict, coalesce_key,
+                                                       local->coalesce);
+                                if (ret)
+                                        gf_log (this->name, GF_LOG_ERROR,
+                                                "%s: set stripe-coalesce "
+                                                "failed", loc->path);
+                        }
                 } else {
                         dict = params;
                 }
@@ -2268,6 +2504,11 @@ stripe_open_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                 local->xattr_self_heal_needed = 1;
                         }
                 }
+                /* Coalesced layout */
+                sprintf (key, "trusted.%s.stripe-coalesce", this->name);
+                if (dict_get (dict, key))
+                        local->fctx->coalesce = 1;
+
                 /* Stripe count */
                 sprintf (key, "trusted.%s.stripe-count", this->name);
                 data = dict_get (dict, key);
@@ -2363,6 +2604,9 @@ unlock:
                         local->op_errno = EIO;
                         goto err;
                 }
+                if (local->fctx->coalesce)
+                        inode_ctx_put (local->loc.inode, this,
+                                       local->fctx->stripe_size);
 
                 local->call_count = local->fctx->stripe_count;
 
@@ -2457,6 +2701,12 @@ stripe_open (call_frame_t *frame, xlator_t *this, loc_t *loc,
                         gf_log (this->name, GF_LOG_WARNING,
                                 "failed to set %s in xattr_req dict", key);
 
+                sprintf (key, "trusted.%s.stripe-coalesce", this->name);
+                ret = dict_set_int64 (dict, key, 8);
+                if (ret)
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "failed to set %s in xattr_req dict", key);
+
                 while (trav) {
                         STACK_WIND (frame, stripe_open_lookup_cbk,
                                     trav->xlator, trav->xlator->fops->lookup,
@@ -2792,6 +3042,9 @@ stripe_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 }
                 if (op_ret >= 0) {
                         local->op_ret = op_ret;
+                        stripe_coalesce_iatt (this, local, prev->this, prebuf);
+                        stripe_coalesce_iatt (this, local, prev->this, postbuf);
+
                         if (FIRST_CHILD(this) == prev->this) {
                                 local->pre_buf  = *prebuf;
                                 local->post_buf = *postbuf;
@@ -2852,6 +3105,7 @@ stripe_fsync (call_frame_t *frame, xlator_t *this, fd_t *fd, int32_t flags)
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, fd->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
@@ -2898,6 +3152,7 @@ stripe_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
                 if (op_ret == 0) {
                         local->op_ret = 0;
+                        stripe_coalesce_iatt (this, local, prev->this, buf);
 
                         if (FIRST_CHILD(this) == prev->this)
                                 local->stbuf = *buf;
@@ -2953,6 +3208,7 @@ stripe_fstat (call_frame_t *frame,
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, fd->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
@@ -2975,6 +3231,8 @@ stripe_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset)
         stripe_private_t *priv = NULL;
         xlator_list_t    *trav = NULL;
         int32_t           op_errno = 1;
+        int32_t           idx = 0;
+        off_t             child_offset = 0;
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -2993,12 +3251,20 @@ stripe_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset)
         }
         local->op_ret = -1;
         frame->local = local;
+        local->coalesce = stripe_coalesce_ctx_get (this, fd->inode);
         local->call_count = priv->child_count;
 
         while (trav) {
+                child_offset = offset;
+                if (local->coalesce)
+                        child_offset = stripe_coalesced_size (offset,
+                                                              local->coalesce,
+                                                              priv->child_count,
+                                                              idx);
                 STACK_WIND (frame, stripe_truncate_cbk, trav->xlator,
-                            trav->xlator->fops->ftruncate, fd, offset);
+                            trav->xlator->fops->ftruncate, fd, child_offset);
                 trav = trav->next;
+                idx++;
         }
 
         return 0;
@@ -3322,6 +3588,384 @@ end:
 }
 
 
+/*
+ * Reads on files with the coalesced layout send one readv to every child
+ * holding part of the range. The replies are then cut back into stripe
+ * blocks and put in logical order, zero filling holes inside the file.
+ */
+int32_t
+stripe_coalesced_readv_unwind (call_frame_t *frame, xlator_t *this, off_t end)
+{
+        stripe_local_t       *local     = NULL;
+        stripe_fd_ctx_t      *fctx      = NULL;
+        struct readv_replies *reply     = NULL;
+        struct iovec         *vec       = NULL;
+        struct iobuf         *iobuf     = NULL;
+        struct iobref        *iobref    = NULL;
+        struct iatt           stbuf     = {0,};
+        size_t                page_size = 0;
+        off_t                 limit     = 0;
+        off_t                 pos       = 0;
+        off_t                 len       = 0;
+        off_t                 take      = 0;
+        off_t                 fill      = 0;
+        int32_t               count     = 0;
+        int32_t               pass      = 0;
+        int32_t               idx       = 0;
+        int32_t               op_ret    = -1;
+        int32_t               op_errno  = ENOMEM;
+
+        local = frame->local;
+        fctx  = local->fctx;
+        page_size = iobpool_pagesize ((struct iobuf_pool *)
+                                      this->ctx->iobuf_pool);
+
+        /* Never cut off data a child did return, even if the size
+           seen by the fstat()s is older than it */
+        limit = max (end, local->offset);
+        pos = local->offset;
+        while (pos < (local->offset + local->readv_size)) {
+                idx = (pos / fctx->stripe_size) % fctx->stripe_count;
+                len = min (roof (pos + 1, fctx->stripe_size),
+                           (local->offset + local->readv_size)) - pos;
+                reply = &local->replies[idx];
+                take = min (len, (reply->op_ret - reply->consumed));
+                if ((take > 0) && (limit < (pos + take)))
+                        limit = pos + take;
+                if (take > 0)
+                        reply->consumed += take;
+                pos += len;
+        }
+
+        /* First pass counts the vectors, second one fills them in */
+        for (pass = 0; pass < 2; pass++) {
+                for (idx = 0; idx < fctx->stripe_count; idx++)
+                        local->replies[idx].consumed = 0;
+
+                count = 0;
+                pos = local->offset;
+                while (pos < limit) {
+                        idx = (pos / fctx->stripe_size) % fctx->stripe_count;
+                        len = min (roof (pos + 1, fctx->stripe_size),
+                                   limit) - pos;
+                        reply = &local->replies[idx];
+                        take = min (len, (reply->op_ret - reply->consumed));
+                        if (take > 0) {
+                                count += iov_subset (reply->vector,
+                                                     reply->count,
+                                                     reply->consumed,
+                                                     reply->consumed + take,
+                                                     vec ? (vec + count) :
+                                                     NULL);
+                                reply->consumed += take;
+                        } else {
+                                take = 0;
+                        }
+
+                        /* hole inside the file */
+                        for (fill = len - take; fill > 0;
+                             fill -= min (fill, page_size)) {
+                                if (vec) {
+                                        vec[count].iov_base = iobuf->ptr;
+                                        vec[count].iov_len  =
+                                                min (fill, page_size);
+                                }
+                                count++;
+                        }
+                        pos += len;
+                }
+
+                if (vec || !count)
+                        break;
+
+                vec = GF_CALLOC (count, sizeof (struct iovec),
+                                 gf_stripe_mt_iovec);
+                if (!vec)
+                        goto unwind;
+
+                iobuf = iobuf_get (this->ctx->iobuf_pool);
+                if (!iobuf)
+                        goto unwind;
+                memset (iobuf->ptr, 0, page_size);
+
+                if (!local->iobref)
+                        local->iobref = iobref_new ();
+                if (!local->iobref)
+                        goto unwind;
+                iobref_add (local->iobref, iobuf);
+        }
+
+        op_ret   = limit - local->offset;
+        op_errno = 0;
+
+        for (idx = 0; idx < fctx->stripe_count; idx++) {
+                reply = &local->replies[idx];
+                if (!reply->requested_size)
+                        continue;
+                if (stbuf.ia_size <= reply->stbuf.ia_size)
+                        stbuf = reply->stbuf;
+        }
+        if (stbuf.ia_size < local->stbuf_size)
+                stbuf.ia_size = local->stbuf_size;
+
+unwind:
+        if (op_ret == -1)
+                count = 0;
+        if (iobuf)
+                iobuf_unref (iobuf);
+
+        for (idx = 0; idx < fctx->stripe_count; idx++) {
+                if (local->replies[idx].vector)
+                        GF_FREE (local->replies[idx].vector);
+        }
+        GF_FREE (local->replies);
+        local->replies = NULL;
+
+        iobref = local->iobref;
+        local->iobref = NULL;
+
+        STRIPE_STACK_UNWIND (readv, frame, op_ret, op_errno, vec, count,
+                             &stbuf, iobref);
+
+        if (iobref)
+                iobref_unref (iobref);
+        if (vec)
+                GF_FREE (vec);
+
+        return 0;
+}
+
+int32_t
+stripe_coalesced_readv_fstat_cbk (call_frame_t *frame, void *cookie,
+                                  xlator_t *this, int32_t op_ret,
+                                  int32_t op_errno, struct iatt *buf)
+{
+        int32_t         callcnt = 0;
+        stripe_local_t *local = NULL;
+        call_frame_t   *prev = NULL;
+
+        if (!this || !frame || !frame->local || !cookie) {
+                gf_log ("stripe", GF_LOG_DEBUG, "possible NULL deref");
+                goto out;
+        }
+
+        prev  = cookie;
+        local = frame->local;
+
+        LOCK (&frame->lock);
+        {
+                callcnt = --local->call_count;
+                if (op_ret != -1) {
+                        stripe_coalesce_iatt (this, local, prev->this, buf);
+                        if (local->stbuf_size < buf->ia_size)
+                                local->stbuf_size = buf->ia_size;
+                }
+        }
+        UNLOCK (&frame->lock);
+
+        if (!callcnt)
+                stripe_coalesced_readv_unwind (frame, this,
+                                               min ((local->offset +
+                                                     local->readv_size),
+                                                    local->stbuf_size));
+out:
+        return 0;
+}
+
+int32_t
+stripe_coalesced_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno,
+                            struct iovec *vector, int32_t count,
+                            struct iatt *stbuf, struct iobref *iobref)
+{
+        int32_t               index = 0;
+        int32_t               callcnt = 0;
+        int32_t               short_read = 0;
+        call_frame_t         *mframe = NULL;
+        call_frame_t         *prev = NULL;
+        stripe_local_t       *mlocal = NULL;
+        stripe_local_t       *local = NULL;
+        stripe_fd_ctx_t      *fctx = NULL;
+        struct readv_replies *reply = NULL;
+
+        if (!this || !frame || !frame->local || !cookie) {
+                gf_log ("stripe", GF_LOG_DEBUG, "possible NULL deref");
+                goto end;
+        }
+
+        prev   = cookie;
+        local  = frame->local;
+        mframe = local->orig_frame;
+        if (!mframe)
+                goto out;
+
+        mlocal = mframe->local;
+        if (!mlocal)
+                goto out;
+
+        fctx  = mlocal->fctx;
+        reply = &mlocal->replies[local->node_index];
+
+        LOCK (&mframe->lock);
+        {
+                reply->op_ret   = op_ret;
+                reply->op_errno = op_errno;
+                if (op_ret >= 0) {
+                        stripe_coalesce_iatt (this, mlocal, prev->this, stbuf);
+                        reply->stbuf  = *stbuf;
+                        reply->count  = count;
+                        reply->vector = iov_dup (vector, count);
+
+                        if (!mlocal->iobref)
+                                mlocal->iobref = iobref_new ();
+                        iobref_merge (mlocal->iobref, iobref);
+                }
+                callcnt = ++mlocal->call_count;
+        }
+        UNLOCK (&mframe->lock);
+
+        if (callcnt != mlocal->wind_count)
+                goto out;
+
+        for (index = 0; index < fctx->stripe_count; index++) {
+                reply = &mlocal->replies[index];
+                if (!reply->requested_size)
+                        continue;
+
+                if (reply->op_ret == -1) {
+                        op_errno = reply->op_errno;
+                        for (index = 0; index < fctx->stripe_count; index++) {
+                                if (mlocal->replies[index].vector)
+                                        GF_FREE (mlocal->replies[index].vector);
+                        }
+                        GF_FREE (mlocal->replies);
+                        mlocal->replies = NULL;
+                        STRIPE_STACK_UNWIND (readv, mframe, -1, op_errno,
+                                             NULL, 0, NULL, NULL);
+                        goto out;
+                }
+                if (reply->op_ret < reply->requested_size)
+                        short_read = 1;
+        }
+
+        if (!short_read) {
+                stripe_coalesced_readv_unwind (mframe, this,
+                                               (mlocal->offset +
+                                                mlocal->readv_size));
+                goto out;
+        }
+
+        /* A child ran out of data: it is either the end of the file
+           or a hole, which only the size of the whole file tells */
+        mlocal->call_count = fctx->stripe_count;
+        for (index = 0; index < fctx->stripe_count; index++) {
+                STACK_WIND (mframe, stripe_coalesced_readv_fstat_cbk,
+                            fctx->xl_array[index],
+                            fctx->xl_array[index]->fops->fstat, mlocal->fd);
+        }
+
+out:
+        STRIPE_STACK_DESTROY (frame);
+end:
+        return 0;
+}
+
+int32_t
+stripe_coalesced_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                        stripe_fd_ctx_t *fctx, size_t size, off_t offset)
+{
+        stripe_local_t       *local = NULL;
+        stripe_local_t       *rlocal = NULL;
+        call_frame_t         *rframe = NULL;
+        struct readv_replies *reply = NULL;
+        struct iatt           stbuf = {0,};
+        int32_t               op_errno = ENOMEM;
+        int32_t               idx = 0;
+        off_t                 pos = 0;
+        off_t                 end = 0;
+
+        local = GF_CALLOC (1, sizeof (stripe_local_t),
+                           gf_stripe_mt_stripe_local_t);
+        if (!local)
+                goto err;
+        frame->local = local;
+
+        local->replies = GF_CALLOC (fctx->stripe_count,
+                                    sizeof (struct readv_replies),
+                                    gf_stripe_mt_readv_replies);
+        if (!local->replies)
+                goto err;
+
+        local->readv_size = size;
+        local->offset     = offset;
+        local->fd         = fd_ref (fd);
+        local->fctx       = fctx;
+        local->coalesce   = fctx->stripe_size;
+
+        /* Work out which part of the range each child holds; it is
+           contiguous in the child's file */
+        end = offset + size;
+        for (idx = 0; idx < fctx->stripe_count; idx++) {
+                reply = &local->replies[idx];
+                pos = stripe_coalesced_first (offset, fctx->stripe_size,
+                                              fctx->stripe_count, idx);
+                if (pos >= end)
+                        continue;
+
+                reply->offset = stripe_coalesced_offset (pos,
+                                                         fctx->stripe_size,
+                                                         fctx->stripe_count);
+                reply->requested_size =
+                        stripe_coalesced_size (end, fctx->stripe_size,
+                                               fctx->stripe_count, idx) -
+                        reply->offset;
+                local->wind_count++;
+        }
+
+        if (!local->wind_count) {
+                GF_FREE (local->replies);
+                local->replies = NULL;
+                STRIPE_STACK_UNWIND (readv, frame, 0, 0, NULL, 0, &stbuf,
+                                     NULL);
+                return 0;
+        }
+
+        for (idx = 0; idx < fctx->stripe_count; idx++) {
+                reply = &local->replies[idx];
+                if (!reply->requested_size)
+                        continue;
+
+                rframe = copy_frame (frame);
+                rlocal = GF_CALLOC (1, sizeof (stripe_local_t),
+                                    gf_stripe_mt_stripe_local_t);
+                if (!rframe || !rlocal)
+                        goto err;
+
+                rlocal->node_index = idx;
+                rlocal->orig_frame = frame;
+                rlocal->readv_size = reply->requested_size;
+                rframe->local = rlocal;
+                STACK_WIND (rframe, stripe_coalesced_readv_cbk,
+                            fctx->xl_array[idx],
+                            fctx->xl_array[idx]->fops->readv,
+                            fd, reply->requested_size, reply->offset);
+                rframe = NULL;
+        }
+
+        return 0;
+err:
+        if (rframe)
+                STRIPE_STACK_DESTROY (rframe);
+        if (local && local->replies) {
+                GF_FREE (local->replies);
+                local->replies = NULL;
+        }
+
+        STRIPE_STACK_UNWIND (readv, frame, -1, op_errno, NULL, 0, NULL, NULL);
+        return 0;
+}
+
+
 int32_t
 stripe_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
               size_t size, off_t offset)
@@ -3360,6 +4004,11 @@ stripe_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
                         "Wrong stripe size for the file");
                 goto err;
         }
+
+        if (fctx->coalesce)
+                return stripe_coalesced_readv (frame, this, fd, fctx, size,
+                                               offset);
+
         /* The file is stripe across the child nodes. Send the read request
          * to the child nodes appropriately after checking which region of
          * the file is in which child node. Always '0-<stripe_size>' part of
@@ -3456,6 +4105,12 @@ stripe_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 }
                 if (op_ret >= 0) {
                         local->op_ret += op_ret;
+                        stripe_coalesce_iatt (this, local, prev->this, prebuf);
+                        stripe_coalesce_iatt (this, local, prev->this, postbuf);
+                        if (local->prebuf_size < prebuf->ia_size)
+                                local->prebuf_size = prebuf->ia_size;
+                        if (local->postbuf_size < postbuf->ia_size)
+                                local->postbuf_size = postbuf->ia_size;
                         local->post_buf = *postbuf;
                         local->pre_buf = *prebuf;
                 }
@@ -3463,6 +4118,11 @@ stripe_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         UNLOCK (&frame->lock);
 
         if ((callcnt == local->wind_count) && local->unwind) {
+                if (local->coalesce) {
+                        local->pre_buf.ia_size  = local->prebuf_size;
+                        local->post_buf.ia_size = local->postbuf_size;
+                }
+
                 STRIPE_STACK_UNWIND (writev, frame, local->op_ret,
                                      local->op_errno, &local->pre_buf,
                                      &local->post_buf);
@@ -3471,6 +4131,104 @@ out:
         return 0;
 }
 
+/*
+ * Writes on files with the coalesced layout gather every block going to the
+ * same child into a single writev.
+ */
+int32_t
+stripe_coalesced_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                         stripe_fd_ctx_t *fctx, struct iovec *vector,
+                         int32_t count, off_t offset, struct iobref *iobref)
+{
+        stripe_local_t *local = NULL;
+        struct iovec   *vec = NULL;
+        int32_t         op_errno = ENOMEM;
+        int32_t         idx = 0;
+        int32_t         pass = 0;
+        int32_t         used = 0;
+        int32_t         child_count = 0;
+        off_t           first = 0;
+        off_t           pos = 0;
+        off_t           len = 0;
+        off_t           end = 0;
+
+        local = GF_CALLOC (1, sizeof (stripe_local_t),
+                           gf_stripe_mt_stripe_local_t);
+        if (!local)
+                goto err;
+        frame->local = local;
+        local->stripe_size = fctx->stripe_size;
+        local->coalesce    = fctx->stripe_size;
+
+        end = offset + iov_length (vector, count);
+
+        /* First pass counts the vectors and the children to wind to,
+           second one fills the vectors in and winds */
+        for (pass = 0; pass < 2; pass++) {
+                used = 0;
+                for (idx = 0; idx < fctx->stripe_count; idx++) {
+                        first = stripe_coalesced_first (offset,
+                                                        fctx->stripe_size,
+                                                        fctx->stripe_count,
+                                                        idx);
+                        if (first >= end)
+                                continue;
+
+                        child_count = 0;
+                        for (pos = first; pos < end;
+                             pos = floor (pos, fctx->stripe_size) +
+                                     (fctx->stripe_size * fctx->stripe_count)) {
+                                len = min (roof (pos + 1, fctx->stripe_size),
+                                           end) - pos;
+                                child_count += iov_subset (vector, count,
+                                                           pos - offset,
+                                                           pos - offset + len,
+                                                           vec ? (vec + used +
+                                                                  child_count)
+                                                           : NULL);
+                        }
+
+                        if (vec)
+                                STACK_WIND (frame, stripe_writev_cbk,
+                                            fctx->xl_array[idx],
+                                            fctx->xl_array[idx]->fops->writev,
+                                            fd, vec + used, child_count,
+                                            stripe_coalesced_offset (first,
+                                                    fctx->stripe_size,
+                                                    fctx->stripe_count),
+                                            iobref);
+                        else
+                                local->wind_count++;
+
+                        used += child_count;
+                }
+
+                if (vec)
+                        break;
+
+                if (!local->wind_count) {
+                        STRIPE_STACK_UNWIND (writev, frame, 0, 0,
+                                             &local->pre_buf,
+                                             &local->post_buf);
+                        return 0;
+                }
+
+                vec = GF_CALLOC (used, sizeof (struct iovec),
+                                 gf_stripe_mt_iovec);
+                if (!vec)
+                        goto err;
+
+                local->unwind = 1;
+        }
+
+        GF_FREE (vec);
+
+        return 0;
+err:
+        STRIPE_STACK_UNWIND (writev, frame, -1, op_errno, NULL, NULL);
+        return 0;
+}
+
 int32_t
 stripe_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
                struct iovec *vector, int32_t count, off_t offset,
@@ -3502,6 +4260,10 @@ stripe_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
         fctx = (stripe_fd_ctx_t *)(long)tmp_fctx;
         stripe_size = fctx->stripe_size;
 
+        if (fctx->coalesce)
+                return stripe_coalesced_writev (frame, this, fd, fctx, vector,
+                                                count, offset, iobref);
+
         /* File has to be stripped across the child nodes */
         for (idx = 0; idx< count; idx ++) {
                 total_size += vector[idx].iov_len;
@@ -3742,18 +4504,37 @@ stripe_iatt_merge (struct iatt *from, struct iatt *to)
 
 int32_t
 stripe_readdirp_entry_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
-                                int32_t op_ret, int32_t op_errno, struct iatt *buf)
+                                int32_t op_ret, int32_t op_errno, inode_t *inode,
+                                struct iatt *buf, dict_t *dict,
+                                struct iatt *postparent)
 {
         gf_dirent_t    *entry = NULL;
         stripe_local_t *local = NULL;
+        stripe_private_t *priv = NULL;
+        stripe_readdirp_cookie_t *rcookie = NULL;
+        uint64_t        coalesce = 0;
         int32_t        done = 0;
 
         if (!this || !frame || !frame->local || !cookie) {
                 gf_log (this->name, GF_LOG_DEBUG, "possible NULL deref");
                 goto out;
         }
-        entry = cookie;
+        rcookie = cookie;
+        entry = rcookie->entry;
         local = frame->local;
+        priv = this->private;
+
+        /* same conversion as lookup and stat do, or stat-prefetch would
+           keep serving the size of the file on the child */
+        if (op_ret != -1) {
+                coalesce = stripe_coalesce_xattr_get (this, dict);
+                if (coalesce)
+                        buf->ia_size = stripe_uncoalesced_size (
+                                buf->ia_size, coalesce, priv->child_count,
+                                stripe_child_index (this, rcookie->subvol));
+        }
+        GF_FREE (rcookie);
+
         LOCK (&frame->lock);
         {
 
@@ -3798,6 +4579,10 @@ stripe_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t        *inode = NULL;
         char           *path;
         int32_t        count = 0;
+        dict_t         *xattr_req = NULL;
+        char           key[256] = {0,};
+        stripe_private_t *priv = NULL;
+        stripe_readdirp_cookie_t *rcookie = NULL;
 
         if (!this || !frame || !frame->local || !cookie) {
                 gf_log ("stripe", GF_LOG_DEBUG, "possible NULL deref");
@@ -3828,6 +4613,22 @@ unlock:
         if (op_ret == -1)
                 goto out;
 
+        /* ask for the coalesce xattr, the sizes reported by the children
+           depend on it */
+        priv = this->private;
+        if (priv->xattr_supported) {
+                xattr_req = dict_new ();
+                if (xattr_req) {
+                        sprintf (key, "trusted.%s.stripe-coalesce",
+                                 this->name);
+                        ret = dict_set_int64 (xattr_req, key, 8);
+                        if (ret)
+                                gf_log (this->name, GF_LOG_WARNING,
+                                        "failed to set %s in xattr_req dict",
+                                        key);
+                }
+        }
+
         ret = 0;
         list_for_each_entry_safe (local_entry, tmp_entry,
                                   (&local->entries.list), list) {
@@ -3860,20 +4661,39 @@ unlock:
                 loc.name++;
                 trav = this->children;
                 while (trav) {
+                        rcookie = GF_CALLOC (1, sizeof (*rcookie),
+                                             gf_stripe_mt_readdirp_cookie_t);
+                        if (!rcookie) {
+                                LOCK (&frame->lock);
+                                {
+                                        local->op_ret = -1;
+                                        local->op_errno = ENOMEM;
+                                }
+                                UNLOCK (&frame->lock);
+                                trav = trav->next;
+                                continue;
+                        }
+                        rcookie->entry  = local_entry;
+                        rcookie->subvol = trav->xlator;
+
                         LOCK (&frame->lock);
                         {
                                 local->wind_count++;
                         }
                         UNLOCK (&frame->lock);
                         STACK_WIND_COOKIE (frame, stripe_readdirp_entry_stat_cbk,
-                                           local_entry, trav->xlator,
-                                           trav->xlator->fops->stat, &loc);
+                                           rcookie, trav->xlator,
+                                           trav->xlator->fops->lookup, &loc,
+                                           xattr_req);
                         count++;
                         trav = trav->next;
                 }
                 inode_unref (loc.inode);
         }
 out:
+        if (xattr_req)
+                dict_unref (xattr_req);
+
         if (!count) {
                 /* all entries are directories */
                 frame->local = NULL;
@@ -4016,6 +4836,18 @@ reconfigure (xlator_t *this, dict_t *options)
                 priv->block_size = (128 * GF_UNIT_KB);
         }
 
+        /* only affects files created from now on */
+        priv->coalesce = _gf_false;
+        data = dict_get (options, "coalesce");
+        if (data) {
+                if (gf_string2boolean (data->data, &priv->coalesce) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "Reconfigure: invalid value for coalesce");
+                        ret = -1;
+                        goto out;
+                }
+        }
+
 out:
 	return ret;
 
@@ -4156,6 +4988,16 @@ init (xlator_t *this)
                 }
         }
 
+        data = dict_get (this->options, "coalesce");
+        if (data) {
+                if (gf_string2boolean (data->data, &priv->coalesce) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid value for option coalesce");
+                        ret = -1;
+                        goto out;
+                }
+        }
+
         /* notify related */
         priv->nodes_down = priv->child_count;
         this->private = priv;
@@ -4589,5 +5431,13 @@ struct volume_options options[] = {
           .type = GF_OPTION_TYPE_BOOL,
           .default_value = "true"
         },
+        { .key  = {"coalesce"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Store the stripe blocks of newly created files "
+                         "contiguously on each subvolume, so that a read "
+                         "or write needs only one call per subvolume. "
+                         "Needs use-xattr."
+        },
         { .key  = {NULL} },
 };
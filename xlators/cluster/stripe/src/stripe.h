@@ -93,6 +93,7 @@ struct stripe_private {
         int8_t                  child_count;
         int8_t                 *state; /* Current state of child node */
         gf_boolean_t            xattr_supported;  /* default yes */
+        gf_boolean_t            coalesce;         /* default no */
         char                    vol_uuid[UUID_SIZE + 1];
 };
 
@@ -106,12 +107,26 @@ struct readv_replies {
         int32_t       op_errno;
         int32_t       requested_size;
         struct iatt   stbuf;    /* 'stbuf' is also a part of reply */
+        off_t         offset;   /* where the read starts on the child,
+                                   used by the coalesced layout */
+        int32_t       consumed; /* bytes of 'vector' already reassembled */
 };
 
+/**
+ * Tells the callback of a readdirp entry lookup which entry and which
+ * child the reply is for, the child being needed to make sense of the
+ * size of a coalesced file
+ */
+typedef struct stripe_readdirp_cookie {
+        gf_dirent_t *entry;
+        xlator_t    *subvol;
+} stripe_readdirp_cookie_t;
+
 typedef struct _stripe_fd_ctx {
         off_t      stripe_size;
         int        stripe_count;
         int        static_array;
+        int        coalesce;
         xlator_t **xl_array;
 } stripe_fd_ctx_t;
 
@@ -182,6 +197,8 @@ struct stripe_local {
         /* General usage */
         off_t                offset;
         off_t                stripe_size;
+        uint64_t             coalesce; /* stripe-size of a file with the
+                                          coalesced layout, 0 otherwise */
 
         int xattr_self_heal_needed;
         int entry_self_heal_needed;
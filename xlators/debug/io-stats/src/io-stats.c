@@ -45,6 +45,7 @@
 #include "io-stats-mem-types.h"
 #include <stdarg.h>
 #include "defaults.h"
+#include "fop-trace.h"
 
 #define MAX_LIST_MEMBERS 100
 
@@ -120,6 +121,7 @@ struct ios_conf {
         gf_boolean_t              dump_fd_stats;
         gf_boolean_t              count_fop_hits;
         int                       measure_latency;
+        gf_boolean_t              fop_trace;
         struct ios_stat_head      list[IOS_STATS_TYPE_MAX];
         struct ios_stat_head      thru_list[IOS_STATS_THRU_MAX];
 };
@@ -2385,6 +2387,17 @@ iostats_configure_options (xlator_t *this, dict_t *xl_options,
                         "'latency-measurement' takes only boolean arguments");
         }
 
+        /* only a change of the option is passed on, so that a process
+         * started with --fop-trace keeps tracing */
+        ret = dict_get_str_boolean (xl_options, "fop-trace", _gf_false);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "'fop-trace' takes only boolean arguments");
+        } else if (conf->fop_trace != ret) {
+                conf->fop_trace = ret;
+                gf_fop_trace_set (ret);
+        }
+
         ret = dict_get_str (xl_options, "log-level", &log_str);
         if (!ret) {
                 if (!is_gf_log_command(this, "trusted.glusterfs.set-log-level",
@@ -2686,6 +2699,13 @@ struct volume_options options[] = {
         { .key  = {"count-fop-hits"},
           .type = GF_OPTION_TYPE_BOOL,
         },
+        { .key  = {"fop-trace"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "If on every wind and unwind is recorded, switching "
+                         "it off writes the records to "
+                         GF_FOP_TRACE_FILE_ROOT ".<pid>."
+        },
         { .key = {"log-level"},
           .type = GF_OPTION_TYPE_STR,
           .value = { "DEBUG", "WARNING", "ERROR", "INFO",
@@ -67,6 +67,10 @@ allocate_domain (const char *volume)
         INIT_LIST_HEAD (&dom->blocked_entrylks);
         INIT_LIST_HEAD (&dom->inodelk_list);
         INIT_LIST_HEAD (&dom->blocked_inodelks);
+        pl_itree_init (&dom->inodelk_tree);
+        pl_itree_init (&dom->blocked_inodelk_tree);
+        INIT_LIST_HEAD (&dom->entrylk_hash.all_names);
+        INIT_LIST_HEAD (&dom->blocked_entrylk_hash.all_names);
 
 out:
         if (dom && (NULL == dom->domain)) {
@@ -29,6 +29,7 @@
 #include "logging.h"
 #include "common-utils.h"
 #include "list.h"
+#include "hashfn.h"
 
 #include "locks.h"
 #include "common.h"
@@ -55,6 +56,7 @@ new_entrylk_lock (pl_inode_t *pinode, const char *basename, entrylk_type type,
 
         INIT_LIST_HEAD (&newlock->domain_list);
         INIT_LIST_HEAD (&newlock->blocked_locks);
+        INIT_LIST_HEAD (&newlock->hash_list);
 
 out:
         return newlock;
@@ -81,6 +83,116 @@ names_conflict (const char *n1, const char *n2)
 }
 
 
+static inline struct list_head *
+__entrylk_bucket (pl_entrylk_hash_t *hash, const char *basename)
+{
+        if (all_names (basename))
+                return &hash->all_names;
+
+        return &hash->buckets[SuperFastHash (basename, strlen (basename))
+                              & (hash->size - 1)];
+}
+
+
+/**
+ * __entrylk_hash_reserve - make room in @hash for one more lock
+ *
+ * Buckets are allocated on the first entrylk of a domain, so domains
+ * used only for inodelks never pay for them, and doubled whenever the
+ * average chain grows past two. Failing to grow is not an error as long
+ * as there are buckets at all.
+ */
+
+static int
+__entrylk_hash_reserve (pl_entrylk_hash_t *hash)
+{
+        struct list_head *buckets = NULL;
+        struct list_head *old     = NULL;
+        pl_entry_lock_t  *lock    = NULL;
+        pl_entry_lock_t  *tmp     = NULL;
+        uint32_t          size    = 0;
+        uint32_t          i       = 0;
+
+        if (hash->buckets && (hash->count < 2 * hash->size))
+                return 0;
+
+        size = hash->buckets ? (2 * hash->size) : PL_ENTRYLK_HASH_MIN;
+
+        buckets = GF_CALLOC (size, sizeof (*buckets), gf_common_mt_list_head);
+        if (!buckets)
+                return hash->buckets ? 0 : -ENOMEM;
+
+        for (i = 0; i < size; i++)
+                INIT_LIST_HEAD (&buckets[i]);
+
+        old = hash->buckets;
+
+        hash->buckets = buckets;
+        hash->size    = size;
+
+        if (!old)
+                return 0;
+
+        for (i = 0; i < size / 2; i++) {
+                list_for_each_entry_safe (lock, tmp, &old[i], hash_list) {
+                        list_move_tail (&lock->hash_list,
+                                        __entrylk_bucket (hash,
+                                                          lock->basename));
+                }
+        }
+
+        GF_FREE (old);
+
+        return 0;
+}
+
+
+static void
+__entrylk_hash_add (pl_entrylk_hash_t *hash, pl_entry_lock_t *lock)
+{
+        list_add_tail (&lock->hash_list,
+                       __entrylk_bucket (hash, lock->basename));
+        if (!all_names (lock->basename))
+                hash->count++;
+}
+
+
+static void
+__entrylk_hash_del (pl_entrylk_hash_t *hash, pl_entry_lock_t *lock)
+{
+        list_del_init (&lock->hash_list);
+        if (!all_names (lock->basename))
+                hash->count--;
+}
+
+
+/**
+ * __entrylk_hash_conflict - find a lock in @hash conflicting with @basename
+ *
+ * Only a lock on the same name or on the whole directory can conflict
+ * with a lock on a name; the caller handles @basename == NULL, which
+ * conflicts with everything.
+ */
+
+static pl_entry_lock_t *
+__entrylk_hash_conflict (pl_entrylk_hash_t *hash, const char *basename)
+{
+        pl_entry_lock_t  *lock = NULL;
+
+        list_for_each_entry (lock, __entrylk_bucket (hash, basename),
+                             hash_list) {
+                if (names_conflict (lock->basename, basename))
+                        return lock;
+        }
+
+        if (!list_empty (&hash->all_names))
+                return list_entry (hash->all_names.next, pl_entry_lock_t,
+                                   hash_list);
+
+        return NULL;
+}
+
+
 static int
 __same_entrylk_owner (pl_entry_lock_t *l1, pl_entry_lock_t *l2)
 {
@@ -104,12 +216,13 @@ __lock_grantable (pl_dom_list_t *dom, const char *basename, entrylk_type type)
         if (list_empty (&dom->entrylk_list))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->entrylk_list, domain_list) {
-                if (names_conflict (lock->basename, basename))
-                        return lock;
+        if (all_names (basename)) {
+                lock = list_entry (dom->entrylk_list.next, pl_entry_lock_t,
+                                   domain_list);
+                return lock;
         }
 
-        return NULL;
+        return __entrylk_hash_conflict (&dom->entrylk_hash, basename);
 }
 
 static pl_entry_lock_t *
@@ -120,12 +233,14 @@ __blocked_lock_conflict (pl_dom_list_t *dom, const char *basename, entrylk_type
         if (list_empty (&dom->blocked_entrylks))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->blocked_entrylks, blocked_locks) {
-                if (names_conflict (lock->basename, basename))
-                        return lock;
+        if (all_names (basename)) {
+                lock = list_entry (dom->blocked_entrylks.next,
+                                   pl_entry_lock_t, blocked_locks);
+                return lock;
         }
 
-        return NULL;
+        return __entrylk_hash_conflict (&dom->blocked_entrylk_hash,
+                                        basename);
 }
 
 static int
@@ -284,21 +399,25 @@ entrylk_trace_block (xlator_t *this, call_frame_t *frame, const char *volume,
 static pl_entry_lock_t *
 __find_most_matching_lock (pl_dom_list_t *dom, const char *basename)
 {
-        pl_entry_lock_t *lock;
-        pl_entry_lock_t *all = NULL;
-        pl_entry_lock_t *exact = NULL;
+        pl_entry_lock_t   *lock = NULL;
+        pl_entrylk_hash_t *hash = NULL;
 
         if (list_empty (&dom->entrylk_list))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->entrylk_list, domain_list) {
-                if (all_names (lock->basename))
-                        all = lock;
-                else if (names_equal (lock->basename, basename))
-                        exact = lock;
+        hash = &dom->entrylk_hash;
+
+        list_for_each_entry (lock, __entrylk_bucket (hash, basename),
+                             hash_list) {
+                if (names_equal (lock->basename, basename))
+                        return lock;
         }
 
-        return (exact ? exact : all);
+        if (!list_empty (&hash->all_names))
+                return list_entry (hash->all_names.next, pl_entry_lock_t,
+                                   hash_list);
+
+        return NULL;
 }
 
 /**
@@ -324,6 +443,16 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
 
         int ret = -EINVAL;
 
+        ret = __entrylk_hash_reserve (&dom->entrylk_hash);
+        if (ret < 0)
+                goto out;
+
+        ret = __entrylk_hash_reserve (&dom->blocked_entrylk_hash);
+        if (ret < 0)
+                goto out;
+
+        ret = -EINVAL;
+
         trans = frame->root->trans;
         client_pid = frame->root->pid;
         owner      = frame->root->lk_owner;
@@ -350,6 +479,7 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
                 }
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_entrylks);
+                __entrylk_hash_add (&dom->blocked_entrylk_hash, lock);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Blocking lock: {pinode=%p, basename=%s}",
@@ -371,6 +501,7 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
                 lock->this      = this;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_entrylks);
+                __entrylk_hash_add (&dom->blocked_entrylk_hash, lock);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Lock is grantable, but blocking to prevent starvation");
@@ -385,6 +516,7 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
 
         case ENTRYLK_WRLCK:
                 list_add_tail (&lock->domain_list, &dom->entrylk_list);
+                __entrylk_hash_add (&dom->entrylk_hash, lock);
                 break;
 
         default:
@@ -427,6 +559,7 @@ __unlock_name (pl_dom_list_t *dom, const char *basename, entrylk_type type)
 
                 if (type == ENTRYLK_WRLCK) {
                         list_del_init (&lock->domain_list);
+                        __entrylk_hash_del (&dom->entrylk_hash, lock);
                         ret_lock = lock;
                 }
         } else {
@@ -453,6 +586,10 @@ __grant_blocked_entry_locks (xlator_t *this, pl_inode_t *pl_inode,
         INIT_LIST_HEAD (&blocked_list);
         list_splice_init (&dom->blocked_entrylks, &blocked_list);
 
+        /* each of them is re-queued (as a new lock) if still blocked */
+        list_for_each_entry (bl, &blocked_list, blocked_locks)
+                __entrylk_hash_del (&dom->blocked_entrylk_hash, bl);
+
         list_for_each_entry_safe (bl, tmp, &blocked_list,
                                   blocked_locks) {
 
@@ -538,6 +675,7 @@ release_entry_locks_for_transport (xlator_t *this, pl_inode_t *pinode,
                                 continue;
 
                         list_del_init (&lock->blocked_locks);
+                        __entrylk_hash_del (&dom->blocked_entrylk_hash, lock);
 
                         gf_log (this->name, GF_LOG_TRACE,
                                 "releasing lock on  held by "
@@ -553,6 +691,7 @@ release_entry_locks_for_transport (xlator_t *this, pl_inode_t *pinode,
                                 continue;
 
                         list_del_init (&lock->domain_list);
+                        __entrylk_hash_del (&dom->entrylk_hash, lock);
 
                         gf_log (this->name, GF_LOG_TRACE,
                                 "releasing lock on  held by "
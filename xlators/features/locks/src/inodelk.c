@@ -34,9 +34,10 @@
 #include "common.h"
 
 void
-__delete_inode_lock (pl_inode_lock_t *lock)
+__delete_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
         list_del (&lock->list);
+        pl_itree_remove (&dom->inodelk_tree, &lock->itree);
 }
 
 void
@@ -134,42 +135,39 @@ inodelk_conflict (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
                 inodelk_type_conflict (l1, l2));
 }
 
-/* Determine if lock is grantable or not */
-static pl_inode_lock_t *
-__inodelk_grantable (pl_dom_list_t *dom, pl_inode_lock_t *lock)
+static int
+inodelk_conflict_match (pl_itree_node_t *node, void *data)
 {
-        pl_inode_lock_t *l = NULL;
-        pl_inode_lock_t *ret = NULL;
-        if (list_empty (&dom->inodelk_list))
-                goto out;
-        list_for_each_entry (l, &dom->inodelk_list, list){
-                if (inodelk_conflict (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
-out:
-        return ret;
+        pl_inode_lock_t *l = list_entry (node, pl_inode_lock_t, itree);
+
+        return inodelk_conflict (data, l);
 }
 
+/* Find a lock in @tree which conflicts with @lock */
 static pl_inode_lock_t *
-__blocked_lock_conflict (pl_dom_list_t *dom, pl_inode_lock_t *lock)
+__inodelk_tree_conflict (pl_itree_t *tree, pl_inode_lock_t *lock)
 {
-        pl_inode_lock_t *l   = NULL;
-        pl_inode_lock_t *ret = NULL;
+        pl_itree_node_t *node = NULL;
 
-        if (list_empty (&dom->blocked_inodelks))
+        node = pl_itree_find (tree, lock->fl_start, lock->fl_end,
+                              inodelk_conflict_match, lock);
+        if (!node)
                 return NULL;
 
-        list_for_each_entry (l, &dom->blocked_inodelks, blocked_locks) {
-                if (inodelk_conflict (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
+        return list_entry (node, pl_inode_lock_t, itree);
+}
 
-out:
-        return ret;
+/* Determine if lock is grantable or not */
+static pl_inode_lock_t *
+__inodelk_grantable (pl_dom_list_t *dom, pl_inode_lock_t *lock)
+{
+        return __inodelk_tree_conflict (&dom->inodelk_tree, lock);
+}
+
+static pl_inode_lock_t *
+__blocked_lock_conflict (pl_dom_list_t *dom, pl_inode_lock_t *lock)
+{
+        return __inodelk_tree_conflict (&dom->blocked_inodelk_tree, lock);
 }
 
 static int
@@ -208,6 +206,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                         goto out;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_inodelk_tree, &lock->itree,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "%s (pid=%d) lk-owner:%"PRIu64" %"PRId64" - %"PRId64" => Blocked",
@@ -227,6 +227,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                         goto out;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_inodelk_tree, &lock->itree,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Lock is grantable, but blocking to prevent starvation");
@@ -242,6 +244,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                 goto out;
         }
         list_add (&lock->list, &dom->inodelk_list);
+        pl_itree_insert (&dom->inodelk_tree, &lock->itree, lock->fl_start,
+                         lock->fl_end);
 
         ret = 0;
 
@@ -261,16 +265,25 @@ inodelks_equal (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
 }
 
 
+static int
+inodelk_unlock_match (pl_itree_node_t *node, void *data)
+{
+        pl_inode_lock_t *l = list_entry (node, pl_inode_lock_t, itree);
+
+        return (inodelks_equal (l, data) && same_inodelk_owner (l, data));
+}
+
 static pl_inode_lock_t *
 find_matching_inodelk (pl_inode_lock_t *lock, pl_dom_list_t *dom)
 {
-        pl_inode_lock_t *l = NULL;
-        list_for_each_entry (l, &dom->inodelk_list, list) {
-                if (inodelks_equal (l, lock) &&
-                    same_inodelk_owner (l, lock))
-                        return l;
-        }
-        return NULL;
+        pl_itree_node_t *node = NULL;
+
+        node = pl_itree_find (&dom->inodelk_tree, lock->fl_start,
+                              lock->fl_end, inodelk_unlock_match, lock);
+        if (!node)
+                return NULL;
+
+        return list_entry (node, pl_inode_lock_t, itree);
 }
 
 /* Set F_UNLCK removes a lock which has the exact same lock boundaries
@@ -288,7 +301,7 @@ __inode_unlock_lock (xlator_t *this, pl_inode_lock_t *lock, pl_dom_list_t *dom)
                         " Matching lock not found for unlock");
                 goto out;
         }
-        __delete_inode_lock (conf);
+        __delete_inode_lock (dom, conf);
         gf_log (this->name, GF_LOG_DEBUG,
                 " Matching lock found for unlock");
         __destroy_inode_lock (lock);
@@ -311,6 +324,7 @@ __grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode,
 
         INIT_LIST_HEAD (&blocked_list);
         list_splice_init (&dom->blocked_inodelks, &blocked_list);
+        pl_itree_init (&dom->blocked_inodelk_tree);
 
         list_for_each_entry_safe (bl, tmp, &blocked_list, blocked_locks) {
 
@@ -391,6 +405,8 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                                 continue;
 
                         list_del_init (&l->blocked_locks);
+                        pl_itree_remove (&dom->blocked_inodelk_tree,
+                                         &l->itree);
 
                         if (inode_path (inode, NULL, &path) < 0) {
                                 gf_log (this->name, GF_LOG_TRACE,
@@ -416,7 +432,7 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                         if (l->transport != trans)
                                 continue;
 
-                        __delete_inode_lock (l);
+                        __delete_inode_lock (dom, l);
                         __destroy_inode_lock (l);
 
 
@@ -0,0 +1,248 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+
+#include "itree.h"
+
+static inline int
+itree_height (pl_itree_node_t *node)
+{
+        return node ? node->height : 0;
+}
+
+
+static inline void
+itree_update (pl_itree_node_t *node)
+{
+        int lh = itree_height (node->left);
+        int rh = itree_height (node->right);
+
+        node->height = ((lh > rh) ? lh : rh) + 1;
+
+        node->max_end = node->end;
+        if (node->left && (node->left->max_end > node->max_end))
+                node->max_end = node->left->max_end;
+        if (node->right && (node->right->max_end > node->max_end))
+                node->max_end = node->right->max_end;
+}
+
+
+static pl_itree_node_t *
+itree_rotate_right (pl_itree_node_t *node)
+{
+        pl_itree_node_t *pivot = node->left;
+
+        node->left = pivot->right;
+        pivot->right = node;
+
+        itree_update (node);
+        itree_update (pivot);
+
+        return pivot;
+}
+
+
+static pl_itree_node_t *
+itree_rotate_left (pl_itree_node_t *node)
+{
+        pl_itree_node_t *pivot = node->right;
+
+        node->right = pivot->left;
+        pivot->left = node;
+
+        itree_update (node);
+        itree_update (pivot);
+
+        return pivot;
+}
+
+
+static pl_itree_node_t *
+itree_balance (pl_itree_node_t *node)
+{
+        int balance = 0;
+
+        itree_update (node);
+
+        balance = itree_height (node->left) - itree_height (node->right);
+
+        if (balance > 1) {
+                if (itree_height (node->left->left)
+                    < itree_height (node->left->right))
+                        node->left = itree_rotate_left (node->left);
+                return itree_rotate_right (node);
+        }
+
+        if (balance < -1) {
+                if (itree_height (node->right->right)
+                    < itree_height (node->right->left))
+                        node->right = itree_rotate_right (node->right);
+                return itree_rotate_left (node);
+        }
+
+        return node;
+}
+
+
+/* nodes are ordered by start, ties broken by address to keep keys unique */
+static inline int
+itree_less (pl_itree_node_t *a, pl_itree_node_t *b)
+{
+        if (a->start != b->start)
+                return (a->start < b->start);
+
+        return ((uintptr_t) a < (uintptr_t) b);
+}
+
+
+static pl_itree_node_t *
+itree_insert (pl_itree_node_t *root, pl_itree_node_t *node)
+{
+        if (root == NULL)
+                return node;
+
+        if (itree_less (node, root))
+                root->left = itree_insert (root->left, node);
+        else
+                root->right = itree_insert (root->right, node);
+
+        return itree_balance (root);
+}
+
+
+static pl_itree_node_t *
+itree_remove_min (pl_itree_node_t *root, pl_itree_node_t **min)
+{
+        if (root->left == NULL) {
+                *min = root;
+                return root->right;
+        }
+
+        root->left = itree_remove_min (root->left, min);
+
+        return itree_balance (root);
+}
+
+
+static pl_itree_node_t *
+itree_remove (pl_itree_node_t *root, pl_itree_node_t *node)
+{
+        pl_itree_node_t *min = NULL;
+
+        if (root == NULL)
+                return NULL;
+
+        if (root != node) {
+                if (itree_less (node, root))
+                        root->left = itree_remove (root->left, node);
+                else
+                        root->right = itree_remove (root->right, node);
+
+                return itree_balance (root);
+        }
+
+        if (root->right == NULL)
+                return root->left;
+
+        root->right = itree_remove_min (root->right, &min);
+        min->left = root->left;
+        min->right = root->right;
+
+        return itree_balance (min);
+}
+
+
+static pl_itree_node_t *
+itree_find (pl_itree_node_t *root, off_t start, off_t end,
+            pl_itree_match_t match, void *data)
+{
+        pl_itree_node_t *found = NULL;
+
+        if ((root == NULL) || (root->max_end < start))
+                return NULL;
+
+        found = itree_find (root->left, start, end, match, data);
+        if (found)
+                return found;
+
+        /* everything from here on starts past the range */
+        if (root->start > end)
+                return NULL;
+
+        if ((root->end >= start) && (!match || match (root, data)))
+                return root;
+
+        return itree_find (root->right, start, end, match, data);
+}
+
+
+void
+pl_itree_init (pl_itree_t *tree)
+{
+        tree->root  = NULL;
+        tree->count = 0;
+}
+
+
+void
+pl_itree_insert (pl_itree_t *tree, pl_itree_node_t *node, off_t start,
+                 off_t end)
+{
+        node->left    = NULL;
+        node->right   = NULL;
+        node->start   = start;
+        node->end     = end;
+        node->max_end = end;
+        node->height  = 1;
+
+        tree->root = itree_insert (tree->root, node);
+        tree->count++;
+}
+
+
+void
+pl_itree_remove (pl_itree_t *tree, pl_itree_node_t *node)
+{
+        tree->root = itree_remove (tree->root, node);
+        tree->count--;
+
+        node->left  = NULL;
+        node->right = NULL;
+}
+
+
+/**
+ * pl_itree_find - find a node overlapping [@start, @end]
+ *
+ * Returns the node with the lowest start among those overlapping the
+ * range for which @match (if given) returns non zero.
+ */
+pl_itree_node_t *
+pl_itree_find (pl_itree_t *tree, off_t start, off_t end,
+               pl_itree_match_t match, void *data)
+{
+        return itree_find (tree->root, start, end, match, data);
+}
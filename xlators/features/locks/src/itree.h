@@ -0,0 +1,70 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ITREE_H__
+#define __ITREE_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * Interval tree of byte ranges: an AVL tree ordered by range start where
+ * every node also carries the largest range end found in its subtree, so
+ * that all ranges overlapping a given one can be found without visiting
+ * the ranges which cannot overlap it.
+ *
+ * Nodes are embedded in the objects they index; the tree does no
+ * allocation of its own and relies on the caller's locking.
+ */
+
+struct pl_itree_node {
+        struct pl_itree_node *left;
+        struct pl_itree_node *right;
+        off_t                 start;
+        off_t                 end;       /* inclusive */
+        off_t                 max_end;   /* max end in this subtree */
+        int                   height;
+};
+typedef struct pl_itree_node pl_itree_node_t;
+
+struct pl_itree {
+        pl_itree_node_t      *root;
+        uint64_t              count;
+};
+typedef struct pl_itree pl_itree_t;
+
+/* returns non zero if @node is the one being looked for */
+typedef int (*pl_itree_match_t) (pl_itree_node_t *node, void *data);
+
+void
+pl_itree_init (pl_itree_t *tree);
+
+void
+pl_itree_insert (pl_itree_t *tree, pl_itree_node_t *node, off_t start,
+                 off_t end);
+
+void
+pl_itree_remove (pl_itree_t *tree, pl_itree_node_t *node);
+
+pl_itree_node_t *
+pl_itree_find (pl_itree_t *tree, off_t start, off_t end,
+               pl_itree_match_t match, void *data);
+
+#endif /* __ITREE_H__ */
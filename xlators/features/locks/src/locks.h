@@ -29,8 +29,12 @@
 #include "stack.h"
 #include "call-stub.h"
 #include "locks-mem-types.h"
+#include "itree.h"
 
 #define POSIX_LOCKS "posix-locks"
+
+/* initial number of buckets of an entrylk hash, doubled as it fills */
+#define PL_ENTRYLK_HASH_MIN 16
 struct __pl_fd;
 
 struct __posix_lock {
@@ -60,6 +64,7 @@ typedef struct __posix_lock posix_lock_t;
 struct __pl_inode_lock {
         struct list_head   list;
         struct list_head   blocked_locks; /* list_head pointing to blocked_inodelks */
+        pl_itree_node_t    itree;         /* node in inodelk_tree or blocked_inodelk_tree */
 
         short              fl_type;
         off_t              fl_start;
@@ -89,6 +94,15 @@ struct __pl_rw_req_t {
 };
 typedef struct __pl_rw_req_t pl_rw_req_t;
 
+/* entry locks of a domain hashed by basename */
+struct __pl_entrylk_hash {
+        struct list_head  *buckets;
+        uint32_t           size;            /* number of buckets */
+        uint32_t           count;           /* locks in buckets */
+        struct list_head   all_names;       /* locks with basename == NULL */
+};
+typedef struct __pl_entrylk_hash pl_entrylk_hash_t;
+
 struct __pl_dom_list_t {
         struct list_head   inode_list;       /* list_head back to pl_inode_t */
         const char        *domain;
@@ -96,12 +110,17 @@ struct __pl_dom_list_t {
         struct list_head   blocked_entrylks; /* List of all blocked entrylks */
         struct list_head   inodelk_list;     /* List of inode locks */
         struct list_head   blocked_inodelks; /* List of all blocked inodelks */
+        pl_itree_t         inodelk_tree;     /* inodelk_list indexed by range */
+        pl_itree_t         blocked_inodelk_tree;
+        pl_entrylk_hash_t  entrylk_hash;     /* entrylk_list by basename */
+        pl_entrylk_hash_t  blocked_entrylk_hash;
 };
 typedef struct __pl_dom_list_t pl_dom_list_t;
 
 struct __entry_lock {
         struct list_head  domain_list;    /* list_head back to pl_dom_list_t */
         struct list_head  blocked_locks; /* list_head back to blocked_entrylks */
+        struct list_head  hash_list;     /* list_head back to (blocked_)entrylk_hash */
 
         call_frame_t     *frame;
         xlator_t         *this;
@@ -1192,7 +1192,7 @@ pl_forget (xlator_t *this,
                                         "Pending inode locks found, releasing.");
 
                                 list_for_each_entry_safe (ino_l, ino_tmp, &dom->inodelk_list, list) {
-                                        __delete_inode_lock (ino_l);
+                                        __delete_inode_lock (dom, ino_l);
                                         __destroy_inode_lock (ino_l);
                                 }
 
@@ -1219,6 +1219,10 @@ pl_forget (xlator_t *this,
                         gf_log ("posix-locks", GF_LOG_TRACE,
                                 " Cleaning up domain: %s", dom->domain);
                         GF_FREE ((char *)(dom->domain));
+                        if (dom->entrylk_hash.buckets)
+                                GF_FREE (dom->entrylk_hash.buckets);
+                        if (dom->blocked_entrylk_hash.buckets)
+                                GF_FREE (dom->blocked_entrylk_hash.buckets);
                         GF_FREE (dom);
                 }
 
@@ -29,47 +29,305 @@
 #include "logging.h"
 #include "common-utils.h"
 #include "list.h"
+#include "globals.h"
+
+#include <sys/time.h>
 
 #include "locks.h"
 #include "common.h"
+#include "itree.h"
+
+/*
+ * Checks the entrylk conflict rules and measures how lock acquisition,
+ * contended grants and byte-range conflict lookups scale with the number
+ * of locks held in a domain. Built from the locks source directory of a
+ * configured tree with:
+ *
+ * cc -I. -I../../../../libglusterfs/src -I../../../../contrib/uuid -I../../../.. \
+ *    -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE -DGF_LINUX_HOST_OS \
+ *    ../tests/unit-test.c common.c posix.c \
+ *    entrylk.c inodelk.c reservelk.c itree.c \
+ *    ../../../../libglusterfs/src/.libs/libglusterfs.so -o unit-test
+ *
+ * usage: unit-test [max-locks]
+ */
+
+#define expect(cond) if (!(cond)) { \
+                fprintf (stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); \
+                goto out; }
+
+extern int __lock_name (pl_inode_t *, const char *, entrylk_type,
+                        call_frame_t *, pl_dom_list_t *, xlator_t *, int);
+extern pl_entry_lock_t *__unlock_name (pl_dom_list_t *, const char *,
+                                       entrylk_type);
+extern void __grant_blocked_entry_locks (xlator_t *, pl_inode_t *,
+                                         pl_dom_list_t *, struct list_head *);
+
+static xlator_t xl = { .name = "locks" };
+
+static double
+elapsed_usec (struct timeval *start)
+{
+        struct timeval now;
+
+        gettimeofday (&now, NULL);
+
+        return ((now.tv_sec - start->tv_sec) * 1000000.0
+                + (now.tv_usec - start->tv_usec));
+}
+
+static call_frame_t *
+new_frames (int count)
+{
+        call_frame_t *frames = NULL;
+        call_stack_t *stacks = NULL;
+        int           i      = 0;
+
+        frames = CALLOC (count, sizeof (*frames));
+        stacks = CALLOC (count, sizeof (*stacks));
+        if (!frames || !stacks)
+                return NULL;
+
+        for (i = 0; i < count; i++) {
+                stacks[i].trans    = (void *) 1;
+                stacks[i].pid      = i + 1;
+                stacks[i].lk_owner = i + 1;
+                frames[i].root     = &stacks[i];
+        }
+
+        return frames;
+}
+
+static void
+free_lock (pl_entry_lock_t *lock)
+{
+        if (lock->basename)
+                GF_FREE ((char *) lock->basename);
+        GF_FREE (lock);
+}
+
+static int
+check_entrylk (pl_inode_t *pinode, pl_dom_list_t *dom, call_frame_t *frames)
+{
+        int ret = 1;
+        int r   = -1;
+
+        r = __lock_name (pinode, NULL, ENTRYLK_WRLCK, &frames[0], dom, &xl, 1);
+        expect (r == 0);
+        {
+                r = __lock_name (pinode, "foo", ENTRYLK_WRLCK, &frames[1],
+                                 dom, &xl, 1);
+                expect (r == -EAGAIN);
+        }
+        free_lock (__unlock_name (dom, NULL, ENTRYLK_WRLCK));
+
+        r = __lock_name (pinode, "foo", ENTRYLK_WRLCK, &frames[0], dom, &xl, 1);
+        expect (r == 0);
+        {
+                r = __lock_name (pinode, "bar", ENTRYLK_WRLCK, &frames[1],
+                                 dom, &xl, 1);
+                expect (r == 0);
+                r = __lock_name (pinode, "foo", ENTRYLK_WRLCK, &frames[1],
+                                 dom, &xl, 1);
+                expect (r == -EAGAIN);
+                r = __lock_name (pinode, NULL, ENTRYLK_WRLCK, &frames[1],
+                                 dom, &xl, 1);
+                expect (r == -EAGAIN);
+                free_lock (__unlock_name (dom, "bar", ENTRYLK_WRLCK));
+        }
+        free_lock (__unlock_name (dom, "foo", ENTRYLK_WRLCK));
+
+        expect (__unlock_name (dom, "foo", ENTRYLK_WRLCK) == NULL);
+
+        r = __lock_name (pinode, "baz", ENTRYLK_WRLCK, &frames[0], dom, &xl, 1);
+        expect (r == 0);
+        r = __lock_name (pinode, "baz", ENTRYLK_WRLCK, &frames[1], dom, &xl, 1);
+        expect (r == -EAGAIN);
+        free_lock (__unlock_name (dom, "baz", ENTRYLK_WRLCK));
+
+        expect (list_empty (&dom->entrylk_list));
+
+        ret = 0;
+out:
+        return ret;
+}
+
+/* n creates in one directory, each holding its own name lock */
+static int
+bench_entrylk (pl_inode_t *pinode, pl_dom_list_t *dom, call_frame_t *frames,
+               int count)
+{
+        struct timeval    start;
+        double            lock_usec   = 0;
+        double            unlock_usec = 0;
+        double            grant_usec  = 0;
+        char              name[32];
+        int               i           = 0;
+        int               r           = 0;
+        pl_entry_lock_t  *lock        = NULL;
+        pl_entry_lock_t  *tmp         = NULL;
+        struct list_head  granted;
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                snprintf (name, sizeof (name), "file-%d", i);
+                r = __lock_name (pinode, name, ENTRYLK_WRLCK, &frames[i],
+                                 dom, &xl, 1);
+                if (r != 0)
+                        return -1;
+        }
+        lock_usec = elapsed_usec (&start);
 
-#define expect(cond) if (!(cond)) { goto out; }
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                snprintf (name, sizeof (name), "file-%d", i);
+                lock = __unlock_name (dom, name, ENTRYLK_WRLCK);
+                if (!lock)
+                        return -1;
+                free_lock (lock);
+        }
+        unlock_usec = elapsed_usec (&start);
 
-extern int lock_name (pl_inode_t *, const char *, entrylk_type);
-extern int unlock_name (pl_inode_t *, const char *, entrylk_type);
+        /* the same creates queued behind a lock on the whole directory */
+        r = __lock_name (pinode, NULL, ENTRYLK_WRLCK, &frames[count], dom,
+                         &xl, 1);
+        if (r != 0)
+                return -1;
+
+        for (i = 0; i < count; i++) {
+                snprintf (name, sizeof (name), "file-%d", i);
+                r = __lock_name (pinode, name, ENTRYLK_WRLCK, &frames[i],
+                                 dom, &xl, 0);
+                if (r != -EAGAIN)
+                        return -1;
+        }
+
+        free_lock (__unlock_name (dom, NULL, ENTRYLK_WRLCK));
+
+        INIT_LIST_HEAD (&granted);
+
+        gettimeofday (&start, NULL);
+        __grant_blocked_entry_locks (&xl, pinode, dom, &granted);
+        grant_usec = elapsed_usec (&start);
+
+        list_for_each_entry_safe (lock, tmp, &granted, blocked_locks) {
+                list_del_init (&lock->blocked_locks);
+                free_lock (lock);
+        }
+
+        for (i = 0; i < count; i++) {
+                snprintf (name, sizeof (name), "file-%d", i);
+                lock = __unlock_name (dom, name, ENTRYLK_WRLCK);
+                if (!lock)
+                        return -1;
+                free_lock (lock);
+        }
+
+        printf ("entrylk %8d  lock %8.3f us/op  unlock %8.3f us/op  "
+                "grant %8.3f us/op\n", count, lock_usec / count,
+                unlock_usec / count, grant_usec / count);
+
+        return 0;
+}
+
+static int
+match_all (pl_itree_node_t *node, void *data)
+{
+        return 1;
+}
+
+/* n disjoint byte ranges held, as by self-heal or striped writers */
+static int
+bench_itree (int count)
+{
+        struct timeval   start;
+        double           insert_usec = 0;
+        double           find_usec   = 0;
+        double           remove_usec = 0;
+        pl_itree_t       tree;
+        pl_itree_node_t *nodes       = NULL;
+        pl_itree_node_t *found       = NULL;
+        int              i           = 0;
+
+        nodes = CALLOC (count, sizeof (*nodes));
+        if (!nodes)
+                return -1;
+
+        pl_itree_init (&tree);
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++)
+                pl_itree_insert (&tree, &nodes[i], (off_t) i * 4096,
+                                 (off_t) i * 4096 + 4095);
+        insert_usec = elapsed_usec (&start);
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                found = pl_itree_find (&tree, (off_t) i * 4096 + 100,
+                                       (off_t) i * 4096 + 200, match_all,
+                                       NULL);
+                if (found != &nodes[i])
+                        return -1;
+        }
+        find_usec = elapsed_usec (&start);
+
+        if (pl_itree_find (&tree, (off_t) count * 4096, LLONG_MAX, NULL,
+                           NULL))
+                return -1;
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++)
+                pl_itree_remove (&tree, &nodes[i]);
+        remove_usec = elapsed_usec (&start);
+
+        if (tree.root || tree.count)
+                return -1;
+
+        printf ("inodelk %8d  lock %8.3f us/op  unlock %8.3f us/op  "
+                "conflict check %8.3f us/op\n", count, insert_usec / count,
+                remove_usec / count, find_usec / count);
+
+        FREE (nodes);
+        return 0;
+}
 
 int main (int argc, char **argv)
 {
-	int ret = 1;
-	int r = -1;
-
-	pl_inode_t *pinode = CALLOC (sizeof (pl_inode_t), 1);
-	pthread_mutex_init (&pinode->dir_lock_mutex, NULL);
-	INIT_LIST_HEAD (&pinode->gf_dir_locks);
-
-	r = lock_name (pinode, NULL, ENTRYLK_WRLCK); expect (r == 0);
-	{
-		r = lock_name (pinode, "foo", ENTRYLK_WRLCK); expect (r == -EAGAIN);
-	}
-	r = unlock_name (pinode, NULL, ENTRYLK_WRLCK); expect (r == 0);
-
-	r = lock_name (pinode, "foo", ENTRYLK_RDLCK); expect (r == 0);
-	{
-		r = lock_name (pinode, "foo", ENTRYLK_RDLCK); expect (r == 0);
-		{
-			r = lock_name (pinode, "foo", ENTRYLK_WRLCK); expect (r == -EAGAIN);
-		}
-		r = unlock_name (pinode, "foo", ENTRYLK_RDLCK); expect (r == 0);
-	}
-	r = unlock_name (pinode, "foo", ENTRYLK_RDLCK); expect (r == 0);
-	
-	r = lock_name (pinode, "foo", ENTRYLK_WRLCK); expect (r == 0);
-	r = unlock_name (pinode, "foo", ENTRYLK_WRLCK); expect (r == 0);
-
-	r = lock_name (pinode, "baz", ENTRYLK_WRLCK); expect (r == 0);
-	r = lock_name (pinode, "baz", ENTRYLK_RDLCK); expect (r == -EAGAIN);
-
-	ret = 0;
+        int            ret    = 1;
+        int            max    = 16384;
+        int            count  = 0;
+        pl_inode_t    *pinode = NULL;
+        pl_dom_list_t *dom    = NULL;
+        call_frame_t  *frames = NULL;
+
+        if (argc > 1)
+                max = atoi (argv[1]);
+
+        glusterfs_globals_init ();
+
+        pinode = CALLOC (sizeof (pl_inode_t), 1);
+        expect (pinode != NULL);
+        pthread_mutex_init (&pinode->mutex, NULL);
+        INIT_LIST_HEAD (&pinode->dom_list);
+
+        dom = get_domain (pinode, "unit-test");
+        expect (dom != NULL);
+
+        frames = new_frames (max + 1);
+        expect (frames != NULL);
+
+        expect (check_entrylk (pinode, dom, frames) == 0);
+
+        for (count = 1024; count <= max; count *= 2) {
+                expect (bench_entrylk (pinode, dom, frames, count) == 0);
+                expect (list_empty (&dom->entrylk_list));
+                expect (list_empty (&dom->blocked_entrylks));
+        }
+
+        for (count = 1024; count <= max; count *= 2)
+                expect (bench_itree (count) == 0);
+
+        ret = 0;
 out:
-	return ret;
+        return ret;
 }
@@ -34,6 +34,7 @@ marker_inode_ctx_new ()
                 goto out;
 
         ctx->quota_ctx = NULL;
+        INIT_LIST_HEAD (&ctx->xtime_pending);
 out:
         return ctx;
 }
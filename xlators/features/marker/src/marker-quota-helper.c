@@ -126,6 +126,7 @@ quota_alloc_inode_ctx ()
         ctx->updation_status = _gf_false;
         LOCK_INIT (&ctx->lock);
         INIT_LIST_HEAD (&ctx->contribution_head);
+        INIT_LIST_HEAD (&ctx->pending);
 out:
         return ctx;
 }
@@ -1287,6 +1287,7 @@ quota_inodelk_cbk (call_frame_t *frame, void *cookie,
         int32_t         ret    = 0;
         gf_boolean_t    status = _gf_false;
         quota_local_t  *local  = NULL;
+        marker_conf_t  *priv   = NULL;
 
         local = frame->local;
 
@@ -1314,6 +1315,17 @@ quota_inodelk_cbk (call_frame_t *frame, void *cookie,
                         xattr_updation_done (frame, NULL, this, 0, 0, NULL);
                         goto out;
                 }
+
+                priv = this->private;
+                if (priv->quota_update_interval) {
+                        /* let the other children of this directory catch
+                         * up, the whole batch goes one level up at once
+                         */
+                        mq_defer_quota_txn (this, &local->loc, local->delta);
+                        xattr_updation_done (frame, NULL, this, 0, 0, NULL);
+                        goto out;
+                }
+
                 status = _gf_true;
 
                 ret = mq_test_and_set_ctx_updation_status (local->ctx, &status);
@@ -1970,6 +1982,137 @@ out:
 }
 
 
+static void
+mq_flush_pending_txns (xlator_t *this)
+{
+        marker_conf_t     *priv = NULL;
+        quota_inode_ctx_t *ctx  = NULL;
+        loc_t              loc  = {0, };
+
+        priv = this->private;
+
+        while (1) {
+                LOCK (&priv->lock);
+                {
+                        if (list_empty (&priv->quota_pending)) {
+                                priv->quota_pending_bytes = 0;
+                                ctx = NULL;
+                        } else {
+                                ctx = list_entry (priv->quota_pending.next,
+                                                  quota_inode_ctx_t, pending);
+                                list_del_init (&ctx->pending);
+
+                                loc = ctx->pending_loc;
+                                memset (&ctx->pending_loc, 0, sizeof (loc_t));
+                        }
+                }
+                UNLOCK (&priv->lock);
+
+                if (ctx == NULL)
+                        break;
+
+                initiate_quota_txn (this, &loc);
+
+                loc_wipe (&loc);
+        }
+}
+
+
+static void
+mq_pending_timer_cbk (void *data)
+{
+        xlator_t      *this = NULL;
+        marker_conf_t *priv = NULL;
+
+        this = data;
+        priv = this->private;
+
+        LOCK (&priv->lock);
+        {
+                if (priv->quota_timer)
+                        gf_timer_call_cancel (this->ctx, priv->quota_timer);
+                priv->quota_timer = NULL;
+        }
+        UNLOCK (&priv->lock);
+
+        mq_flush_pending_txns (this);
+}
+
+
+/* Queue the inode for a quota txn instead of starting one right away.
+ * Every write to a file or update of a directory in the interval folds
+ * into a single txn, since the txn recomputes the delta from the on-disk
+ * size and contribution anyway. Nothing is lost on a crash: the size and
+ * contribution xattrs stay mismatched on disk and lookup starts the txn.
+ */
+int
+mq_defer_quota_txn (xlator_t *this, loc_t *loc, int64_t delta)
+{
+        int32_t            ret   = -1;
+        gf_boolean_t       flush = _gf_false;
+        marker_conf_t     *priv  = NULL;
+        quota_inode_ctx_t *ctx   = NULL;
+        struct timeval     delay = {0, };
+
+        GF_VALIDATE_OR_GOTO ("marker", this, out);
+        GF_VALIDATE_OR_GOTO ("marker", loc, out);
+        GF_VALIDATE_OR_GOTO ("marker", loc->inode, out);
+
+        priv = this->private;
+
+        if (priv->quota_update_interval == 0 || loc->parent == NULL)
+                return initiate_quota_txn (this, loc);
+
+        ret = quota_inode_ctx_get (loc->inode, this, &ctx);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "inode ctx get failed, aborting quota txn");
+                goto out;
+        }
+
+        if (delta < 0)
+                delta = -delta;
+
+        LOCK (&priv->lock);
+        {
+                if (list_empty (&ctx->pending)) {
+                        ret = mq_loc_copy (&ctx->pending_loc, loc);
+                        if (ret < 0) {
+                                UNLOCK (&priv->lock);
+                                goto out;
+                        }
+
+                        list_add_tail (&ctx->pending, &priv->quota_pending);
+                }
+
+                priv->quota_pending_bytes += delta;
+
+                if (priv->quota_pending_bytes >
+                    (int64_t) priv->quota_update_slack) {
+                        flush = _gf_true;
+                } else if (priv->quota_timer == NULL) {
+                        delay.tv_sec  = priv->quota_update_interval;
+                        delay.tv_usec = 0;
+
+                        priv->quota_timer =
+                                gf_timer_call_after (this->ctx, delay,
+                                                     mq_pending_timer_cbk,
+                                                     (void *) this);
+                        if (priv->quota_timer == NULL)
+                                flush = _gf_true;
+                }
+        }
+        UNLOCK (&priv->lock);
+
+        if (flush)
+                mq_flush_pending_txns (this);
+
+        ret = 0;
+out:
+        return ret;
+}
+
+
 /* int32_t */
 /* validate_inode_size_contribution (xlator_t *this, loc_t *loc, int64_t size, */
 /*                                int64_t contribution) */
@@ -2452,9 +2595,78 @@ out:
 
 
 int32_t
-init_quota_priv (xlator_t *this)
+init_quota_priv (xlator_t *this, dict_t *options)
 {
-        return 0;
+        int32_t        ret      = -1;
+        uint32_t       interval = QUOTA_UPDATE_INTERVAL;
+        uint64_t       slack    = QUOTA_UPDATE_SLACK;
+        data_t        *data     = NULL;
+        marker_conf_t *priv     = NULL;
+
+        priv = this->private;
+
+        data = dict_get (options, "quota-update-interval");
+        if (data) {
+                ret = gf_string2uint32 (data->data, &interval);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid quota-update-interval %s",
+                                data->data);
+                        goto out;
+                }
+        }
+
+        data = dict_get (options, "quota-update-slack");
+        if (data) {
+                ret = gf_string2bytesize (data->data, &slack);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid quota-update-slack %s",
+                                data->data);
+                        goto out;
+                }
+        }
+
+        LOCK (&priv->lock);
+        {
+                priv->quota_update_interval = interval;
+                priv->quota_update_slack = slack;
+        }
+        UNLOCK (&priv->lock);
+
+        /* deferral was switched off, push out what is queued */
+        if (interval == 0)
+                mq_flush_pending_txns (this);
+
+        ret = 0;
+out:
+        return ret;
+}
+
+
+void
+quota_priv_cleanup (xlator_t *this)
+{
+        marker_conf_t     *priv = NULL;
+        quota_inode_ctx_t *ctx  = NULL;
+        quota_inode_ctx_t *tmp  = NULL;
+
+        priv = this->private;
+
+        LOCK (&priv->lock);
+        {
+                if (priv->quota_timer)
+                        gf_timer_call_cancel (this->ctx, priv->quota_timer);
+                priv->quota_timer = NULL;
+
+                list_for_each_entry_safe (ctx, tmp, &priv->quota_pending,
+                                          pending) {
+                        list_del_init (&ctx->pending);
+                        loc_wipe (&ctx->pending_loc);
+                }
+                priv->quota_pending_bytes = 0;
+        }
+        UNLOCK (&priv->lock);
 }
 
 
@@ -35,6 +35,14 @@
 #define CONTRI_KEY_MAX 512
 #define READDIR_BUF 4096
 
+#define QUOTA_UPDATE_INTERVAL 1
+#define QUOTA_UPDATE_SLACK    (10 * GF_UNIT_MB)
+
+/* change in on-disk usage between the pre and post op iatts of a fop */
+#define QUOTA_SIZE_DELTA(_prebuf, _postbuf)                     \
+        (((int64_t) (_postbuf)->ia_blocks -                     \
+          (int64_t) (_prebuf)->ia_blocks) * 512)
+
 #define QUOTA_STACK_DESTROY(_frame, _this)              \
         do {                                            \
                 quota_local_t *_local = NULL;           \
@@ -92,6 +100,9 @@ struct quota_inode_ctx {
         gf_boolean_t           updation_status;
         gf_lock_t              lock;
         struct list_head       contribution_head;
+        struct list_head       pending;     /* deferred txn, protected by
+                                               marker_conf->lock */
+        loc_t                  pending_loc;
 };
 typedef struct quota_inode_ctx quota_inode_ctx_t;
 
@@ -132,7 +143,10 @@ int32_t
 quota_req_xattr (xlator_t *, loc_t *, dict_t *);
 
 int32_t
-init_quota_priv (xlator_t *);
+init_quota_priv (xlator_t *, dict_t *);
+
+void
+quota_priv_cleanup (xlator_t *);
 
 int32_t
 quota_xattr_state (xlator_t *, loc_t *, dict_t *, struct iatt);
@@ -143,6 +157,9 @@ quota_set_inode_xattr (xlator_t *, loc_t *);
 int
 initiate_quota_txn (xlator_t *, loc_t *);
 
+int
+mq_defer_quota_txn (xlator_t *, loc_t *, int64_t);
+
 int32_t
 quota_dirty_inode_readdir (call_frame_t *, void *, xlator_t *,
                            int32_t, int32_t, fd_t *);
@@ -426,9 +426,402 @@ marker_create_frame (xlator_t *this, marker_local_t *local)
         return 0;
 }
 
+static int32_t
+marker_path_depth (const char *path)
+{
+        int32_t depth = 0;
+
+        if (strcmp (path, "/") == 0)
+                return 0;
+
+        for (; *path; path++)
+                if (*path == '/')
+                        depth++;
+
+        return depth;
+}
+
+static int
+marker_xtime_entry_cmp (const void *a, const void *b)
+{
+        const marker_xtime_entry_t *ea = a;
+        const marker_xtime_entry_t *eb = b;
+
+        /* deepest first, a directory is written after its descendants */
+        return eb->depth - ea->depth;
+}
+
+static gf_boolean_t
+marker_xtime_newer (uint32_t *xtime, struct timeval *tv)
+{
+        if (xtime[0] != (uint32_t) tv->tv_sec)
+                return (xtime[0] > (uint32_t) tv->tv_sec);
+
+        return (xtime[1] >= (uint32_t) tv->tv_usec);
+}
+
+static void
+marker_xtime_flush_timer_cbk (void *data);
+
+static void
+__marker_xtime_arm_timer (xlator_t *this, marker_conf_t *priv)
+{
+        struct timeval delay = {0, };
+
+        if (priv->xtime_timer || priv->xtime_flushing ||
+            list_empty (&priv->xtime_pending))
+                return;
+
+        delay.tv_sec  = priv->xtime_update_interval;
+        delay.tv_usec = 0;
+
+        priv->xtime_timer = gf_timer_call_after (this->ctx, delay,
+                                                 marker_xtime_flush_timer_cbk,
+                                                 (void *) this);
+        if (priv->xtime_timer == NULL)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "failed to arm the xtime flush timer");
+}
+
+static int32_t
+marker_xtime_batch_done (call_frame_t *frame, xlator_t *this)
+{
+        int32_t               i     = 0;
+        marker_conf_t        *priv  = NULL;
+        marker_xtime_batch_t *batch = NULL;
+
+        priv = this->private;
+        batch = frame->local;
+
+        frame->local = NULL;
+        STACK_DESTROY (frame->root);
+
+        for (i = 0; i < batch->count; i++)
+                loc_wipe (&batch->entries[i].loc);
+
+        GF_FREE (batch);
+
+        LOCK (&priv->lock);
+        {
+                priv->xtime_flushing = _gf_false;
+                __marker_xtime_arm_timer (this, priv);
+        }
+        UNLOCK (&priv->lock);
+
+        return 0;
+}
+
+static int32_t
+marker_xtime_batch_wind (call_frame_t *frame, xlator_t *this);
+
+static int32_t
+marker_xtime_batch_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                        int32_t op_ret, int32_t op_errno)
+{
+        marker_xtime_batch_t *batch = NULL;
+
+        batch = frame->local;
+
+        if (op_ret == -1 && op_errno == ENOSPC) {
+                marker_error_handler (this);
+                marker_xtime_batch_done (frame, this);
+                goto out;
+        }
+
+        batch->next++;
+
+        marker_xtime_batch_wind (frame, this);
+out:
+        return 0;
+}
+
+static int32_t
+marker_xtime_batch_wind (call_frame_t *frame, xlator_t *this)
+{
+        int32_t               ret   = 0;
+        dict_t               *dict  = NULL;
+        marker_conf_t        *priv  = NULL;
+        marker_xtime_batch_t *batch = NULL;
+        marker_xtime_entry_t *entry = NULL;
+
+        priv = this->private;
+        batch = frame->local;
+
+        for (; batch->next < batch->count; batch->next++) {
+                entry = &batch->entries[batch->next];
+
+                dict = dict_new ();
+                if (dict == NULL)
+                        break;
+
+                ret = dict_set_static_bin (dict, priv->marker_xattr,
+                                           (void *)entry->timebuf, 8);
+                if (ret) {
+                        dict_unref (dict);
+                        dict = NULL;
+                        continue;
+                }
+
+                gf_log (this->name, GF_LOG_DEBUG, "path = %s",
+                        entry->loc.path);
+
+                STACK_WIND (frame, marker_xtime_batch_cbk, FIRST_CHILD(this),
+                            FIRST_CHILD(this)->fops->setxattr, &entry->loc,
+                            dict, 0);
+
+                dict_unref (dict);
+
+                return 0;
+        }
+
+        marker_xtime_batch_done (frame, this);
+
+        return 0;
+}
+
+/* Write out every pending xtime with one frame, one setxattr after the
+ * other, deepest path first. Since every update raised the xtime of all
+ * the ancestors of the inode to at least its own value, an ancestor is
+ * never behind its descendants once the batch is on disk, and it is
+ * never written before them.
+ */
+static void
+marker_xtime_flush (xlator_t *this)
+{
+        int32_t               count = 0;
+        marker_conf_t        *priv  = NULL;
+        marker_inode_ctx_t   *ctx   = NULL;
+        marker_xtime_batch_t *batch = NULL;
+        marker_xtime_entry_t *entry = NULL;
+        call_frame_t         *frame = NULL;
+
+        priv = this->private;
+
+        LOCK (&priv->lock);
+        {
+                if (priv->xtime_flushing)
+                        count = 0;
+                else
+                        count = priv->xtime_pending_count;
+                if (count)
+                        priv->xtime_flushing = _gf_true;
+        }
+        UNLOCK (&priv->lock);
+
+        if (count == 0)
+                goto out;
+
+        batch = GF_CALLOC (1, sizeof (*batch) + count * sizeof (*entry),
+                           gf_marker_mt_marker_xtime_batch_t);
+        if (batch == NULL)
+                goto err;
+
+        LOCK (&priv->lock);
+        {
+                while (batch->count < count &&
+                       !list_empty (&priv->xtime_pending)) {
+                        ctx = list_entry (priv->xtime_pending.next,
+                                          marker_inode_ctx_t, xtime_pending);
+                        list_del_init (&ctx->xtime_pending);
+                        priv->xtime_pending_count--;
+
+                        entry = &batch->entries[batch->count++];
+
+                        entry->loc = ctx->xtime_loc;
+                        memset (&ctx->xtime_loc, 0, sizeof (loc_t));
+
+                        entry->timebuf[0] = htonl (ctx->xtime[0]);
+                        entry->timebuf[1] = htonl (ctx->xtime[1]);
+                        entry->depth = ctx->xtime_depth;
+                }
+        }
+        UNLOCK (&priv->lock);
+
+        qsort (batch->entries, batch->count, sizeof (*entry),
+               marker_xtime_entry_cmp);
+
+        frame = create_frame (this, this->ctx->pool);
+        if (frame == NULL)
+                goto err;
+
+        frame->local = batch;
+
+        marker_xtime_batch_wind (frame, this);
+out:
+        return;
+err:
+        /* the entries are lost, same as a failed setxattr */
+        if (batch) {
+                for (count = 0; count < batch->count; count++)
+                        loc_wipe (&batch->entries[count].loc);
+                GF_FREE (batch);
+        }
+
+        LOCK (&priv->lock);
+        {
+                priv->xtime_flushing = _gf_false;
+        }
+        UNLOCK (&priv->lock);
+}
+
+static void
+marker_xtime_flush_timer_cbk (void *data)
+{
+        xlator_t      *this = NULL;
+        marker_conf_t *priv = NULL;
+
+        this = data;
+        priv = this->private;
+
+        LOCK (&priv->lock);
+        {
+                if (priv->xtime_timer)
+                        gf_timer_call_cancel (this->ctx, priv->xtime_timer);
+                priv->xtime_timer = NULL;
+        }
+        UNLOCK (&priv->lock);
+
+        marker_xtime_flush (this);
+}
+
+/* Record the xtime on the inode and on each of its ancestors, stopping
+ * at the first one which already carries a newer value, the ones above
+ * it were raised at least as much.
+ */
+static int32_t
+marker_xtime_mark_pending (xlator_t *this, marker_local_t *local)
+{
+        int32_t             ret    = -1;
+        gf_boolean_t        stop   = _gf_false;
+        gf_boolean_t        insert = _gf_false;
+        struct timeval      tv     = {0, };
+        marker_conf_t      *priv   = NULL;
+        marker_inode_ctx_t *ctx    = NULL;
+        inode_t            *inode  = NULL;
+        inode_t            *parent = NULL;
+        loc_t               loc    = {0, };
+
+        priv = this->private;
+
+        gettimeofday (&tv, NULL);
+
+        inode = inode_ref (local->loc.inode);
+
+        while (inode) {
+                ret = marker_force_inode_ctx_get (inode, this, &ctx);
+                if (ret < 0)
+                        break;
+
+                insert = _gf_false;
+
+                LOCK (&priv->lock);
+                {
+                        if (list_empty (&ctx->xtime_pending))
+                                insert = _gf_true;
+                        else if (marker_xtime_newer (ctx->xtime, &tv))
+                                stop = _gf_true;
+                        else {
+                                ctx->xtime[0] = tv.tv_sec;
+                                ctx->xtime[1] = tv.tv_usec;
+                        }
+                }
+                UNLOCK (&priv->lock);
+
+                if (stop)
+                        break;
+
+                if (insert) {
+                        if (inode == local->loc.inode)
+                                ret = loc_copy (&loc, &local->loc);
+                        else
+                                ret = marker_inode_loc_fill (inode, &loc);
+                        if (ret < 0)
+                                break;
+
+                        LOCK (&priv->lock);
+                        {
+                                if (list_empty (&ctx->xtime_pending)) {
+                                        ctx->xtime_loc = loc;
+                                        ctx->xtime_depth =
+                                                marker_path_depth (loc.path);
+                                        memset (&loc, 0, sizeof (loc));
+
+                                        list_add_tail (&ctx->xtime_pending,
+                                                       &priv->xtime_pending);
+                                        priv->xtime_pending_count++;
+                                }
+
+                                if (!marker_xtime_newer (ctx->xtime, &tv)) {
+                                        ctx->xtime[0] = tv.tv_sec;
+                                        ctx->xtime[1] = tv.tv_usec;
+                                }
+                        }
+                        UNLOCK (&priv->lock);
+
+                        loc_wipe (&loc);
+                }
+
+                if (inode->ino == 1)
+                        break;
+
+                if (inode == local->loc.inode && local->loc.parent)
+                        parent = inode_ref (local->loc.parent);
+                else
+                        parent = inode_parent (inode, 0, NULL);
+
+                inode_unref (inode);
+                inode = parent;
+                parent = NULL;
+        }
+
+        if (inode)
+                inode_unref (inode);
+
+        LOCK (&priv->lock);
+        {
+                __marker_xtime_arm_timer (this, priv);
+        }
+        UNLOCK (&priv->lock);
+
+        return 0;
+}
+
+void
+marker_xtime_priv_pending_cleanup (xlator_t *this)
+{
+        marker_conf_t      *priv = NULL;
+        marker_inode_ctx_t *ctx  = NULL;
+        marker_inode_ctx_t *tmp  = NULL;
+
+        priv = this->private;
+
+        LOCK (&priv->lock);
+        {
+                if (priv->xtime_timer)
+                        gf_timer_call_cancel (this->ctx, priv->xtime_timer);
+                priv->xtime_timer = NULL;
+
+                list_for_each_entry_safe (ctx, tmp, &priv->xtime_pending,
+                                          xtime_pending) {
+                        list_del_init (&ctx->xtime_pending);
+                        loc_wipe (&ctx->xtime_loc);
+                }
+                priv->xtime_pending_count = 0;
+        }
+        UNLOCK (&priv->lock);
+}
+
 int32_t
 marker_xtime_update_marks (xlator_t *this, marker_local_t *local)
 {
+        marker_conf_t *priv = NULL;
+
+        priv = this->private;
+
+        if (priv->xtime_update_interval && local->loc.inode &&
+            local->loc.path)
+                return marker_xtime_mark_pending (this, local);
+
         marker_gettimeofday (local);
 
         marker_local_ref (local);
@@ -607,7 +1000,8 @@ marker_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         priv = this->private;
 
         if (priv->feature_enabled & GF_QUOTA)
-                initiate_quota_txn (this, &local->loc);
+                mq_defer_quota_txn (this, &local->loc,
+                                    QUOTA_SIZE_DELTA (prebuf, postbuf));
 
         if (priv->feature_enabled & GF_XTIME)
                 marker_xtime_update_marks (this, local);
@@ -1453,7 +1847,8 @@ marker_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         priv = this->private;
 
         if (priv->feature_enabled & GF_QUOTA)
-                initiate_quota_txn (this, &local->loc);
+                mq_defer_quota_txn (this, &local->loc,
+                                    QUOTA_SIZE_DELTA (prebuf, postbuf));
 
         if (priv->feature_enabled & GF_XTIME)
                 marker_xtime_update_marks (this, local);
@@ -1521,7 +1916,8 @@ marker_ftruncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         priv = this->private;
 
         if (priv->feature_enabled & GF_QUOTA)
-                initiate_quota_txn (this, &local->loc);
+                mq_defer_quota_txn (this, &local->loc,
+                                    QUOTA_SIZE_DELTA (prebuf, postbuf));
 
         if (priv->feature_enabled & GF_XTIME)
                 marker_xtime_update_marks (this, local);
@@ -2247,6 +2643,18 @@ init_xtime_priv (xlator_t *this, dict_t *options)
                 goto out;
         }
 
+        priv->xtime_update_interval = XTIME_UPDATE_INTERVAL;
+        if ((data = dict_get (options, "xtime-update-interval")) != NULL) {
+                ret = gf_string2uint32 (data->data,
+                                        &priv->xtime_update_interval);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid xtime-update-interval %s",
+                                data->data);
+                        goto out;
+                }
+        }
+
         ret = 0;
 out:
         return ret;
@@ -2288,6 +2696,10 @@ marker_priv_cleanup (xlator_t *this)
 
         marker_xtime_priv_cleanup (this);
 
+        marker_xtime_priv_pending_cleanup (this);
+
+        quota_priv_cleanup (this);
+
         LOCK_DESTROY (&priv->lock);
 
         GF_FREE (priv);
@@ -2316,7 +2728,7 @@ reconfigure (xlator_t *this, dict_t *options)
         if (data) {
                 ret = gf_string2boolean (data->data, &flag);
                 if (ret == 0 && flag == _gf_true) {
-                        ret = init_quota_priv (this);
+                        ret = init_quota_priv (this, options);
                         if (ret < 0) {
                                 gf_log (this->name, GF_LOG_WARNING,
                                         "failed to initialize quota private");
@@ -2378,11 +2790,15 @@ init (xlator_t *this)
 
         LOCK_INIT (&priv->lock);
 
+        INIT_LIST_HEAD (&priv->quota_pending);
+
+        INIT_LIST_HEAD (&priv->xtime_pending);
+
         data = dict_get (options, "quota");
         if (data) {
                 ret = gf_string2boolean (data->data, &flag);
                 if (ret == 0 && flag == _gf_true) {
-                        ret = init_quota_priv (this);
+                        ret = init_quota_priv (this, options);
                         if (ret < 0)
                                 goto err;
 
@@ -2465,6 +2881,27 @@ struct volume_options options[] = {
         {.key = {"volume-uuid"}},
         {.key = {"timestamp-file"}},
         {.key = {"quota"}},
+        {.key = {"quota-update-interval"},
+         .type = GF_OPTION_TYPE_INT,
+         .min = 0,
+         .max = 60,
+         .description = "Seconds for which size changes are batched in "
+         "memory before being propagated to the ancestors. 0 propagates "
+         "every change right away."
+        },
+        {.key = {"quota-update-slack"},
+         .type = GF_OPTION_TYPE_SIZET,
+         .description = "Amount of unpropagated size changes after which "
+         "the batch is flushed before quota-update-interval expires."
+        },
         {.key = {"xtime"}},
+        {.key = {"xtime-update-interval"},
+         .type = GF_OPTION_TYPE_INT,
+         .min = 0,
+         .max = 60,
+         .description = "Seconds for which xtime updates are collapsed in "
+         "memory before being set on the inodes and their ancestors. 0 "
+         "sets them after every fop."
+        },
         {.key = {NULL}}
 };
@@ -29,6 +29,7 @@
 #include "defaults.h"
 #include "uuid.h"
 #include "call-stub.h"
+#include "timer.h"
 
 #define MARKER_XATTR_PREFIX "trusted.glusterfs"
 #define XTIME               "xtime"
@@ -36,6 +37,8 @@
 #define VOLUME_UUID         "volume-uuid"
 #define TIMESTAMP_FILE      "timestamp-file"
 
+#define XTIME_UPDATE_INTERVAL 1
+
 enum {
         GF_QUOTA=1,
         GF_XTIME=2
@@ -94,9 +97,29 @@ typedef struct marker_local marker_local_t;
 
 struct marker_inode_ctx {
         struct quota_inode_ctx *quota_ctx;
+
+        /* xtime waiting to be flushed, protected by marker_conf->lock */
+        struct list_head        xtime_pending;
+        loc_t                   xtime_loc;
+        uint32_t                xtime[2];
+        int32_t                 xtime_depth;
 };
 typedef struct marker_inode_ctx marker_inode_ctx_t;
 
+struct marker_xtime_entry {
+        loc_t           loc;
+        uint32_t        timebuf[2];
+        int32_t         depth;
+};
+typedef struct marker_xtime_entry marker_xtime_entry_t;
+
+struct marker_xtime_batch {
+        int32_t               count;
+        int32_t               next;
+        marker_xtime_entry_t  entries[0];
+};
+typedef struct marker_xtime_batch marker_xtime_batch_t;
+
 struct marker_conf{
         char         feature_enabled;
         char        *size_key;
@@ -107,6 +130,24 @@ struct marker_conf{
         char        *marker_xattr;
         uint64_t     quota_lk_owner;
         gf_lock_t    lock;
+
+        /* inodes whose contribution to the parent is yet to be
+         * propagated, flushed every quota_update_interval seconds or
+         * as soon as quota_pending_bytes crosses quota_update_slack */
+        struct list_head  quota_pending;
+        int64_t           quota_pending_bytes;
+        uint32_t          quota_update_interval;
+        uint64_t          quota_update_slack;
+        gf_timer_t       *quota_timer;
+
+        /* directories (and files) with a newer xtime than what is on
+         * disk, written out bottom-up every xtime_update_interval
+         * seconds by a single flush */
+        struct list_head  xtime_pending;
+        int32_t           xtime_pending_count;
+        uint32_t          xtime_update_interval;
+        gf_boolean_t      xtime_flushing;
+        gf_timer_t       *xtime_timer;
 };
 typedef struct marker_conf marker_conf_t;
 
@@ -38,10 +38,28 @@
 //#include "glusterd.h"
 #include "rpcsvc.h"
 
+typedef struct glusterd_store_kv_ {
+        char    *key;
+        char    *value;
+} glusterd_store_kv_t;
+
+/* a store file parsed once, key and value point into buf */
+struct glusterd_store_index_ {
+        int32_t                 ref;
+        char                    *buf;
+        glusterd_store_kv_t     *kv;
+        int32_t                 count;
+};
+
+typedef struct glusterd_store_index_  glusterd_store_index_t;
+
 struct glusterd_store_handle_ {
-        char    *path;
-        int     fd;
-        FILE    *read;
+        char                    *path;
+        int                     fd;
+        glusterd_store_index_t  *index;
+        char                    *wbuf;
+        size_t                  wlen;
+        size_t                  wsize;
 };
 
 typedef struct glusterd_store_handle_  glusterd_store_handle_t;
@@ -104,9 +104,68 @@ glusterd_store_mkstemp (glusterd_store_handle_t *shandle)
                         "error: %s", tmppath, strerror (errno));
         }
 
+        shandle->fd = fd;
+        shandle->wlen = 0;
+
         return fd;
 }
 
+/* write out everything glusterd_store_save_value buffered, a store file
+ * is rewritten with a single write () before being renamed in place
+ */
+static int32_t
+glusterd_store_flush (glusterd_store_handle_t *shandle)
+{
+        int32_t         ret = 0;
+        size_t          written = 0;
+
+        GF_ASSERT (shandle);
+
+        while (written < shandle->wlen) {
+                ret = write (shandle->fd, shandle->wbuf + written,
+                             shandle->wlen - written);
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        gf_log ("glusterd", GF_LOG_CRITICAL, "Unable to "
+                                "write %s.tmp, error: %s", shandle->path,
+                                strerror (errno));
+                        ret = -1;
+                        goto out;
+                }
+                written += ret;
+        }
+
+        ret = 0;
+out:
+        shandle->wlen = 0;
+        return ret;
+}
+
+static void
+glusterd_store_index_unref (glusterd_store_index_t *index)
+{
+        if (!index)
+                return;
+
+        if (--index->ref > 0)
+                return;
+
+        if (index->buf)
+                GF_FREE (index->buf);
+        if (index->kv)
+                GF_FREE (index->kv);
+        GF_FREE (index);
+}
+
+/* drop the parsed copy of a store file which was just rewritten */
+static void
+glusterd_store_handle_invalidate (glusterd_store_handle_t *shandle)
+{
+        glusterd_store_index_unref (shandle->index);
+        shandle->index = NULL;
+}
+
 int32_t
 glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
 {
@@ -116,13 +175,21 @@ glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
         GF_ASSERT (shandle);
         GF_ASSERT (shandle->path);
 
+        ret = glusterd_store_flush (shandle);
+        if (ret)
+                goto out;
+
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
         ret = rename (tmppath, shandle->path);
         if (ret) {
                 gf_log ("glusterd", GF_LOG_ERROR, "Failed to mv %s to %s, "
                         "error: %s", tmppath, shandle->path, strerror (errno));
+                goto out;
         }
 
+        glusterd_store_handle_invalidate (shandle);
+out:
+        shandle->fd = 0;
         return ret;
 }
 
@@ -135,6 +202,9 @@ glusterd_store_unlink_tmppath (glusterd_store_handle_t *shandle)
         GF_ASSERT (shandle);
         GF_ASSERT (shandle->path);
 
+        shandle->fd = 0;
+        shandle->wlen = 0;
+
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
         ret = unlink (tmppath);
         if (ret && (errno != ENOENT)) {
@@ -228,7 +298,7 @@ glusterd_store_brickinfopath_set (glusterd_volinfo_t *volinfo,
 }
 
 int32_t
-glusterd_store_volinfo_brick_fname_write (int vol_fd,
+glusterd_store_volinfo_brick_fname_write (glusterd_store_handle_t *vol_shandle,
                                          glusterd_brickinfo_t *brickinfo,
                                          int32_t brick_count)
 {
@@ -240,7 +310,7 @@ glusterd_store_volinfo_brick_fname_write (int vol_fd,
                   brick_count);
         glusterd_store_brickinfofname_set (brickinfo, brickfname,
                                         sizeof (brickfname));
-        ret = glusterd_store_save_value (vol_fd, key, brickfname);
+        ret = glusterd_store_save_value (vol_shandle, key, brickfname);
         return ret;
 }
 
@@ -262,30 +332,31 @@ glusterd_store_create_brick_shandle_on_absence (glusterd_volinfo_t *volinfo,
 }
 
 int32_t
-glusterd_store_brickinfo_write (int fd, glusterd_brickinfo_t *brickinfo)
+glusterd_store_brickinfo_write (glusterd_store_handle_t *shandle,
+                                glusterd_brickinfo_t *brickinfo)
 {
         char                    value[256] = {0,};
         int32_t                 ret = 0;
 
         GF_ASSERT (brickinfo);
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_HOSTNAME,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_HOSTNAME,
                                          brickinfo->hostname);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_PATH,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_PATH,
                                          brickinfo->path);
         if (ret)
                 goto out;
 
         snprintf (value, sizeof(value), "%d", brickinfo->port);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_PORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_PORT,
                                          value);
 
         snprintf (value, sizeof(value), "%d", brickinfo->rdma_port);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_RDMA_PORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_RDMA_PORT,
                                          value);
 
 out:
@@ -306,7 +377,7 @@ glusterd_store_perform_brick_store (glusterd_brickinfo_t *brickinfo)
                 goto out;
         }
 
-        ret = glusterd_store_brickinfo_write (fd, brickinfo);
+        ret = glusterd_store_brickinfo_write (brickinfo->shandle, brickinfo);
         if (ret)
                 goto out;
 
@@ -323,14 +394,14 @@ out:
 int32_t
 glusterd_store_brickinfo (glusterd_volinfo_t *volinfo,
                           glusterd_brickinfo_t *brickinfo, int32_t brick_count,
-                          int vol_fd)
+                          glusterd_store_handle_t *vol_shandle)
 {
         int32_t                 ret = -1;
 
         GF_ASSERT (volinfo);
         GF_ASSERT (brickinfo);
 
-        ret = glusterd_store_volinfo_brick_fname_write (vol_fd, brickinfo,
+        ret = glusterd_store_volinfo_brick_fname_write (vol_shandle, brickinfo,
                                                        brick_count);
         if (ret)
                 goto out;
@@ -477,7 +548,7 @@ _storeslaves (dict_t *this, char *key, data_t *value, void *data)
         gf_log ("", GF_LOG_DEBUG, "Storing in volinfo:key= %s, val=%s",
                 key, value->data);
 
-        ret = glusterd_store_save_value (shandle->fd, key, (char*)value->data);
+        ret = glusterd_store_save_value (shandle, key, (char*)value->data);
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Unable to write into store"
                                 " handle for path: %s", shandle->path);
@@ -518,7 +589,7 @@ void _storeopts (dict_t *this, char *key, data_t *value, void *data)
                 return;
         }
 
-        ret = glusterd_store_save_value (shandle->fd, key, (char*)value->data);
+        ret = glusterd_store_save_value (shandle, key, (char*)value->data);
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Unable to write into store"
                                 " handle for path: %s", shandle->path);
@@ -527,48 +598,49 @@ void _storeopts (dict_t *this, char *key, data_t *value, void *data)
 }
 
 int32_t
-glusterd_volume_exclude_options_write (int fd, glusterd_volinfo_t *volinfo)
+glusterd_volume_exclude_options_write (glusterd_store_handle_t *shandle,
+                                       glusterd_volinfo_t *volinfo)
 {
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
         GF_ASSERT (volinfo);
 
         char                    buf[PATH_MAX] = {0,};
         int32_t                 ret           = -1;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->type);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_TYPE, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_TYPE, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->brick_count);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_COUNT, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_COUNT, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->status);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_STATUS, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_STATUS, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->sub_count);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_SUB_COUNT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_SUB_COUNT,
                                          buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->version);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_VERSION,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_VERSION,
                                          buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->transport_type);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_TRANSPORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_TRANSPORT,
                                          buf);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_ID,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_ID,
                                          uuid_utoa (volinfo->volume_id));
         if (ret)
                 goto out;
@@ -610,24 +682,21 @@ glusterd_store_create_volume_dir (glusterd_volinfo_t *volinfo)
 }
 
 int32_t
-glusterd_store_volinfo_write (int fd, glusterd_volinfo_t *volinfo)
+glusterd_store_volinfo_write (glusterd_store_handle_t *shandle,
+                              glusterd_volinfo_t *volinfo)
 {
         int32_t                         ret = -1;
-        glusterd_store_handle_t         *shandle = NULL;
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
+        GF_ASSERT (shandle->fd > 0);
         GF_ASSERT (volinfo);
-        GF_ASSERT (volinfo->shandle);
 
-        shandle = volinfo->shandle;
-        ret = glusterd_volume_exclude_options_write (fd, volinfo);
+        ret = glusterd_volume_exclude_options_write (shandle, volinfo);
         if (ret)
                 goto out;
 
-        shandle->fd = fd;
         dict_foreach (volinfo->dict, _storeopts, shandle);
 
         dict_foreach (volinfo->gsync_slaves, _storeslaves, shandle);
-        shandle->fd = 0;
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
@@ -691,7 +760,8 @@ glusterd_store_create_vol_shandle_on_absence (glusterd_volinfo_t *volinfo)
 }
 
 int32_t
-glusterd_store_brickinfos (glusterd_volinfo_t *volinfo, int vol_fd)
+glusterd_store_brickinfos (glusterd_volinfo_t *volinfo,
+                           glusterd_store_handle_t *vol_shandle)
 {
         int32_t                 ret = 0;
         glusterd_brickinfo_t    *brickinfo = NULL;
@@ -701,7 +771,7 @@ glusterd_store_brickinfos (glusterd_volinfo_t *volinfo, int vol_fd)
 
         list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
                 ret = glusterd_store_brickinfo (volinfo, brickinfo,
-                                            brick_count, vol_fd);
+                                            brick_count, vol_shandle);
                 if (ret)
                         goto out;
                 brick_count++;
@@ -712,16 +782,17 @@ out:
 }
 
 int32_t
-glusterd_store_rbstate_write (int fd, glusterd_volinfo_t *volinfo)
+glusterd_store_rbstate_write (glusterd_store_handle_t *shandle,
+                              glusterd_volinfo_t *volinfo)
 {
         int     ret             = -1;
         char    buf[PATH_MAX]   = {0, };
 
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
         GF_ASSERT (volinfo);
 
         snprintf (buf, sizeof (buf), "%d", volinfo->rb_status);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_RB_STATUS,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_RB_STATUS,
                                          buf);
         if (ret)
                 goto out;
@@ -731,7 +802,7 @@ glusterd_store_rbstate_write (int fd, glusterd_volinfo_t *volinfo)
                 snprintf (buf, sizeof (buf), "%s:%s",
                           volinfo->src_brick->hostname,
                           volinfo->src_brick->path);
-                ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_RB_SRC_BRICK,
+                ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_RB_SRC_BRICK,
                                                  buf);
                 if (ret)
                         goto out;
@@ -739,7 +810,7 @@ glusterd_store_rbstate_write (int fd, glusterd_volinfo_t *volinfo)
                 snprintf (buf, sizeof (buf), "%s:%s",
                           volinfo->dst_brick->hostname,
                           volinfo->dst_brick->path);
-                ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_RB_DST_BRICK,
+                ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_RB_DST_BRICK,
                                                  buf);
                 if (ret)
                         goto out;
@@ -763,7 +834,7 @@ glusterd_store_perform_rbstate_store (glusterd_volinfo_t *volinfo)
                 goto out;
         }
 
-        ret = glusterd_store_rbstate_write (fd, volinfo);
+        ret = glusterd_store_rbstate_write (volinfo->rb_shandle, volinfo);
         if (ret)
                 goto out;
 
@@ -791,11 +862,11 @@ glusterd_store_perform_volume_store (glusterd_volinfo_t *volinfo)
                 goto out;
         }
 
-        ret = glusterd_store_volinfo_write (fd, volinfo);
+        ret = glusterd_store_volinfo_write (volinfo->shandle, volinfo);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_brickinfos (volinfo, fd);
+        ret = glusterd_store_brickinfos (volinfo, volinfo->shandle);
         if (ret)
                 goto out;
 
@@ -943,42 +1014,133 @@ out:
 }
 
 
-int
-glusterd_store_read_and_tokenize (FILE *file, char *str,
-                                  char **iter_key, char **iter_val,
-                                  glusterd_store_op_errno_t *store_errno)
+/* Read the whole store file and split it into key=value pairs, the same
+ * way it used to be tokenized with fscanf () one key at a time.
+ */
+static int32_t
+glusterd_store_index_build (char *path, glusterd_store_index_t **index,
+                            glusterd_store_op_errno_t *store_errno)
 {
-        int32_t  ret = -1;
+        int32_t                 ret = -1;
+        int                     fd = -1;
+        ssize_t                 len = 0;
+        size_t                  size = 0;
+        int32_t                 slots = 0;
+        char                    *token = NULL;
+        char                    *saveptr = NULL;
+        char                    *kvptr = NULL;
+        struct stat             st = {0,};
+        glusterd_store_kv_t     *kv = NULL;
+        glusterd_store_index_t  *tmp_index = NULL;
 
-        GF_ASSERT (file);
-        GF_ASSERT (str);
-        GF_ASSERT (iter_key);
-        GF_ASSERT (iter_val);
+        GF_ASSERT (path);
+        GF_ASSERT (index);
         GF_ASSERT (store_errno);
 
-        ret = fscanf (file, "%s", str);
-        if (ret <= 0) {
-                ret = -1;
-                *store_errno = GD_STORE_EOF;
+        *store_errno = GD_STORE_SUCCESS;
+
+        fd = open (path, O_RDONLY);
+        if (fd < 0) {
+                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %d",
+                        path, errno);
                 goto out;
         }
 
-        *iter_key = strtok (str, "=");
-        if (*iter_key == NULL) {
-                ret = -1;
-                *store_errno = GD_STORE_KEY_NULL;
+        ret = fstat (fd, &st);
+        if (ret < 0) {
+                gf_log ("glusterd", GF_LOG_WARNING,
+                        "stat on file failed");
+                *store_errno = GD_STORE_STAT_FAILED;
                 goto out;
         }
 
-        *iter_val = strtok (NULL, "=");
-        if (*iter_key == NULL) {
-                ret = -1;
-                *store_errno = GD_STORE_VALUE_NULL;
+        ret = -1;
+
+        tmp_index = GF_CALLOC (1, sizeof (*tmp_index),
+                               gf_gld_mt_store_index_t);
+        if (!tmp_index) {
+                *store_errno = GD_STORE_ENOMEM;
                 goto out;
         }
+        tmp_index->ref = 1;
 
-        *store_errno = GD_STORE_SUCCESS;
+        tmp_index->buf = GF_CALLOC (1, st.st_size + 1, gf_gld_mt_char);
+        if (!tmp_index->buf) {
+                *store_errno = GD_STORE_ENOMEM;
+                goto out;
+        }
+
+        while (size < st.st_size) {
+                len = read (fd, tmp_index->buf + size, st.st_size - size);
+                if (len < 0 && errno == EINTR)
+                        continue;
+                if (len <= 0)
+                        break;
+                size += len;
+        }
+        if (len < 0) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to read %s, "
+                        "error: %s", path, strerror (errno));
+                goto out;
+        }
+
+        for (token = strtok_r (tmp_index->buf, " \t\n\r\v\f", &saveptr);
+             token;
+             token = strtok_r (NULL, " \t\n\r\v\f", &saveptr)) {
+                if (tmp_index->count == slots) {
+                        slots = slots ? 2 * slots : 16;
+                        if (tmp_index->kv)
+                                kv = GF_REALLOC (tmp_index->kv,
+                                                 slots * sizeof (*kv));
+                        else
+                                kv = GF_MALLOC (slots * sizeof (*kv),
+                                                gf_gld_mt_store_index_t);
+                        if (!kv) {
+                                *store_errno = GD_STORE_ENOMEM;
+                                goto out;
+                        }
+                        tmp_index->kv = kv;
+                }
+
+                kv = &tmp_index->kv[tmp_index->count++];
+                kv->key = strtok_r (token, "=", &kvptr);
+                kv->value = strtok_r (NULL, "=", &kvptr);
+        }
+
+        *index = tmp_index;
+        tmp_index = NULL;
         ret = 0;
+out:
+        if (fd >= 0)
+                close (fd);
+
+        glusterd_store_index_unref (tmp_index);
+
+        return ret;
+}
+
+/* the handle keeps the parsed file until it is rewritten */
+static int32_t
+glusterd_store_handle_index (glusterd_store_handle_t *shandle,
+                             glusterd_store_index_t **index,
+                             glusterd_store_op_errno_t *store_errno)
+{
+        int32_t         ret = 0;
+
+        GF_ASSERT (shandle);
+
+        *store_errno = GD_STORE_SUCCESS;
+
+        if (!shandle->index) {
+                ret = glusterd_store_index_build (shandle->path,
+                                                  &shandle->index,
+                                                  store_errno);
+                if (ret)
+                        goto out;
+        }
+
+        shandle->index->ref++;
+        *index = shandle->index;
 out:
         return ret;
 }
@@ -987,101 +1149,73 @@ int32_t
 glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
                                char *key, char **value)
 {
-        int32_t         ret = -1;
-        char            *scan_str = NULL;
-        char            *iter_key = NULL;
-        char            *iter_val = NULL;
-        char            *free_str = NULL;
-        struct stat     st        = {0,};
+        int32_t                 ret = -1;
+        int32_t                 i = 0;
+        glusterd_store_index_t  *index = NULL;
         glusterd_store_op_errno_t store_errno = GD_STORE_SUCCESS;
 
         GF_ASSERT (handle);
 
-        handle->fd = open (handle->path, O_RDWR);
-
-        if (!handle->read)
-                handle->read = fdopen (handle->fd, "r");
-
-        if (!handle->read) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %d",
-                        handle->path, errno);
+        ret = glusterd_store_handle_index (handle, &index, &store_errno);
+        if (ret)
                 goto out;
-        }
 
-        ret = fstat (handle->fd, &st);
-        if (ret < 0) {
-                gf_log ("glusterd", GF_LOG_WARNING,
-                        "stat on file failed");
-                ret = -1;
-                store_errno = GD_STORE_STAT_FAILED;
-                goto out;
-        }
+        ret = -1;
+        for (i = 0; i < index->count; i++) {
+                if (!index->kv[i].key || strcmp (key, index->kv[i].key))
+                        continue;
 
-        scan_str = GF_CALLOC (1, st.st_size,
-                              gf_gld_mt_char);
-        if (scan_str == NULL) {
-                ret = -1;
-                store_errno = GD_STORE_ENOMEM;
-                goto out;
+                gf_log ("", GF_LOG_DEBUG, "key %s found", key);
+                ret = 0;
+                if (index->kv[i].value)
+                        *value = gf_strdup (index->kv[i].value);
+                break;
         }
-
-        free_str = scan_str;
-
-        do {
-                ret = glusterd_store_read_and_tokenize (handle->read, scan_str,
-                                                        &iter_key, &iter_val,
-                                                        &store_errno);
-                if (ret < 0) {
-                        goto out;
-                }
-
-                gf_log ("", GF_LOG_DEBUG, "key %s read", iter_key);
-
-                if (!strcmp (key, iter_key)) {
-                        gf_log ("", GF_LOG_DEBUG, "key %s found", key);
-                        ret = 0;
-                        if (iter_val)
-                                *value = gf_strdup (iter_val);
-                        goto out;
-                }
-        } while (1);
 out:
-        if (handle->fd > 0) {
-                close (handle->fd);
-                handle->read = NULL;
-        }
-
-        if (free_str)
-                GF_FREE (free_str);
+        glusterd_store_index_unref (index);
 
         return ret;
 }
 
 int32_t
-glusterd_store_save_value (int fd, char *key, char *value)
+glusterd_store_save_value (glusterd_store_handle_t *shandle, char *key,
+                           char *value)
 {
         int32_t         ret = -1;
+        size_t          len = 0;
+        size_t          size = 0;
+        char            *wbuf = NULL;
 
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
+        GF_ASSERT (shandle->fd > 0);
         GF_ASSERT (key);
         GF_ASSERT (value);
 
-        ret = write (fd, key, strlen (key));
-        if (ret > 0)
-                ret = write (fd, "=", strlen ("="));
-        if (ret > 0)
-                ret = write (fd, value, strlen (value));
-        if (ret > 0)
-                ret = write (fd, "\n", strlen ("\n"));
-
-        if (ret <= 0) {
-                gf_log ("", GF_LOG_CRITICAL, "Unable to store key: %s,"
-                        "value: %s, error: %s", key, value,
-                        strerror (errno));
-                ret = -1;
-                goto out;
+        len = strlen (key) + strlen (value) + 2;
+
+        if (shandle->wlen + len + 1 > shandle->wsize) {
+                size = shandle->wsize ? shandle->wsize : 4096;
+                while (size < shandle->wlen + len + 1)
+                        size *= 2;
+
+                if (shandle->wbuf)
+                        wbuf = GF_REALLOC (shandle->wbuf, size);
+                else
+                        wbuf = GF_MALLOC (size, gf_gld_mt_char);
+                if (!wbuf) {
+                        gf_log ("", GF_LOG_CRITICAL, "Unable to store key: %s,"
+                                "value: %s, error: %s", key, value,
+                                strerror (ENOMEM));
+                        goto out;
+                }
+                shandle->wbuf = wbuf;
+                shandle->wsize = size;
         }
 
+        shandle->wlen += snprintf (shandle->wbuf + shandle->wlen,
+                                   shandle->wsize - shandle->wlen,
+                                   "%s=%s\n", key, value);
+
         ret = 0;
 
 out:
@@ -1163,6 +1297,11 @@ glusterd_store_handle_destroy (glusterd_store_handle_t *handle)
                 goto out;
         }
 
+        glusterd_store_handle_invalidate (handle);
+
+        if (handle->wbuf)
+                GF_FREE (handle->wbuf);
+
         GF_FREE (handle->path);
 
         GF_FREE (handle);
@@ -1181,6 +1320,7 @@ glusterd_store_uuid ()
         glusterd_conf_t *priv = NULL;
         char            path[PATH_MAX] = {0,};
         int32_t         ret = -1;
+        int             fd = -1;
         glusterd_store_handle_t *handle = NULL;
 
         priv = THIS->private;
@@ -1202,12 +1342,13 @@ glusterd_store_uuid ()
                 handle = priv->handle;
         }
 
-        handle->fd = open (handle->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
-        if (handle->fd <= 0) {
+        fd = glusterd_store_mkstemp (handle);
+        if (fd <= 0) {
                 ret = -1;
                 goto out;
         }
-        ret = glusterd_store_save_value (handle->fd, GLUSTERD_STORE_UUID_KEY,
+
+        ret = glusterd_store_save_value (handle, GLUSTERD_STORE_UUID_KEY,
                                          uuid_utoa (priv->uuid));
 
         if (ret) {
@@ -1216,12 +1357,12 @@ glusterd_store_uuid ()
                 goto out;
         }
 
-
+        ret = glusterd_store_rename_tmppath (handle);
 out:
-        if (handle->fd > 0) {
-                close (handle->fd);
-                handle->fd = 0;
-        }
+        if (ret && (fd > 0))
+                glusterd_store_unlink_tmppath (handle);
+        if (fd > 0)
+                close (fd);
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
@@ -1276,7 +1417,7 @@ glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
 {
         int32_t                 ret = -1;
         glusterd_store_iter_t   *tmp_iter = NULL;
-        int                     fd = -1;
+        glusterd_store_op_errno_t store_errno = GD_STORE_SUCCESS;
 
         GF_ASSERT (shandle);
         GF_ASSERT (iter);
@@ -1289,21 +1430,12 @@ glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
                 goto out;
         }
 
-        fd = open (shandle->path, O_RDWR);
-
-        if (fd < 0) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open %s, errno: %d",
-                        shandle->path, errno);
-                goto out;
-        }
-
-        tmp_iter->fd = fd;
-
-        tmp_iter->file = fdopen (tmp_iter->fd, "r");
-
-        if (!tmp_iter->file) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %d",
-                        shandle->path, errno);
+        ret = glusterd_store_handle_index (shandle, &tmp_iter->index,
+                                           &store_errno);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "Unable to read %s, reason: %s",
+                        shandle->path, glusterd_store_strerror (store_errno));
+                GF_FREE (tmp_iter);
                 goto out;
         }
 
@@ -1356,47 +1488,27 @@ glusterd_store_iter_get_next (glusterd_store_iter_t *iter,
                               glusterd_store_op_errno_t *op_errno)
 {
         int32_t         ret = -1;
-        char            *scan_str = NULL;
-        char            *free_str = NULL;
         char            *iter_key = NULL;
         char            *iter_val = NULL;
-        struct stat     st        = {0,};
         glusterd_store_op_errno_t store_errno = GD_STORE_SUCCESS;
 
         GF_ASSERT (iter);
-        GF_ASSERT (iter->file);
+        GF_ASSERT (iter->index);
         GF_ASSERT (key);
         GF_ASSERT (value);
 
-        ret = fstat (iter->fd, &st);
-        if (ret < 0) {
-                gf_log ("glusterd", GF_LOG_WARNING,
-                        "stat on file failed");
-                ret = -1;
-                store_errno = GD_STORE_STAT_FAILED;
-                goto out;
-        }
-
-        scan_str = GF_CALLOC (1, st.st_size,
-                              gf_gld_mt_char);
-        if (scan_str == NULL) {
-                ret = -1;
-                store_errno = GD_STORE_ENOMEM;
-                goto out;
-        }
-
         *key = NULL;
         *value = NULL;
 
-        free_str = scan_str;
-
-        ret = glusterd_store_read_and_tokenize (iter->file, scan_str,
-                                                &iter_key, &iter_val,
-                                                &store_errno);
-        if (ret < 0) {
+        if (iter->next >= iter->index->count) {
+                ret = -1;
+                store_errno = GD_STORE_EOF;
                 goto out;
         }
 
+        iter_key = iter->index->kv[iter->next].key;
+        iter_val = iter->index->kv[iter->next].value;
+        iter->next++;
 
         ret = glusterd_store_validate_key_value (iter->filepath, iter_key,
                                                  iter_val, &store_errno);
@@ -1406,7 +1518,7 @@ glusterd_store_iter_get_next (glusterd_store_iter_t *iter,
         *value = gf_strdup (iter_val);
 
         *key   = gf_strdup (iter_key);
-        if (!iter_key || !iter_val) {
+        if (!*key || !*value) {
                 ret = -1;
                 store_errno = GD_STORE_ENOMEM;
                 goto out;
@@ -1425,8 +1537,6 @@ out:
                         *value = NULL;
                 }
         }
-        if (free_str)
-                GF_FREE (free_str);
         if (op_errno)
                 *op_errno = store_errno;
 
@@ -1462,21 +1572,13 @@ out:
 int32_t
 glusterd_store_iter_destroy (glusterd_store_iter_t *iter)
 {
-        int32_t         ret = -1;
-
         GF_ASSERT (iter);
-        GF_ASSERT (iter->fd > 0);
 
-        ret = fclose (iter->file);
-
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "Unable to close fd: %d, ret: %d, "
-                        "errno: %d" ,iter->fd, ret, errno);
-        }
+        glusterd_store_index_unref (iter->index);
 
         GF_FREE (iter);
 
-        return ret;
+        return 0;
 }
 
 char*
@@ -2078,22 +2180,23 @@ glusterd_store_create_peer_shandle (glusterd_peerinfo_t *peerinfo)
 }
 
 int32_t
-glusterd_store_peer_write (int fd, glusterd_peerinfo_t *peerinfo)
+glusterd_store_peer_write (glusterd_store_handle_t *shandle,
+                           glusterd_peerinfo_t *peerinfo)
 {
         char                    buf[50] = {0};
         int32_t                 ret = 0;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_UUID,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_UUID,
                                          uuid_utoa (peerinfo->uuid));
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", peerinfo->state.state);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_STATE, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_STATE, buf);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_HOSTNAME "1",
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_HOSTNAME "1",
                                          peerinfo->hostname);
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -2114,7 +2217,7 @@ glusterd_store_perform_peer_store (glusterd_peerinfo_t *peerinfo)
                 goto out;
         }
 
-        ret = glusterd_store_peer_write (fd, peerinfo);
+        ret = glusterd_store_peer_write (peerinfo->shandle, peerinfo);
         if (ret)
                 goto out;
 
@@ -89,6 +89,9 @@ typedef enum {
         GD_STORE_STAT_FAILED
 } glusterd_store_op_errno_t;
 
+char*
+glusterd_store_strerror (glusterd_store_op_errno_t op_errno);
+
 int32_t
 glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t ac);
 
@@ -102,7 +105,8 @@ int32_t
 glusterd_store_handle_new (char *path, glusterd_store_handle_t **handle);
 
 int32_t
-glusterd_store_save_value (int fd, char *key, char *value);
+glusterd_store_save_value (glusterd_store_handle_t *shandle, char *key,
+                           char *value);
 
 int32_t
 glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
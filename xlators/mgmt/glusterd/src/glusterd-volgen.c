@@ -108,6 +108,10 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
 
         {"cluster.lookup-unhashed",              "cluster/distribute", NULL, NULL, NO_DOC, 0    },
         {"cluster.min-free-disk",                "cluster/distribute", NULL, NULL, NO_DOC, 0    },
+        {"cluster.hash-type",                    "cluster/distribute", NULL, NULL, NO_DOC, 0    },
+        {"cluster.weighted-layout",              "cluster/distribute", NULL, NULL, NO_DOC, 0    },
+        {"cluster.parallel-readdir",             "cluster/distribute", NULL, NULL, NO_DOC, 0    },
+        {"cluster.linkfile-cache",               "cluster/distribute", NULL, NULL, NO_DOC, 0    },
 
         {"cluster.entry-change-log",             "cluster/replicate",  NULL, NULL, NO_DOC, 0     },
         {"cluster.read-subvolume",               "cluster/replicate",  NULL, NULL, NO_DOC, 0    },
@@ -126,6 +130,7 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {VKEY_DIAG_LAT_MEASUREMENT,              "debug/io-stats",     "latency-measurement", "off", NO_DOC, 0      },
         {"diagnostics.dump-fd-stats",            "debug/io-stats",     NULL, NULL, NO_DOC, 0     },
         {VKEY_DIAG_CNT_FOP_HITS,                 "debug/io-stats",     "count-fop-hits", "off", NO_DOC, 0     },
+        {"diagnostics.fop-trace",                "debug/io-stats",     "fop-trace", "off", NO_DOC, 0     },
         {"diagnostics.brick-log-level",          "debug/io-stats",     "!brick-log-level", NULL, DOC, 0},
         {"diagnostics.client-log-level",         "debug/io-stats",     "!client-log-level", NULL, DOC, 0},
 
@@ -136,6 +141,8 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"performance.cache-size",               "performance/io-cache",   NULL, NULL, NO_DOC, 0 },
         {"performance.cache-size",               "performance/quick-read", NULL, NULL, NO_DOC, 0 },
         {"performance.flush-behind",             "performance/write-behind",      "flush-behind", NULL, DOC, 0},
+        {"performance.nl-cache-timeout",         "performance/nl-cache",      "cache-timeout", NULL, DOC, 0},
+        {"performance.nl-cache-limit",           "performance/nl-cache",      "limit", NULL, DOC, 0},
 
         {"performance.io-thread-count",          "performance/io-threads",    "thread-count", DOC, 0},
 
@@ -146,7 +153,15 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
 
         {"network.frame-timeout",                "protocol/client",    NULL, NULL, NO_DOC, 0     },
         {"network.ping-timeout",                 "protocol/client",    NULL, NULL, NO_DOC, 0     },
+        {"network.reopen-window",                "protocol/client",    NULL, NULL, NO_DOC, 0     },
+        {"network.connection-count",             "protocol/client",    NULL, NULL, NO_DOC, 0     },
         {"network.inode-lru-limit",              "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.fair-queue-depth",              "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.fair-queue-quantum",            "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.client-iops-limit",             "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.client-bandwidth-limit",        "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.volume-iops-limit",             "protocol/server",    NULL, NULL, NO_DOC, 0     },
+        {"server.volume-bandwidth-limit",        "protocol/server",    NULL, NULL, NO_DOC, 0     },
 
         {"auth.allow",                           "protocol/server",           "!auth.addr.*.allow", "*", DOC},
         {"auth.reject",                          "protocol/server",           "!auth.addr.*.reject", NULL, DOC},
@@ -154,6 +169,7 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"transport.keepalive",                   "protocol/server",           "transport.socket.keepalive", NULL, NO_DOC, 0},
         {"server.allow-insecure",                 "protocol/server",          "rpc-auth-allow-insecure", NULL, NO_DOC, 0},
 
+        {"performance.nl-cache",                 "performance/nl-cache",      "!perf", "off", NO_DOC, 0},
         {"performance.write-behind",             "performance/write-behind",  "!perf", "on", NO_DOC, 0},
         {"performance.read-ahead",               "performance/read-ahead",    "!perf", "on", NO_DOC, 0},
         {"performance.io-cache",                 "performance/io-cache",      "!perf", "on", NO_DOC, 0},
@@ -162,6 +178,7 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"performance.client-io-threads",        "performance/io-threads",    "!perf", "off", NO_DOC, 0},
         {VKEY_MARKER_XTIME,                      "features/marker",           "xtime", "off", NO_DOC, OPT_FLAG_FORCE},
         {VKEY_MARKER_XTIME,                      "features/marker",           "!xtime", "off", NO_DOC, OPT_FLAG_FORCE},
+        {GEOREP".indexing-interval",             "features/marker",           "xtime-update-interval", NULL, DOC, 0},
 
         {"nfs.enable-ino32",                     "nfs/server",                "nfs.enable-ino32", NULL, GLOBAL_DOC, 0},
         {"nfs.mem-factor",                       "nfs/server",                "nfs.mem-factor", NULL, GLOBAL_DOC, 0},
@@ -171,6 +188,9 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"nfs.dynamic-volumes",                  "nfs/server",                "nfs.dynamic-volumes", NULL, GLOBAL_NO_DOC, 0},
         {"nfs.register-with-portmap",            "nfs/server",                "rpc.register-with-portmap", NULL, GLOBAL_DOC, 0},
         {"nfs.port",                             "nfs/server",                "nfs.port", NULL, GLOBAL_DOC, 0},
+        {"nfs.udp-listeners",                    "nfs/server",                "rpc.udp-listeners", NULL, GLOBAL_DOC, 0},
+        {"nfs.drc",                              "nfs/server",                "rpc.drc", NULL, GLOBAL_DOC, 0},
+        {"nfs.drc-size",                         "nfs/server",                "rpc.drc-size", NULL, GLOBAL_DOC, 0},
 
         {"nfs.rpc-auth-unix",                    "nfs/server",                "!rpc-auth.auth-unix.*", NULL, DOC, 0},
         {"nfs.rpc-auth-null",                    "nfs/server",                "!rpc-auth.auth-null.*", NULL, DOC},
@@ -188,6 +208,8 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {VKEY_FEATURES_QUOTA,                    "features/marker",           "quota", "off", NO_DOC, OPT_FLAG_FORCE},
         {VKEY_FEATURES_LIMIT_USAGE,              "features/quota",            "limit-set", NULL, NO_DOC, 0},
         {"features.quota-timeout",               "features/quota",            "timeout", "0", DOC, 0},
+        {"features.quota-update-interval",       "features/marker",           "quota-update-interval", NULL, DOC, 0},
+        {"features.quota-update-slack",          "features/marker",           "quota-update-slack", NULL, DOC, 0},
         {NULL,                                                                }
 };
 
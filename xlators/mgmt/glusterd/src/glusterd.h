@@ -81,9 +81,9 @@ typedef enum glusterd_op_ {
 
 
 struct glusterd_store_iter_ {
-        int     fd;
-        FILE    *file;
-        char    filepath[PATH_MAX];
+        glusterd_store_index_t  *index;
+        int32_t                 next;
+        char                    filepath[PATH_MAX];
 };
 
 typedef struct glusterd_store_iter_     glusterd_store_iter_t;
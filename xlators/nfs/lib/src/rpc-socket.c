@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -143,7 +144,8 @@ err:
 }
 
 int
-nfs_rpcsvc_udp_socket_listen (int addrfam, char *listenhost, uint16_t listenport)
+nfs_rpcsvc_udp_socket_listen (int addrfam, char *listenhost, uint16_t listenport,
+                              int reuseport)
 {
         int                     sock = -1;
         struct sockaddr_storage sockaddr;
@@ -188,6 +190,23 @@ nfs_rpcsvc_udp_socket_listen (int addrfam, char *listenhost, uint16_t listenport
                 goto close_err;
         }
 
+#ifdef SO_REUSEPORT
+        /* Lets several sockets, each served by its own thread, share the
+         * port, with the kernel spreading the datagrams over them. Only
+         * asked for when there is more than one listener, so that a lone
+         * socket does not open the port up to other processes.
+         */
+        if (reuseport) {
+                ret = setsockopt (sock, SOL_SOCKET, SO_REUSEPORT, &opt,
+                                  sizeof (opt));
+                if (ret == -1) {
+                        gf_log (GF_RPCSVC_SOCK, GF_LOG_WARNING, "setsockopt()"
+                                " for SO_REUSEPORT failed (%s)",
+                                strerror (errno));
+                }
+        }
+#endif
+
         ret = bind (sock, (struct sockaddr *)&sockaddr, sockaddr_len);
         if (ret == -1) {
                 if (errno != EADDRINUSE) {
@@ -283,30 +302,58 @@ nfs_rpcsvc_socket_read (int sockfd, char *readaddr, size_t readsize)
         return dataread;
 }
 
-ssize_t
-nfs_rpcsvc_udp_socket_read (rpcsvc_conn_t *conn,
-                            int sockfd, char *readaddr, size_t readsize)
+/* Takes up to count datagrams off the socket, into the buffers and address
+ * storage given in msgs. The length of each datagram is returned in lens.
+ * Returns the number of datagrams received, 0 if there were none waiting.
+ */
+int
+nfs_rpcsvc_udp_socket_recvv (int sockfd, struct msghdr *msgs, ssize_t *lens,
+                             int count)
 {
-        ssize_t         dataread = 0;
-        ssize_t         readlen = -1;
+        int                     received = 0;
+#ifdef HAVE_RECVMMSG
+        struct mmsghdr          mmsgs[count];
+        int                     i = 0;
+#else
+        ssize_t                 readlen = -1;
+#endif
 
-        if (!readaddr)
+        if ((!msgs) || (!lens) || (count <= 0))
                 return -1;
 
-        conn->sockaddrlen = sizeof (conn->addr);
-        readlen = recvfrom (sockfd, readaddr, readsize,
-                            0, &conn->addr, &conn->sockaddrlen);
-        if (readlen == -1) {
-                if (errno != EAGAIN) {
-                        dataread = -1;
-                }
+#ifdef HAVE_RECVMMSG
+        for (i = 0; i < count; i++) {
+                mmsgs[i].msg_hdr = msgs[i];
+                mmsgs[i].msg_len = 0;
+        }
+
+        received = recvmmsg (sockfd, mmsgs, count, MSG_DONTWAIT, NULL);
+        if (received == -1) {
+                if (errno == EAGAIN)
+                        received = 0;
                 goto out;
         }
-        conn->is_udp = 1;
 
-        dataread += readlen;
+        for (i = 0; i < received; i++) {
+                msgs[i].msg_namelen = mmsgs[i].msg_hdr.msg_namelen;
+                msgs[i].msg_flags = mmsgs[i].msg_hdr.msg_flags;
+                lens[i] = mmsgs[i].msg_len;
+        }
 out:
-        return dataread;
+#else
+        while (received < count) {
+                readlen = recvmsg (sockfd, &msgs[received], MSG_DONTWAIT);
+                if (readlen == -1) {
+                        if ((errno != EAGAIN) && (received == 0))
+                                received = -1;
+                        break;
+                }
+
+                lens[received] = readlen;
+                received++;
+        }
+#endif
+        return received;
 }
 
 ssize_t
@@ -341,37 +388,71 @@ nfs_rpcsvc_socket_write (int sockfd, char *buffer, size_t size, int *eagain)
         return written;
 }
 
+/* Sends as much of the vector as the socket takes in one go. A short write
+ * is not retried here, the caller decides what to do with the rest.
+ */
 ssize_t
-nfs_rpcsvc_udp_write (rpcsvc_conn_t *conn,
-                         int sockfd, char *buffer, size_t size)
+nfs_rpcsvc_socket_writev (int sockfd, struct iovec *vector, int count,
+                          int *eagain)
 {
-        size_t          writelen = -1;
-        ssize_t         written = 0;
-        int             myerrno = 0;
+        ssize_t         written = -1;
 
-        if (!buffer)
+        if (!vector)
                 return -1;
 
-        while (size > 0) {
-                writelen = sendto (sockfd, buffer, size, 0,
-                                   &conn->addr, conn->sockaddrlen);
-                if (writelen == -1) {
-                        myerrno = errno;
-                        if (errno != EAGAIN) {
-                                written = -1;
-                                gf_log ("", GF_LOG_ERROR, "Udp write failed, errno: %d",
-                                        errno);
-                                break;
-                        }
-                } else if (writelen == 0)
+        written = writev (sockfd, vector, count);
+        if (written == -1) {
+                if (errno == EAGAIN)
+                        *eagain = 1;
+        }
+
+        return written;
+}
+
+/* Sends each of the count messages as a datagram of its own. Returns how
+ * many were sent, which can be fewer than asked for, or -1 if not even the
+ * first one could be sent.
+ */
+int
+nfs_rpcsvc_udp_socket_sendv (int sockfd, struct msghdr *msgs, int count,
+                             int *eagain)
+{
+        int                     sent = 0;
+#ifdef HAVE_SENDMMSG
+        struct mmsghdr          mmsgs[count];
+        int                     i = 0;
+#endif
+
+        if ((!msgs) || (count <= 0))
+                return -1;
+
+#ifdef HAVE_SENDMMSG
+        for (i = 0; i < count; i++) {
+                mmsgs[i].msg_hdr = msgs[i];
+                mmsgs[i].msg_len = 0;
+        }
+
+        sent = sendmmsg (sockfd, mmsgs, count, 0);
+#else
+        while (sent < count) {
+                if (sendmsg (sockfd, &msgs[sent], 0) == -1) {
+                        if (sent == 0)
+                                sent = -1;
                         break;
+                }
 
-                written += writelen;
-                size -= writelen;
-                buffer += writelen;
+                sent++;
+        }
+#endif
+        if (sent == -1) {
+                if (errno == EAGAIN)
+                        *eagain = 1;
+                else
+                        gf_log ("", GF_LOG_ERROR, "Udp write failed, errno: %d",
+                                errno);
         }
 
-        return written;
+        return sent;
 }
 
 int
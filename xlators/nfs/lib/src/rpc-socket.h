@@ -51,6 +51,10 @@ nfs_rpcsvc_socket_read (int sockfd, char *readaddr, size_t readsize);
 extern ssize_t
 nfs_rpcsvc_socket_write (int sockfd, char *buffer, size_t size, int *eagain);
 
+extern ssize_t
+nfs_rpcsvc_socket_writev (int sockfd, struct iovec *vector, int count,
+                          int *eagain);
+
 extern int
 nfs_rpcsvc_socket_peername (int sockfd, char *hostname, int hostlen);
 
@@ -64,13 +68,14 @@ extern int
 nfs_rpcsvc_socket_unblock_tx (int sockfd);
 
 extern int
-nfs_rpcsvc_udp_socket_listen (int addrfam, char *listenhost, uint16_t listenport);
+nfs_rpcsvc_udp_socket_listen (int addrfam, char *listenhost, uint16_t listenport,
+                              int reuseport);
 
-extern ssize_t
-nfs_rpcsvc_udp_socket_read (rpcsvc_conn_t *conn,
-                            int sockfd, char *readaddr, size_t readsize);
+extern int
+nfs_rpcsvc_udp_socket_recvv (int sockfd, struct msghdr *msgs, ssize_t *lens,
+                             int count);
 
-ssize_t
-nfs_rpcsvc_udp_write (rpcsvc_conn_t *conn,
-                      int sockfd, char *buffer, size_t size);
+extern int
+nfs_rpcsvc_udp_socket_sendv (int sockfd, struct msghdr *msgs, int count,
+                             int *eagain);
 #endif
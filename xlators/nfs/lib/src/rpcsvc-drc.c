@@ -0,0 +1,358 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "rpcsvc.h"
+#include "logging.h"
+#include "dict.h"
+#include "hashfn.h"
+#include "common-utils.h"
+
+#include <string.h>
+
+
+int
+nfs_rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
+{
+        rpcsvc_drc_t    *drc = NULL;
+        char            *optstr = NULL;
+        gf_boolean_t    enabled = _gf_true;
+        int             size = RPCSVC_DRC_DEFAULT_SIZE;
+        int             ret = -1;
+        int             i = 0;
+
+        if ((!svc) || (!options))
+                return -1;
+
+        if (dict_get (options, "rpc.drc")) {
+                ret = dict_get_str (options, "rpc.drc", &optstr);
+                if (ret < 0) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to parse "
+                                "dict");
+                        goto out;
+                }
+
+                ret = gf_string2boolean (optstr, &enabled);
+                if (ret < 0) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to parse "
+                                "bool string");
+                        goto out;
+                }
+        }
+
+        if (!enabled) {
+                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Duplicate request cache "
+                        "disabled");
+                ret = 0;
+                goto out;
+        }
+
+        if (dict_get (options, "rpc.drc-size")) {
+                ret = dict_get_str (options, "rpc.drc-size", &optstr);
+                if (ret < 0) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to parse "
+                                "dict");
+                        goto out;
+                }
+
+                ret = gf_string2int (optstr, &size);
+                if ((ret < 0) || (size < 1)) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Invalid duplicate "
+                                "request cache size: %s", optstr);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        drc = GF_CALLOC (1, sizeof (*drc), gf_common_mt_rpcsvc_drc_t);
+        if (!drc) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                ret = -1;
+                goto out;
+        }
+
+        pthread_mutex_init (&drc->drclock, NULL);
+        for (i = 0; i < RPCSVC_DRC_BUCKETS; i++)
+                INIT_LIST_HEAD (&drc->buckets[i]);
+        INIT_LIST_HEAD (&drc->lru);
+        drc->size = size;
+
+        svc->drc = drc;
+        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Duplicate request cache size: %d",
+                size);
+        ret = 0;
+out:
+        return ret;
+}
+
+
+static uint32_t
+nfs_rpcsvc_drc_csum (rpcsvc_request_t *req)
+{
+        if (!req->msg.iov_base)
+                return 0;
+
+        return gf_xxh32_hashfn (req->msg.iov_base,
+                                min (req->msg.iov_len, RPCSVC_DRC_CSUMLEN));
+}
+
+
+static int
+nfs_rpcsvc_drc_match (rpcsvc_drc_entry_t *entry, rpcsvc_request_t *req)
+{
+        if ((entry->xid != req->xid) || (entry->csum != req->drccsum))
+                return 0;
+
+        if ((entry->prognum != req->prognum)
+            || (entry->progver != req->progver)
+            || (entry->procnum != req->procnum))
+                return 0;
+
+        if ((entry->is_udp != req->conn->is_udp)
+            || (entry->addrlen != req->peeraddrlen))
+                return 0;
+
+        return (memcmp (&entry->addr, &req->peeraddr, entry->addrlen) == 0);
+}
+
+
+static rpcsvc_drc_entry_t *
+__nfs_rpcsvc_drc_find (rpcsvc_drc_t *drc, rpcsvc_request_t *req)
+{
+        rpcsvc_drc_entry_t      *entry = NULL;
+        int                     bucket = 0;
+
+        bucket = (req->xid ^ req->drccsum) % RPCSVC_DRC_BUCKETS;
+        list_for_each_entry (entry, &drc->buckets[bucket], hashlist) {
+                if (nfs_rpcsvc_drc_match (entry, req))
+                        return entry;
+        }
+
+        return NULL;
+}
+
+
+static void
+__nfs_rpcsvc_drc_remove (rpcsvc_drc_t *drc, rpcsvc_drc_entry_t *entry)
+{
+        list_del (&entry->hashlist);
+        list_del (&entry->lrulist);
+        --drc->count;
+
+        if (entry->reply)
+                GF_FREE (entry->reply);
+        GF_FREE (entry);
+}
+
+
+/* Makes room for a new entry by evicting the least recently used answered
+ * one. Entries of calls in progress cannot be evicted, since their
+ * retransmissions would then be executed again.
+ */
+static int
+__nfs_rpcsvc_drc_evict (rpcsvc_drc_t *drc)
+{
+        rpcsvc_drc_entry_t      *entry = NULL;
+
+        if (drc->count < drc->size)
+                return 0;
+
+        list_for_each_entry (entry, &drc->lru, lrulist) {
+                if (entry->state != RPCSVC_DRC_DONE)
+                        continue;
+
+                __nfs_rpcsvc_drc_remove (drc, entry);
+                drc->evictions++;
+                return 0;
+        }
+
+        return -1;
+}
+
+
+/* Looks the request up in the cache. Returns RPCSVC_DRC_NEW if the request
+ * is to be executed, RPCSVC_DRC_DROP if it is a retransmission of a call
+ * still being executed, or RPCSVC_DRC_REPLAY if it is a retransmission of a
+ * call already answered. In the last case, reply and replyiob are filled in
+ * with a copy of the reply, which the caller must send.
+ */
+int
+nfs_rpcsvc_drc_lookup (rpcsvc_request_t *req, struct iovec *reply,
+                       struct iobuf **replyiob)
+{
+        rpcsvc_drc_t            *drc = NULL;
+        rpcsvc_drc_entry_t      *entry = NULL;
+        struct iobuf            *iob = NULL;
+        rpcsvc_t                *svc = NULL;
+        int                     bucket = 0;
+        int                     ret = RPCSVC_DRC_NEW;
+
+        if ((!req) || (!reply) || (!replyiob))
+                return RPCSVC_DRC_NEW;
+
+        svc = nfs_rpcsvc_request_service (req);
+        drc = svc->drc;
+        if (!drc)
+                return RPCSVC_DRC_NEW;
+
+        req->drccsum = nfs_rpcsvc_drc_csum (req);
+
+        pthread_mutex_lock (&drc->drclock);
+        {
+                entry = __nfs_rpcsvc_drc_find (drc, req);
+                if (entry) {
+                        if (entry->state == RPCSVC_DRC_INPROGRESS) {
+                                drc->drops++;
+                                ret = RPCSVC_DRC_DROP;
+                                goto unlock;
+                        }
+
+                        iob = iobuf_get (svc->ctx->iobuf_pool);
+                        if (!iob) {
+                                ret = RPCSVC_DRC_DROP;
+                                goto unlock;
+                        }
+
+                        memcpy (iobuf_ptr (iob), entry->reply,
+                                entry->replylen);
+                        reply->iov_base = iobuf_ptr (iob);
+                        reply->iov_len = entry->replylen;
+                        *replyiob = iob;
+
+                        list_move_tail (&entry->lrulist, &drc->lru);
+                        drc->hits++;
+                        ret = RPCSVC_DRC_REPLAY;
+                        goto unlock;
+                }
+
+                if (__nfs_rpcsvc_drc_evict (drc) == -1)
+                        goto unlock;
+
+                entry = GF_CALLOC (1, sizeof (*entry),
+                                   gf_common_mt_rpcsvc_drc_entry_t);
+                if (!entry)
+                        goto unlock;
+
+                memcpy (&entry->addr, &req->peeraddr, req->peeraddrlen);
+                entry->addrlen = req->peeraddrlen;
+                entry->is_udp = req->conn->is_udp;
+                entry->xid = req->xid;
+                entry->prognum = req->prognum;
+                entry->progver = req->progver;
+                entry->procnum = req->procnum;
+                entry->csum = req->drccsum;
+                entry->state = RPCSVC_DRC_INPROGRESS;
+
+                bucket = (req->xid ^ req->drccsum) % RPCSVC_DRC_BUCKETS;
+                list_add (&entry->hashlist, &drc->buckets[bucket]);
+                list_add_tail (&entry->lrulist, &drc->lru);
+                ++drc->count;
+                req->drcpending = _gf_true;
+        }
+unlock:
+        pthread_mutex_unlock (&drc->drclock);
+
+        return ret;
+}
+
+
+/* Completes the request's entry with a copy of its reply record. A reply
+ * which could not be replayed from a single iobuf is not kept.
+ */
+void
+nfs_rpcsvc_drc_reply (rpcsvc_request_t *req, struct iovec *vector, int count)
+{
+        rpcsvc_drc_t            *drc = NULL;
+        rpcsvc_drc_entry_t      *entry = NULL;
+        rpcsvc_t                *svc = NULL;
+        struct iobuf_pool       *iobpool = NULL;
+        char                    *reply = NULL;
+        size_t                  replylen = 0;
+        size_t                  offset = 0;
+        int                     i = 0;
+
+        if ((!req) || (!req->drcpending))
+                return;
+
+        req->drcpending = _gf_false;
+        svc = nfs_rpcsvc_request_service (req);
+        drc = svc->drc;
+        iobpool = svc->ctx->iobuf_pool;
+
+        for (i = 0; i < count; i++)
+                replylen += vector[i].iov_len;
+
+        if (replylen <= iobpool_pagesize (iobpool))
+                reply = GF_MALLOC (replylen, gf_common_mt_char);
+
+        if (reply) {
+                for (i = 0; i < count; i++) {
+                        memcpy (reply + offset, vector[i].iov_base,
+                                vector[i].iov_len);
+                        offset += vector[i].iov_len;
+                }
+        }
+
+        pthread_mutex_lock (&drc->drclock);
+        {
+                entry = __nfs_rpcsvc_drc_find (drc, req);
+                if (!entry)
+                        goto unlock;
+
+                if (!reply) {
+                        __nfs_rpcsvc_drc_remove (drc, entry);
+                        goto unlock;
+                }
+
+                entry->reply = reply;
+                entry->replylen = replylen;
+                entry->state = RPCSVC_DRC_DONE;
+                reply = NULL;
+                list_move_tail (&entry->lrulist, &drc->lru);
+        }
+unlock:
+        pthread_mutex_unlock (&drc->drclock);
+
+        if (reply)
+                GF_FREE (reply);
+}
+
+
+/* Drops the request's entry when no reply will be sent for it, so that a
+ * retransmission gets executed.
+ */
+void
+nfs_rpcsvc_drc_forget (rpcsvc_request_t *req)
+{
+        rpcsvc_drc_t            *drc = NULL;
+        rpcsvc_drc_entry_t      *entry = NULL;
+
+        if ((!req) || (!req->drcpending))
+                return;
+
+        req->drcpending = _gf_false;
+        drc = nfs_rpcsvc_request_service (req)->drc;
+
+        pthread_mutex_lock (&drc->drclock);
+        {
+                entry = __nfs_rpcsvc_drc_find (drc, req);
+                if (entry && (entry->state == RPCSVC_DRC_INPROGRESS))
+                        __nfs_rpcsvc_drc_remove (drc, entry);
+        }
+        pthread_mutex_unlock (&drc->drclock);
+}
@@ -52,6 +52,15 @@
                 memset (request, 0, sizeof (rpcsvc_request_t));         \
         } while (0)                                                     \
 
+/* A request that still has a DRC entry in progress will never get a reply
+ * cached for it, so drop the entry to let a retransmission be executed.
+ */
+#define nfs_rpcsvc_destroy_request(con, request)                        \
+        do {                                                            \
+                nfs_rpcsvc_drc_forget (request);                        \
+                mem_put ((con)->rxpool, request);                       \
+        } while (0)                                                     \
+
 /* The generic event handler for every stage */
 void *
 nfs_rpcsvc_stage_proc (void *arg)
@@ -103,6 +112,7 @@ nfs_rpcsvc_stage_init (rpcsvc_t *svc)
         }
 
         stg->svc = svc;
+        INIT_LIST_HEAD (&stg->stglist);
         ret = 0;
 free_stg:
         if (ret == -1) {
@@ -147,6 +157,31 @@ nfs_rpcsvc_init_options (rpcsvc_t *svc, dict_t *options)
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Portmap registration "
                         "disabled");
 
+        svc->udp_listeners = RPCSVC_DEFAULT_UDP_LISTENERS;
+        if (dict_get (options, "rpc.udp-listeners")) {
+                ret = dict_get_str (options, "rpc.udp-listeners", &optstr);
+                if (ret < 0) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to parse "
+                                "dict");
+                        goto out;
+                }
+
+                ret = gf_string2int (optstr, &svc->udp_listeners);
+                if ((ret < 0) || (svc->udp_listeners < 1)) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Invalid number of "
+                                "UDP listeners: %s", optstr);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+#ifndef SO_REUSEPORT
+        /* Without it, only the first socket would get the port. */
+        svc->udp_listeners = 1;
+#endif
+        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "UDP listeners: %d",
+                svc->udp_listeners);
+
         ret = 0;
 out:
         return ret;
@@ -189,6 +224,20 @@ nfs_rpcsvc_init (glusterfs_ctx_t *ctx, dict_t *options)
                 goto free_svc;
         }
 
+        ret = nfs_rpcsvc_drc_init (svc, options);
+        if (ret == -1) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to init duplicate "
+                        "request cache");
+                goto free_svc;
+        }
+
+        ret = nfs_rpcsvc_addr_auth_init (svc, options);
+        if (ret == -1) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to init address "
+                        "authentication");
+                goto free_svc;
+        }
+
         ret = -1;
         poolsize = RPCSVC_POOLCOUNT_MULT * RPCSVC_DEFAULT_MEMFACTOR;
         svc->connpool = mem_pool_new (rpcsvc_conn_t, poolsize);
@@ -236,123 +285,510 @@ nfs_rpcsvc_select_stage (rpcsvc_t *rpcservice)
 }
 
 
-int
-nfs_rpcsvc_conn_peer_check_search (dict_t *options, char *pattern, char *clstr)
+/* The stage serving the idx'th UDP listener of every program. The first one
+ * is the default stage, the others are started the first time they are
+ * asked for and shared by the listeners of all programs after that.
+ */
+rpcsvc_stage_t *
+nfs_rpcsvc_select_udp_stage (rpcsvc_t *svc, int idx)
 {
-        int                     ret = -1;
-        char                    *addrtok = NULL;
-        char                    *addrstr = NULL;
-        char                    *svptr = NULL;
+        rpcsvc_stage_t          *stg = NULL;
+        int                     cnt = 0;
+
+        if (!svc)
+                return NULL;
+
+        if (idx == 0)
+                return svc->defaultstage;
+
+        pthread_mutex_lock (&svc->rpclock);
+        {
+                list_for_each_entry (stg, &svc->stages, stglist) {
+                        if (++cnt == idx)
+                                goto unlock;
+                }
+
+                stg = nfs_rpcsvc_stage_init (svc);
+                if (!stg)
+                        goto unlock;
 
-        if ((!options) || (!clstr))
+                list_add_tail (&stg->stglist, &svc->stages);
+        }
+unlock:
+        pthread_mutex_unlock (&svc->rpclock);
+
+        return stg;
+}
+
+
+static int
+nfs_rpcsvc_addr_prefix_match (unsigned char *addr, unsigned char *net,
+                              int prefixlen)
+{
+        int     bytes = prefixlen / 8;
+        int     bits = prefixlen % 8;
+
+        if (memcmp (addr, net, bytes) != 0)
                 return -1;
 
-        if (!dict_get (options, pattern))
+        if ((bits) && ((addr[bytes] ^ net[bytes]) & (0xff << (8 - bits))))
                 return -1;
 
-        ret = dict_get_str (options, pattern, &addrstr);
-        if (ret < 0) {
-                ret = -1;
-                goto err;
-        }
+        return 0;
+}
 
-        if (!addrstr) {
-                ret = -1;
-                goto err;
-        }
 
-        addrtok = strtok_r (addrstr, ",", &svptr);
-        while (addrtok) {
+static int
+nfs_rpcsvc_addr_rule_match (rpcsvc_addr_rule_t *rule, struct sockaddr *sa,
+                            char *clstr)
+{
+        int     ret = -1;
+
+        if (rule->pattern) {
+                if (!clstr)
+                        return -1;
 
                 /* CASEFOLD not present on Solaris */
 #ifdef FNM_CASEFOLD
-                ret = fnmatch (addrtok, clstr, FNM_CASEFOLD);
+                ret = fnmatch (rule->pattern, clstr, FNM_CASEFOLD);
 #else
-                ret = fnmatch (addrtok, clstr, 0);
+                ret = fnmatch (rule->pattern, clstr, 0);
 #endif
-                if (ret == 0)
-                        goto err;
-
-                addrtok = strtok_r (NULL, ",", &svptr);
+                return (ret == 0) ? 0 : -1;
         }
 
-        ret = -1;
-err:
+        if ((!sa) || (sa->sa_family != rule->family))
+                return -1;
+
+        if (rule->family == AF_INET)
+                ret = nfs_rpcsvc_addr_prefix_match ((unsigned char *)
+                                        &((struct sockaddr_in *)sa)->sin_addr,
+                                        (unsigned char *)&rule->net.in,
+                                        rule->prefixlen);
+        else
+                ret = nfs_rpcsvc_addr_prefix_match ((unsigned char *)
+                                        &((struct sockaddr_in6 *)sa)->sin6_addr,
+                                        (unsigned char *)&rule->net.in6,
+                                        rule->prefixlen);
 
         return ret;
 }
 
 
+/* Returns 0 if the peer matches an entry of the list, -1 otherwise. */
 int
-nfs_rpcsvc_conn_peer_check_allow (dict_t *options, char *volname, char *clstr)
+nfs_rpcsvc_conn_peer_check_search (struct list_head *rules,
+                                   struct sockaddr *sa, char *clstr)
 {
-        int     ret = RPCSVC_AUTH_DONTCARE;
-        char    *srchstr = NULL;
-        char    globalrule[] = "rpc-auth.addr.allow";
+        rpcsvc_addr_rule_t      *rule = NULL;
 
-        if ((!options) || (!clstr))
-                return ret;
+        list_for_each_entry (rule, rules, list) {
+                if (nfs_rpcsvc_addr_rule_match (rule, sa, clstr) == 0)
+                        return 0;
+        }
 
-        /* If volname is NULL, then we're searching for the general rule to
-         * determine the current address in clstr is allowed or not for all
-         * subvolumes.
-         */
-        if (volname) {
-                ret = gf_asprintf (&srchstr, "rpc-auth.addr.%s.allow", volname);
-                if (ret == -1) {
-                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "asprintf failed");
-                        ret = RPCSVC_AUTH_DONTCARE;
-                        goto out;
-                }
-        } else
-                srchstr = globalrule;
+        return -1;
+}
 
-        ret = nfs_rpcsvc_conn_peer_check_search (options, srchstr, clstr);
-        if (volname)
-                GF_FREE (srchstr);
 
-        if (ret == 0)
+int
+nfs_rpcsvc_conn_peer_check_allow (rpcsvc_addr_rules_t *rules,
+                                  struct sockaddr *sa, char *clstr)
+{
+        int     ret = RPCSVC_AUTH_DONTCARE;
+
+        if (!rules)
+                return ret;
+
+        if (nfs_rpcsvc_conn_peer_check_search (&rules->allow, sa, clstr) == 0)
                 ret = RPCSVC_AUTH_ACCEPT;
-        else
-                ret = RPCSVC_AUTH_DONTCARE;
-out:
+
         return ret;
 }
 
+
 int
-nfs_rpcsvc_conn_peer_check_reject (dict_t *options, char *volname, char *clstr)
+nfs_rpcsvc_conn_peer_check_reject (rpcsvc_addr_rules_t *rules,
+                                   struct sockaddr *sa, char *clstr)
 {
         int     ret = RPCSVC_AUTH_DONTCARE;
-        char    *srchstr = NULL;
-        char    generalrule[] = "rpc-auth.addr.reject";
 
-        if ((!options) || (!clstr))
+        if (!rules)
                 return ret;
 
-        if (volname) {
-                ret = gf_asprintf (&srchstr, "rpc-auth.addr.%s.reject",
-                                   volname);
-                if (ret == -1) {
-                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "asprintf failed");
-                        ret = RPCSVC_AUTH_REJECT;
-                        goto out;
-                }
+        if (nfs_rpcsvc_conn_peer_check_search (&rules->reject, sa, clstr) == 0)
+                ret = RPCSVC_AUTH_REJECT;
+
+        return ret;
+}
+
+
+static void
+nfs_rpcsvc_addr_rules_destroy (rpcsvc_addr_rules_t *rules)
+{
+        rpcsvc_addr_rule_t      *rule = NULL;
+        rpcsvc_addr_rule_t      *tmp = NULL;
+
+        list_for_each_entry_safe (rule, tmp, &rules->allow, list) {
+                list_del (&rule->list);
+                if (rule->pattern)
+                        GF_FREE (rule->pattern);
+                GF_FREE (rule);
+        }
+
+        list_for_each_entry_safe (rule, tmp, &rules->reject, list) {
+                list_del (&rule->list);
+                if (rule->pattern)
+                        GF_FREE (rule->pattern);
+                GF_FREE (rule);
+        }
+
+        if (rules->allowstr)
+                GF_FREE (rules->allowstr);
+        if (rules->volname)
+                GF_FREE (rules->volname);
+}
+
+
+static void
+nfs_rpcsvc_addr_auth_free (rpcsvc_addr_auth_t *auth)
+{
+        rpcsvc_addr_rules_t     *rules = NULL;
+        rpcsvc_addr_rules_t     *tmp = NULL;
+
+        if (!auth)
+                return;
+
+        list_for_each_entry_safe (rules, tmp, &auth->exports, list) {
+                list_del (&rules->list);
+                nfs_rpcsvc_addr_rules_destroy (rules);
+                GF_FREE (rules);
+        }
+
+        nfs_rpcsvc_addr_rules_destroy (&auth->general);
+        GF_FREE (auth);
+}
+
+
+/* Compiles an entry of an allow or reject list. An address, optionally
+ * followed by a prefix length, becomes a network to compare the peer address
+ * against. Everything else is kept as a pattern.
+ */
+static rpcsvc_addr_rule_t *
+nfs_rpcsvc_addr_rule_compile (char *entry)
+{
+        rpcsvc_addr_rule_t      *rule = NULL;
+        unsigned char           *net = NULL;
+        char                    addrstr[INET6_ADDRSTRLEN];
+        char                    *prefix = NULL;
+        char                    *end = NULL;
+        size_t                  addrlen = 0;
+        long                    prefixlen = 0;
+        int                     maxlen = 0;
+        int                     i = 0;
+
+        rule = GF_CALLOC (1, sizeof (*rule), gf_common_mt_rpcsvc_addr_rule_t);
+        if (!rule) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                return NULL;
+        }
+
+        INIT_LIST_HEAD (&rule->list);
+        prefix = strchr (entry, '/');
+        addrlen = (prefix) ? (prefix - entry) : strlen (entry);
+        if (addrlen >= sizeof (addrstr))
+                goto pattern;
+
+        memcpy (addrstr, entry, addrlen);
+        addrstr[addrlen] = '\0';
+        if (inet_pton (AF_INET, addrstr, &rule->net.in) == 1) {
+                rule->family = AF_INET;
+                maxlen = 32;
+        } else if (inet_pton (AF_INET6, addrstr, &rule->net.in6) == 1) {
+                rule->family = AF_INET6;
+                maxlen = 128;
         } else
-                srchstr = generalrule;
+                goto pattern;
+
+        prefixlen = maxlen;
+        if (prefix) {
+                prefixlen = strtol (prefix + 1, &end, 10);
+                if ((prefix[1] == '\0') || (*end != '\0') || (prefixlen < 0)
+                    || (prefixlen > maxlen)) {
+                        gf_log (GF_RPCSVC, GF_LOG_WARNING, "Invalid prefix "
+                                "length in %s, matching it as a pattern",
+                                entry);
+                        goto pattern;
+                }
+        }
 
-        ret = nfs_rpcsvc_conn_peer_check_search (options, srchstr, clstr);
-        if (volname)
-                GF_FREE (srchstr);
+        /* Clear the host part, so that matching only compares prefixes. */
+        net = (unsigned char *)&rule->net;
+        for (i = prefixlen; i < maxlen; i++)
+                net[i / 8] &= ~(0x80 >> (i % 8));
+
+        rule->prefixlen = prefixlen;
+        return rule;
+
+pattern:
+        rule->family = AF_UNSPEC;
+        rule->pattern = gf_strdup (entry);
+        if (!rule->pattern) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                GF_FREE (rule);
+                rule = NULL;
+        }
+
+        return rule;
+}
+
+
+static int
+nfs_rpcsvc_addr_rules_compile (struct list_head *head, char *addrstr)
+{
+        rpcsvc_addr_rule_t      *rule = NULL;
+        char                    *addrcopy = NULL;
+        char                    *addrtok = NULL;
+        char                    *svptr = NULL;
+        int                     ret = -1;
+
+        addrcopy = gf_strdup (addrstr);
+        if (!addrcopy) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                goto err;
+        }
+
+        addrtok = strtok_r (addrcopy, ",", &svptr);
+        while (addrtok) {
+                rule = nfs_rpcsvc_addr_rule_compile (addrtok);
+                if (!rule)
+                        goto err;
+
+                list_add_tail (&rule->list, head);
+                addrtok = strtok_r (NULL, ",", &svptr);
+        }
+
+        ret = 0;
+err:
+        if (addrcopy)
+                GF_FREE (addrcopy);
 
-        if (ret == 0)
-                ret = RPCSVC_AUTH_REJECT;
-        else
-                ret = RPCSVC_AUTH_DONTCARE;
-out:
         return ret;
 }
 
 
+static void
+nfs_rpcsvc_addr_rules_init (rpcsvc_addr_rules_t *rules)
+{
+        INIT_LIST_HEAD (&rules->list);
+        INIT_LIST_HEAD (&rules->allow);
+        INIT_LIST_HEAD (&rules->reject);
+}
+
+
+static int
+nfs_rpcsvc_addr_rules_add (rpcsvc_addr_rules_t *rules, gf_boolean_t allow,
+                           char *addrstr)
+{
+        if (!allow)
+                return nfs_rpcsvc_addr_rules_compile (&rules->reject, addrstr);
+
+        rules->allowstr = gf_strdup (addrstr);
+        if (!rules->allowstr) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                return -1;
+        }
+
+        return nfs_rpcsvc_addr_rules_compile (&rules->allow, addrstr);
+}
+
+
+static rpcsvc_addr_rules_t *
+nfs_rpcsvc_addr_export_find (rpcsvc_addr_auth_t *auth, char *volname)
+{
+        rpcsvc_addr_rules_t     *rules = NULL;
+
+        list_for_each_entry (rules, &auth->exports, list) {
+                if (strcmp (rules->volname, volname) == 0)
+                        return rules;
+        }
+
+        return NULL;
+}
+
+
+struct rpcsvc_addr_compile_state {
+        rpcsvc_addr_auth_t      *auth;
+        int                     ret;
+};
+
+/* dict_foreach callback picking the rpc-auth.addr.<volname>.allow and
+ * rpc-auth.addr.<volname>.reject options.
+ */
+static void
+nfs_rpcsvc_addr_auth_compile_volume (dict_t *options, char *key,
+                                     data_t *value, void *data)
+{
+        struct rpcsvc_addr_compile_state        *state = NULL;
+        rpcsvc_addr_rules_t                     *rules = NULL;
+        char                                    *volname = NULL;
+        char                                    *suffix = NULL;
+        gf_boolean_t                            allow = _gf_false;
+        size_t                                  prefixlen = 0;
+        size_t                                  namelen = 0;
+
+        state = data;
+        if (state->ret == -1)
+                return;
+
+        prefixlen = strlen ("rpc-auth.addr.");
+        if (strncmp (key, "rpc-auth.addr.", prefixlen) != 0)
+                return;
+
+        /* Leaves out the general rules and rpc-auth.addr.namelookup. */
+        suffix = strrchr (key, '.');
+        if (suffix - key <= prefixlen)
+                return;
+
+        if (strcmp (suffix, ".allow") == 0)
+                allow = _gf_true;
+        else if (strcmp (suffix, ".reject") != 0)
+                return;
+
+        state->ret = -1;
+        namelen = suffix - key - prefixlen;
+        volname = GF_CALLOC (namelen + 1, sizeof (char), gf_common_mt_char);
+        if (!volname) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                return;
+        }
+
+        memcpy (volname, key + prefixlen, namelen);
+        rules = nfs_rpcsvc_addr_export_find (state->auth, volname);
+        if (rules) {
+                GF_FREE (volname);
+        } else {
+                rules = GF_CALLOC (1, sizeof (*rules),
+                                   gf_common_mt_rpcsvc_addr_rules_t);
+                if (!rules) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation "
+                                "failed");
+                        GF_FREE (volname);
+                        return;
+                }
+
+                nfs_rpcsvc_addr_rules_init (rules);
+                rules->volname = volname;
+                list_add_tail (&rules->list, &state->auth->exports);
+        }
+
+        if (nfs_rpcsvc_addr_rules_add (rules, allow, value->data) == -1)
+                return;
+
+        state->ret = 0;
+}
+
+
+static rpcsvc_addr_auth_t *
+nfs_rpcsvc_addr_auth_compile (dict_t *options)
+{
+        struct rpcsvc_addr_compile_state        state = {0, };
+        rpcsvc_addr_auth_t                      *auth = NULL;
+        char                                    *optstr = NULL;
+        int                                     ret = -1;
+
+        auth = GF_CALLOC (1, sizeof (*auth), gf_common_mt_rpcsvc_addr_auth_t);
+        if (!auth) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Memory allocation failed");
+                return NULL;
+        }
+
+        nfs_rpcsvc_addr_rules_init (&auth->general);
+        INIT_LIST_HEAD (&auth->exports);
+
+        /* Enabled by default */
+        auth->namelookup = _gf_true;
+        if ((dict_get (options, "rpc-auth.addr.namelookup"))) {
+                ret = dict_get_str (options, "rpc-auth.addr.namelookup",
+                                    &optstr);
+                if (ret == 0)
+                        ret = gf_string2boolean (optstr, &auth->namelookup);
+        }
+
+        if (dict_get_str (options, "rpc-auth.addr.allow", &optstr) == 0) {
+                ret = nfs_rpcsvc_addr_rules_add (&auth->general, _gf_true,
+                                                 optstr);
+                if (ret == -1)
+                        goto err;
+        }
+
+        if (dict_get_str (options, "rpc-auth.addr.reject", &optstr) == 0) {
+                ret = nfs_rpcsvc_addr_rules_add (&auth->general, _gf_false,
+                                                 optstr);
+                if (ret == -1)
+                        goto err;
+        }
+
+        state.auth = auth;
+        dict_foreach (options, nfs_rpcsvc_addr_auth_compile_volume, &state);
+        if (state.ret == -1)
+                goto err;
+
+        return auth;
+
+err:
+        nfs_rpcsvc_addr_auth_free (auth);
+        return NULL;
+}
+
+
+/* Replaces the address rules with the ones in @options. The current rules
+ * stay in force if the new ones cannot be compiled.
+ */
+int
+nfs_rpcsvc_addr_auth_reconf (rpcsvc_t *svc, dict_t *options)
+{
+        rpcsvc_addr_auth_t      *auth = NULL;
+        rpcsvc_addr_auth_t      *tmp = NULL;
+        uint64_t                gen = 0;
+
+        if ((!svc) || (!options))
+                return -1;
+
+        auth = nfs_rpcsvc_addr_auth_compile (options);
+        if (!auth) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to compile address "
+                        "rules");
+                return -1;
+        }
+
+        pthread_rwlock_wrlock (&svc->addrlock);
+        {
+                tmp = svc->addrauth;
+                svc->addrauth = auth;
+                auth = tmp;
+                gen = ++svc->addrgen;
+        }
+        pthread_rwlock_unlock (&svc->addrlock);
+
+        nfs_rpcsvc_addr_auth_free (auth);
+        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Address rules compiled, generation: "
+                "%"PRIu64, gen);
+        return 0;
+}
+
+
+int
+nfs_rpcsvc_addr_auth_init (rpcsvc_t *svc, dict_t *options)
+{
+        if ((!svc) || (!options))
+                return -1;
+
+        pthread_rwlock_init (&svc->addrlock, NULL);
+        return nfs_rpcsvc_addr_auth_reconf (svc, options);
+}
+
+
 /* This function tests the results of the allow rule and the reject rule to
  * combine them into a single result that can be used to determine if the
  * connection should be allowed to proceed.
@@ -483,27 +919,17 @@ nfs_rpcsvc_combine_gen_spec_volume_checks (int gen, int spec)
 
 
 int
-nfs_rpcsvc_conn_peer_check_name (dict_t *options, char *volname,
-                                 rpcsvc_conn_t *conn)
+nfs_rpcsvc_conn_peer_check_name (rpcsvc_addr_rules_t *rules, char *clname)
 {
         int     ret = RPCSVC_AUTH_REJECT;
         int     aret = RPCSVC_AUTH_REJECT;
         int     rjret = RPCSVC_AUTH_REJECT;
-        char    clstr[RPCSVC_PEER_STRLEN];
 
-        if (!conn)
-                return ret;
-
-        ret = nfs_rpcsvc_conn_peername (conn, clstr, RPCSVC_PEER_STRLEN);
-        if (ret != 0) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to get remote addr: "
-                        "%s", gai_strerror (ret));
-                ret = RPCSVC_AUTH_REJECT;
+        if (!clname)
                 goto err;
-        }
 
-        aret = nfs_rpcsvc_conn_peer_check_allow (options, volname, clstr);
-        rjret = nfs_rpcsvc_conn_peer_check_reject (options, volname, clstr);
+        aret = nfs_rpcsvc_conn_peer_check_allow (rules, NULL, clname);
+        rjret = nfs_rpcsvc_conn_peer_check_reject (rules, NULL, clname);
 
         ret = nfs_rpcsvc_combine_allow_reject_volume_check (aret, rjret);
 
@@ -514,28 +940,18 @@ err:
 
 
 int
-nfs_rpcsvc_conn_peer_check_addr (dict_t *options, char *volname,
-                                 rpcsvc_conn_t *conn)
+nfs_rpcsvc_conn_peer_check_addr (rpcsvc_addr_rules_t *rules,
+                                 struct sockaddr *sa, char *claddr)
 {
         int     ret = RPCSVC_AUTH_REJECT;
         int     aret = RPCSVC_AUTH_DONTCARE;
         int     rjret = RPCSVC_AUTH_REJECT;
-        char    clstr[RPCSVC_PEER_STRLEN];
-
-        if (!conn)
-                return ret;
 
-        ret = nfs_rpcsvc_conn_peeraddr (conn, clstr, RPCSVC_PEER_STRLEN, NULL,
-                                        0);
-        if (ret != 0) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to get remote addr: "
-                        "%s", gai_strerror (ret));
-                ret = RPCSVC_AUTH_REJECT;
+        if (!claddr)
                 goto err;
-        }
 
-        aret = nfs_rpcsvc_conn_peer_check_allow (options, volname, clstr);
-        rjret = nfs_rpcsvc_conn_peer_check_reject (options, volname, clstr);
+        aret = nfs_rpcsvc_conn_peer_check_allow (rules, sa, claddr);
+        rjret = nfs_rpcsvc_conn_peer_check_reject (rules, sa, claddr);
 
         ret = nfs_rpcsvc_combine_allow_reject_volume_check (aret, rjret);
 err:
@@ -543,37 +959,27 @@ err:
 }
 
 
+/* Checks the peer against the general rules, when @rules is
+ * &auth->general, or against the rules of a volume.
+ */
 int
-nfs_rpcsvc_conn_check_volume_specific (dict_t *options, char *volname,
-                                       rpcsvc_conn_t *conn)
+nfs_rpcsvc_conn_check_rules (rpcsvc_addr_auth_t *auth,
+                             rpcsvc_addr_rules_t *rules, struct sockaddr *sa,
+                             char *claddr, char *clname)
 {
         int             namechk = RPCSVC_AUTH_REJECT;
         int             addrchk = RPCSVC_AUTH_REJECT;
-        gf_boolean_t    namelookup = _gf_true;
-        char            *namestr = NULL;
         int             ret = 0;
 
-        if ((!options) || (!volname) || (!conn))
-                return RPCSVC_AUTH_REJECT;
-
-        /* Enabled by default */
-        if ((dict_get (options, "rpc-auth.addr.namelookup"))) {
-                ret = dict_get_str (options, "rpc-auth.addr.namelookup"
-                                    , &namestr);
-                if (ret == 0)
-                        ret = gf_string2boolean (namestr, &namelookup);
-        }
-
         /* We need two separate checks because the rules with addresses in them
          * can be network addresses which can be general and names can be
          * specific which will over-ride the network address rules.
          */
-        if (namelookup)
-                namechk = nfs_rpcsvc_conn_peer_check_name (options, volname,
-                                                           conn);
-        addrchk = nfs_rpcsvc_conn_peer_check_addr (options, volname, conn);
+        if (auth->namelookup)
+                namechk = nfs_rpcsvc_conn_peer_check_name (rules, clname);
+        addrchk = nfs_rpcsvc_conn_peer_check_addr (rules, sa, claddr);
 
-        if (namelookup)
+        if (auth->namelookup)
                 ret = nfs_rpcsvc_combine_gen_spec_addr_checks (addrchk,
                                                                namechk);
         else
@@ -583,89 +989,183 @@ nfs_rpcsvc_conn_check_volume_specific (dict_t *options, char *volname,
 }
 
 
-int
-nfs_rpcsvc_conn_check_volume_general (dict_t *options, rpcsvc_conn_t *conn)
+/* Returns the verdict the connection got for the volume with the current
+ * rules, -1 if it has not been checked yet.
+ */
+static int
+nfs_rpcsvc_conn_auth_cached (rpcsvc_conn_t *conn, char *volname, uint64_t gen)
 {
-        int             addrchk = RPCSVC_AUTH_REJECT;
-        int             namechk = RPCSVC_AUTH_REJECT;
-        gf_boolean_t    namelookup = _gf_true;
-        char            *namestr = NULL;
-        int             ret = 0;
+        rpcsvc_addr_verdict_t   *verdict = NULL;
+        int                     ret = -1;
+        int                     i = 0;
 
-        if ((!options) || (!conn))
-                return RPCSVC_AUTH_REJECT;
+        if (conn->is_udp)
+                return -1;
 
-        /* Enabled by default */
-        if ((dict_get (options, "rpc-auth.addr.namelookup"))) {
-                ret = dict_get_str (options, "rpc-auth.addr.namelookup"
-                                    , &namestr);
-                if (ret == 0)
-                        ret = gf_string2boolean (namestr, &namelookup);
+        pthread_mutex_lock (&conn->connlock);
+        {
+                for (i = 0; i < RPCSVC_CONN_AUTHCACHE; i++) {
+                        verdict = &conn->authcache[i];
+                        if ((!verdict->volname) || (verdict->gen != gen))
+                                continue;
+
+                        if (strcmp (verdict->volname, volname) == 0) {
+                                ret = verdict->verdict;
+                                break;
+                        }
+                }
         }
+        pthread_mutex_unlock (&conn->connlock);
 
-        /* We need two separate checks because the rules with addresses in them
-         * can be network addresses which can be general and names can be
-         * specific which will over-ride the network address rules.
-         */
-        if (namelookup)
-                namechk = nfs_rpcsvc_conn_peer_check_name (options, NULL, conn);
-        addrchk = nfs_rpcsvc_conn_peer_check_addr (options, NULL, conn);
+        return ret;
+}
 
-        if (namelookup)
-                ret = nfs_rpcsvc_combine_gen_spec_addr_checks (addrchk,
-                                                               namechk);
-        else
-                ret = addrchk;
 
-        return ret;
+static void
+nfs_rpcsvc_conn_auth_cache (rpcsvc_conn_t *conn, char *volname, uint64_t gen,
+                            int result)
+{
+        rpcsvc_addr_verdict_t   *verdict = NULL;
+        int                     i = 0;
+
+        if (conn->is_udp)
+                return;
+
+        pthread_mutex_lock (&conn->connlock);
+        {
+                for (i = 0; i < RPCSVC_CONN_AUTHCACHE; i++) {
+                        verdict = &conn->authcache[i];
+                        if ((verdict->volname)
+                            && (strcmp (verdict->volname, volname) == 0))
+                                goto set;
+                }
+
+                verdict = &conn->authcache[conn->authnext];
+                conn->authnext = (conn->authnext + 1) % RPCSVC_CONN_AUTHCACHE;
+                if (verdict->volname)
+                        GF_FREE (verdict->volname);
+                verdict->volname = gf_strdup (volname);
+set:
+                verdict->gen = gen;
+                verdict->verdict = result;
+        }
+        pthread_mutex_unlock (&conn->connlock);
 }
 
-int
-nfs_rpcsvc_conn_peer_check (dict_t *options, char *volname, rpcsvc_conn_t *conn)
+
+static socklen_t
+nfs_rpcsvc_sockaddr_len (struct sockaddr *sa)
 {
-        int     general_chk = RPCSVC_AUTH_REJECT;
-        int     specific_chk = RPCSVC_AUTH_REJECT;
+        if (sa->sa_family == AF_INET6)
+                return sizeof (struct sockaddr_in6);
+
+        return sizeof (struct sockaddr_in);
+}
 
-        if ((!options) || (!volname) || (!conn))
+
+int
+nfs_rpcsvc_conn_peer_check (rpcsvc_t *svc, char *volname, rpcsvc_conn_t *conn)
+{
+        struct sockaddr_storage sa = {0, };
+        char                    claddr[RPCSVC_PEER_STRLEN];
+        char                    clname[RPCSVC_PEER_STRLEN];
+        char                    *addrp = NULL;
+        char                    *namep = NULL;
+        rpcsvc_addr_auth_t      *auth = NULL;
+        gf_boolean_t            namelookup = _gf_true;
+        uint64_t                gen = 0;
+        int                     general_chk = RPCSVC_AUTH_REJECT;
+        int                     specific_chk = RPCSVC_AUTH_REJECT;
+        int                     ret = RPCSVC_AUTH_REJECT;
+
+        if ((!svc) || (!volname) || (!conn))
                 return RPCSVC_AUTH_REJECT;
 
-        general_chk = nfs_rpcsvc_conn_check_volume_general (options, conn);
-        specific_chk = nfs_rpcsvc_conn_check_volume_specific (options, volname,
-                                                              conn);
+        pthread_rwlock_rdlock (&svc->addrlock);
+        {
+                gen = svc->addrgen;
+                namelookup = svc->addrauth->namelookup;
+        }
+        pthread_rwlock_unlock (&svc->addrlock);
+
+        ret = nfs_rpcsvc_conn_auth_cached (conn, volname, gen);
+        if (ret != -1)
+                goto out;
+
+        /* The peer is resolved before taking the lock, since name lookups
+         * can take long.
+         */
+        ret = nfs_rpcsvc_conn_peeraddr (conn, NULL, 0, (struct sockaddr *)&sa,
+                                        sizeof (sa));
+        if (ret == 0)
+                ret = getnameinfo ((struct sockaddr *)&sa,
+                                   nfs_rpcsvc_sockaddr_len ((struct sockaddr *)
+                                                            &sa),
+                                   claddr, sizeof (claddr), NULL, 0,
+                                   NI_NUMERICHOST);
+        if (ret != 0)
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to get remote addr: "
+                        "%s", gai_strerror (ret));
+        else
+                addrp = claddr;
+
+        if (namelookup) {
+                ret = nfs_rpcsvc_conn_peername (conn, clname, sizeof (clname));
+                if (ret != 0)
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to get remote"
+                                " addr: %s", gai_strerror (ret));
+                else
+                        namep = clname;
+        }
 
-        return nfs_rpcsvc_combine_gen_spec_volume_checks (general_chk,
-                                                          specific_chk);
+        pthread_rwlock_rdlock (&svc->addrlock);
+        {
+                auth = svc->addrauth;
+                gen = svc->addrgen;
+                general_chk = nfs_rpcsvc_conn_check_rules (auth,
+                                                           &auth->general,
+                                                           (struct sockaddr *)
+                                                           &sa, addrp, namep);
+                specific_chk = nfs_rpcsvc_conn_check_rules (auth,
+                                       nfs_rpcsvc_addr_export_find (auth,
+                                                                    volname),
+                                       (struct sockaddr *)&sa, addrp, namep);
+        }
+        pthread_rwlock_unlock (&svc->addrlock);
+
+        ret = nfs_rpcsvc_combine_gen_spec_volume_checks (general_chk,
+                                                         specific_chk);
+        nfs_rpcsvc_conn_auth_cache (conn, volname, gen, ret);
+out:
+        return ret;
 }
 
 
+/* Returns a copy of the allow list applying to the volume, NULL if there is
+ * none. The caller must free it.
+ */
 char *
-nfs_rpcsvc_volume_allowed (dict_t *options, char *volname)
+nfs_rpcsvc_volume_allowed (rpcsvc_t *svc, char *volname)
 {
-        char    globalrule[] = "rpc-auth.addr.allow";
-        char    *srchstr = NULL;
-        char    *addrstr = NULL;
-        int     ret = -1;
+        rpcsvc_addr_rules_t     *rules = NULL;
+        char                    *addrstr = NULL;
 
-        if ((!options) || (!volname))
+        if ((!svc) || (!volname))
                 return NULL;
 
-        ret = gf_asprintf (&srchstr, "rpc-auth.addr.%s.allow", volname);
-        if (ret == -1) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "asprintf failed");
-                goto out;
-        }
+        pthread_rwlock_rdlock (&svc->addrlock);
+        {
+                rules = nfs_rpcsvc_addr_export_find (svc->addrauth, volname);
+                if ((rules) && (rules->allowstr))
+                        addrstr = rules->allowstr;
+                else
+                        addrstr = svc->addrauth->general.allowstr;
 
-        if (!dict_get (options, srchstr)) {
-                GF_FREE (srchstr);
-                srchstr = globalrule;
-                ret = dict_get_str (options, srchstr, &addrstr);
-                srchstr = NULL;
-        } else
-                ret = dict_get_str (options, srchstr, &addrstr);
+                if (addrstr)
+                        addrstr = gf_strdup (addrstr);
+        }
+        pthread_rwlock_unlock (&svc->addrlock);
 
-out:
-        if (srchstr != NULL)
-                GF_FREE (srchstr);
         return addrstr;
 }
 
@@ -685,6 +1185,9 @@ nfs_rpcsvc_conn_init (rpcsvc_t *svc, int sockfd)
         }
 
         conn->sockfd = sockfd;
+        conn->is_udp = _gf_false;
+        memset (conn->authcache, 0, sizeof (conn->authcache));
+        conn->authnext = 0;
         INIT_LIST_HEAD (&conn->txbufs);
         poolcount = RPCSVC_POOLCOUNT_MULT * svc->memfactor;
         gf_log (GF_RPCSVC, GF_LOG_TRACE, "tx pool: %d", poolcount);
@@ -730,9 +1233,16 @@ free_conn:
 void
 nfs_rpcsvc_conn_destroy (rpcsvc_conn_t *conn)
 {
+        int     i = 0;
+
         mem_pool_destroy (conn->txpool);
         mem_pool_destroy (conn->rxpool);
 
+        for (i = 0; i < RPCSVC_CONN_AUTHCACHE; i++) {
+                if (conn->authcache[i].volname)
+                        GF_FREE (conn->authcache[i].volname);
+        }
+
         /* Need to destory record state, txlists etc. */
         mem_put (((rpcsvc_t *)conn->stage->svc)->connpool, conn);
         gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Connection destroyed");
@@ -885,34 +1395,6 @@ err:
         return conn;
 }
 
-rpcsvc_conn_t *
-nfs_rpcsvc_udp_conn_listen_init (rpcsvc_t *svc, rpcsvc_program_t *newprog)
-{
-        rpcsvc_conn_t  *conn = NULL;
-        int             sock = -1;
-
-        if (!newprog)
-                return NULL;
-
-        sock = nfs_rpcsvc_udp_socket_listen (newprog->progaddrfamily,
-                                             newprog->proghost, newprog->progport);
-        if (sock == -1)
-                goto err;
-
-        conn = nfs_rpcsvc_conn_init (svc, sock);
-        if (!conn)
-                goto sock_close_err;
-
-        nfs_rpcsvc_conn_state_init (conn);
-sock_close_err:
-        if (!conn)
-                close (sock);
-
-err:
-        return conn;
-}
-
-
 void
 nfs_rpcsvc_record_init (rpcsvc_record_state_t *rs, struct iobuf_pool *pool)
 {
@@ -983,6 +1465,40 @@ nfs_rpcsvc_udp_record_init (rpcsvc_record_state_t *rs, struct iobuf_pool *pool)
 
 }
 
+rpcsvc_conn_t *
+nfs_rpcsvc_udp_conn_listen_init (rpcsvc_t *svc, rpcsvc_program_t *newprog)
+{
+        rpcsvc_conn_t  *conn = NULL;
+        int             sock = -1;
+
+        if (!newprog)
+                return NULL;
+
+        sock = nfs_rpcsvc_udp_socket_listen (newprog->progaddrfamily,
+                                             newprog->proghost, newprog->progport,
+                                             (svc->udp_listeners > 1));
+        if (sock == -1)
+                goto err;
+
+        conn = nfs_rpcsvc_conn_init (svc, sock);
+        if (!conn)
+                goto sock_close_err;
+
+        /* There is no accept() for UDP, the listening connection is the one
+         * the requests are read from and the replies sent on.
+         */
+        conn->is_udp = _gf_true;
+        nfs_rpcsvc_udp_record_init (&conn->rstate, svc->ctx->iobuf_pool);
+        nfs_rpcsvc_conn_state_init (conn);
+sock_close_err:
+        if (!conn)
+                close (sock);
+
+err:
+        return conn;
+}
+
+
 int
 nfs_rpcsvc_conn_privport_check (rpcsvc_t *svc, char *volname,
                                 rpcsvc_conn_t *conn)
@@ -1093,34 +1609,12 @@ nfs_rpcsvc_conn_accept_init (rpcsvc_t *svc, int listenfd)
                 goto err;
         }
 
-        nfs_rpcsvc_record_init (&newconn->rstate, svc->ctx->iobuf_pool);
-        nfs_rpcsvc_conn_state_init (newconn);
-        ret = 0;
-
-err:
-        if (ret == -1)
-                close (sock);
-
-        return newconn;
-}
-
-rpcsvc_conn_t *
-nfs_rpcsvc_conn_udp_init (rpcsvc_t *svc, int listenfd)
-{
-        rpcsvc_conn_t   *newconn = NULL;
-        int             sock = -1;
-        int             ret = -1;
-
-        sock = dup (listenfd);
-
-        newconn = nfs_rpcsvc_conn_init (svc, sock);
-        if (!newconn) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to init conn object");
-                ret = -1;
-                goto err;
-        }
+        newconn->sockaddrlen = sizeof (newconn->addr);
+        if (getpeername (sock, (struct sockaddr *)&newconn->addr,
+                         &newconn->sockaddrlen) == -1)
+                newconn->sockaddrlen = 0;
 
-        nfs_rpcsvc_udp_record_init (&newconn->rstate, svc->ctx->iobuf_pool);
+        nfs_rpcsvc_record_init (&newconn->rstate, svc->ctx->iobuf_pool);
         nfs_rpcsvc_conn_state_init (newconn);
         ret = 0;
 
@@ -1517,6 +2011,20 @@ nfs_rpcsvc_conn_append_txlist (rpcsvc_conn_t *conn, struct iovec msg,
 }
 
 
+/* Over UDP, the record starting with this txbuf goes back to wherever the
+ * request came from.
+ */
+void
+nfs_rpcsvc_txbuf_set_peer (rpcsvc_txbuf_t *txbuf, rpcsvc_request_t *req)
+{
+        if ((!txbuf) || (!req) || (!req->conn->is_udp))
+                return;
+
+        memcpy (&txbuf->addr, &req->peeraddr, req->peeraddrlen);
+        txbuf->addrlen = req->peeraddrlen;
+}
+
+
 void
 nfs_rpcsvc_set_lastfrag (uint32_t *fragsize) {
         (*fragsize) |= 0x80000000U;
@@ -1593,20 +2101,20 @@ err:
 }
 
 int
-nfs_rpcsvc_udp_submit (rpcsvc_conn_t *conn, struct iovec hdr,
+nfs_rpcsvc_conn_submit (rpcsvc_request_t *req, struct iovec hdr,
                         struct iobuf *hdriob, struct iovec msgvec,
                         struct iobuf *msgiob)
 {
-        int     ret = -1;
-        struct iovec iov = {0,};
-        struct iobuf *iobuf = NULL;
-        char   *buf = NULL;
-        rpcsvc_t *svc = NULL;
-        size_t  size = 0;
+        int             ret = -1;
+        int             txflags = 0;
+        rpcsvc_conn_t   *conn = NULL;
+        rpcsvc_txbuf_t  *txbuf = NULL;
 
-        if ((!conn) || (!hdr.iov_base) || (!hdriob))
+        if ((!req) || (!req->conn) || (!hdr.iov_base) || (!hdriob))
                 return -1;
 
+        conn = req->conn;
+
         gf_log (GF_RPCSVC, GF_LOG_TRACE, "Tx Header: %zu, payload: %zu",
                 hdr.iov_len, msgvec.iov_len);
         /* Now that we have both the RPC and Program buffers in xdr format
@@ -1619,81 +2127,21 @@ nfs_rpcsvc_udp_submit (rpcsvc_conn_t *conn, struct iovec hdr,
                         goto unlock_err;
                 }
 
-                if (msgiob)
-                        size = hdr.iov_len + msgvec.iov_len;
-                else
-                        size = hdr.iov_len;
-
-                svc = nfs_rpcsvc_conn_rpcsvc (conn);
-                iobuf = iobuf_get (svc->ctx->iobuf_pool);
-                if (!iobuf)
-                        goto unlock_err;
-
-                buf = iobuf->ptr;
-
-                memcpy (buf, hdr.iov_base, hdr.iov_len);
-
-                if (msgiob)
-                        memcpy (buf + hdr.iov_len, msgvec.iov_base, msgvec.iov_len);
-
-                iov.iov_base = buf;
-                iov.iov_len = size;
+                txflags = RPCSVC_TXB_FIRST;
+                if (!msgiob)
+                        txflags |= RPCSVC_TXB_LAST;
 
-                ret = nfs_rpcsvc_conn_append_txlist (conn, iov, iobuf,
-                                                     RPCSVC_TXB_FIRST);
-                if (ret == -1) {
+                txbuf = nfs_rpcsvc_init_txbuf (conn, hdr, hdriob, NULL,
+                                               txflags);
+                if (!txbuf) {
                         gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to append "
                                 "header to transmission list");
+                        ret = -1;
                         goto unlock_err;
                 }
 
-        }
-unlock_err:
-        pthread_mutex_unlock (&conn->connlock);
-
-        if (ret == -1)
-                goto err;
-
-        /* Tell event pool, we're interested in poll_out to trigger flush
-         * of our tx buffers.
-         */
-        conn->eventidx = event_select_on (conn->stage->eventpool, conn->sockfd,
-                                          conn->eventidx, -1, 1);
-        ret = 0;
-err:
-
-        return ret;
-}
-
-int
-nfs_rpcsvc_conn_submit (rpcsvc_conn_t *conn, struct iovec hdr,
-                        struct iobuf *hdriob, struct iovec msgvec,
-                        struct iobuf *msgiob)
-{
-        int     ret = -1;
-
-        if ((!conn) || (!hdr.iov_base) || (!hdriob))
-                return -1;
-
-        gf_log (GF_RPCSVC, GF_LOG_TRACE, "Tx Header: %zu, payload: %zu",
-                hdr.iov_len, msgvec.iov_len);
-        /* Now that we have both the RPC and Program buffers in xdr format
-         * lets hand it to the transmission layer.
-         */
-        pthread_mutex_lock (&conn->connlock);
-        {
-                if (!nfs_rpcsvc_conn_check_active (conn)) {
-                        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Connection inactive");
-                        goto unlock_err;
-                }
-
-                ret = nfs_rpcsvc_conn_append_txlist (conn, hdr, hdriob,
-                                                     RPCSVC_TXB_FIRST);
-                if (ret == -1) {
-                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to append "
-                                "header to transmission list");
-                        goto unlock_err;
-                }
+                nfs_rpcsvc_txbuf_set_peer (txbuf, req);
+                list_add_tail (&txbuf->txlist, &conn->txbufs);
 
                 /* It is possible that this RPC reply is an error reply. In that
                  * case we might not have been handed a payload.
@@ -1850,6 +2298,7 @@ nfs_rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec msgvec,
         int                     ret = -1;
         struct iobuf            *replyiob = NULL;
         struct iovec            recordhdr = {0, };
+        struct iovec            replyvec[2];
         rpcsvc_conn_t           *conn = NULL;
         int                     rpc_status = 0;
         int                     rpc_error = 0;
@@ -1864,6 +2313,7 @@ nfs_rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec msgvec,
                                                    &recordhdr);
         if (!replyiob) {
                 gf_log (GF_RPCSVC, GF_LOG_ERROR,"Reply record creation failed");
+                nfs_rpcsvc_drc_forget (req);
                 goto disconnect_exit;
         }
 
@@ -1872,12 +2322,15 @@ nfs_rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec msgvec,
          * of the buffer to us. Note msg can be NULL if an RPC-only message
          * was being sent. Happens when an RPC error reply is being sent.
          */
+        if (req->drcpending) {
+                replyvec[0] = recordhdr;
+                replyvec[1] = msgvec;
+                nfs_rpcsvc_drc_reply (req, replyvec, (msg) ? 2 : 1);
+        }
+
         if (msg)
                 iobuf_ref (msg);
-        if (conn->is_udp)
-                ret = nfs_rpcsvc_udp_submit (conn, recordhdr, replyiob, msgvec, msg);
-        else
-                ret = nfs_rpcsvc_conn_submit (conn, recordhdr, replyiob, msgvec, msg);
+        ret = nfs_rpcsvc_conn_submit (req, recordhdr, replyiob, msgvec, msg);
 
         if (ret == -1) {
                 gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to submit message");
@@ -1906,7 +2359,7 @@ disconnect_exit:
         /* Must mem_put req back to rxpool before the possibility of destroying
          * conn in conn_unref, where the rxpool itself is destroyed.
          */
-        mem_put (conn->rxpool, req);
+        nfs_rpcsvc_destroy_request (conn, req);
         if ((rpc_status == MSG_ACCEPTED) && (rpc_error == SUCCESS))
                 nfs_rpcsvc_conn_unref (conn);
 
@@ -1983,6 +2436,9 @@ nfs_rpcsvc_submit_vectors (rpcsvc_request_t *req)
         struct iovec            recordhdr = {0, };
         rpcsvc_txbuf_t          *rpctxb = NULL;
         rpcsvc_conn_t           *conn = NULL;
+        struct iovec            replyvec[RPCSVC_TXVEC_MAX];
+        rpcsvc_txbuf_t          *txb = NULL;
+        int                     count = 0;
 
         if ((!req) || (!req->conn))
                 return -1;
@@ -1992,6 +2448,7 @@ nfs_rpcsvc_submit_vectors (rpcsvc_request_t *req)
                                                    &recordhdr);
         if (!replyiob) {
                 gf_log (GF_RPCSVC, GF_LOG_ERROR,"Reply record creation failed");
+                nfs_rpcsvc_drc_forget (req);
                 goto disconnect_exit;
         }
 
@@ -1999,9 +2456,28 @@ nfs_rpcsvc_submit_vectors (rpcsvc_request_t *req)
                                         RPCSVC_TXB_FIRST);
         if (!rpctxb) {
                 gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to create tx buf");
+                nfs_rpcsvc_drc_forget (req);
+                iobuf_unref (replyiob);
                 goto disconnect_exit;
         }
 
+        nfs_rpcsvc_txbuf_set_peer (rpctxb, req);
+
+        if (req->drcpending) {
+                replyvec[0] = recordhdr;
+                count = 1;
+                list_for_each_entry (txb, &req->txlist, txlist) {
+                        if (count == RPCSVC_TXVEC_MAX)
+                                break;
+                        replyvec[count++] = txb->buf;
+                }
+
+                if (&txb->txlist == &req->txlist)
+                        nfs_rpcsvc_drc_reply (req, replyvec, count);
+                else
+                        nfs_rpcsvc_drc_forget (req);
+        }
+
         pthread_mutex_lock (&req->conn->connlock);
         {
                 list_add_tail (&rpctxb->txlist, &req->conn->txbufs);
@@ -2022,7 +2498,7 @@ disconnect_exit:
         /* Must mem_put req back to rxpool before the possibility of destroying
          * conn in conn_unref, where the rxpool itself is destroyed.
          */
-        mem_put (conn->rxpool, req);
+        nfs_rpcsvc_destroy_request (conn, req);
 
         nfs_rpcsvc_conn_unref (conn);
         if (ret == -1)
@@ -2107,6 +2583,9 @@ nfs_rpcsvc_request_create (rpcsvc_conn_t *conn)
                 goto err;
         }
 
+        memcpy (&req->peeraddr, &conn->addr, conn->sockaddrlen);
+        req->peeraddrlen = conn->sockaddrlen;
+
         msgbuf = iobuf_ptr (conn->rstate.activeiob);
         ret = nfs_xdr_to_rpc_call (msgbuf, conn->rstate.recordsize, &rpcmsg,
                                    &progmsg, req->cred.authdata,
@@ -2164,6 +2643,39 @@ err:
 }
 
 
+/* Returns 1 if the request turned out to be a retransmission which has been
+ * answered from the duplicate request cache, or dropped, and so must not be
+ * handed to the actor.
+ */
+int
+nfs_rpcsvc_request_drc_check (rpcsvc_request_t *req, rpcsvc_actor_t *actor)
+{
+        struct iovec            reply = {0, };
+        struct iovec            nomsg = {0, };
+        struct iobuf            *replyiob = NULL;
+        int                     ret = RPCSVC_DRC_NEW;
+
+        if (!actor->nonidempotent)
+                return 0;
+
+        ret = nfs_rpcsvc_drc_lookup (req, &reply, &replyiob);
+        if (ret == RPCSVC_DRC_NEW)
+                return 0;
+
+        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Retransmitted request: xid %u, %s, "
+                "%s", req->xid, actor->procname,
+                (ret == RPCSVC_DRC_REPLAY) ? "replaying reply" : "dropped");
+        if (ret == RPCSVC_DRC_REPLAY) {
+                if (nfs_rpcsvc_conn_submit (req, reply, replyiob, nomsg,
+                                            NULL) == -1)
+                        iobuf_unref (replyiob);
+        }
+
+        nfs_rpcsvc_destroy_request (req->conn, req);
+        return 1;
+}
+
+
 int
 nfs_rpcsvc_handle_rpc_call (rpcsvc_conn_t *conn)
 {
@@ -2185,6 +2697,11 @@ nfs_rpcsvc_handle_rpc_call (rpcsvc_conn_t *conn)
         if (!actor)
                 goto err_reply;
 
+        if (nfs_rpcsvc_request_drc_check (req, actor)) {
+                ret = 0;
+                goto err;
+        }
+
         if ((actor) && (actor->actor)) {
                 THIS = nfs_rpcsvc_request_actorxl (req);
                 nfs_rpcsvc_conn_ref (conn);
@@ -2194,8 +2711,9 @@ nfs_rpcsvc_handle_rpc_call (rpcsvc_conn_t *conn)
 err_reply:
         if (ret == RPCSVC_ACTOR_ERROR)
                 ret = nfs_rpcsvc_error_reply (req);
-        else if (ret == RPCSVC_ACTOR_IGNORE)
-                mem_put (conn->rxpool, req);
+        else if (ret == RPCSVC_ACTOR_IGNORE) {
+                nfs_rpcsvc_destroy_request (conn, req);
+        }
 
         /* No need to propagate error beyond this function since the reply
          * has now been queued. */
@@ -2493,6 +3011,9 @@ nfs_rpcsvc_record_vectored_call_actor (rpcsvc_conn_t *conn)
         if (!actor)
                 goto err_reply;
 
+        if (nfs_rpcsvc_request_drc_check (req, actor))
+                goto err;
+
         if (actor->vector_actor) {
                 nfs_rpcsvc_conn_ref (conn);
                 THIS = nfs_rpcsvc_request_actorxl (req);
@@ -2506,8 +3027,9 @@ nfs_rpcsvc_record_vectored_call_actor (rpcsvc_conn_t *conn)
 err_reply:
         if (ret == RPCSVC_ACTOR_ERROR)
                 ret = nfs_rpcsvc_error_reply (req);
-        else if (ret == RPCSVC_ACTOR_IGNORE)
-                mem_put (conn->rxpool, req);
+        else if (ret == RPCSVC_ACTOR_IGNORE) {
+                nfs_rpcsvc_destroy_request (conn, req);
+        }
 
         /* No need to propagate error beyond this function since the reply
          * has now been queued. */
@@ -2681,7 +3203,10 @@ nfs_rpcsvc_record_update_state (rpcsvc_conn_t *conn, ssize_t dataread)
                 gf_log (GF_RPCSVC, GF_LOG_TRACE, "Full Record Received.");
                 nfs_rpcsvc_handle_rpc_call (conn);
                 svc = nfs_rpcsvc_conn_rpcsvc (conn);
-                nfs_rpcsvc_record_init (rs, svc->ctx->iobuf_pool);
+                if (conn->is_udp)
+                        nfs_rpcsvc_udp_record_init (rs, svc->ctx->iobuf_pool);
+                else
+                        nfs_rpcsvc_record_init (rs, svc->ctx->iobuf_pool);
         }
 
         return 0;
@@ -2728,29 +3253,85 @@ err:
         return ret;
 }
 
+/* Drains up to RPCSVC_UDP_BATCH datagrams in one go. The first one is read
+ * straight into the record buffer, the others into a scratch iobuf from
+ * which they are copied into the record buffer when their turn comes.
+ */
 int
 nfs_rpcsvc_udp_data_poll_in (rpcsvc_conn_t *conn)
 {
-        ssize_t         dataread = -1;
-        size_t          readsize = 0;
-        char            *readaddr = NULL;
-        int             ret = -1;
+        struct iobuf            *iob = NULL;
+        struct iovec            iov[RPCSVC_UDP_BATCH];
+        struct msghdr           msgs[RPCSVC_UDP_BATCH];
+        struct sockaddr_storage addrs[RPCSVC_UDP_BATCH];
+        ssize_t                 lens[RPCSVC_UDP_BATCH];
+        char                    *readaddr = NULL;
+        rpcsvc_t                *svc = NULL;
+        int                     count = 1;
+        int                     received = 0;
+        int                     i = 0;
+        int                     ret = -1;
 
+        svc = nfs_rpcsvc_conn_rpcsvc (conn);
         readaddr = nfs_rpcsvc_record_read_addr (&conn->rstate);
         if (!readaddr)
                 goto err;
 
-        dataread = nfs_rpcsvc_udp_socket_read (conn, conn->sockfd, readaddr, 4096);
-        gf_log (GF_RPCSVC, GF_LOG_TRACE, "conn: 0x%lx, readsize: %zu, dataread:"
-                "%zd", (long)conn, readsize, dataread);
+        iov[0].iov_base = readaddr;
+        iov[0].iov_len = RPCSVC_UDP_MSGSZ;
+
+        iob = iobuf_get (svc->ctx->iobuf_pool);
+        if (iob) {
+                count = min (RPCSVC_UDP_BATCH,
+                             1 + (iobuf_pagesize (iob) / RPCSVC_UDP_MSGSZ));
+                for (i = 1; i < count; i++) {
+                        iov[i].iov_base = iobuf_ptr (iob)
+                                          + ((i - 1) * RPCSVC_UDP_MSGSZ);
+                        iov[i].iov_len = RPCSVC_UDP_MSGSZ;
+                }
+        }
 
-        if (dataread > 0) {
-                conn->rstate.fragsize = dataread;
-                conn->rstate.remainingfrag = dataread;
-                ret = nfs_rpcsvc_record_update_state (conn, dataread);
+        for (i = 0; i < count; i++) {
+                memset (&msgs[i], 0, sizeof (msgs[i]));
+                msgs[i].msg_name = &addrs[i];
+                msgs[i].msg_namelen = sizeof (addrs[i]);
+                msgs[i].msg_iov = &iov[i];
+                msgs[i].msg_iovlen = 1;
+        }
+
+        received = nfs_rpcsvc_udp_socket_recvv (conn->sockfd, msgs, lens,
+                                                count);
+        gf_log (GF_RPCSVC, GF_LOG_TRACE, "conn: 0x%lx, datagrams: %d",
+                (long)conn, received);
+        if (received == -1)
+                goto err;
+
+        ret = 0;
+        for (i = 0; i < received; i++) {
+                if (lens[i] <= 0)
+                        continue;
+
+                if (i > 0) {
+                        readaddr = nfs_rpcsvc_record_read_addr (&conn->rstate);
+                        if (!readaddr) {
+                                ret = -1;
+                                break;
+                        }
+                        memcpy (readaddr, iov[i].iov_base, lens[i]);
+                }
+
+                memcpy (&conn->addr, &addrs[i], msgs[i].msg_namelen);
+                conn->sockaddrlen = msgs[i].msg_namelen;
+
+                conn->rstate.fragsize = lens[i];
+                conn->rstate.remainingfrag = lens[i];
+                ret = nfs_rpcsvc_record_update_state (conn, lens[i]);
         }
 
 err:
+        if (iob)
+                iobuf_unref (iob);
+
         return ret;
 }
 
@@ -2765,88 +3346,176 @@ nfs_rpcsvc_conn_data_poll_err (rpcsvc_conn_t *conn)
 }
 
 
+/* Moves the transmission list ahead by the given number of bytes, releasing
+ * the buffers that have been sent completely.
+ */
+void
+__nfs_rpcsvc_conn_tx_consume (rpcsvc_conn_t *conn, size_t written)
+{
+        rpcsvc_txbuf_t          *txbuf = NULL;
+        rpcsvc_txbuf_t          *tmp = NULL;
+        size_t                  left = 0;
+
+        list_for_each_entry_safe (txbuf, tmp, &conn->txbufs, txlist) {
+                left = txbuf->buf.iov_len - txbuf->offset;
+                if (written < left) {
+                        txbuf->offset += written;
+                        break;
+                }
+
+                written -= left;
+                /* It doesnt matter who ref'ed this iobuf, rpcsvc for
+                 * its own header or a RPC program.
+                 */
+                if (txbuf->iob)
+                        iobuf_unref (txbuf->iob);
+                if (txbuf->iobref)
+                        iobref_unref (txbuf->iobref);
+
+                list_del (&txbuf->txlist);
+                mem_put (conn->txpool, txbuf);
+        }
+}
+
+
+/* Over UDP every record is a datagram of its own, addressed to wherever
+ * its request came from, and up to RPCSVC_UDP_BATCH of them are handed to
+ * the kernel at a time.
+ */
+int
+__nfs_rpcsvc_conn_udp_poll_out (rpcsvc_conn_t *conn)
+{
+        rpcsvc_txbuf_t          *txbuf = NULL;
+        struct iovec            vector[RPCSVC_TXVEC_MAX];
+        struct msghdr           msgs[RPCSVC_UDP_BATCH];
+        size_t                  msgsize[RPCSVC_UDP_BATCH];
+        int                     count = 0;
+        int                     nmsgs = 0;
+        int                     sent = 0;
+        int                     full = 0;
+        int                     eagain = 0;
+        int                     i = 0;
+
+        while (!list_empty (&conn->txbufs)) {
+                count = 0;
+                nmsgs = 0;
+                full = 0;
+                eagain = 0;
+                list_for_each_entry (txbuf, &conn->txbufs, txlist) {
+                        if ((nmsgs == 0)
+                            || (txbuf->txbehave & RPCSVC_TXB_FIRST)) {
+                                if (nmsgs == RPCSVC_UDP_BATCH)
+                                        break;
+
+                                memset (&msgs[nmsgs], 0, sizeof (msgs[nmsgs]));
+                                msgs[nmsgs].msg_name = &txbuf->addr;
+                                msgs[nmsgs].msg_namelen = txbuf->addrlen;
+                                msgs[nmsgs].msg_iov = &vector[count];
+                                msgsize[nmsgs] = 0;
+                                ++nmsgs;
+                        }
+
+                        if (count == RPCSVC_TXVEC_MAX) {
+                                full = 1;
+                                break;
+                        }
+
+                        vector[count].iov_base = txbuf->buf.iov_base
+                                                 + txbuf->offset;
+                        vector[count].iov_len = txbuf->buf.iov_len
+                                                - txbuf->offset;
+                        msgs[nmsgs - 1].msg_iovlen++;
+                        msgsize[nmsgs - 1] += vector[count].iov_len;
+                        ++count;
+                }
+
+                /* A record that did not fit is left for the next round,
+                 * unless it is the only one, which then cannot be sent whole
+                 * at all.
+                 */
+                if (full && (nmsgs > 1))
+                        --nmsgs;
+
+                sent = nfs_rpcsvc_udp_socket_sendv (conn->sockfd, msgs, nmsgs,
+                                                    &eagain);
+                /* We'll be back when the socket can take more. */
+                if (eagain)
+                        break;
+
+                /* A datagram that could not be sent is as good as lost on
+                 * the wire, the client will retransmit.
+                 */
+                if (sent <= 0)
+                        sent = 1;
+
+                for (i = 0; i < sent; i++)
+                        __nfs_rpcsvc_conn_tx_consume (conn, msgsize[i]);
+        }
+
+        if (list_empty (&conn->txbufs))
+                conn->eventidx = event_select_on (conn->stage->eventpool,
+                                                  conn->sockfd, conn->eventidx,
+                                                  -1, 0);
+
+        return 0;
+}
+
+
 int
 __nfs_rpcsvc_conn_data_poll_out (rpcsvc_conn_t *conn)
 {
         rpcsvc_txbuf_t          *txbuf = NULL;
-        rpcsvc_txbuf_t          *tmp = NULL;
+        struct iovec            vector[RPCSVC_TXVEC_MAX];
+        int                     count = 0;
         ssize_t                 written = -1;
-        char                    *writeaddr = NULL;
-        size_t                  writesize = -1;
+        size_t                  writesize = 0;
         int                     eagain = 0;
 
         if (!conn)
                 return -1;
 
-        /* Attempt transmission of each of the pending buffers */
-        list_for_each_entry_safe (txbuf, tmp, &conn->txbufs, txlist) {
-tx_remaining:
-                eagain = 0;
-                writeaddr = (char *)(txbuf->buf.iov_base + txbuf->offset);
-                writesize = (txbuf->buf.iov_len - txbuf->offset);
+        if (conn->is_udp)
+                return __nfs_rpcsvc_conn_udp_poll_out (conn);
 
-                if (txbuf->txbehave & RPCSVC_TXB_FIRST) {
-                        //gf_log (GF_RPCSVC, GF_LOG_TRACE, "First Tx Buf");
-                        nfs_rpcsvc_socket_block_tx (conn->sockfd);
+        /* Gather the pending buffers into as few system calls as possible,
+         * i.e. everything queued, up to RPCSVC_TXVEC_MAX buffers at a time,
+         * regardless of record boundaries.
+         */
+        while (!list_empty (&conn->txbufs)) {
+                count = 0;
+                writesize = 0;
+                eagain = 0;
+                list_for_each_entry (txbuf, &conn->txbufs, txlist) {
+                        vector[count].iov_base = txbuf->buf.iov_base
+                                                 + txbuf->offset;
+                        vector[count].iov_len = txbuf->buf.iov_len
+                                                - txbuf->offset;
+                        writesize += vector[count].iov_len;
+                        ++count;
+
+                        if (count == RPCSVC_TXVEC_MAX)
+                                break;
                 }
 
-                if (!conn->is_udp) {
-                        written = nfs_rpcsvc_socket_write (conn->sockfd, writeaddr,
-                                                   writesize, &eagain);
-                } else {
-                        written = nfs_rpcsvc_udp_write (conn, conn->sockfd, writeaddr,
-                                                        writesize);
-
-                }
-                if (txbuf->txbehave & RPCSVC_TXB_LAST) {
-                    //    gf_log (GF_RPCSVC, GF_LOG_TRACE, "Last Tx Buf");
-                        nfs_rpcsvc_socket_unblock_tx (conn->sockfd);
-                }
+                written = nfs_rpcsvc_socket_writev (conn->sockfd, vector,
+                                                    count, &eagain);
                 //gf_log (GF_RPCSVC, GF_LOG_TRACE, "conn: 0x%lx, Tx request: %zu,"
                   //      " Tx sent: %zd", (long)conn, writesize, written);
 
-                /* There was an error transmitting this buffer */
-                if (written == -1)
+                /* We'll be back when the socket can take more. */
+                if (eagain)
                         break;
 
-                if (written >= 0)
-                        txbuf->offset += written;
+                /* The error handler will tear the connection down. */
+                if (written == -1)
+                        break;
 
-                /* If the current buffer has been completely transmitted,
-                 * delete it from the list and move on to the next buffer.
-                 */
-                if (txbuf->offset == txbuf->buf.iov_len) {
-                        /* It doesnt matter who ref'ed this iobuf, rpcsvc for
-                         * its own header or a RPC program.
-                         */
-                        if (txbuf->iob)
-                                iobuf_unref (txbuf->iob);
-                        if (txbuf->iobref)
-                                iobref_unref (txbuf->iobref);
-
-                        list_del (&txbuf->txlist);
-                        mem_put (conn->txpool, txbuf);
-                } else {
-                        /* If the current buffer is incompletely tx'd, do not
-                         * go to the head of the loop, since that moves us to
-                         * the next buffer.
-                         *
-                         * BUT, if the current transmission exited due to EAGAIN
-                         * we need to leave the buffers where they are and come
-                         * back later for retransmission.
-                         */
-                        if (!eagain)
-                                goto tx_remaining;
-                        else
-                                break;
-                }
+                if ((written == 0) && (writesize > 0))
+                        break;
 
+                __nfs_rpcsvc_conn_tx_consume (conn, written);
         }
 
-        /* If we've broken out of the loop above then we must unblock
-         * the transmission now.
-         */
-        nfs_rpcsvc_socket_unblock_tx (conn->sockfd);
         if (list_empty (&conn->txbufs))
                 conn->eventidx = event_select_on (conn->stage->eventpool,
                                                   conn->sockfd, conn->eventidx,
@@ -2981,52 +3650,6 @@ err:
         return ret;
 }
 
-int
-nfs_rpcsvc_conn_udp_handler (int fd, int idx, void *data, int poll_in,
-                                   int poll_out, int poll_err)
-{
-        rpcsvc_conn_t           *newconn = NULL;
-        rpcsvc_stage_t          *selectedstage = NULL;
-        int                     ret = -1;
-        rpcsvc_conn_t           *conn = NULL;
-        rpcsvc_t                *svc = NULL;
-
-        if (!poll_in)
-                return 0;
-
-        conn = (rpcsvc_conn_t *)data;
-        svc = nfs_rpcsvc_conn_rpcsvc (conn);
-        newconn = nfs_rpcsvc_conn_udp_init (svc, fd);
-        if (!newconn) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "failed to accept connection");
-                goto err;
-        }
-
-        selectedstage = nfs_rpcsvc_select_stage (svc);
-        if (!selectedstage)
-                goto close_err;
-
-        /* Now that we've accepted the connection, we need to associate
-         * its events to a stage.
-         */
-        ret = nfs_rpcsvc_stage_conn_associate (selectedstage, newconn,
-                                               nfs_rpcsvc_udp_data_handler,
-                                               newconn);
-        if (ret == -1) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "could not associate stage "
-                        " with new connection");
-                goto close_err;
-        }
-        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "New Connection");
-        ret = 0;
-close_err:
-        if (ret == -1)
-                nfs_rpcsvc_conn_unref (newconn);
-
-err:
-        return ret;
-}
-
 /* Register the program with the local portmapper service. */
 int
 nfs_rpcsvc_program_register_portmap (rpcsvc_t *svc, rpcsvc_program_t *newprog)
@@ -3121,25 +3744,37 @@ nfs_rpcsvc_stage_udp_program_register (rpcsvc_stage_t *stg,
 {
         rpcsvc_conn_t           *newconn = NULL;
         rpcsvc_t                *svc = NULL;
+        rpcsvc_stage_t          *listenstg = NULL;
+        int                     i = 0;
 
         if ((!stg) || (!newprog))
                 return -1;
 
         svc = nfs_rpcsvc_stage_service (stg);
-        /* Create a listening socket */
-        newconn = nfs_rpcsvc_udp_conn_listen_init (svc, newprog);
-        if (!newconn) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR, "could not create listening"
-                        " connection");
-                return -1;
-        }
+        for (i = 0; i < svc->udp_listeners; i++) {
+                listenstg = (i == 0) ? stg : nfs_rpcsvc_select_udp_stage (svc,
+                                                                          i);
+                if (!listenstg) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "could not start "
+                                "stage for UDP listener %d", i);
+                        return -1;
+                }
 
-        if ((nfs_rpcsvc_stage_conn_associate (stg, newconn,
-                                              nfs_rpcsvc_conn_udp_handler,
-                                              newconn)) == -1) {
-                gf_log (GF_RPCSVC, GF_LOG_ERROR,"could not associate stage with"
-                        " listening connection");
-                return -1;
+                /* Create a listening socket */
+                newconn = nfs_rpcsvc_udp_conn_listen_init (svc, newprog);
+                if (!newconn) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "could not create "
+                                "listening connection");
+                        return -1;
+                }
+
+                if ((nfs_rpcsvc_stage_conn_associate (listenstg, newconn,
+                                                      nfs_rpcsvc_udp_data_handler,
+                                                      newconn)) == -1) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR,"could not associate "
+                                "stage with listening connection");
+                        return -1;
+                }
         }
 
         return 0;
@@ -3324,7 +3959,8 @@ nfs_rpcsvc_conn_peeraddr (rpcsvc_conn_t *conn, char *addrstr, int addrlen,
 
         if (conn->is_udp) {
                 if (sa)
-                        memcpy (sa, &conn->addr, conn->sockaddrlen);
+                        memcpy (sa, &conn->addr, min (sasize,
+                                                      conn->sockaddrlen));
                 return 0;
         }
 
@@ -38,6 +38,8 @@
 
 #include <pthread.h>
 #include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
 #ifdef GF_DARWIN_HOST_OS
 #include <nfs/rpcv2.h>
@@ -53,6 +55,14 @@
 #define RPCSVC_CONN_READ        (128 * GF_UNIT_KB)
 #define RPCSVC_PAGE_SIZE        (128 * GF_UNIT_KB)
 
+/* Largest datagram taken off a UDP socket, kept at the vectored fragment
+ * threshold so UDP requests never go down the vectored path.
+ */
+#define RPCSVC_UDP_MSGSZ        RPCSVC_VECTORED_FRAGSZ
+/* Most datagrams received or sent in one system call. */
+#define RPCSVC_UDP_BATCH        16
+#define RPCSVC_DEFAULT_UDP_LISTENERS    1
+
 /* Defines for RPC record and fragment assembly */
 
 #define RPCSVC_FRAGHDR_SIZE  4       /* 4-byte RPC fragment header size */
@@ -120,6 +130,7 @@ typedef struct rpc_svc_stage_context {
         pthread_t               tid;
         struct event_pool       *eventpool;     /* Per-stage event-pool */
         void                    *svc;           /* Ref to the rpcsvc_t */
+        struct list_head        stglist;        /* In rpcsvc_t->stages */
 } rpcsvc_stage_t;
 
 
@@ -209,6 +220,16 @@ typedef struct rpcsvc_request rpcsvc_request_t;
  * Anything that can be accessed by a RPC program must be synced through
  * connlock.
  */
+/* Number of per-volume address check results a connection remembers. */
+#define RPCSVC_CONN_AUTHCACHE   4
+
+typedef struct rpcsvc_addr_verdict {
+        char                    *volname;
+        /* Generation of the address rules the verdict was reached with. */
+        uint64_t                gen;
+        int                     verdict;
+} rpcsvc_addr_verdict_t;
+
 typedef struct rpc_conn_state {
 
         /* Transport or connection state */
@@ -263,9 +284,21 @@ typedef struct rpc_conn_state {
          * more data to be got from the network.
          */
         rpcsvc_request_t        *vectoredreq;
-        struct sockaddr         addr;
+
+        /* The peer of a TCP connection or, for UDP, the source of the
+         * datagram currently being processed. Every request copies it, since
+         * replies may be sent long after other datagrams have come in.
+         */
+        struct sockaddr_storage addr;
         socklen_t               sockaddrlen;
         gf_boolean_t            is_udp;
+
+        /* Results of the rpc-auth.addr checks of the peer, by volume. Not
+         * used for UDP, whose datagrams can come from any peer.
+         * Protected by connlock.
+         */
+        rpcsvc_addr_verdict_t   authcache[RPCSVC_CONN_AUTHCACHE];
+        int                     authnext;
 } rpcsvc_conn_t;
 
 
@@ -367,6 +400,18 @@ struct rpcsvc_request {
 
         /* To save a ref to the program for which this request is. */
         rpcsvc_program_t        *program;
+
+        /* The address the request came from. For UDP, this is also where
+         * the reply is to be sent to.
+         */
+        struct sockaddr_storage peeraddr;
+        socklen_t               peeraddrlen;
+
+        /* Set when the request has an in-progress entry in the duplicate
+         * request cache, which the reply must complete.
+         */
+        gf_boolean_t            drcpending;
+        uint32_t                drccsum;
 };
 
 #define nfs_rpcsvc_request_program(req) ((rpcsvc_program_t *)((req)->program))
@@ -450,6 +495,12 @@ typedef struct rpc_svc_actor_desc {
         rpcsvc_vector_actor     vector_actor;
         rpcsvc_vector_sizer     vector_sizer;
 
+        /* Set for procedures which must not be executed twice when a call
+         * is retransmitted. Their replies are kept in the duplicate request
+         * cache and sent again in response to retransmissions.
+         */
+        int                     nonidempotent;
+
 } rpcsvc_actor_t;
 
 /* Describes a program and its version along with the function pointers
@@ -532,6 +583,22 @@ typedef struct rpc_svc_state {
 
         /* Mempool for incoming connection objects. */
         struct mem_pool         *connpool;
+
+        /* Number of SO_REUSEPORT sockets, each served by a stage of its
+         * own, that every UDP program listens on.
+         */
+        int                     udp_listeners;
+
+        /* Duplicate request cache, NULL when disabled. */
+        struct rpcsvc_drc       *drc;
+
+        /* The rpc-auth.addr.* rules, compiled at init and replaced as a
+         * whole on reconfigure. addrgen is bumped on every replacement, which
+         * invalidates the verdicts cached in the connections.
+         */
+        pthread_rwlock_t        addrlock;
+        struct rpcsvc_addr_auth *addrauth;
+        uint64_t                addrgen;
 } rpcsvc_t;
 
 
@@ -573,18 +640,17 @@ nfs_rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec msgvec,
 
 
 /* These are used to differentiate between multiple txbufs which form
- * a single RPC record. For eg, one purpose we use these for is to
- * prevent dividing a RPC record over multiple TCP segments. Multiple
- * TCP segments are possible for a single RPC record because we generally do not
- * have control over how the kernel's TCP segments the buffers when putting
- * them on the wire. So, on Linux, we use these to set TCP_CORK to create
- * a single TCP segment from multiple txbufs that are part of the same RPC
- * record. This improves network performance by reducing tiny message
- * transmissions.
+ * a single RPC record. Pending txbufs are handed to the kernel together in
+ * a single writev, so over TCP the record boundaries do not matter, but over
+ * UDP each record, i.e. the txbufs from a FIRST through the next LAST, must
+ * be sent as one datagram.
  */
 #define RPCSVC_TXB_FIRST        0x1
 #define RPCSVC_TXB_LAST         0x2
 
+/* Most txbufs handed to the kernel in one system call. */
+#define RPCSVC_TXVEC_MAX        64
+
 /* The list of buffers appended to a connection's pending
  * transmission list.
  */
@@ -619,6 +685,12 @@ typedef struct rpcsvc_txbuf {
          * See the RPCSVC_TXB_* defines for more info.
          */
         int                     txbehave;
+
+        /* For UDP, the destination of the record. Only set on the first
+         * txbuf of a record.
+         */
+        struct sockaddr_storage addr;
+        socklen_t               addrlen;
 } rpcsvc_txbuf_t;
 
 extern int
@@ -636,8 +708,49 @@ extern int
 nfs_rpcsvc_conn_peeraddr (rpcsvc_conn_t *conn, char *addrstr, int addrlen,
                           struct sockaddr *returnsa, socklen_t sasize);
 
+/* Compiled form of an entry of an rpc-auth.addr allow or reject list. An
+ * address or a network in CIDR notation is matched against the peer address
+ * numerically. Anything else is an fnmatch pattern, matched against the
+ * address or host name string of the peer.
+ */
+typedef struct rpcsvc_addr_rule {
+        struct list_head        list;
+        int                     family;
+        union {
+                struct in_addr  in;
+                struct in6_addr in6;
+        } net;
+        int                     prefixlen;
+        char                    *pattern;
+} rpcsvc_addr_rule_t;
+
+/* The allow and reject lists of a volume, or the general ones when volname
+ * is NULL.
+ */
+typedef struct rpcsvc_addr_rules {
+        struct list_head        list;
+        char                    *volname;
+        /* The allow option as given, for the exports list. */
+        char                    *allowstr;
+        struct list_head        allow;
+        struct list_head        reject;
+} rpcsvc_addr_rules_t;
+
+typedef struct rpcsvc_addr_auth {
+        gf_boolean_t            namelookup;
+        rpcsvc_addr_rules_t     general;
+        /* Volume specific rules. */
+        struct list_head        exports;
+} rpcsvc_addr_auth_t;
+
 extern int
-nfs_rpcsvc_conn_peer_check (dict_t *options, char *volname,rpcsvc_conn_t *conn);
+nfs_rpcsvc_addr_auth_init (rpcsvc_t *svc, dict_t *options);
+
+extern int
+nfs_rpcsvc_addr_auth_reconf (rpcsvc_t *svc, dict_t *options);
+
+extern int
+nfs_rpcsvc_conn_peer_check (rpcsvc_t *svc, char *volname, rpcsvc_conn_t *conn);
 
 extern int
 nfs_rpcsvc_conn_privport_check (rpcsvc_t *svc, char *volname,
@@ -730,8 +843,75 @@ extern int
 nfs_rpcsvc_combine_gen_spec_volume_checks (int gen, int spec);
 
 extern char *
-nfs_rpcsvc_volume_allowed (dict_t *options, char *volname);
+nfs_rpcsvc_volume_allowed (rpcsvc_t *svc, char *volname);
 
 extern int
 nfs_rpcsvc_udp_program_register (rpcsvc_t *svc, rpcsvc_program_t program);
+
+/* Duplicate request cache.
+ *
+ * Calls to non-idempotent procedures are remembered by client address, XID,
+ * program, version, procedure and a checksum of the first
+ * RPCSVC_DRC_CSUMLEN bytes of their arguments. A retransmission of a call
+ * still being executed is dropped, one of a call already answered gets the
+ * same reply again. Once the cache holds its maximum number of entries,
+ * the least recently used answered entries are evicted to make room.
+ */
+#define RPCSVC_DRC_DEFAULT_SIZE 1024
+#define RPCSVC_DRC_BUCKETS      257
+#define RPCSVC_DRC_CSUMLEN      128
+
+/* Entry states */
+#define RPCSVC_DRC_INPROGRESS   1
+#define RPCSVC_DRC_DONE         2
+
+/* Lookup results */
+#define RPCSVC_DRC_NEW          0
+#define RPCSVC_DRC_DROP         1
+#define RPCSVC_DRC_REPLAY       2
+
+typedef struct rpcsvc_drc_entry {
+        struct list_head        hashlist;
+        struct list_head        lrulist;
+
+        struct sockaddr_storage addr;
+        socklen_t               addrlen;
+        gf_boolean_t            is_udp;
+        uint32_t                xid;
+        int                     prognum;
+        int                     progver;
+        int                     procnum;
+        uint32_t                csum;
+
+        int                     state;
+        /* The complete reply record, as handed to the transport. */
+        char                    *reply;
+        size_t                  replylen;
+} rpcsvc_drc_entry_t;
+
+typedef struct rpcsvc_drc {
+        pthread_mutex_t         drclock;
+        struct list_head        buckets[RPCSVC_DRC_BUCKETS];
+        /* Least recently used first. */
+        struct list_head        lru;
+        int                     count;
+        int                     size;
+
+        uint64_t                hits;
+        uint64_t                drops;
+        uint64_t                evictions;
+} rpcsvc_drc_t;
+
+extern int
+nfs_rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options);
+
+extern int
+nfs_rpcsvc_drc_lookup (rpcsvc_request_t *req, struct iovec *reply,
+                       struct iobuf **replyiob);
+
+extern void
+nfs_rpcsvc_drc_reply (rpcsvc_request_t *req, struct iovec *vector, int count);
+
+extern void
+nfs_rpcsvc_drc_forget (rpcsvc_request_t *req);
 #endif
@@ -742,7 +742,7 @@ mnt3_check_client_net (struct mount3_state *ms, rpcsvc_request_t *req,
                 return -1;
 
         svc = nfs_rpcsvc_request_service (req);
-        ret = nfs_rpcsvc_conn_peer_check (svc->options, targetxl->name,
+        ret = nfs_rpcsvc_conn_peer_check (svc, targetxl->name,
                                           nfs_rpcsvc_request_conn (req));
         if (ret == RPCSVC_AUTH_REJECT) {
                 gf_log (GF_MNT, GF_LOG_TRACE, "Peer not allowed");
@@ -1306,11 +1306,8 @@ mnt3_xlchildren_to_exports (rpcsvc_t *svc, struct mount3_state *ms)
 
                 strcpy (elist->ex_dir, ent->expname);
 
-                addrstr = nfs_rpcsvc_volume_allowed (svc->options,
-                                                     ent->vol->name);
-                if (addrstr)
-                        addrstr = gf_strdup (addrstr);
-                else
+                addrstr = nfs_rpcsvc_volume_allowed (svc, ent->vol->name);
+                if (!addrstr)
                         addrstr = gf_strdup ("No Access");
 
                 elist->ex_groups = GF_CALLOC (1, sizeof (struct groupnode),
@@ -39,6 +39,7 @@
 #include "mount3.h"
 #include "nfs3.h"
 #include "nfs-mem-types.h"
+#include "statedump.h"
 
 /* Every NFS version must call this function with the init function
  * for its particular version.
@@ -716,6 +717,29 @@ err:
 }
 
 
+/* Only the address authentication rules can change without a restart. */
+int
+reconfigure (xlator_t *this, dict_t *options)
+{
+        struct nfs_state        *nfs = NULL;
+        int                     ret = 0;
+
+        if ((!this) || (!options))
+                return -1;
+
+        nfs = (struct nfs_state *)this->private;
+        if ((!nfs) || (!nfs->rpcsvc))
+                return 0;
+
+        ret = nfs_rpcsvc_addr_auth_reconf (nfs->rpcsvc, options);
+        if (ret == -1)
+                gf_log (GF_NFS, GF_LOG_ERROR, "Failed to reconfigure address "
+                        "authentication rules");
+
+        return ret;
+}
+
+
 int
 notify (xlator_t *this, int32_t event, void *data, ...)
 {
@@ -758,8 +782,50 @@ fini (xlator_t *this)
         return 0;
 }
 
+int
+nfs_priv_dump (xlator_t *this)
+{
+        char                    key_prefix[GF_DUMP_MAX_BUF_LEN];
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+        struct nfs_state        *nfs = NULL;
+        rpcsvc_drc_t            *drc = NULL;
+
+        if ((!this) || (!this->private))
+                return -1;
+
+        nfs = (struct nfs_state *)this->private;
+        if ((!nfs->rpcsvc) || (!nfs->rpcsvc->drc))
+                return 0;
+
+        drc = nfs->rpcsvc->drc;
+        gf_proc_dump_add_section ("xlator.nfs.server.%s.priv", this->name);
+        gf_proc_dump_build_key (key_prefix, "xlator.nfs.server", "%s.priv",
+                                this->name);
+
+        pthread_mutex_lock (&drc->drclock);
+        {
+                gf_proc_dump_build_key (key, key_prefix, "drc.size");
+                gf_proc_dump_write (key, "%d", drc->size);
+                gf_proc_dump_build_key (key, key_prefix, "drc.entries");
+                gf_proc_dump_write (key, "%d", drc->count);
+                gf_proc_dump_build_key (key, key_prefix, "drc.hits");
+                gf_proc_dump_write (key, "%"PRIu64, drc->hits);
+                gf_proc_dump_build_key (key, key_prefix, "drc.drops");
+                gf_proc_dump_write (key, "%"PRIu64, drc->drops);
+                gf_proc_dump_build_key (key, key_prefix, "drc.evictions");
+                gf_proc_dump_write (key, "%"PRIu64, drc->evictions);
+        }
+        pthread_mutex_unlock (&drc->drclock);
+
+        return 0;
+}
+
+
 struct xlator_cbks cbks = { };
 struct xlator_fops fops = { };
+struct xlator_dumpops dumpops = {
+        .priv = nfs_priv_dump,
+};
 
 /* TODO: If needed, per-volume options below can be extended to be export
 + * specific also because after export-dir is introduced, a volume is not
@@ -970,6 +1036,31 @@ struct volume_options options[] = {
                          "portmap service. Use this option to turn off portmap "
                          "registration for Gluster NFS. On by default."
         },
+        { .key  = {"rpc.udp-listeners"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = 64,
+          .default_value = "1",
+          .description = "Number of sockets, each served by a thread of its "
+                         "own, over which the NFS programs receive requests "
+                         "sent over UDP."
+        },
+        { .key  = {"rpc.drc"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "on",
+          .description = "Keep the replies to non-idempotent requests, such "
+                         "as CREATE, REMOVE, RENAME and WRITE, so that "
+                         "retransmissions of those requests are answered "
+                         "again instead of being executed again. On by "
+                         "default."
+        },
+        { .key  = {"rpc.drc-size"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .default_value = "1024",
+          .description = "Number of requests whose replies are kept in the "
+                         "duplicate request cache."
+        },
         { .key  = {"nfs.port"},
           .type = GF_OPTION_TYPE_INT,
           .default_value = "",
@@ -1658,6 +1658,93 @@ nfs3_cached_inode_opened (xlator_t *nfsxl, inode_t *inode)
 }
 
 
+/* COMMIT only needs to fsync a file which has taken UNSTABLE writes since it
+ * was last committed. That is tracked in the second value of the inode
+ * context, the first one being used for the open state above:
+ *
+ * 0                    - there may be uncommitted data. This is also what
+ *                        every put of the first value alone leaves behind.
+ * GF_NFS3_COMMITTED    - all of the data has been committed.
+ * anything larger      - a COMMIT is flushing the file. Unless a write comes
+ *                        in before its fsync returns, the file is committed.
+ *
+ * Without an inode context, nothing is known and every COMMIT fsyncs.
+ */
+void
+nfs3_uncommitted_write (xlator_t *nfsxl, inode_t *inode)
+{
+        uint64_t        value1 = 0;
+
+        if ((!nfsxl) || (!inode))
+                return;
+
+        LOCK (&inode->lock);
+        {
+                if (__inode_ctx_get2 (inode, nfsxl, &value1, NULL) == 0)
+                        __inode_ctx_put2 (inode, nfsxl, value1, 0);
+        }
+        UNLOCK (&inode->lock);
+}
+
+
+/* Returns GF_NFS3_COMMITTED if there is nothing to commit. Otherwise, the
+ * file must be fsynced and the value returned handed to nfs3_commit_done
+ * once that succeeds.
+ */
+uint64_t
+nfs3_commit_begin (xlator_t *nfsxl, inode_t *inode)
+{
+        uint64_t        value1 = 0;
+        uint64_t        state = 0;
+        uint64_t        commitgen = 0;
+
+        if ((!nfsxl) || (!inode))
+                return 0;
+
+        LOCK (&inode->lock);
+        {
+                if (__inode_ctx_get2 (inode, nfsxl, &value1, &state) == -1)
+                        goto unlock;
+
+                if (state == GF_NFS3_COMMITTED) {
+                        commitgen = GF_NFS3_COMMITTED;
+                        goto unlock;
+                }
+
+                commitgen = (state > GF_NFS3_COMMITTED) ? state + 1
+                                                        : GF_NFS3_COMMITTED + 1;
+                __inode_ctx_put2 (inode, nfsxl, value1, commitgen);
+        }
+unlock:
+        UNLOCK (&inode->lock);
+
+        return commitgen;
+}
+
+
+void
+nfs3_commit_done (xlator_t *nfsxl, inode_t *inode, uint64_t commitgen)
+{
+        uint64_t        value1 = 0;
+        uint64_t        state = 0;
+
+        if ((!nfsxl) || (!inode) || (commitgen <= GF_NFS3_COMMITTED))
+                return;
+
+        LOCK (&inode->lock);
+        {
+                if (__inode_ctx_get2 (inode, nfsxl, &value1, &state) == -1)
+                        goto unlock;
+
+                if (state == commitgen)
+                        __inode_ctx_put2 (inode, nfsxl, value1,
+                                          GF_NFS3_COMMITTED);
+        }
+unlock:
+        UNLOCK (&inode->lock);
+}
+
+
 int32_t
 nfs3_dir_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                    int32_t op_ret, int32_t op_errno, fd_t *fd)
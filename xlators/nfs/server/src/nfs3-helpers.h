@@ -34,6 +34,8 @@
 #include <sys/statvfs.h>
 
 #define GF_NFS3_FD_CACHED       0xcaced
+/* Second inode context value once all UNSTABLE writes have been committed. */
+#define GF_NFS3_COMMITTED       1
 
 extern struct nfs3_fh
 nfs3_extract_lookup_fh (lookup3args *args);
@@ -254,6 +256,15 @@ nfs3_fill_pathconf3res (pathconf3res *res, nfsstat3 stat, struct iatt *buf,
 extern int
 nfs3_cached_inode_opened (xlator_t *nfsxl, inode_t *inode);
 
+extern void
+nfs3_uncommitted_write (xlator_t *nfsxl, inode_t *inode);
+
+extern uint64_t
+nfs3_commit_begin (xlator_t *nfsxl, inode_t *inode);
+
+extern void
+nfs3_commit_done (xlator_t *nfsxl, inode_t *inode, uint64_t commitgen);
+
 extern void
 nfs3_log_common_res (uint32_t xid, char *op, nfsstat3 stat, int pstat);
 
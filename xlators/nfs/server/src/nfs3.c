@@ -1941,6 +1941,9 @@ err:
  *| COMMIT      ||    fsync     | getattr      |
  *+============================================+
  *
+ * Without either option, UNSTABLE writes are returned UNSTABLE and the
+ * COMMIT fsyncs the file only if it has taken UNSTABLE writes since it was
+ * last committed.
  *
  */
 int32_t
@@ -1971,6 +1974,9 @@ nfs3svc_write_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         sync_trusted = nfs3_export_sync_trusted (cs->nfs3state,
                                                  cs->resolvefh.exportid);
         ret = nfs3_write_how (&cs->writetype, write_trusted, sync_trusted);
+        /* Acknowledged without a sync, so the next COMMIT has to fsync. */
+        if (cs->writetype == UNSTABLE)
+                nfs3_uncommitted_write (cs->nfsx, cs->fd->inode);
         if (ret == -1)
                 goto err;
 
@@ -4806,6 +4812,9 @@ nfs3svc_commit_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         else
                 stat = NFS3_OK;
 
+        if (op_ret != -1)
+                nfs3_commit_done (cs->nfsx, cs->fd->inode, cs->commitgen);
+
         nfs3 = nfs_rpcsvc_request_program_private (cs->req);
         nfs3_log_commit_res (nfs_rpcsvc_request_xid (cs->req), stat, op_errno,
                              nfs3->serverstart);
@@ -4835,6 +4844,14 @@ nfs3_commit_resume (void *carg)
                 goto nfs3err;
         }
 
+        cs->commitgen = nfs3_commit_begin (cs->nfsx, cs->fd->inode);
+        if (cs->commitgen == GF_NFS3_COMMITTED) {
+                gf_log (GF_NFS3, GF_LOG_TRACE, "Nothing to commit");
+                ret = -1;
+                stat = NFS3_OK;
+                goto nfs3err;
+        }
+
         nfs_request_user_init (&nfu, cs->req);
         ret = nfs_fsync (cs->nfsx, cs->vol, &nfu, cs->fd, 0,
                          nfs3svc_commit_cbk, cs);
@@ -4960,20 +4977,20 @@ rpcerr:
 rpcsvc_actor_t          nfs3svc_actors[NFS3_PROC_COUNT] = {
         {"NULL",        NFS3_NULL,      nfs3svc_null,   NULL,   NULL},
         {"GETATTR",     NFS3_GETATTR,   nfs3svc_getattr,NULL,   NULL},
-        {"SETATTR",     NFS3_SETATTR,   nfs3svc_setattr,NULL,   NULL},
+        {"SETATTR",     NFS3_SETATTR,   nfs3svc_setattr,NULL,   NULL, 1},
         {"LOOKUP",      NFS3_LOOKUP,    nfs3svc_lookup, NULL,   NULL},
         {"ACCESS",      NFS3_ACCESS,    nfs3svc_access, NULL,   NULL},
         {"READLINK",    NFS3_READLINK,  nfs3svc_readlink,NULL,  NULL},
         {"READ",        NFS3_READ,      nfs3svc_read,   NULL,   NULL},
-        {"WRITE", NFS3_WRITE, nfs3svc_write, nfs3svc_write_vec, nfs3svc_write_vecsizer},
-        {"CREATE",      NFS3_CREATE,    nfs3svc_create, NULL,   NULL},
-        {"MKDIR",       NFS3_MKDIR,     nfs3svc_mkdir,  NULL,   NULL},
-        {"SYMLINK",     NFS3_SYMLINK,   nfs3svc_symlink,NULL,   NULL},
-        {"MKNOD",       NFS3_MKNOD,     nfs3svc_mknod,  NULL,   NULL},
-        {"REMOVE",      NFS3_REMOVE,    nfs3svc_remove, NULL,   NULL},
-        {"RMDIR",       NFS3_RMDIR,     nfs3svc_rmdir,  NULL,   NULL},
-        {"RENAME",      NFS3_RENAME,    nfs3svc_rename, NULL,   NULL},
-        {"LINK",        NFS3_LINK,      nfs3svc_link,   NULL,   NULL},
+        {"WRITE", NFS3_WRITE, nfs3svc_write, nfs3svc_write_vec, nfs3svc_write_vecsizer, 1},
+        {"CREATE",      NFS3_CREATE,    nfs3svc_create, NULL,   NULL, 1},
+        {"MKDIR",       NFS3_MKDIR,     nfs3svc_mkdir,  NULL,   NULL, 1},
+        {"SYMLINK",     NFS3_SYMLINK,   nfs3svc_symlink,NULL,   NULL, 1},
+        {"MKNOD",       NFS3_MKNOD,     nfs3svc_mknod,  NULL,   NULL, 1},
+        {"REMOVE",      NFS3_REMOVE,    nfs3svc_remove, NULL,   NULL, 1},
+        {"RMDIR",       NFS3_RMDIR,     nfs3svc_rmdir,  NULL,   NULL, 1},
+        {"RENAME",      NFS3_RENAME,    nfs3svc_rename, NULL,   NULL, 1},
+        {"LINK",        NFS3_LINK,      nfs3svc_link,   NULL,   NULL, 1},
         {"READDIR",     NFS3_READDIR,   nfs3svc_readdir,NULL,   NULL},
         {"READDIRPLUS", NFS3_READDIRP,  nfs3svc_readdirp,NULL,  NULL},
         {"FSSTAT",      NFS3_FSSTAT,    nfs3svc_fsstat, NULL,   NULL},
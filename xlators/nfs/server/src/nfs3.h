@@ -193,6 +193,7 @@ struct nfs3_local {
         cookie3                 cookie;
         struct iovec            datavec;
         mode_t                  mode;
+        uint64_t                commitgen;
 
         /* NFSv3 FH resolver state */
         struct nfs3_fh          resolvefh;
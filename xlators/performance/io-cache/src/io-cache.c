@@ -52,43 +52,6 @@ ioc_hashfn (void *data, int len)
         return (offset >> ioc_log2_page_size);
 }
 
-inline ioc_inode_t *
-ioc_inode_reupdate (ioc_inode_t *ioc_inode)
-{
-        ioc_table_t *table = NULL;
-
-        table = ioc_inode->table;
-
-        list_add_tail (&ioc_inode->inode_lru,
-                       &table->inode_lru[ioc_inode->weight]);
-
-        return ioc_inode;
-}
-
-inline ioc_inode_t *
-ioc_get_inode (dict_t *dict, char *name)
-{
-        ioc_inode_t *ioc_inode      = NULL;
-        data_t      *ioc_inode_data = NULL;
-        ioc_table_t *table          = NULL;
-
-        ioc_inode_data = dict_get (dict, name);
-        if (ioc_inode_data) {
-                ioc_inode = data_to_ptr (ioc_inode_data);
-                table = ioc_inode->table;
-
-                ioc_table_lock (table);
-                {
-                        if (list_empty (&ioc_inode->inode_lru)) {
-                                ioc_inode = ioc_inode_reupdate (ioc_inode);
-                        }
-                }
-                ioc_table_unlock (table);
-        }
-
-        return ioc_inode;
-}
-
 int32_t
 ioc_inode_need_revalidate (ioc_inode_t *ioc_inode)
 {
@@ -134,22 +97,12 @@ __ioc_inode_flush (ioc_inode_t *ioc_inode)
 void
 ioc_inode_flush (ioc_inode_t *ioc_inode)
 {
-        int64_t destroy_size = 0;
-
         ioc_inode_lock (ioc_inode);
         {
-                destroy_size = __ioc_inode_flush (ioc_inode);
+                __ioc_inode_flush (ioc_inode);
         }
         ioc_inode_unlock (ioc_inode);
 
-        if (destroy_size) {
-                ioc_table_lock (ioc_inode->table);
-                {
-                        ioc_inode->table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (ioc_inode->table);
-        }
-
         return;
 }
 
@@ -190,7 +143,7 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         ioc_table_t *table             = NULL;
         uint8_t      cache_still_valid = 0;
         uint64_t     tmp_ioc_inode     = 0;
-        uint32_t     weight            = 0xffffffff;
+        uint32_t     weight            = 1;
         const char  *path              = NULL;
         ioc_local_t *local             = NULL;
 
@@ -214,14 +167,19 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         path = local->file_loc.path;
 
+        /* resolve the priority before taking the inode lock, matching
+         * patterns must not be done under a spinlock. Inodes already
+         * carrying a context do not need it. */
+        inode_ctx_get (inode, this, &tmp_ioc_inode);
+        if (!tmp_ioc_inode)
+                weight = ioc_get_priority (table, path);
+
         LOCK (&inode->lock);
         {
                 __inode_ctx_get (inode, this, &tmp_ioc_inode);
                 ioc_inode = (ioc_inode_t *)(long)tmp_ioc_inode;
 
                 if (!ioc_inode) {
-                        weight = ioc_get_priority (table, path);
-
                         ioc_inode = ioc_inode_update (table, inode,
                                                       weight);
 
@@ -249,13 +207,6 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 ioc_inode_flush (ioc_inode);
         }
 
-        ioc_table_lock (ioc_inode->table);
-        {
-                list_move_tail (&ioc_inode->inode_lru,
-                                &table->inode_lru[ioc_inode->weight]);
-        }
-        ioc_table_unlock (ioc_inode->table);
-
 out:
         if (frame->local != NULL) {
                 local = frame->local;
@@ -342,7 +293,6 @@ ioc_cache_validate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 {
         ioc_local_t *local        = NULL;
         ioc_inode_t *ioc_inode    = NULL;
-        size_t       destroy_size = 0;
         struct iatt *local_stbuf  = NULL;
 
         local = frame->local;
@@ -360,7 +310,7 @@ ioc_cache_validate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                  */
                 ioc_inode_lock (ioc_inode);
                 {
-                        destroy_size = __ioc_inode_flush (ioc_inode);
+                        __ioc_inode_flush (ioc_inode);
                         if (op_ret >= 0) {
                                 ioc_inode->cache.mtime = stbuf->ia_mtime;
                                 ioc_inode->cache.mtime_nsec
@@ -371,14 +321,6 @@ ioc_cache_validate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 local_stbuf = NULL;
         }
 
-        if (destroy_size) {
-                ioc_table_lock (ioc_inode->table);
-                {
-                        ioc_inode->table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (ioc_inode->table);
-        }
-
         if (op_ret < 0)
                 local_stbuf = NULL;
 
@@ -488,30 +430,66 @@ out:
         return ret;
 }
 
-inline uint32_t
-is_match (const char *path, const char *pattern)
+static inline uint32_t
+is_match (const char *path, struct ioc_priority *curr)
 {
-        int32_t ret = 0;
+        size_t  path_len = 0;
+        int32_t ret      = 0;
+
+        switch (curr->type) {
+        case IOC_PATTERN_ANY:
+                return 1;
+
+        case IOC_PATTERN_EXACT:
+                return (strcmp (path, curr->literal) == 0);
+
+        case IOC_PATTERN_PREFIX:
+                return (strncmp (path, curr->literal, curr->literal_len) == 0);
+
+        case IOC_PATTERN_SUFFIX:
+                path_len = strlen (path);
+                if (path_len < curr->literal_len)
+                        return 0;
 
-        ret = fnmatch (pattern, path, FNM_NOESCAPE);
+                return (memcmp (path + path_len - curr->literal_len,
+                                curr->literal, curr->literal_len) == 0);
 
-        return (ret == 0);
+        default:
+                ret = fnmatch (curr->pattern, path, FNM_NOESCAPE);
+                return (ret == 0);
+        }
 }
 
+/*
+ * ioc_get_priority - priority of the last configured pattern matching @path
+ *
+ * priority_list is kept with the last configured pattern first, so the
+ * first match is the one that counts.
+ */
 uint32_t
 ioc_get_priority (ioc_table_t *table, const char *path)
 {
         uint32_t             priority = 1;
         struct ioc_priority *curr     = NULL;
 
-        if (list_empty(&table->priority_list))
-                return priority;
+        ioc_table_lock (table);
+        {
+                if (list_empty (&table->priority_list))
+                        goto unlock;
+
+                priority = 0;
+                if (path == NULL)
+                        goto unlock;
 
-        priority = 0;
-        list_for_each_entry (curr, &table->priority_list, list) {
-                if (is_match (path, curr->pattern))
-                        priority = curr->priority;
+                list_for_each_entry (curr, &table->priority_list, list) {
+                        if (is_match (path, curr)) {
+                                priority = curr->priority;
+                                break;
+                        }
+                }
         }
+unlock:
+        ioc_table_unlock (table);
 
         return priority;
 }
@@ -550,13 +528,6 @@ ioc_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                 inode_ctx_get (fd->inode, this, &tmp_ioc_inode);
                 ioc_inode = (ioc_inode_t *)(long)tmp_ioc_inode;
 
-                ioc_table_lock (ioc_inode->table);
-                {
-                        list_move_tail (&ioc_inode->inode_lru,
-                                        &table->inode_lru[ioc_inode->weight]);
-                }
-                ioc_table_unlock (ioc_inode->table);
-
                 ioc_inode_lock (ioc_inode);
                 {
                         if ((table->min_file_size > ioc_inode->ia_size)
@@ -889,15 +860,7 @@ ioc_readv_disabled_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 int32_t
 ioc_need_prune (ioc_table_t *table)
 {
-        int64_t cache_difference = 0;
-
-        ioc_table_lock (table);
-        {
-                cache_difference = table->cache_used - table->cache_size;
-        }
-        ioc_table_unlock (table);
-
-        if (cache_difference > 0)
+        if (ioc_cache_used (table) > table->cache_size)
                 return 1;
         else
                 return 0;
@@ -1078,9 +1041,7 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
         uint64_t     tmp_ioc_inode = 0;
         ioc_inode_t *ioc_inode     = NULL;
         ioc_local_t *local         = NULL;
-        uint32_t     weight        = 0;
         ioc_table_t *table         = NULL;
-        uint32_t     num_pages     = 0;
         int32_t      op_errno      = -1;
 
         if (!this) {
@@ -1108,28 +1069,6 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
         }
 
 
-        ioc_table_lock (table);
-        {
-                if (!table->mem_pool) {
-
-                        num_pages = (table->cache_size / table->page_size)
-                                + ((table->cache_size % table->page_size)
-                                   ? 1 : 0);
-
-                        table->mem_pool
-                                =  mem_pool_new (rbthash_entry_t, num_pages);
-
-                        if (!table->mem_pool) {
-                                gf_log (this->name, GF_LOG_ERROR,
-                                        "Unable to allocate mem_pool");
-                                op_errno = ENOMEM;
-                                ioc_table_unlock (table);
-                                goto out;
-                        }
-                }
-        }
-        ioc_table_unlock (table);
-
         ioc_inode_lock (ioc_inode);
         {
                 if (!ioc_inode->cache.page_table) {
@@ -1178,15 +1117,6 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 "NEW REQ (%p) offset = %"PRId64" && size = %"GF_PRI_SIZET"",
                 frame, offset, size);
 
-        weight = ioc_inode->weight;
-
-        ioc_table_lock (ioc_inode->table);
-        {
-                list_move_tail (&ioc_inode->inode_lru,
-                                &ioc_inode->table->inode_lru[weight]);
-        }
-        ioc_table_unlock (ioc_inode->table);
-
         ioc_dispatch_requests (frame, ioc_inode, fd, offset, size);
         return 0;
 
@@ -1395,6 +1325,50 @@ ioc_lk (call_frame_t *frame, xlator_t *this, fd_t *fd, int32_t cmd,
         return 0;
 }
 
+/*
+ * ioc_compile_pattern - classify a priority pattern so that the common
+ *                       shapes can be matched without fnmatch
+ */
+static void
+ioc_compile_pattern (struct ioc_priority *curr)
+{
+        char   *pattern = NULL;
+        size_t  len     = 0;
+
+        pattern = curr->pattern;
+        len = strlen (pattern);
+
+        curr->type = IOC_PATTERN_GLOB;
+        curr->literal = pattern;
+        curr->literal_len = len;
+
+        if (strcmp (pattern, "*") == 0) {
+                curr->type = IOC_PATTERN_ANY;
+        } else if (!strpbrk (pattern, "*?[\\")) {
+                curr->type = IOC_PATTERN_EXACT;
+        } else if ((pattern[0] == '*') && !strpbrk (pattern + 1, "*?[\\")) {
+                curr->type = IOC_PATTERN_SUFFIX;
+                curr->literal = pattern + 1;
+                curr->literal_len = len - 1;
+        } else if ((pattern[len - 1] == '*')
+                   && (strcspn (pattern, "*?[\\") == len - 1)) {
+                curr->type = IOC_PATTERN_PREFIX;
+                curr->literal_len = len - 1;
+        }
+}
+
+void
+ioc_free_priority_list (struct list_head *first)
+{
+        struct ioc_priority *curr = NULL, *tmp = NULL;
+
+        list_for_each_entry_safe (curr, tmp, first, list) {
+                list_del_init (&curr->list);
+                GF_FREE (curr->pattern);
+                GF_FREE (curr);
+        }
+}
+
 int32_t
 ioc_get_priority_list (const char *opt_str, struct list_head *first)
 {
@@ -1407,7 +1381,7 @@ ioc_get_priority_list (const char *opt_str, struct list_head *first)
         char                *pattern    = NULL;
         char                *priority   = NULL;
         char                *string     = NULL;
-        struct ioc_priority *curr       = NULL, *tmp = NULL;
+        struct ioc_priority *curr       = NULL;
 
         string = gf_strdup (opt_str);
         if (string == NULL) {
@@ -1417,9 +1391,7 @@ ioc_get_priority_list (const char *opt_str, struct list_head *first)
 
         /* Get the pattern for cache priority.
          * "option priority *.jpg:1,abc*:2" etc
-         */
-        /* TODO: inode_lru in table is statically hard-coded to 5,
-         * should be changed to run-time configuration
+         * later patterns override earlier ones, so they are put first.
          */
         stripe_str = strtok_r (string, ",", &tmp_str);
         while (stripe_str) {
@@ -1430,7 +1402,7 @@ ioc_get_priority_list (const char *opt_str, struct list_head *first)
                         goto out;
                 }
 
-                list_add_tail (&curr->list, first);
+                list_add (&curr->list, first);
 
                 dup_str = gf_strdup (stripe_str);
                 if (dup_str == NULL) {
@@ -1461,6 +1433,8 @@ ioc_get_priority_list (const char *opt_str, struct list_head *first)
                         goto out;
                 }
 
+                ioc_compile_pattern (curr);
+
                 curr->priority = strtol (priority, &tmp_str2, 0);
                 if (tmp_str2 && (*tmp_str2)) {
                         max_pri = -1;
@@ -1484,11 +1458,7 @@ out:
         }
 
         if (max_pri == -1) {
-                list_for_each_entry_safe (curr, tmp, first, list) {
-                        list_del_init (&curr->list);
-                        GF_FREE (curr->pattern);
-                        GF_FREE (curr);
-                }
+                ioc_free_priority_list (first);
         }
 
         return max_pri;
@@ -1569,7 +1539,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                 gf_log (this->name, GF_LOG_WARNING,
                                         "cache-timeout %d seconds invalid,"
                                         " has to be  >=0", cache_timeout);
-                                goto out;
+                                goto unlock;
                         }
 
 
@@ -1577,7 +1547,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                 gf_log (this->name, GF_LOG_WARNING,
                                         "cache-timeout %d seconds invalid,"
                                         " has to be  <=60", cache_timeout);
-                                goto out;
+                                goto unlock;
                         }
 
                         table->cache_timeout = cache_timeout;
@@ -1601,7 +1571,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                         "invalid number format \"%s\" of "
                                         "\"option cache-size\" Defaulting"
                                         "to old value", cache_size_string);
-                                goto out;
+                                goto unlock;
                         }
 
                         if (cache_size < (4 * GF_UNIT_MB)) {
@@ -1611,7 +1581,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                        "Max value can be 4MiB, Defaulting to "
                                        "old value (%"PRIu64")",
                                        cache_size_string, table->cache_size);
-                                goto out;
+                                goto unlock;
                         }
 
                         if (cache_size > (6 * GF_UNIT_GB)) {
@@ -1621,7 +1591,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                         "Max value can be 6GiB, Defaulting to "
                                         "old value (%"PRIu64")",
                                         cache_size_string, table->cache_size);
-                                goto out;
+                                goto unlock;
                         }
 
 
@@ -1636,17 +1606,39 @@ reconfigure (xlator_t *this, dict_t *options)
                 if (dict_get (options, "priority")) {
                         char *option_list = data_to_str (dict_get (options,
                                                                    "priority"));
+                        struct list_head     priority_list;
+                        struct ioc_priority *curr    = NULL;
+                        int32_t              max_pri = 0;
+
                         gf_log (this->name, GF_LOG_TRACE,
                                 "option path %s", option_list);
-                        /* parse the list of pattern:priority */
-                        table->max_pri = ioc_get_priority_list (option_list,
-                                                                &table->priority_list);
 
-                        if (table->max_pri == -1) {
+                        INIT_LIST_HEAD (&priority_list);
+                        /* parse the list of pattern:priority */
+                        max_pri = ioc_get_priority_list (option_list,
+                                                         &priority_list);
+                        if (max_pri == -1) {
                                 ret = -1;
-                                goto out;
+                                goto unlock;
                         }
-                        table->max_pri ++;
+
+                        /* the shard queues were sized at init */
+                        list_for_each_entry (curr, &priority_list, list) {
+                                if (curr->priority < table->max_pri)
+                                        continue;
+
+                                gf_log (this->name, GF_LOG_WARNING,
+                                        "priority %u of pattern %s is above "
+                                        "the highest priority configured at "
+                                        "start (%d), lowering it",
+                                        curr->priority, curr->pattern,
+                                        table->max_pri - 1);
+                                curr->priority = table->max_pri - 1;
+                        }
+
+                        ioc_free_priority_list (&table->priority_list);
+                        list_splice_init (&priority_list,
+                                          &table->priority_list);
                 }
 
 
@@ -1661,7 +1653,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                         "invalid number format \"%s\" of "
                                         "\"option min-file-size\"", tmp);
                                 ret = -1;
-                                goto out;
+                                goto unlock;
                         }
 
                         gf_log (this->name, GF_LOG_DEBUG,
@@ -1679,7 +1671,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                         "invalid number format \"%s\" of "
                                         "\"option max-file-size\"", tmp);
                                 ret = -1;
-                                goto out;
+                                goto unlock;
                         }
 
 
@@ -1694,7 +1686,7 @@ reconfigure (xlator_t *this, dict_t *options)
                                 "greater than maximum size (%"PRIu64"). "
                                 "Hence Defaulting to old value",
                                 table->min_file_size, table->max_file_size);
-                        goto out;
+                        goto unlock;
                 }
 
                 table->min_file_size = min_file_size;
@@ -1704,7 +1696,7 @@ reconfigure (xlator_t *this, dict_t *options)
                 if (data_to_str (dict_get (options, "max-file-size")))
                         table->max_file_size = 0;
         }
-
+unlock:
         ioc_table_unlock (table);
 out:
         return ret;
@@ -1721,7 +1713,7 @@ init (xlator_t *this)
 {
         ioc_table_t     *table             = NULL;
         dict_t          *xl_options        = this->options;
-        uint32_t         index             = 0;
+        uint32_t         num_pages         = 0;
         char            *cache_size_string = NULL, *tmp = NULL;
         int32_t          ret               = -1;
         glusterfs_ctx_t *ctx               = NULL;
@@ -1748,6 +1740,7 @@ init (xlator_t *this)
                 goto out;
         }
 
+        INIT_LIST_HEAD (&table->priority_list);
         table->xl = this;
         table->page_size = this->ctx->page_size;
         table->cache_size = IOC_CACHE_SIZE;
@@ -1809,7 +1802,6 @@ init (xlator_t *this)
                         table->cache_timeout);
         }
 
-        INIT_LIST_HEAD (&table->priority_list);
         table->max_pri = 1;
         data = dict_get (xl_options, "priority");
         if (data) {
@@ -1895,8 +1887,6 @@ init (xlator_t *this)
                 gf_log (this->name, GF_LOG_TRACE,
                         "using max-file-size %"PRIu64"", table->max_file_size);
         }
-        INIT_LIST_HEAD (&table->inodes);
-
         if ((table->max_file_size >= 0)
             && (table->min_file_size > table->max_file_size)) {
                 gf_log ("io-cache", GF_LOG_ERROR, "minimum size (%"
@@ -1906,15 +1896,21 @@ init (xlator_t *this)
                 goto out;
         }
 
-        table->inode_lru = GF_CALLOC (table->max_pri,
-                                      sizeof (struct list_head),
-                                      gf_ioc_mt_list_head);
-        if (table->inode_lru == NULL) {
+        if (ioc_shards_init (table) != 0) {
+                gf_log (this->name, GF_LOG_ERROR, "out of memory");
                 goto out;
         }
 
-        for (index = 0; index < (table->max_pri); index++)
-                INIT_LIST_HEAD (&table->inode_lru[index]);
+        num_pages = (table->cache_size / table->page_size)
+                + ((table->cache_size % table->page_size) ? 1 : 0);
+
+        table->mem_pool = mem_pool_new (rbthash_entry_t, num_pages);
+        if (!table->mem_pool) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "Unable to allocate mem_pool");
+                ioc_shards_fini (table);
+                goto out;
+        }
 
         pthread_mutex_init (&table->table_lock, NULL);
         this->private = table;
@@ -1926,7 +1922,7 @@ init (xlator_t *this)
 out:
         if (ret == -1) {
                 if (table != NULL) {
-                        GF_FREE (table->inode_lru);
+                        ioc_free_priority_list (&table->priority_list);
                         GF_FREE (table);
                 }
         }
@@ -1938,6 +1934,9 @@ int
 ioc_priv_dump (xlator_t *this)
 {
         ioc_table_t *priv                            = NULL;
+        ioc_shard_t *shard                           = NULL;
+        uint32_t     inode_count                     = 0;
+        int          i                               = 0;
         char         key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
         char         key[GF_DUMP_MAX_BUF_LEN]        = {0, };
 
@@ -1954,9 +1953,50 @@ ioc_priv_dump (xlator_t *this)
         gf_proc_dump_build_key (key, key_prefix, "cache_size");
         gf_proc_dump_write (key, "%ld", priv->cache_size);
         gf_proc_dump_build_key (key, key_prefix, "cache_used");
-        gf_proc_dump_write (key, "%ld", priv->cache_used);
+        gf_proc_dump_write (key, "%ld", ioc_cache_used (priv));
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &priv->shards[i];
+
+                ioc_shard_lock (shard);
+                {
+                        inode_count += shard->inode_count;
+
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].cache_used", i);
+                        gf_proc_dump_write (key, "%"PRIu64, shard->cache_used);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].probation_used", i);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            shard->probation_used);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].inode_count", i);
+                        gf_proc_dump_write (key, "%u", shard->inode_count);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].hits", i);
+                        gf_proc_dump_write (key, "%"PRIu64, shard->hits);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].misses", i);
+                        gf_proc_dump_write (key, "%"PRIu64, shard->misses);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].hit_ratio", i);
+                        gf_proc_dump_write (key, "%.2f%%",
+                                            (shard->hits + shard->misses)
+                                            ? (100.0 * shard->hits
+                                               / (shard->hits + shard->misses))
+                                            : 0.0);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].ghost_hits", i);
+                        gf_proc_dump_write (key, "%"PRIu64, shard->ghost_hits);
+                        gf_proc_dump_build_key (key, key_prefix,
+                                                "shard[%d].evictions", i);
+                        gf_proc_dump_write (key, "%"PRIu64, shard->evictions);
+                }
+                ioc_shard_unlock (shard);
+        }
+
         gf_proc_dump_build_key (key, key_prefix, "inode_count");
-        gf_proc_dump_write (key, "%u", priv->inode_count);
+        gf_proc_dump_write (key, "%u", inode_count);
 
 out:
         return 0;
@@ -1983,6 +2023,8 @@ fini (xlator_t *this)
                 table->mem_pool = NULL;
         }
 
+        ioc_shards_fini (table);
+        ioc_free_priority_list (&table->priority_list);
         pthread_mutex_destroy (&table->table_lock);
         GF_FREE (table);
 
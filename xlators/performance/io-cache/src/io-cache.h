@@ -43,17 +43,54 @@
 #define IOC_CACHE_SIZE   (32 * 1024 * 1024)
 #define IOC_PAGE_TABLE_BUCKET_COUNT 1
 
+/* number of independently locked shards the cache is split into, inodes are
+ * assigned to a shard by hashing the inode */
+#define IOC_SHARD_COUNT            16
+#define IOC_GHOST_BUCKET_COUNT     64
+/* share of a shard's fair size that newly faulted pages may hold before
+ * they are evicted ahead of re-referenced ones (2Q "Kin") */
+#define IOC_PROBATION_PERCENT      25
+
 struct ioc_table;
 struct ioc_local;
 struct ioc_page;
 struct ioc_inode;
 
+/*
+ * priority patterns are classified once, when the option is parsed, so that
+ * the common shapes ("*.jpg", "abc*", exact names) are matched with a
+ * string compare instead of fnmatch.
+ */
+typedef enum {
+        IOC_PATTERN_GLOB,
+        IOC_PATTERN_EXACT,
+        IOC_PATTERN_PREFIX,
+        IOC_PATTERN_SUFFIX,
+        IOC_PATTERN_ANY,
+} ioc_pattern_type_t;
+
 struct ioc_priority {
-        struct list_head list;
-        char             *pattern;
-        uint32_t         priority;
+        struct list_head   list;
+        char               *pattern;
+        uint32_t           priority;
+        ioc_pattern_type_t type;
+        char               *literal; /* points into pattern */
+        size_t             literal_len;
 };
 
+/*
+ * page replacement follows 2Q: a page enters the probation queue (A1in)
+ * when it is faulted in and stays there no matter how often it is read,
+ * so a sequential scan only ever cycles through probation. a page is
+ * moved to the protected queue (Am) only if it is faulted in again while
+ * its key is still remembered in the shard's ghost list (A1out).
+ */
+typedef enum {
+        IOC_QUEUE_NONE,
+        IOC_QUEUE_PROBATION,
+        IOC_QUEUE_PROTECTED,
+} ioc_queue_t;
+
 /*
  * ioc_waitq - this structure is used to represents the waiting
  *             frames on a page
@@ -115,6 +152,9 @@ struct ioc_local {
  */
 struct ioc_page {
         struct list_head    page_lru;
+        struct list_head    shard_lru; /* probation or protected queue */
+        ioc_queue_t         queue;
+        size_t              cached_size; /* bytes charged to the shard */
         struct ioc_inode    *inode;   /* inode this page belongs to */
         struct ioc_priority *priority;
         char                dirty;
@@ -142,15 +182,44 @@ struct ioc_cache {
                                         */
 };
 
+/*
+ * ioc_ghost - key of a page recently evicted from probation. the inode
+ *             pointer is only compared, never dereferenced, so a stale
+ *             entry can at worst promote an unrelated page.
+ */
+struct ioc_ghost {
+        struct list_head  hash;
+        struct list_head  fifo;
+        struct ioc_inode *inode;
+        off_t             offset;
+};
+
+struct ioc_shard {
+        pthread_mutex_t   shard_lock;
+        struct list_head  inodes;     /* list of inodes in this shard */
+        uint32_t          inode_count;
+        uint64_t          cache_used;
+        uint64_t          probation_used;
+        struct list_head *probation;  /* one queue per priority */
+        struct list_head *protected;  /* one queue per priority */
+        struct list_head  ghost_hash[IOC_GHOST_BUCKET_COUNT];
+        struct list_head  ghost_fifo;
+        uint32_t          ghost_count;
+        uint64_t          hits;
+        uint64_t          misses;
+        uint64_t          ghost_hits;
+        uint64_t          evictions;
+};
+
 struct ioc_inode {
         struct ioc_table      *table;
+        struct ioc_shard      *shard;
         off_t                  ia_size;
         struct ioc_cache       cache;
         struct list_head       inode_list; /*
                                             * list of inodes, maintained by
                                             * io-cache translator
                                             */
-        struct list_head       inode_lru;
         struct ioc_waitq      *waitq;
         pthread_mutex_t        inode_lock;
         uint32_t               weight;      /*
@@ -162,20 +231,18 @@ struct ioc_inode {
 struct ioc_table {
         uint64_t         page_size;
         uint64_t         cache_size;
-        uint64_t         cache_used;
         int64_t          min_file_size;
         int64_t          max_file_size;
-        struct list_head inodes; /* list of inodes cached */
         struct list_head active;
-        struct list_head *inode_lru;
-        struct list_head priority_list;
+        struct list_head priority_list; /* last configured pattern first */
         int32_t          readv_count;
         pthread_mutex_t  table_lock;
         xlator_t         *xl;
-        uint32_t         inode_count;
         int32_t          cache_timeout;
         int32_t          max_pri;
         struct mem_pool  *mem_pool;
+        struct ioc_shard shards[IOC_SHARD_COUNT];
+        uint32_t         prune_cursor;
 };
 
 typedef struct ioc_table ioc_table_t;
@@ -184,6 +251,8 @@ typedef struct ioc_page ioc_page_t;
 typedef struct ioc_inode ioc_inode_t;
 typedef struct ioc_waitq ioc_waitq_t;
 typedef struct ioc_fill ioc_fill_t;
+typedef struct ioc_shard ioc_shard_t;
+typedef struct ioc_ghost ioc_ghost_t;
 
 void *
 str_to_ptr (char *string);
@@ -200,6 +269,12 @@ ioc_readv_disabled_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 ioc_page_t *
 __ioc_page_get (ioc_inode_t *ioc_inode, off_t offset);
 
+ioc_page_t *
+__ioc_page_lookup (ioc_inode_t *ioc_inode, off_t offset);
+
+void
+__ioc_page_charge (ioc_page_t *page, size_t size);
+
 ioc_page_t *
 __ioc_page_create (ioc_inode_t *ioc_inode, off_t offset);
 
@@ -261,6 +336,18 @@ ioc_frame_fill (ioc_page_t *page, call_frame_t *frame, off_t offset,
         } while (0)
 
 
+#define ioc_shard_lock(shard)                                   \
+        do {                                                    \
+                pthread_mutex_lock (&shard->shard_lock);        \
+        } while (0)
+
+
+#define ioc_shard_unlock(shard)                                 \
+        do {                                                    \
+                pthread_mutex_unlock (&shard->shard_lock);      \
+        } while (0)
+
+
 #define ioc_local_lock(local)                                           \
         do {                                                            \
                 gf_log (local->inode->table->xl->name, GF_LOG_TRACE,    \
@@ -336,6 +423,15 @@ ioc_prune (ioc_table_t *table);
 int32_t
 ioc_need_prune (ioc_table_t *table);
 
+uint64_t
+ioc_cache_used (ioc_table_t *table);
+
+int32_t
+ioc_shards_init (ioc_table_t *table);
+
+void
+ioc_shards_fini (ioc_table_t *table);
+
 inline uint32_t
 ioc_hashfn (void *data, int len);
 #endif /* __IO_CACHE_H */
@@ -184,6 +184,7 @@ ioc_inode_t *
 ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
 {
         ioc_inode_t     *ioc_inode   = NULL;
+        ioc_shard_t     *shard       = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", table, out);
 
@@ -192,22 +193,25 @@ ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
                 goto out;
         }
 
+        shard = &table->shards[((unsigned long)inode / sizeof (*inode))
+                               % IOC_SHARD_COUNT];
+
         ioc_inode->table = table;
+        ioc_inode->shard = shard;
         INIT_LIST_HEAD (&ioc_inode->cache.page_lru);
         pthread_mutex_init (&ioc_inode->inode_lock, NULL);
         ioc_inode->weight = weight;
 
-        ioc_table_lock (table);
+        ioc_shard_lock (shard);
         {
-                table->inode_count++;
-                list_add (&ioc_inode->inode_list, &table->inodes);
-                list_add_tail (&ioc_inode->inode_lru,
-                               &table->inode_lru[weight]);
+                shard->inode_count++;
+                list_add (&ioc_inode->inode_list, &shard->inodes);
         }
-        ioc_table_unlock (table);
+        ioc_shard_unlock (shard);
 
         gf_log (table->xl->name, GF_LOG_TRACE,
-                "adding to inode_lru[%d]", weight);
+                "adding inode(%p) with priority %d to shard %ld", ioc_inode,
+                weight, (long)(shard - table->shards));
 
 out:
         return ioc_inode;
@@ -224,19 +228,18 @@ out:
 void
 ioc_inode_destroy (ioc_inode_t *ioc_inode)
 {
-        ioc_table_t *table = NULL;
+        ioc_shard_t *shard = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode, out);
 
-        table = ioc_inode->table;
+        shard = ioc_inode->shard;
 
-        ioc_table_lock (table);
+        ioc_shard_lock (shard);
         {
-                table->inode_count--;
+                shard->inode_count--;
                 list_del (&ioc_inode->inode_list);
-                list_del (&ioc_inode->inode_lru);
         }
-        ioc_table_unlock (table);
+        ioc_shard_unlock (shard);
 
         ioc_inode_flush (ioc_inode);
         rbthash_table_destroy (ioc_inode->cache.page_table);
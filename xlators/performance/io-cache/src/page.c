@@ -31,6 +31,8 @@
 #include <assert.h>
 #include <sys/time.h>
 
+extern int ioc_log2_page_size;
+
 char
 ioc_empty (struct ioc_cache *cache)
 {
@@ -45,8 +47,232 @@ out:
 }
 
 
+static inline uint32_t
+ioc_ghost_hash (ioc_inode_t *ioc_inode, off_t offset)
+{
+        uint64_t key = 0;
+
+        key = ((uint64_t)(long)ioc_inode >> 4) ^ (offset >> ioc_log2_page_size);
+
+        return (uint32_t)((key * 2654435761ULL) >> 16) % IOC_GHOST_BUCKET_COUNT;
+}
+
+
+/*
+ * __ioc_shard_ghost_remove - forget the ghost of the page at @offset, if any
+ *
+ * returns 1 if the page was evicted from probation recently.
+ * assumes shard lock is held
+ */
+static int
+__ioc_shard_ghost_remove (ioc_shard_t *shard, ioc_inode_t *ioc_inode,
+                          off_t offset)
+{
+        ioc_ghost_t *ghost  = NULL;
+        uint32_t     bucket = 0;
+        int          found  = 0;
+
+        if (!shard->ghost_count)
+                goto out;
+
+        bucket = ioc_ghost_hash (ioc_inode, offset);
+
+        list_for_each_entry (ghost, &shard->ghost_hash[bucket], hash) {
+                if ((ghost->inode == ioc_inode) && (ghost->offset == offset)) {
+                        list_del (&ghost->hash);
+                        list_del (&ghost->fifo);
+                        shard->ghost_count--;
+                        GF_FREE (ghost);
+                        found = 1;
+                        break;
+                }
+        }
+
+out:
+        return found;
+}
+
+
+/*
+ * __ioc_shard_ghost_add - remember a page evicted from probation. the ghost
+ *                         list is bounded to half the pages of a shard's
+ *                         fair share, the oldest ghost is recycled when full.
+ *
+ * assumes shard lock is held
+ */
+static void
+__ioc_shard_ghost_add (ioc_shard_t *shard, ioc_inode_t *ioc_inode,
+                       off_t offset)
+{
+        ioc_table_t *table     = NULL;
+        ioc_ghost_t *ghost     = NULL;
+        uint64_t     ghost_max = 0;
+
+        table = ioc_inode->table;
+
+        ghost_max = (table->cache_size / table->page_size)
+                / (IOC_SHARD_COUNT * 2);
+        if (ghost_max == 0)
+                ghost_max = 1;
+
+        if (shard->ghost_count >= ghost_max) {
+                ghost = list_entry (shard->ghost_fifo.next, ioc_ghost_t, fifo);
+                list_del (&ghost->hash);
+                list_del (&ghost->fifo);
+                shard->ghost_count--;
+        } else {
+                ghost = GF_CALLOC (1, sizeof (*ghost), gf_ioc_mt_ioc_ghost_t);
+                if (ghost == NULL)
+                        goto out;
+        }
+
+        ghost->inode = ioc_inode;
+        ghost->offset = offset;
+
+        list_add (&ghost->hash,
+                  &shard->ghost_hash[ioc_ghost_hash (ioc_inode, offset)]);
+        list_add_tail (&ghost->fifo, &shard->ghost_fifo);
+        shard->ghost_count++;
+
+out:
+        return;
+}
+
+
+static inline struct list_head *
+__ioc_shard_queue (ioc_shard_t *shard, ioc_page_t *page)
+{
+        uint32_t index = 0;
+
+        index = page->inode->weight;
+
+        if (page->queue == IOC_QUEUE_PROTECTED)
+                return &shard->protected[index];
+
+        return &shard->probation[index];
+}
+
+
+/*
+ * __ioc_shard_page_unlink - take a page off its shard queue and release
+ *                           whatever it was charged
+ *
+ * assumes shard lock is held
+ */
+static void
+__ioc_shard_page_unlink (ioc_shard_t *shard, ioc_page_t *page)
+{
+        if (page->queue == IOC_QUEUE_NONE)
+                return;
+
+        list_del_init (&page->shard_lru);
+
+        shard->cache_used -= page->cached_size;
+        if (page->queue == IOC_QUEUE_PROBATION)
+                shard->probation_used -= page->cached_size;
+
+        page->cached_size = 0;
+        page->queue = IOC_QUEUE_NONE;
+}
+
+
+int32_t
+ioc_shards_init (ioc_table_t *table)
+{
+        ioc_shard_t *shard = NULL;
+        int32_t      ret   = -1;
+        int          i     = 0;
+        int          j     = 0;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &table->shards[i];
+
+                shard->probation = GF_CALLOC (table->max_pri,
+                                              sizeof (struct list_head),
+                                              gf_ioc_mt_list_head);
+                shard->protected = GF_CALLOC (table->max_pri,
+                                              sizeof (struct list_head),
+                                              gf_ioc_mt_list_head);
+                if ((shard->probation == NULL) || (shard->protected == NULL))
+                        goto out;
+
+                for (j = 0; j < table->max_pri; j++) {
+                        INIT_LIST_HEAD (&shard->probation[j]);
+                        INIT_LIST_HEAD (&shard->protected[j]);
+                }
+
+                for (j = 0; j < IOC_GHOST_BUCKET_COUNT; j++)
+                        INIT_LIST_HEAD (&shard->ghost_hash[j]);
+
+                INIT_LIST_HEAD (&shard->ghost_fifo);
+                INIT_LIST_HEAD (&shard->inodes);
+                pthread_mutex_init (&shard->shard_lock, NULL);
+        }
+
+        ret = 0;
+out:
+        if (ret == -1) {
+                for (; i >= 0; i--) {
+                        GF_FREE (table->shards[i].probation);
+                        GF_FREE (table->shards[i].protected);
+                        table->shards[i].probation = NULL;
+                        table->shards[i].protected = NULL;
+                }
+        }
+
+        return ret;
+}
+
+
+void
+ioc_shards_fini (ioc_table_t *table)
+{
+        ioc_shard_t *shard = NULL;
+        ioc_ghost_t *ghost = NULL, *tmp = NULL;
+        int          i     = 0;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &table->shards[i];
+
+                list_for_each_entry_safe (ghost, tmp, &shard->ghost_fifo,
+                                          fifo) {
+                        list_del (&ghost->fifo);
+                        GF_FREE (ghost);
+                }
+
+                GF_FREE (shard->probation);
+                GF_FREE (shard->protected);
+                pthread_mutex_destroy (&shard->shard_lock);
+        }
+}
+
+
+/*
+ * ioc_cache_used - total number of bytes cached across all shards
+ *
+ * the per-shard counters are read without their locks, the result is only
+ * used to decide whether pruning is worth attempting.
+ */
+uint64_t
+ioc_cache_used (ioc_table_t *table)
+{
+        uint64_t cache_used = 0;
+        int      i          = 0;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++)
+                cache_used += table->shards[i].cache_used;
+
+        return cache_used;
+}
+
+
+/*
+ * __ioc_page_lookup - find a page without counting it as an access
+ *
+ * assumes ioc_inode is locked
+ */
 ioc_page_t *
-__ioc_page_get (ioc_inode_t *ioc_inode, off_t offset)
+__ioc_page_lookup (ioc_inode_t *ioc_inode, off_t offset)
 {
         ioc_page_t   *page           = NULL;
         ioc_table_t  *table          = NULL;
@@ -62,10 +288,40 @@ __ioc_page_get (ioc_inode_t *ioc_inode, off_t offset)
         page = rbthash_get (ioc_inode->cache.page_table, &rounded_offset,
                             sizeof (rounded_offset));
 
-        if (page != NULL) {
-                /* push the page to the end of the lru list */
-                list_move_tail (&page->page_lru, &ioc_inode->cache.page_lru);
+out:
+        return page;
+}
+
+
+/*
+ * __ioc_page_get - find a page on behalf of a read and account the access
+ *
+ * assumes ioc_inode is locked
+ */
+ioc_page_t *
+__ioc_page_get (ioc_inode_t *ioc_inode, off_t offset)
+{
+        ioc_page_t  *page  = NULL;
+        ioc_shard_t *shard = NULL;
+
+        page = __ioc_page_lookup (ioc_inode, offset);
+        if (page == NULL)
+                goto out;
+
+        /* push the page to the end of the lru list */
+        list_move_tail (&page->page_lru, &ioc_inode->cache.page_lru);
+
+        shard = ioc_inode->shard;
+        ioc_shard_lock (shard);
+        {
+                shard->hits++;
+                /* references to a page in probation are correlated with
+                 * the one that faulted it in, they do not reorder it */
+                if (page->queue == IOC_QUEUE_PROTECTED)
+                        list_move_tail (&page->shard_lru,
+                                        __ioc_shard_queue (shard, page));
         }
+        ioc_shard_unlock (shard);
 
 out:
         return page;
@@ -92,48 +348,95 @@ out:
 }
 
 
+/*
+ * __ioc_page_charge - account @size bytes of cached data to the page's
+ *                     shard, replacing whatever the page held before
+ *
+ * assumes ioc_inode is locked
+ */
+void
+__ioc_page_charge (ioc_page_t *page, size_t size)
+{
+        ioc_shard_t *shard = NULL;
+
+        shard = page->inode->shard;
+
+        ioc_shard_lock (shard);
+        {
+                if (page->queue != IOC_QUEUE_NONE) {
+                        shard->cache_used += size - page->cached_size;
+                        if (page->queue == IOC_QUEUE_PROBATION)
+                                shard->probation_used += size
+                                        - page->cached_size;
+                        page->cached_size = size;
+                }
+        }
+        ioc_shard_unlock (shard);
+}
+
+
+/*
+ * __ioc_page_free - release a page which is already off its shard queue
+ *
+ * assumes ioc_inode is locked
+ */
+static void
+__ioc_page_free (ioc_page_t *page)
+{
+        rbthash_remove (page->inode->cache.page_table, &page->offset,
+                        sizeof (page->offset));
+        list_del (&page->page_lru);
+
+        gf_log (page->inode->table->xl->name, GF_LOG_TRACE,
+                "destroying page = %p, offset = %"PRId64" "
+                "&& inode = %p",
+                page, page->offset, page->inode);
+
+        if (page->vector){
+                iobref_unref (page->iobref);
+                GF_FREE (page->vector);
+                page->vector = NULL;
+        }
+
+        page->inode = NULL;
+
+        pthread_mutex_destroy (&page->page_lock);
+        GF_FREE (page);
+}
+
+
 /*
  * __ioc_page_destroy -
  *
  * @page:
  *
+ * returns the number of bytes released from the cache, or -1 if frames are
+ * still waiting on the page. assumes ioc_inode is locked
  */
 int64_t
 __ioc_page_destroy (ioc_page_t *page)
 {
-        int64_t  page_size = 0;
+        int64_t      page_size = 0;
+        ioc_shard_t *shard     = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", page, out);
 
-        if (page->iobref)
-                page_size = iobref_size (page->iobref);
-
         if (page->waitq) {
                 /* frames waiting on this page, do not destroy this page */
                 page_size = -1;
-        } else {
-                rbthash_remove (page->inode->cache.page_table, &page->offset,
-                                sizeof (page->offset));
-                list_del (&page->page_lru);
+                goto out;
+        }
 
-                gf_log (page->inode->table->xl->name, GF_LOG_TRACE,
-                        "destroying page = %p, offset = %"PRId64" "
-                        "&& inode = %p",
-                        page, page->offset, page->inode);
-
-                if (page->vector){
-                        iobref_unref (page->iobref);
-                        GF_FREE (page->vector);
-                        page->vector = NULL;
-                }
+        shard = page->inode->shard;
 
-                page->inode = NULL;
+        ioc_shard_lock (shard);
+        {
+                page_size = page->cached_size;
+                __ioc_shard_page_unlink (shard, page);
         }
+        ioc_shard_unlock (shard);
 
-        if (page_size != -1) {
-                pthread_mutex_destroy (&page->page_lock);
-                GF_FREE (page);
-        }
+        __ioc_page_free (page);
 
 out:
         return page_size;
@@ -143,105 +446,152 @@ out:
 int64_t
 ioc_page_destroy (ioc_page_t *page)
 {
-        int64_t ret = 0;
+        int64_t      ret       = 0;
+        ioc_inode_t *ioc_inode = NULL;
 
         if (page == NULL) {
                 goto out;
         }
 
-        ioc_inode_lock (page->inode);
+        ioc_inode = page->inode;
+
+        ioc_inode_lock (ioc_inode);
         {
                 ret = __ioc_page_destroy (page);
         }
-        ioc_inode_unlock (page->inode);
+        ioc_inode_unlock (ioc_inode);
 
 out:
         return ret;
 }
 
-int32_t
-__ioc_inode_prune (ioc_inode_t *curr, uint64_t *size_pruned,
-                   uint64_t size_to_prune, uint32_t index)
+
+typedef enum {
+        IOC_PRUNE_PROBATION_EXCESS, /* probation beyond its 2Q share */
+        IOC_PRUNE_PROTECTED,
+        IOC_PRUNE_PROBATION,
+        IOC_PRUNE_PASS_MAX,
+} ioc_prune_pass_t;
+
+
+/*
+ * ioc_shard_prune - evict pages of priority @index from one queue of a shard
+ *
+ * the shard lock is taken before the inode locks here, which is the reverse
+ * of the regular order, so inodes busy elsewhere are skipped rather than
+ * waited for.
+ */
+static uint64_t
+ioc_shard_prune (ioc_shard_t *shard, ioc_prune_pass_t pass, uint32_t index,
+                 uint64_t size_to_prune)
 {
-        ioc_page_t  *page  = NULL, *next = NULL;
-        int32_t      ret   = 0;
-        ioc_table_t *table = NULL;
+        ioc_table_t      *table       = NULL;
+        ioc_page_t       *page        = NULL, *next = NULL;
+        ioc_inode_t      *ioc_inode   = NULL;
+        struct list_head *queue       = NULL;
+        uint64_t          size_pruned = 0;
+        uint64_t          kin         = 0;
+        ioc_queue_t       queue_type  = IOC_QUEUE_NONE;
+
+        ioc_shard_lock (shard);
+        {
+                if (pass == IOC_PRUNE_PROTECTED)
+                        queue = &shard->protected[index];
+                else
+                        queue = &shard->probation[index];
 
-        if (curr == NULL) {
-                goto out;
-        }
+                list_for_each_entry_safe (page, next, queue, shard_lru) {
+                        if (size_pruned >= size_to_prune)
+                                break;
 
-        table = curr->table;
+                        ioc_inode = page->inode;
+                        table = ioc_inode->table;
 
-        list_for_each_entry_safe (page, next, &curr->cache.page_lru, page_lru) {
-                *size_pruned += page->size;
-                ret = __ioc_page_destroy (page);
+                        if (pass == IOC_PRUNE_PROBATION_EXCESS) {
+                                kin = (table->cache_size / IOC_SHARD_COUNT)
+                                        * IOC_PROBATION_PERCENT / 100;
+                                if (shard->probation_used <= kin)
+                                        break;
+                        }
 
-                if (ret != -1)
-                        table->cache_used -= ret;
+                        if (pthread_mutex_trylock (&ioc_inode->inode_lock))
+                                continue;
 
-                gf_log (table->xl->name, GF_LOG_TRACE,
-                        "index = %d && table->cache_used = %"PRIu64" && table->"
-                        "cache_size = %"PRIu64, index, table->cache_used,
-                        table->cache_size);
+                        if (page->waitq) {
+                                pthread_mutex_unlock (&ioc_inode->inode_lock);
+                                continue;
+                        }
 
-                if ((*size_pruned) >= size_to_prune)
-                        break;
-        }
+                        size_pruned += page->cached_size;
+                        queue_type = page->queue;
+
+                        __ioc_shard_page_unlink (shard, page);
+                        if (queue_type == IOC_QUEUE_PROBATION)
+                                __ioc_shard_ghost_add (shard, ioc_inode,
+                                                       page->offset);
+
+                        __ioc_page_free (page);
+                        shard->evictions++;
 
-        if (ioc_empty (&curr->cache)) {
-                list_del_init (&curr->inode_lru);
+                        pthread_mutex_unlock (&ioc_inode->inode_lock);
+                }
         }
+        ioc_shard_unlock (shard);
 
-out:
-        return 0;
+        return size_pruned;
 }
+
+
 /*
  * ioc_prune - prune the cache. we have a limit to the number of pages we
  *             can have in-memory.
  *
  * @table: ioc_table_t of this translator
  *
+ * evicts in 2Q order: probation pages beyond their share first, then
+ * protected pages, then the rest of probation. lower priorities go before
+ * higher ones within each pass. shards are visited round-robin so that no
+ * single shard absorbs all evictions.
  */
 int32_t
 ioc_prune (ioc_table_t *table)
 {
-        ioc_inode_t *curr          = NULL, *next_ioc_inode = NULL;
-        int32_t      index         = 0;
-        uint64_t     size_to_prune = 0;
-        uint64_t     size_pruned   = 0;
+        uint64_t         cache_used    = 0;
+        uint64_t         size_to_prune = 0;
+        uint64_t         size_pruned   = 0;
+        uint32_t         start         = 0;
+        int32_t          index         = 0;
+        int              pass          = 0;
+        int              i             = 0;
+        ioc_shard_t     *shard         = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", table, out);
 
-        ioc_table_lock (table);
-        {
-                size_to_prune = table->cache_used - table->cache_size;
-                /* take out the least recently used inode */
-                for (index=0; index < table->max_pri; index++) {
-                        list_for_each_entry_safe (curr, next_ioc_inode,
-                                                  &table->inode_lru[index],
-                                                  inode_lru) {
-                                /* prune page-by-page for this inode, till
-                                 * we reach the equilibrium */
-                                ioc_inode_lock (curr);
-                                {
-                                        __ioc_inode_prune (curr, &size_pruned,
-                                                           size_to_prune,
-                                                           index);
-                                }
-                                ioc_inode_unlock (curr);
+        cache_used = ioc_cache_used (table);
+        if (cache_used <= table->cache_size)
+                goto out;
 
+        size_to_prune = cache_used - table->cache_size;
+        start = table->prune_cursor++;
+
+        for (pass = 0; pass < IOC_PRUNE_PASS_MAX; pass++) {
+                for (index = 0; index < table->max_pri; index++) {
+                        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                                shard = &table->shards[(start + i)
+                                                       % IOC_SHARD_COUNT];
+                                size_pruned += ioc_shard_prune (shard, pass,
+                                                                index,
+                                                                size_to_prune
+                                                                - size_pruned);
                                 if (size_pruned >= size_to_prune)
-                                        break;
-                        } /* list_for_each_entry_safe (curr...) */
-
-                        if (size_pruned >= size_to_prune)
-                                break;
-                } /* for(index=0;...) */
-
-        } /* ioc_inode_table locked region end */
-        ioc_table_unlock (table);
+                                        goto out;
+                        }
+                }
+        }
 
+        gf_log (table->xl->name, GF_LOG_TRACE,
+                "pruned %"PRIu64" of %"PRIu64" bytes, rest is in use",
+                size_pruned, size_to_prune);
 out:
         return 0;
 }
@@ -260,6 +610,7 @@ __ioc_page_create (ioc_inode_t *ioc_inode, off_t offset)
         ioc_page_t  *page           = NULL;
         off_t        rounded_offset = 0;
         ioc_page_t  *newpage        = NULL;
+        ioc_shard_t *shard          = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode, out);
 
@@ -288,6 +639,25 @@ __ioc_page_create (ioc_inode_t *ioc_inode, off_t offset)
 
         list_add_tail (&newpage->page_lru, &ioc_inode->cache.page_lru);
 
+        shard = ioc_inode->shard;
+        ioc_shard_lock (shard);
+        {
+                shard->misses++;
+
+                newpage->queue = IOC_QUEUE_PROBATION;
+                if (__ioc_shard_ghost_remove (shard, ioc_inode,
+                                              rounded_offset)) {
+                        /* faulted in again soon after being evicted, the
+                         * page is part of the working set */
+                        newpage->queue = IOC_QUEUE_PROTECTED;
+                        shard->ghost_hits++;
+                }
+
+                list_add_tail (&newpage->shard_lru,
+                               __ioc_shard_queue (shard, newpage));
+        }
+        ioc_shard_unlock (shard);
+
         page = newpage;
 
         gf_log ("io-cache", GF_LOG_TRACE,
@@ -423,10 +793,8 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         ioc_inode_t *ioc_inode        = NULL;
         ioc_table_t *table            = NULL;
         ioc_page_t  *page             = NULL;
-        int32_t      destroy_size     = 0;
         size_t       page_size        = 0;
         ioc_waitq_t *waitq            = NULL;
-        size_t       iobref_page_size = 0;
         char         zero_filled      = 0;
 
         GF_ASSERT (frame);
@@ -451,7 +819,7 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         gf_log (ioc_inode->table->xl->name, GF_LOG_TRACE,
                                 "cache for inode(%p) is invalid. flushing "
                                 "all pages", ioc_inode);
-                        destroy_size = __ioc_inode_flush (ioc_inode);
+                        __ioc_inode_flush (ioc_inode);
                 }
 
                 if ((op_ret >= 0) && !zero_filled) {
@@ -463,14 +831,14 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
                 if (op_ret < 0) {
                         /* error, readv returned -1 */
-                        page = __ioc_page_get (ioc_inode, offset);
+                        page = __ioc_page_lookup (ioc_inode, offset);
                         if (page)
                                 waitq = __ioc_page_error (page, op_ret,
                                                           op_errno);
                 } else {
                         gf_log (ioc_inode->table->xl->name, GF_LOG_TRACE,
                                 "op_ret = %d", op_ret);
-                        page = __ioc_page_get (ioc_inode, offset);
+                        page = __ioc_page_lookup (ioc_inode, offset);
                         if (!page) {
                                 /* page was flushed */
                                 /* some serious bug ? */
@@ -488,7 +856,7 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                 /* keep a copy of the page for our cache */
                                 page->vector = iov_dup (vector, count);
                                 if (page->vector == NULL) {
-                                        page = __ioc_page_get (ioc_inode,
+                                        page = __ioc_page_lookup (ioc_inode,
                                                                offset);
                                         if (page != NULL)
                                                 waitq = __ioc_page_error (page,
@@ -518,7 +886,8 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                 page_size = iov_length(vector, count);
                                 page->size = page_size;
 
-                                iobref_page_size = iobref_size (page->iobref);
+                                __ioc_page_charge (page,
+                                                   iobref_size (page->iobref));
 
                                 if (page->waitq) {
                                         /* wake up all the frames waiting on
@@ -534,22 +903,6 @@ unlock:
 
         ioc_waitq_return (waitq);
 
-        if (iobref_page_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used += iobref_page_size;
-                }
-                ioc_table_unlock (table);
-        }
-
-        if (destroy_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (table);
-        }
-
         if (ioc_need_prune (ioc_inode->table)) {
                 ioc_prune (ioc_inode->table);
         }
@@ -636,7 +989,7 @@ ioc_page_fault (ioc_inode_t *ioc_inode, call_frame_t *frame, fd_t *fd,
 err:
         ioc_inode_lock (ioc_inode);
         {
-                page = __ioc_page_get (ioc_inode, offset);
+                page = __ioc_page_lookup (ioc_inode, offset);
                 if (page != NULL) {
                         waitq = __ioc_page_error (page, op_ret, op_errno);
                 }
@@ -966,8 +1319,6 @@ __ioc_page_error (ioc_page_t *page, int32_t op_ret, int32_t op_errno)
 {
         ioc_waitq_t  *waitq = NULL, *trav = NULL;
         call_frame_t *frame = NULL;
-        int64_t       ret   = 0;
-        ioc_table_t  *table = NULL;
         ioc_local_t  *local = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", page, out);
@@ -993,12 +1344,7 @@ __ioc_page_error (ioc_page_t *page, int32_t op_ret, int32_t op_errno)
                 ioc_local_unlock (local);
         }
 
-        table = page->inode->table;
-        ret = __ioc_page_destroy (page);
-
-        if (ret != -1) {
-                table->cache_used -= ret;
-        }
+        __ioc_page_destroy (page);
 
 out:
         return waitq;
@@ -0,0 +1,1404 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nl-cache: negative lookup cache.
+ *
+ * Remembers, per parent directory, names which are known not to exist:
+ * either because a lookup on them returned ENOENT, or because they were
+ * unlinked/renamed away through this client, or because they are absent
+ * from a complete readdir of the parent. Lookups on such names are
+ * answered with ENOENT without going to the subvolumes, for at most
+ * cache-timeout seconds. Entry operations done through this client keep
+ * the cache up to date; changes done by other clients are only noticed
+ * once the entries expire.
+ */
+
+#include "nl-cache.h"
+#include "statedump.h"
+
+struct volume_options options[];
+
+
+void
+nlc_local_free (nlc_local_t *local)
+{
+        if (local == NULL) {
+                goto out;
+        }
+
+        loc_wipe (&local->loc);
+        loc_wipe (&local->loc2);
+
+        if (local->fd != NULL) {
+                fd_unref (local->fd);
+        }
+
+        GF_FREE (local);
+out:
+        return;
+}
+
+
+nlc_local_t *
+nlc_local_new (loc_t *loc, loc_t *loc2)
+{
+        nlc_local_t *local = NULL;
+        int32_t      ret   = -1;
+
+        local = GF_CALLOC (1, sizeof (*local), gf_nlc_mt_nlc_local_t);
+        if (local == NULL) {
+                goto out;
+        }
+
+        if (loc != NULL) {
+                ret = loc_copy (&local->loc, loc);
+                if (ret != 0) {
+                        goto out;
+                }
+        }
+
+        if (loc2 != NULL) {
+                ret = loc_copy (&local->loc2, loc2);
+                if (ret != 0) {
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        if ((ret != 0) && (local != NULL)) {
+                nlc_local_free (local);
+                local = NULL;
+        }
+
+        return local;
+}
+
+
+static inline uint32_t
+nlc_hash (const char *name)
+{
+        return SuperFastHash (name, strlen (name)) % NLC_HASH_BUCKETS;
+}
+
+
+nlc_name_t *
+__nlc_name_find (nlc_dir_t *dir, const char *name)
+{
+        nlc_name_t *entry = NULL, *found = NULL;
+
+        list_for_each_entry (entry, &dir->names[nlc_hash (name)], list) {
+                if (strcmp (entry->name, name) == 0) {
+                        found = entry;
+                        break;
+                }
+        }
+
+        return found;
+}
+
+
+nlc_name_t *
+nlc_name_new (const char *name, char negative)
+{
+        nlc_name_t *entry = NULL;
+        size_t      len   = 0;
+
+        len = strlen (name);
+
+        entry = GF_CALLOC (1, sizeof (*entry) + len + 1,
+                           gf_nlc_mt_nlc_name_t);
+        if (entry == NULL) {
+                goto out;
+        }
+
+        INIT_LIST_HEAD (&entry->list);
+        memcpy (entry->name, name, len + 1);
+        entry->negative = negative;
+        if (negative) {
+                entry->neg_time = time (NULL);
+        }
+
+out:
+        return entry;
+}
+
+
+void
+__nlc_name_del (nlc_conf_t *conf, nlc_dir_t *dir, nlc_name_t *entry)
+{
+        list_del_init (&entry->list);
+        GF_FREE (entry);
+
+        dir->count--;
+        conf->current--;
+}
+
+
+/* keeps @dir on the lru only as long as it holds any names */
+void
+__nlc_dir_touch (nlc_conf_t *conf, nlc_dir_t *dir)
+{
+        if (dir->count == 0) {
+                list_del_init (&dir->lru);
+        } else {
+                list_move_tail (&dir->lru, &conf->lru);
+        }
+}
+
+
+void
+__nlc_dir_purge (nlc_conf_t *conf, nlc_dir_t *dir, char positive_only)
+{
+        nlc_name_t *entry = NULL, *tmp = NULL;
+        int         i     = 0;
+
+        for (i = 0; i < NLC_HASH_BUCKETS; i++) {
+                list_for_each_entry_safe (entry, tmp, &dir->names[i], list) {
+                        if (positive_only && entry->negative) {
+                                continue;
+                        }
+
+                        __nlc_name_del (conf, dir, entry);
+                }
+        }
+
+        dir->listing_complete = 0;
+        __nlc_dir_touch (conf, dir);
+}
+
+
+void
+__nlc_prune (nlc_conf_t *conf, nlc_dir_t *keep)
+{
+        nlc_dir_t *dir = NULL, *tmp = NULL;
+
+        list_for_each_entry_safe (dir, tmp, &conf->lru, lru) {
+                if (conf->current <= conf->limit) {
+                        break;
+                }
+
+                if (dir == keep) {
+                        continue;
+                }
+
+                __nlc_dir_purge (conf, dir, 0);
+                conf->purges++;
+        }
+
+        if ((conf->current > conf->limit) && (keep != NULL)) {
+                __nlc_dir_purge (conf, keep, 0);
+                conf->purges++;
+        }
+}
+
+
+nlc_dir_t *
+__nlc_dir_get (xlator_t *this, inode_t *inode, char create)
+{
+        nlc_conf_t *conf  = NULL;
+        nlc_dir_t  *dir   = NULL;
+        uint64_t    value = 0;
+        int32_t     ret   = -1;
+        int         i     = 0;
+
+        ret = inode_ctx_get (inode, this, &value);
+        if (ret == 0) {
+                dir = (nlc_dir_t *)(long) value;
+                goto out;
+        }
+
+        if (!create) {
+                goto out;
+        }
+
+        dir = GF_CALLOC (1, sizeof (*dir), gf_nlc_mt_nlc_dir_t);
+        if (dir == NULL) {
+                goto out;
+        }
+
+        for (i = 0; i < NLC_HASH_BUCKETS; i++) {
+                INIT_LIST_HEAD (&dir->names[i]);
+        }
+
+        INIT_LIST_HEAD (&dir->lru);
+        dir->inode = inode;
+
+        /* generations are unique across dirs, so a dir that was freed and
+         * set up again never matches a generation recorded earlier */
+        conf = this->private;
+        dir->gen = ++conf->gen;
+
+        ret = inode_ctx_put (inode, this, (uint64_t)(long) dir);
+        if (ret != 0) {
+                GF_FREE (dir);
+                dir = NULL;
+        }
+
+out:
+        return dir;
+}
+
+
+/*
+ * Returns whether the listing of @dir can be trusted; an expired listing
+ * is dropped on the way.
+ */
+char
+__nlc_listing_valid (nlc_conf_t *conf, nlc_dir_t *dir, time_t now)
+{
+        if (!dir->listing_complete) {
+                return 0;
+        }
+
+        if ((now - dir->listing_time) < conf->cache_timeout) {
+                return 1;
+        }
+
+        __nlc_dir_purge (conf, dir, 1);
+        return 0;
+}
+
+
+char
+nlc_is_negative (xlator_t *this, inode_t *parent, const char *name)
+{
+        nlc_conf_t *conf  = NULL;
+        nlc_dir_t  *dir   = NULL;
+        nlc_name_t *entry = NULL;
+        time_t      now   = 0;
+        char        hit   = 0;
+
+        conf = this->private;
+        now = time (NULL);
+
+        LOCK (&conf->lock);
+        {
+                dir = __nlc_dir_get (this, parent, 0);
+                if (dir == NULL) {
+                        goto unlock;
+                }
+
+                entry = __nlc_name_find (dir, name);
+                if ((entry != NULL) && entry->negative) {
+                        if ((now - entry->neg_time) < conf->cache_timeout) {
+                                hit = 1;
+                                goto unlock;
+                        }
+
+                        __nlc_name_del (conf, dir, entry);
+                        entry = NULL;
+                }
+
+                if (__nlc_listing_valid (conf, dir, now) && (entry == NULL)) {
+                        hit = 1;
+                }
+
+        unlock:
+                if (hit) {
+                        conf->hits++;
+                        __nlc_dir_touch (conf, dir);
+                } else {
+                        conf->misses++;
+                }
+        }
+        UNLOCK (&conf->lock);
+
+        return hit;
+}
+
+
+/* generation of the cached state of @inode, 0 if nothing is cached */
+uint64_t
+nlc_dir_gen (xlator_t *this, inode_t *inode)
+{
+        nlc_conf_t *conf = NULL;
+        nlc_dir_t  *dir  = NULL;
+        uint64_t    gen  = 0;
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                dir = __nlc_dir_get (this, inode, 0);
+                if (dir != NULL) {
+                        gen = dir->gen;
+                }
+        }
+        UNLOCK (&conf->lock);
+
+        return gen;
+}
+
+
+/*
+ * @name was found not to exist (ENOENT from a lookup, or removed by us).
+ * With @gen, the answer is dropped if the directory has changed since that
+ * generation, as the name may have been created after the lookup was
+ * answered.
+ */
+void
+nlc_set_negative (xlator_t *this, inode_t *parent, const char *name,
+                  char removed, uint64_t *gen)
+{
+        nlc_conf_t *conf  = NULL;
+        nlc_dir_t  *dir   = NULL;
+        nlc_name_t *entry = NULL;
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                if (conf->limit == 0) {
+                        goto unlock;
+                }
+
+                if (gen != NULL) {
+                        dir = __nlc_dir_get (this, parent, 0);
+                        if ((dir ? dir->gen : 0) != *gen) {
+                                goto unlock;
+                        }
+                }
+
+                dir = __nlc_dir_get (this, parent, 1);
+                if (dir == NULL) {
+                        goto unlock;
+                }
+
+                if (removed) {
+                        dir->gen = ++conf->gen;
+                }
+
+                entry = __nlc_name_find (dir, name);
+                if (entry != NULL) {
+                        if (!entry->negative && !removed) {
+                                /* someone else removed it; listing is stale */
+                                __nlc_dir_purge (conf, dir, 1);
+                        } else {
+                                __nlc_name_del (conf, dir, entry);
+                        }
+                }
+
+                entry = nlc_name_new (name, 1);
+                if (entry == NULL) {
+                        goto unlock;
+                }
+
+                list_add (&entry->list, &dir->names[nlc_hash (name)]);
+                dir->count++;
+                conf->current++;
+
+                __nlc_dir_touch (conf, dir);
+                __nlc_prune (conf, dir);
+        }
+unlock:
+        UNLOCK (&conf->lock);
+
+        return;
+}
+
+
+/*
+ * @name was found to exist: either a lookup or an EEXIST told us so, or
+ * we created it ourselves (@created), in which case a complete listing
+ * of the parent is kept complete by adding the name to it.
+ */
+void
+nlc_set_exists (xlator_t *this, inode_t *parent, const char *name,
+                char created)
+{
+        nlc_conf_t *conf  = NULL;
+        nlc_dir_t  *dir   = NULL;
+        nlc_name_t *entry = NULL;
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                /* a creation has to leave a new generation behind even
+                 * when nothing is cached yet, for lookups racing with it */
+                dir = __nlc_dir_get (this, parent, created);
+                if (dir == NULL) {
+                        goto unlock;
+                }
+
+                if (created) {
+                        dir->gen = ++conf->gen;
+                }
+
+                entry = __nlc_name_find (dir, name);
+                if ((entry != NULL) && entry->negative) {
+                        __nlc_name_del (conf, dir, entry);
+                        entry = NULL;
+                }
+
+                if ((entry == NULL) && dir->listing_complete) {
+                        if (!created) {
+                                /* created elsewhere; listing is stale */
+                                __nlc_dir_purge (conf, dir, 1);
+                                goto touch;
+                        }
+
+                        entry = nlc_name_new (name, 0);
+                        if (entry == NULL) {
+                                __nlc_dir_purge (conf, dir, 1);
+                                goto touch;
+                        }
+
+                        list_add (&entry->list, &dir->names[nlc_hash (name)]);
+                        dir->count++;
+                        conf->current++;
+                }
+
+        touch:
+                __nlc_dir_touch (conf, dir);
+                __nlc_prune (conf, dir);
+        }
+unlock:
+        UNLOCK (&conf->lock);
+
+        return;
+}
+
+
+void
+nlc_fd_ctx_reset (nlc_fd_ctx_t *fd_ctx)
+{
+        nlc_name_t *entry = NULL, *tmp = NULL;
+
+        list_for_each_entry_safe (entry, tmp, &fd_ctx->names, list) {
+                list_del_init (&entry->list);
+                GF_FREE (entry);
+        }
+
+        fd_ctx->count = 0;
+        fd_ctx->valid = 0;
+}
+
+
+nlc_fd_ctx_t *
+__nlc_fd_ctx_get (xlator_t *this, fd_t *fd)
+{
+        nlc_fd_ctx_t *fd_ctx = NULL;
+        uint64_t      value  = 0;
+        int32_t       ret    = -1;
+
+        ret = fd_ctx_get (fd, this, &value);
+        if (ret == 0) {
+                fd_ctx = (nlc_fd_ctx_t *)(long) value;
+                goto out;
+        }
+
+        fd_ctx = GF_CALLOC (1, sizeof (*fd_ctx), gf_nlc_mt_nlc_fd_ctx_t);
+        if (fd_ctx == NULL) {
+                goto out;
+        }
+
+        INIT_LIST_HEAD (&fd_ctx->names);
+
+        ret = fd_ctx_set (fd, this, (uint64_t)(long) fd_ctx);
+        if (ret != 0) {
+                GF_FREE (fd_ctx);
+                fd_ctx = NULL;
+        }
+
+out:
+        return fd_ctx;
+}
+
+
+/*
+ * A directory read which starts at offset 0 and proceeds, in order, to
+ * the end without any entry changes seen in between gives a complete
+ * listing of the directory.
+ */
+void
+nlc_readdir_begin (xlator_t *this, fd_t *fd, off_t offset)
+{
+        nlc_conf_t   *conf   = NULL;
+        nlc_dir_t    *dir    = NULL;
+        nlc_fd_ctx_t *fd_ctx = NULL;
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                if ((offset != 0) || (conf->limit == 0)) {
+                        goto unlock;
+                }
+
+                fd_ctx = __nlc_fd_ctx_get (this, fd);
+                dir = __nlc_dir_get (this, fd->inode, 1);
+                if ((fd_ctx == NULL) || (dir == NULL)) {
+                        goto unlock;
+                }
+
+                nlc_fd_ctx_reset (fd_ctx);
+                fd_ctx->valid = 1;
+                fd_ctx->next_off = 0;
+                fd_ctx->gen = dir->gen;
+        }
+unlock:
+        UNLOCK (&conf->lock);
+
+        return;
+}
+
+
+void
+__nlc_install_listing (nlc_conf_t *conf, nlc_dir_t *dir,
+                       nlc_fd_ctx_t *fd_ctx)
+{
+        nlc_name_t *entry = NULL, *tmp = NULL;
+
+        __nlc_dir_purge (conf, dir, 0);
+
+        list_for_each_entry_safe (entry, tmp, &fd_ctx->names, list) {
+                list_move (&entry->list, &dir->names[nlc_hash (entry->name)]);
+        }
+
+        dir->count = fd_ctx->count;
+        conf->current += fd_ctx->count;
+        fd_ctx->count = 0;
+
+        dir->listing_complete = 1;
+        dir->listing_time = time (NULL);
+        conf->listings++;
+
+        __nlc_dir_touch (conf, dir);
+        __nlc_prune (conf, dir);
+}
+
+
+void
+nlc_readdir_collect (xlator_t *this, fd_t *fd, off_t offset, int32_t op_ret,
+                     gf_dirent_t *entries)
+{
+        nlc_conf_t   *conf   = NULL;
+        nlc_dir_t    *dir    = NULL;
+        nlc_fd_ctx_t *fd_ctx = NULL;
+        nlc_name_t   *name   = NULL;
+        gf_dirent_t  *entry  = NULL;
+        uint64_t      value  = 0;
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                if (fd_ctx_get (fd, this, &value) != 0) {
+                        goto unlock;
+                }
+
+                fd_ctx = (nlc_fd_ctx_t *)(long) value;
+                if (!fd_ctx->valid) {
+                        goto unlock;
+                }
+
+                if ((op_ret < 0) || (offset != fd_ctx->next_off)) {
+                        goto invalid;
+                }
+
+                if (op_ret == 0) {
+                        dir = __nlc_dir_get (this, fd->inode, 0);
+                        if ((dir != NULL) && (dir->gen == fd_ctx->gen)) {
+                                __nlc_install_listing (conf, dir, fd_ctx);
+                        }
+
+                        goto invalid;
+                }
+
+                list_for_each_entry (entry, &entries->list, list) {
+                        fd_ctx->next_off = entry->d_off;
+
+                        if ((strcmp (entry->d_name, ".") == 0)
+                            || (strcmp (entry->d_name, "..") == 0)) {
+                                continue;
+                        }
+
+                        if (fd_ctx->count >= conf->limit) {
+                                goto invalid;
+                        }
+
+                        name = nlc_name_new (entry->d_name, 0);
+                        if (name == NULL) {
+                                goto invalid;
+                        }
+
+                        list_add_tail (&name->list, &fd_ctx->names);
+                        fd_ctx->count++;
+                }
+
+                goto unlock;
+
+        invalid:
+                nlc_fd_ctx_reset (fd_ctx);
+        }
+unlock:
+        UNLOCK (&conf->lock);
+
+        return;
+}
+
+
+int32_t
+nlc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                int32_t op_ret, int32_t op_errno, inode_t *inode,
+                struct iatt *buf, dict_t *dict, struct iatt *postparent)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if (local == NULL) {
+                goto out;
+        }
+
+        if (op_ret == 0) {
+                nlc_set_exists (this, local->loc.parent, local->loc.name, 0);
+        } else if (op_errno == ENOENT) {
+                nlc_set_negative (this, local->loc.parent, local->loc.name,
+                                  0, &local->gen);
+        }
+
+out:
+        NLC_STACK_UNWIND (lookup, frame, op_ret, op_errno, inode, buf, dict,
+                          postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
+            dict_t *xattr_req)
+{
+        nlc_local_t *local = NULL;
+
+        if ((loc->parent == NULL) || (loc->name == NULL)) {
+                goto wind;
+        }
+
+        if (nlc_is_negative (this, loc->parent, loc->name)) {
+                STACK_UNWIND_STRICT (lookup, frame, -1, ENOENT, NULL, NULL,
+                                     NULL, NULL);
+                return 0;
+        }
+
+        /* a lookup without a cached answer is simply not remembered */
+        local = nlc_local_new (loc, NULL);
+        if (local != NULL) {
+                local->gen = nlc_dir_gen (this, loc->parent);
+        }
+
+        frame->local = local;
+
+wind:
+        STACK_WIND (frame, nlc_lookup_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->lookup, loc, xattr_req);
+        return 0;
+}
+
+
+/* common completion of the fops which create an entry under loc->parent */
+void
+nlc_entry_created (xlator_t *this, nlc_local_t *local, int32_t op_ret,
+                   int32_t op_errno)
+{
+        if ((local == NULL) || (local->loc.parent == NULL)
+            || (local->loc.name == NULL)) {
+                return;
+        }
+
+        if (op_ret == 0) {
+                nlc_set_exists (this, local->loc.parent, local->loc.name, 1);
+        } else if (op_errno == EEXIST) {
+                nlc_set_exists (this, local->loc.parent, local->loc.name, 0);
+        }
+}
+
+
+void
+nlc_entry_removed (xlator_t *this, loc_t *loc, int32_t op_ret)
+{
+        if ((op_ret != 0) || (loc->parent == NULL) || (loc->name == NULL)) {
+                return;
+        }
+
+        nlc_set_negative (this, loc->parent, loc->name, 1, NULL);
+}
+
+
+int32_t
+nlc_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+               int32_t op_ret, int32_t op_errno, inode_t *inode,
+               struct iatt *buf, struct iatt *preparent,
+               struct iatt *postparent)
+{
+        nlc_entry_created (this, frame->local, op_ret, op_errno);
+
+        NLC_STACK_UNWIND (mknod, frame, op_ret, op_errno, inode, buf,
+                          preparent, postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
+           dev_t rdev, dict_t *params)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_mknod_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->mknod, loc, mode, rdev, params);
+        return 0;
+}
+
+
+int32_t
+nlc_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+               int32_t op_ret, int32_t op_errno, inode_t *inode,
+               struct iatt *buf, struct iatt *preparent,
+               struct iatt *postparent)
+{
+        nlc_entry_created (this, frame->local, op_ret, op_errno);
+
+        NLC_STACK_UNWIND (mkdir, frame, op_ret, op_errno, inode, buf,
+                          preparent, postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_mkdir (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
+           dict_t *params)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_mkdir_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->mkdir, loc, mode, params);
+        return 0;
+}
+
+
+int32_t
+nlc_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                 int32_t op_ret, int32_t op_errno, inode_t *inode,
+                 struct iatt *buf, struct iatt *preparent,
+                 struct iatt *postparent)
+{
+        nlc_entry_created (this, frame->local, op_ret, op_errno);
+
+        NLC_STACK_UNWIND (symlink, frame, op_ret, op_errno, inode, buf,
+                          preparent, postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_symlink (call_frame_t *frame, xlator_t *this, const char *linkpath,
+             loc_t *loc, dict_t *params)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_symlink_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->symlink, linkpath, loc, params);
+        return 0;
+}
+
+
+int32_t
+nlc_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                int32_t op_ret, int32_t op_errno, fd_t *fd, inode_t *inode,
+                struct iatt *buf, struct iatt *preparent,
+                struct iatt *postparent)
+{
+        nlc_entry_created (this, frame->local, op_ret, op_errno);
+
+        NLC_STACK_UNWIND (create, frame, op_ret, op_errno, fd, inode, buf,
+                          preparent, postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_create (call_frame_t *frame, xlator_t *this, loc_t *loc, int32_t flags,
+            mode_t mode, fd_t *fd, dict_t *params)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_create_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->create, loc, flags, mode, fd,
+                    params);
+        return 0;
+}
+
+
+int32_t
+nlc_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+              int32_t op_ret, int32_t op_errno, inode_t *inode,
+              struct iatt *buf, struct iatt *preparent,
+              struct iatt *postparent)
+{
+        nlc_entry_created (this, frame->local, op_ret, op_errno);
+
+        NLC_STACK_UNWIND (link, frame, op_ret, op_errno, inode, buf,
+                          preparent, postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_link (call_frame_t *frame, xlator_t *this, loc_t *oldloc, loc_t *newloc)
+{
+        frame->local = nlc_local_new (newloc, NULL);
+
+        STACK_WIND (frame, nlc_link_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->link, oldloc, newloc);
+        return 0;
+}
+
+
+int32_t
+nlc_unlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                int32_t op_ret, int32_t op_errno, struct iatt *preparent,
+                struct iatt *postparent)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if (local != NULL) {
+                nlc_entry_removed (this, &local->loc, op_ret);
+        }
+
+        NLC_STACK_UNWIND (unlink, frame, op_ret, op_errno, preparent,
+                          postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_unlink (call_frame_t *frame, xlator_t *this, loc_t *loc)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_unlink_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->unlink, loc);
+        return 0;
+}
+
+
+int32_t
+nlc_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+               int32_t op_ret, int32_t op_errno, struct iatt *preparent,
+               struct iatt *postparent)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if (local != NULL) {
+                nlc_entry_removed (this, &local->loc, op_ret);
+        }
+
+        NLC_STACK_UNWIND (rmdir, frame, op_ret, op_errno, preparent,
+                          postparent);
+        return 0;
+}
+
+
+int32_t
+nlc_rmdir (call_frame_t *frame, xlator_t *this, loc_t *loc, int flags)
+{
+        frame->local = nlc_local_new (loc, NULL);
+
+        STACK_WIND (frame, nlc_rmdir_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->rmdir, loc, flags);
+        return 0;
+}
+
+
+int32_t
+nlc_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                int32_t op_ret, int32_t op_errno, struct iatt *buf,
+                struct iatt *preoldparent, struct iatt *postoldparent,
+                struct iatt *prenewparent, struct iatt *postnewparent)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if ((local != NULL) && (op_ret == 0)) {
+                nlc_entry_removed (this, &local->loc, op_ret);
+
+                if ((local->loc2.parent != NULL)
+                    && (local->loc2.name != NULL)) {
+                        nlc_set_exists (this, local->loc2.parent,
+                                        local->loc2.name, 1);
+                }
+        }
+
+        NLC_STACK_UNWIND (rename, frame, op_ret, op_errno, buf, preoldparent,
+                          postoldparent, prenewparent, postnewparent);
+        return 0;
+}
+
+
+int32_t
+nlc_rename (call_frame_t *frame, xlator_t *this, loc_t *oldloc,
+            loc_t *newloc)
+{
+        frame->local = nlc_local_new (oldloc, newloc);
+
+        STACK_WIND (frame, nlc_rename_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->rename, oldloc, newloc);
+        return 0;
+}
+
+
+int32_t
+nlc_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                 int32_t op_ret, int32_t op_errno, gf_dirent_t *entries)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if (local != NULL) {
+                nlc_readdir_collect (this, local->fd, local->offset, op_ret,
+                                     entries);
+        }
+
+        NLC_STACK_UNWIND (readdir, frame, op_ret, op_errno, entries);
+        return 0;
+}
+
+
+int32_t
+nlc_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
+             off_t offset)
+{
+        nlc_local_t *local = NULL;
+
+        nlc_readdir_begin (this, fd, offset);
+
+        local = nlc_local_new (NULL, NULL);
+        if (local != NULL) {
+                local->fd = fd_ref (fd);
+                local->offset = offset;
+        }
+
+        frame->local = local;
+
+        STACK_WIND (frame, nlc_readdir_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->readdir, fd, size, offset);
+        return 0;
+}
+
+
+int32_t
+nlc_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                  int32_t op_ret, int32_t op_errno, gf_dirent_t *entries)
+{
+        nlc_local_t *local = NULL;
+
+        local = frame->local;
+        if (local != NULL) {
+                nlc_readdir_collect (this, local->fd, local->offset, op_ret,
+                                     entries);
+        }
+
+        NLC_STACK_UNWIND (readdirp, frame, op_ret, op_errno, entries);
+        return 0;
+}
+
+
+int32_t
+nlc_readdirp (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
+              off_t offset)
+{
+        nlc_local_t *local = NULL;
+
+        nlc_readdir_begin (this, fd, offset);
+
+        local = nlc_local_new (NULL, NULL);
+        if (local != NULL) {
+                local->fd = fd_ref (fd);
+                local->offset = offset;
+        }
+
+        frame->local = local;
+
+        STACK_WIND (frame, nlc_readdirp_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->readdirp, fd, size, offset);
+        return 0;
+}
+
+
+int32_t
+nlc_releasedir (xlator_t *this, fd_t *fd)
+{
+        nlc_fd_ctx_t *fd_ctx = NULL;
+        uint64_t      value  = 0;
+        int32_t       ret    = -1;
+
+        GF_VALIDATE_OR_GOTO ("nl-cache", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, fd, out);
+
+        ret = fd_ctx_del (fd, this, &value);
+        if (ret == 0) {
+                fd_ctx = (nlc_fd_ctx_t *)(long) value;
+                if (fd_ctx != NULL) {
+                        nlc_fd_ctx_reset (fd_ctx);
+                        GF_FREE (fd_ctx);
+                }
+        }
+
+out:
+        return 0;
+}
+
+
+int32_t
+nlc_forget (xlator_t *this, inode_t *inode)
+{
+        nlc_conf_t *conf  = NULL;
+        nlc_dir_t  *dir   = NULL;
+        uint64_t    value = 0;
+        int32_t     ret   = -1;
+
+        GF_VALIDATE_OR_GOTO ("nl-cache", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, this->private, out);
+        GF_VALIDATE_OR_GOTO (this->name, inode, out);
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                ret = inode_ctx_del (inode, this, &value);
+                if (ret == 0) {
+                        dir = (nlc_dir_t *)(long) value;
+                        __nlc_dir_purge (conf, dir, 0);
+                        GF_FREE (dir);
+                }
+        }
+        UNLOCK (&conf->lock);
+
+out:
+        return 0;
+}
+
+
+int
+nlc_priv_dump (xlator_t *this)
+{
+        nlc_conf_t *conf = NULL;
+        char        key[GF_DUMP_MAX_BUF_LEN];
+        char        key_prefix[GF_DUMP_MAX_BUF_LEN];
+
+        if (!this) {
+                return -1;
+        }
+
+        conf = this->private;
+        if (!conf) {
+                gf_log (this->name, GF_LOG_WARNING, "conf null in xlator");
+                return -1;
+        }
+
+        gf_proc_dump_build_key (key_prefix, "xlator.performance.nl-cache",
+                                "priv");
+
+        gf_proc_dump_add_section (key_prefix);
+
+        LOCK (&conf->lock);
+        {
+                gf_proc_dump_build_key (key, key_prefix, "cache_timeout");
+                gf_proc_dump_write (key, "%d", conf->cache_timeout);
+                gf_proc_dump_build_key (key, key_prefix, "limit");
+                gf_proc_dump_write (key, "%"PRIu64, conf->limit);
+                gf_proc_dump_build_key (key, key_prefix, "names_cached");
+                gf_proc_dump_write (key, "%"PRIu64, conf->current);
+                gf_proc_dump_build_key (key, key_prefix, "hits");
+                gf_proc_dump_write (key, "%"PRIu64, conf->hits);
+                gf_proc_dump_build_key (key, key_prefix, "misses");
+                gf_proc_dump_write (key, "%"PRIu64, conf->misses);
+                gf_proc_dump_build_key (key, key_prefix, "listings");
+                gf_proc_dump_write (key, "%"PRIu64, conf->listings);
+                gf_proc_dump_build_key (key, key_prefix, "purges");
+                gf_proc_dump_write (key, "%"PRIu64, conf->purges);
+        }
+        UNLOCK (&conf->lock);
+
+        return 0;
+}
+
+
+int32_t
+nlc_inodectx_dump (xlator_t *this, inode_t *inode)
+{
+        nlc_conf_t *conf = NULL;
+        nlc_dir_t  *dir  = NULL;
+        char        key[GF_DUMP_MAX_BUF_LEN];
+
+        if (!this || !inode) {
+                return -1;
+        }
+
+        conf = this->private;
+
+        LOCK (&conf->lock);
+        {
+                dir = __nlc_dir_get (this, inode, 0);
+                if (dir != NULL) {
+                        gf_proc_dump_build_key (key,
+                                                "xlator.performance.nl-cache",
+                                                "%s.inode.%ld",
+                                                this->name, inode->ino);
+                        gf_proc_dump_write (key, "names=%"PRIu64", "
+                                            "listing_complete=%d, "
+                                            "gen=%"PRIu64, dir->count,
+                                            dir->listing_complete, dir->gen);
+                }
+        }
+        UNLOCK (&conf->lock);
+
+        return 0;
+}
+
+
+int32_t
+mem_acct_init (xlator_t *this)
+{
+        int     ret = -1;
+
+        if (!this)
+                return ret;
+
+        ret = xlator_mem_acct_init (this, gf_nlc_mt_end + 1);
+
+        if (ret != 0) {
+                gf_log (this->name, GF_LOG_ERROR, "Memory accounting init"
+                        "failed");
+                return ret;
+        }
+
+        return ret;
+}
+
+
+int32_t
+nlc_get_options (xlator_t *this, dict_t *options, int32_t *cache_timeout,
+                 uint64_t *limit)
+{
+        char    *str = NULL;
+        int32_t  ret = -1;
+
+        *cache_timeout = 1;
+        ret = dict_get_str (options, "cache-timeout", &str);
+        if (ret == 0) {
+                ret = gf_string2uint_base10 (str,
+                                             (unsigned int *)cache_timeout);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid cache-timeout value %s", str);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        *limit = NLC_DEFAULT_LIMIT;
+        ret = dict_get_str (options, "limit", &str);
+        if (ret == 0) {
+                ret = gf_string2uint64_base10 (str, limit);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid limit value %s", str);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        return ret;
+}
+
+
+int
+validate_options (xlator_t *this, char **op_errstr)
+{
+        int                 ret = 0;
+        volume_opt_list_t  *vol_opt = NULL;
+        volume_opt_list_t  *tmp;
+
+        if (!this) {
+                gf_log (this->name, GF_LOG_DEBUG, "'this' not a valid ptr");
+                ret =-1;
+                goto out;
+        }
+
+        if (list_empty (&this->volume_options))
+                goto out;
+
+        vol_opt = list_entry (this->volume_options.next,
+                                      volume_opt_list_t, list);
+        list_for_each_entry_safe (vol_opt, tmp, &this->volume_options, list) {
+                ret = validate_xlator_volume_options_attacherr (this,
+                                                                vol_opt->given_opt,
+                                                                op_errstr);
+        }
+
+out:
+        return ret;
+}
+
+
+int
+reconfigure (xlator_t *this, dict_t *options)
+{
+        nlc_conf_t *conf          = NULL;
+        int32_t     cache_timeout = 0;
+        uint64_t    limit         = 0;
+        int32_t     ret           = -1;
+
+        GF_VALIDATE_OR_GOTO ("nl-cache", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, this->private, out);
+        GF_VALIDATE_OR_GOTO (this->name, options, out);
+
+        conf = this->private;
+
+        ret = nlc_get_options (this, options, &cache_timeout, &limit);
+        if (ret != 0) {
+                goto out;
+        }
+
+        LOCK (&conf->lock);
+        {
+                conf->cache_timeout = cache_timeout;
+                conf->limit = limit;
+                __nlc_prune (conf, NULL);
+        }
+        UNLOCK (&conf->lock);
+
+        gf_log (this->name, GF_LOG_DEBUG, "Reconfiguring cache-timeout to %d"
+                ", limit to %"PRIu64, cache_timeout, limit);
+out:
+        return ret;
+}
+
+
+int32_t
+init (xlator_t *this)
+{
+        nlc_conf_t *conf = NULL;
+        int32_t     ret  = -1;
+
+        if (!this->children || this->children->next) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "FATAL: volume (%s) not configured with exactly one "
+                        "child", this->name);
+                goto out;
+        }
+
+        if (!this->parents) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "dangling volume. check volfile ");
+        }
+
+        conf = GF_CALLOC (1, sizeof (*conf), gf_nlc_mt_nlc_conf_t);
+        if (conf == NULL) {
+                goto out;
+        }
+
+        ret = nlc_get_options (this, this->options, &conf->cache_timeout,
+                               &conf->limit);
+        if (ret != 0) {
+                goto out;
+        }
+
+        LOCK_INIT (&conf->lock);
+        INIT_LIST_HEAD (&conf->lru);
+
+        this->private = conf;
+        ret = 0;
+out:
+        if ((ret != 0) && (conf != NULL)) {
+                GF_FREE (conf);
+        }
+
+        return ret;
+}
+
+
+void
+fini (xlator_t *this)
+{
+        nlc_conf_t *conf = NULL;
+
+        conf = this->private;
+        if (conf == NULL) {
+                return;
+        }
+
+        this->private = NULL;
+
+        LOCK_DESTROY (&conf->lock);
+        GF_FREE (conf);
+
+        return;
+}
+
+
+struct xlator_fops fops = {
+        .lookup      = nlc_lookup,
+        .mknod       = nlc_mknod,
+        .mkdir       = nlc_mkdir,
+        .symlink     = nlc_symlink,
+        .create      = nlc_create,
+        .link        = nlc_link,
+        .unlink      = nlc_unlink,
+        .rmdir       = nlc_rmdir,
+        .rename      = nlc_rename,
+        .readdir     = nlc_readdir,
+        .readdirp    = nlc_readdirp,
+};
+
+struct xlator_cbks cbks = {
+        .forget     = nlc_forget,
+        .releasedir = nlc_releasedir,
+};
+
+struct xlator_dumpops dumpops = {
+        .priv      = nlc_priv_dump,
+        .inodectx  = nlc_inodectx_dump,
+};
+
+struct volume_options options[] = {
+        { .key  = {"cache-timeout"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 60,
+          .description = "Seconds for which a negative entry or a directory "
+                         "listing is trusted."
+        },
+        { .key  = {"limit"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 16 * 1048576,
+          .description = "Maximum number of names cached across all "
+                         "directories, 0 disables the cache."
+        },
+        { .key  = {NULL} },
+};
@@ -0,0 +1,108 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __NL_CACHE_H
+#define __NL_CACHE_H
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "glusterfs.h"
+#include "logging.h"
+#include "dict.h"
+#include "xlator.h"
+#include "list.h"
+#include "hashfn.h"
+#include "common-utils.h"
+#include "defaults.h"
+#include <time.h>
+#include "nl-cache-mem-types.h"
+
+#define NLC_HASH_BUCKETS   64
+#define NLC_DEFAULT_LIMIT  131072
+
+/*
+ * A name cached under a parent directory. Negative names come from
+ * ENOENT replies (or unlinks done through this client) and expire on
+ * their own; positive names come from a complete readdir of the parent
+ * and are only valid as long as that listing is.
+ */
+struct nlc_name {
+        struct list_head  list;
+        time_t            neg_time;
+        char              negative;
+        char              name[0];
+};
+typedef struct nlc_name nlc_name_t;
+
+/* kept in the inode ctx of the parent directory */
+struct nlc_dir {
+        struct list_head  names[NLC_HASH_BUCKETS];
+        uint64_t          count;
+        char              listing_complete;
+        time_t            listing_time;
+        uint64_t          gen;            /* bumped on every entry change */
+        struct list_head  lru;
+        inode_t          *inode;
+};
+typedef struct nlc_dir nlc_dir_t;
+
+/* accumulates the names of a directory while it is read from offset 0 */
+struct nlc_fd_ctx {
+        off_t             next_off;
+        uint64_t          gen;
+        char              valid;
+        uint64_t          count;
+        struct list_head  names;
+};
+typedef struct nlc_fd_ctx nlc_fd_ctx_t;
+
+struct nlc_local {
+        loc_t             loc;
+        loc_t             loc2;
+        fd_t             *fd;
+        off_t             offset;
+        uint64_t          gen;            /* of loc.parent at wind time */
+};
+typedef struct nlc_local nlc_local_t;
+
+struct nlc_conf {
+        int32_t           cache_timeout;
+        uint64_t          limit;          /* names held across all dirs */
+        uint64_t          current;
+        struct list_head  lru;            /* nlc_dir_t, oldest first */
+        uint64_t          hits;
+        uint64_t          misses;
+        uint64_t          listings;
+        uint64_t          purges;
+        uint64_t          gen;            /* last generation handed out */
+        gf_lock_t         lock;
+};
+typedef struct nlc_conf nlc_conf_t;
+
+#define NLC_STACK_UNWIND(op, frame, params ...) do {            \
+                nlc_local_t *__local = frame->local;            \
+                frame->local = NULL;                            \
+                STACK_UNWIND_STRICT (op, frame, params);        \
+                nlc_local_free (__local);                       \
+        } while (0)
+
+#endif /* __NL_CACHE_H */
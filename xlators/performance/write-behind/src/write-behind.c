@@ -41,25 +41,43 @@
 #define WB_AGGREGATE_SIZE 131072 /* 128 KB */
 #define WB_WINDOW_SIZE    1048576 /* 1MB */
 
+/* most writes sent along with a flush in one compound call */
+#define WB_COMPOUND_MAX_OPS 16
+
+/* open flags which make writes through two fds non interchangeable */
+#define WB_SYNC_FLAGS     (O_DIRECT | O_SYNC)
+
 typedef struct list_head list_head_t;
 struct wb_conf;
 struct wb_page;
 struct wb_file;
+struct wb_inode;
+
+/* write-behind state shared by all the fds opened on an inode. Keeping the
+ * request queue per inode orders writes done through different fds against
+ * each other and lets them be coalesced into the same sync.
+ */
+typedef struct wb_inode {
+        size_t       window_conf;
+        size_t       window_current;
+        size_t       aggregate_current;
+        list_head_t  request;
+        list_head_t  passive_requests;
+        list_head_t  files;
+        gf_lock_t    lock;
+        xlator_t    *this;
+}wb_inode_t;
 
 typedef struct wb_file {
         int          disabled;
         uint64_t     disable_till;
         size_t       window_conf;
-        size_t       window_current;
         int32_t      flags;
-        size_t       aggregate_current;
-        int32_t      refcount;
         int32_t      op_ret;
         int32_t      op_errno;
-        list_head_t  request;
-        list_head_t  passive_requests;
+        list_head_t  list;
         fd_t        *fd;
-        gf_lock_t    lock;
+        wb_inode_t  *wb_inode;
         xlator_t    *this;
 }wb_file_t;
 
@@ -72,6 +90,7 @@ typedef struct wb_request {
         size_t          write_size;
         int32_t         refcount;
         wb_file_t      *file;
+        wb_inode_t     *wb_inode;
         glusterfs_fop_t fop;
         union {
                 struct  {
@@ -109,6 +128,8 @@ typedef struct wb_local {
         int32_t         flags;
         int32_t         wbflags;
         struct wb_file *file;
+        wb_inode_t     *wb_inode;
+        fd_t           *fd;
         wb_request_t   *request;
         int             op_ret;
         int             op_errno;
@@ -120,10 +141,10 @@ typedef struct wb_conf wb_conf_t;
 typedef struct wb_page wb_page_t;
 
 int32_t
-wb_process_queue (call_frame_t *frame, wb_file_t *file);
+wb_process_queue (call_frame_t *frame, wb_inode_t *wb_inode);
 
 ssize_t
-wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds);
+wb_sync (call_frame_t *frame, wb_inode_t *wb_inode, list_head_t *winds);
 
 ssize_t
 __wb_mark_winds (list_head_t *list, list_head_t *winds, size_t aggregate_size,
@@ -161,18 +182,18 @@ out:
 static int
 wb_request_unref (wb_request_t *this)
 {
-        wb_file_t *file = NULL;
-        int        ret  = -1;
+        wb_inode_t *wb_inode = NULL;
+        int         ret      = -1;
 
         GF_VALIDATE_OR_GOTO ("write-behind", this, out);
 
-        file = this->file;
+        wb_inode = this->wb_inode;
 
-        LOCK (&file->lock);
+        LOCK (&wb_inode->lock);
         {
                 ret = __wb_request_unref (this);
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
 out:
         return ret;
@@ -201,33 +222,78 @@ out:
 wb_request_t *
 wb_request_ref (wb_request_t *this)
 {
-        wb_file_t *file = NULL;
+        wb_inode_t *wb_inode = NULL;
 
         GF_VALIDATE_OR_GOTO ("write-behind", this, out);
 
-        file = this->file;
-        LOCK (&file->lock);
+        wb_inode = this->wb_inode;
+        LOCK (&wb_inode->lock);
         {
                 this = __wb_request_ref (this);
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
 out:
         return this;
 }
 
 
+/* a failed sync is reported on the next write, flush or fsync of every fd
+ * opened on the inode, since the data written through them could have been
+ * part of it.
+ */
+static void
+__wb_inode_set_error (wb_inode_t *wb_inode, int32_t op_errno)
+{
+        wb_file_t *file = NULL;
+
+        list_for_each_entry (file, &wb_inode->files, list) {
+                file->op_ret = -1;
+                file->op_errno = op_errno;
+        }
+}
+
+
+static void
+wb_inode_set_error (wb_inode_t *wb_inode, int32_t op_errno)
+{
+        GF_VALIDATE_OR_GOTO ("write-behind", wb_inode, out);
+
+        LOCK (&wb_inode->lock);
+        {
+                __wb_inode_set_error (wb_inode, op_errno);
+        }
+        UNLOCK (&wb_inode->lock);
+
+out:
+        return;
+}
+
+
+static void
+__wb_mark_flush_all (wb_inode_t *wb_inode)
+{
+        wb_request_t *request = NULL;
+
+        list_for_each_entry (request, &wb_inode->request, list) {
+                if (request->stub && request->stub->fop == GF_FOP_WRITE) {
+                        request->flags.write_request.flush_all = 1;
+                }
+        }
+}
+
+
 wb_request_t *
-wb_enqueue (wb_file_t *file, call_stub_t *stub)
+wb_enqueue (wb_inode_t *wb_inode, wb_file_t *file, call_stub_t *stub)
 {
-        wb_request_t *request = NULL, *tmp = NULL;
+        wb_request_t *request = NULL;
         call_frame_t *frame   = NULL;
         wb_local_t   *local   = NULL;
         struct iovec *vector  = NULL;
         int32_t       count   = 0;
 
-        GF_VALIDATE_OR_GOTO ("write-behind", file, out);
-        GF_VALIDATE_OR_GOTO (file->this->name, stub, out);
+        GF_VALIDATE_OR_GOTO ("write-behind", wb_inode, out);
+        GF_VALIDATE_OR_GOTO (wb_inode->this->name, stub, out);
 
         request = GF_CALLOC (1, sizeof (*request), gf_wb_mt_wb_request_t);
         if (request == NULL) {
@@ -241,6 +307,7 @@ wb_enqueue (wb_file_t *file, call_stub_t *stub)
 
         request->stub = stub;
         request->file = file;
+        request->wb_inode = wb_inode;
         request->fop  = stub->fop;
 
         frame = stub->frame;
@@ -262,9 +329,9 @@ wb_enqueue (wb_file_t *file, call_stub_t *stub)
                 request->flags.write_request.virgin = 1;
         }
 
-        LOCK (&file->lock);
+        LOCK (&wb_inode->lock);
         {
-                list_add_tail (&request->list, &file->request);
+                list_add_tail (&request->list, &wb_inode->request);
                 if (stub->fop == GF_FOP_WRITE) {
                         /* reference for stack winding */
                         __wb_request_ref (request);
@@ -272,44 +339,126 @@ wb_enqueue (wb_file_t *file, call_stub_t *stub)
                         /* reference for stack unwinding */
                         __wb_request_ref (request);
 
-                        file->aggregate_current += request->write_size;
-                } else {
-                        list_for_each_entry (tmp, &file->request, list) {
-                                if (tmp->stub && tmp->stub->fop
-                                    == GF_FOP_WRITE) {
-                                        tmp->flags.write_request.flush_all = 1;
-                                }
+                        wb_inode->aggregate_current += request->write_size;
+
+                        /* writes through an fd with a zero window are not
+                         * acknowledged till they reach the server, don't
+                         * make them wait for more data to aggregate.
+                         */
+                        if (file->window_conf == 0) {
+                                __wb_mark_flush_all (wb_inode);
                         }
+                } else {
+                        __wb_mark_flush_all (wb_inode);
 
                         /*reference for resuming */
                         __wb_request_ref (request);
                 }
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
 out:
         return request;
 }
 
 
+wb_inode_t *
+wb_inode_ctx_get (xlator_t *this, inode_t *inode)
+{
+        uint64_t    value    = 0;
+        wb_inode_t *wb_inode = NULL;
+        int         ret      = -1;
+
+        GF_VALIDATE_OR_GOTO ("write-behind", this, out);
+
+        if (inode == NULL) {
+                goto out;
+        }
+
+        ret = inode_ctx_get (inode, this, &value);
+        if (ret == 0) {
+                wb_inode = (wb_inode_t *)(long)value;
+        }
+
+out:
+        return wb_inode;
+}
+
+
+wb_inode_t *
+wb_inode_create (xlator_t *this, inode_t *inode)
+{
+        wb_inode_t *wb_inode = NULL;
+        wb_conf_t  *conf     = NULL;
+        uint64_t    value    = 0;
+        int         ret      = -1;
+
+        GF_VALIDATE_OR_GOTO ("write-behind", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, inode, out);
+
+        conf = this->private;
+
+        LOCK (&inode->lock);
+        {
+                ret = __inode_ctx_get (inode, this, &value);
+                if (ret == 0) {
+                        wb_inode = (wb_inode_t *)(long)value;
+                        goto unlock;
+                }
+
+                wb_inode = GF_CALLOC (1, sizeof (*wb_inode),
+                                      gf_wb_mt_wb_inode_t);
+                if (wb_inode == NULL) {
+                        goto unlock;
+                }
+
+                INIT_LIST_HEAD (&wb_inode->request);
+                INIT_LIST_HEAD (&wb_inode->passive_requests);
+                INIT_LIST_HEAD (&wb_inode->files);
+
+                wb_inode->this = this;
+                wb_inode->window_conf = conf->window_size;
+
+                LOCK_INIT (&wb_inode->lock);
+
+                ret = __inode_ctx_put (inode, this, (uint64_t)(long)wb_inode);
+                if (ret != 0) {
+                        LOCK_DESTROY (&wb_inode->lock);
+                        GF_FREE (wb_inode);
+                        wb_inode = NULL;
+                }
+        }
+unlock:
+        UNLOCK (&inode->lock);
+
+out:
+        return wb_inode;
+}
+
+
 wb_file_t *
 wb_file_create (xlator_t *this, fd_t *fd, int32_t flags)
 {
-        wb_file_t *file = NULL;
-        wb_conf_t *conf = NULL;
+        wb_file_t  *file     = NULL;
+        wb_inode_t *wb_inode = NULL;
+        wb_conf_t  *conf     = NULL;
 
         GF_VALIDATE_OR_GOTO ("write-behind", this, out);
         GF_VALIDATE_OR_GOTO (this->name, fd, out);
 
         conf = this->private;
 
+        wb_inode = wb_inode_create (this, fd->inode);
+        if (wb_inode == NULL) {
+                goto out;
+        }
+
         file = GF_CALLOC (1, sizeof (*file), gf_wb_mt_wb_file_t);
         if (file == NULL) {
                 goto out;
         }
 
-        INIT_LIST_HEAD (&file->request);
-        INIT_LIST_HEAD (&file->passive_requests);
+        INIT_LIST_HEAD (&file->list);
 
         /*
           fd_ref() not required, file should never decide the existance of
@@ -318,11 +467,15 @@ wb_file_create (xlator_t *this, fd_t *fd, int32_t flags)
         file->fd= fd;
         file->disable_till = conf->disable_till;
         file->this = this;
-        file->refcount = 1;
         file->window_conf = conf->window_size;
         file->flags = flags;
+        file->wb_inode = wb_inode;
 
-        LOCK_INIT (&file->lock);
+        LOCK (&wb_inode->lock);
+        {
+                list_add_tail (&file->list, &wb_inode->files);
+        }
+        UNLOCK (&wb_inode->lock);
 
         fd_ctx_set (fd, this, (uint64_t)(long)file);
 
@@ -334,20 +487,19 @@ out:
 void
 wb_file_destroy (wb_file_t *file)
 {
-        int32_t refcount = 0;
+        wb_inode_t *wb_inode = NULL;
 
         GF_VALIDATE_OR_GOTO ("write-behind", file, out);
 
-        LOCK (&file->lock);
+        wb_inode = file->wb_inode;
+
+        LOCK (&wb_inode->lock);
         {
-                refcount = --file->refcount;
+                list_del_init (&file->list);
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
-        if (!refcount){
-                LOCK_DESTROY (&file->lock);
-                GF_FREE (file);
-        }
+        GF_FREE (file);
 
 out:
         return;
@@ -360,7 +512,7 @@ wb_sync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
 {
         wb_local_t   *local             = NULL;
         list_head_t  *winds             = NULL;
-        wb_file_t    *file              = NULL;
+        wb_inode_t   *wb_inode          = NULL;
         wb_request_t *request           = NULL, *dummy = NULL;
         wb_local_t   *per_request_local = NULL;
         int32_t       ret               = -1;
@@ -372,10 +524,12 @@ wb_sync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
         local = frame->local;
         winds = &local->winds;
 
-        file = local->file;
-        GF_VALIDATE_OR_GOTO (this->name, file, out);
+        wb_inode = local->wb_inode;
+        GF_VALIDATE_OR_GOTO (this->name, wb_inode, out);
 
-        LOCK (&file->lock);
+        fd = local->fd;
+
+        LOCK (&wb_inode->lock);
         {
                 list_for_each_entry_safe (request, dummy, winds, winds) {
                         request->flags.write_request.got_reply = 1;
@@ -388,29 +542,22 @@ wb_sync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                         }
 
                         if (request->flags.write_request.write_behind) {
-                                file->window_current -= request->write_size;
+                                wb_inode->window_current -= request->write_size;
                         }
 
                         __wb_request_unref (request);
                 }
 
                 if (op_ret == -1) {
-                        file->op_ret = op_ret;
-                        file->op_errno = op_errno;
+                        __wb_inode_set_error (wb_inode, op_errno);
                 }
-                fd = file->fd;
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
-        ret = wb_process_queue (frame, file);
+        ret = wb_process_queue (frame, wb_inode);
         if (ret == -1) {
                 if (errno == ENOMEM) {
-                        LOCK (&file->lock);
-                        {
-                                file->op_ret = -1;
-                                file->op_errno = ENOMEM;
-                        }
-                        UNLOCK (&file->lock);
+                        wb_inode_set_error (wb_inode, ENOMEM);
                 }
 
                 gf_log (this->name, GF_LOG_WARNING,
@@ -427,8 +574,33 @@ out:
 }
 
 
+/* writes done through different fds can be sent in a single call, as long
+ * as the fds agree on the open flags which change how the server treats a
+ * write. O_APPEND writes are never mixed with writes from other fds, since
+ * their offsets are not meaningful.
+ */
+static int
+wb_requests_mergeable (wb_request_t *first, wb_request_t *request)
+{
+        int32_t first_flags = 0, flags = 0;
+
+        if (first->file == request->file) {
+                return 1;
+        }
+
+        first_flags = first->file->flags;
+        flags = request->file->flags;
+
+        if ((first_flags & O_APPEND) || (flags & O_APPEND)) {
+                return 0;
+        }
+
+        return ((first_flags & WB_SYNC_FLAGS) == (flags & WB_SYNC_FLAGS));
+}
+
+
 ssize_t
-wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
+wb_sync (call_frame_t *frame, wb_inode_t *wb_inode, list_head_t *winds)
 {
         wb_request_t   *dummy         = NULL, *request = NULL;
         wb_request_t   *first_request = NULL, *next = NULL;
@@ -444,15 +616,15 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
         fd_t           *fd            = NULL;
         int32_t         op_errno      = -1;
 
-        GF_VALIDATE_OR_GOTO_WITH_ERROR ((file ? file->this->name
+        GF_VALIDATE_OR_GOTO_WITH_ERROR ((wb_inode ? wb_inode->this->name
                                          : "write-behind"), frame,
                                         out, bytes, -1);
-        GF_VALIDATE_OR_GOTO_WITH_ERROR (frame->this->name, file, out, bytes,
-                                        -1);
+        GF_VALIDATE_OR_GOTO_WITH_ERROR (frame->this->name, wb_inode, out,
+                                        bytes, -1);
         GF_VALIDATE_OR_GOTO_WITH_ERROR (frame->this->name, winds, out, bytes,
                                         -1);
 
-        conf = file->this->private;
+        conf = wb_inode->this->private;
         list_for_each_entry (request, winds, winds) {
                 total_count += request->stub->args.writev.count;
                 if (total_count > 0) {
@@ -461,8 +633,8 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
         }
 
         if (total_count == 0) {
-                gf_log (file->this->name, GF_LOG_TRACE, "no vectors are to be"
-                        "synced");
+                gf_log (wb_inode->this->name, GF_LOG_TRACE, "no vectors are "
+                        "to be synced");
                 goto out;
         }
 
@@ -524,7 +696,8 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
                     || ((count + next->stub->args.writev.count)
                         > MAX_VECTOR_COUNT)
                     || ((current_size + next->write_size)
-                        > conf->aggregate_size)) {
+                        > conf->aggregate_size)
+                    || !wb_requests_mergeable (first_request, next)) {
 
                         sync_frame = copy_frame (frame);
                         if (sync_frame == NULL) {
@@ -533,16 +706,15 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
                                 goto out;
                         }
 
-                        sync_frame->local = local;
-                        local->file = file;
-
-                        LOCK (&file->lock);
-                        {
-                                fd = file->fd;
-                        }
-                        UNLOCK (&file->lock);
+                        /* the batch goes out through the fd of its first
+                         * request, which may be one of several fds of the
+                         * inode.
+                         */
+                        fd = fd_ref (first_request->stub->args.writev.fd);
 
-                        fd_ref (fd);
+                        sync_frame->local = local;
+                        local->wb_inode = wb_inode;
+                        local->fd = fd;
 
                         bytes += current_size;
                         STACK_WIND (sync_frame, wb_sync_cbk,
@@ -602,13 +774,8 @@ out:
                         }
                 }
 
-                if (file != NULL) {
-                        LOCK (&file->lock);
-                        {
-                                file->op_ret = -1;
-                                file->op_errno = op_errno;
-                        }
-                        UNLOCK (&file->lock);
+                if (wb_inode != NULL) {
+                        wb_inode_set_error (wb_inode, op_errno);
                 }
         }
 
@@ -623,15 +790,14 @@ wb_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
         wb_local_t   *local         = NULL;
         wb_request_t *request       = NULL;
         call_frame_t *process_frame = NULL;
-        wb_file_t    *file          = NULL;
+        wb_inode_t   *wb_inode      = NULL;
         int32_t       ret           = -1;
-        fd_t         *fd            = NULL;
 
         GF_ASSERT (frame);
         GF_ASSERT (this);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
 
         request = local->request;
         if (request) {
@@ -649,15 +815,10 @@ wb_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
         }
 
         if (process_frame != NULL) {
-                ret = wb_process_queue (process_frame, file);
+                ret = wb_process_queue (process_frame, wb_inode);
                 if (ret == -1) {
-                        if ((errno == ENOMEM) && (file != NULL)) {
-                                LOCK (&file->lock);
-                                {
-                                        file->op_ret = -1;
-                                        file->op_errno = ENOMEM;
-                                }
-                                UNLOCK (&file->lock);
+                        if ((errno == ENOMEM) && (wb_inode != NULL)) {
+                                wb_inode_set_error (wb_inode, ENOMEM);
                         }
 
                         gf_log (this->name, GF_LOG_WARNING,
@@ -667,16 +828,6 @@ wb_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                 STACK_DESTROY (process_frame->root);
         }
 
-        if (file) {
-                LOCK (&file->lock);
-                {
-                        fd = file->fd;
-                }
-                UNLOCK (&file->lock);
-
-                fd_unref (fd);
-        }
-
         return 0;
 }
 
@@ -696,10 +847,8 @@ wb_stat_helper (call_frame_t *frame, xlator_t *this, loc_t *loc)
 int32_t
 wb_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
 {
-        wb_file_t    *file     = NULL;
-        fd_t         *iter_fd  = NULL;
+        wb_inode_t   *wb_inode = NULL;
         wb_local_t   *local    = NULL;
-        uint64_t      tmp_file = 0;
         call_stub_t  *stub     = NULL;
         wb_request_t *request  = NULL;
         int32_t       ret      = -1, op_errno = EINVAL;
@@ -708,18 +857,7 @@ wb_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
         GF_VALIDATE_OR_GOTO (frame->this->name, this, unwind);
         GF_VALIDATE_OR_GOTO (frame->this->name, loc, unwind);
 
-        if (loc->inode) {
-                /* FIXME: fd_lookup extends life of fd till stat returns */
-                iter_fd = fd_lookup (loc->inode, frame->root->pid);
-                if (iter_fd) {
-                        if (!fd_ctx_get (iter_fd, this, &tmp_file)) {
-                                file = (wb_file_t *)(long)tmp_file;
-                        } else {
-                                fd_unref (iter_fd);
-                                iter_fd = NULL;
-                        }
-                }
-        }
+        wb_inode = wb_inode_ctx_get (this, loc->inode);
 
         local = GF_CALLOC (1, sizeof (*local), gf_wb_mt_wb_local_t);
         if (local == NULL) {
@@ -727,24 +865,24 @@ wb_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
                 goto unwind;
         }
 
-        local->file = file;
+        local->wb_inode = wb_inode;
 
         frame->local = local;
 
-        if (file) {
+        if (wb_inode) {
                 stub = fop_stat_stub (frame, wb_stat_helper, loc);
                 if (stub == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (wb_inode, NULL, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -762,10 +900,6 @@ unwind:
                 call_stub_destroy (stub);
         }
 
-        if (iter_fd != NULL) {
-                fd_unref (iter_fd);
-        }
-
         return 0;
 }
 
@@ -774,20 +908,20 @@ int32_t
 wb_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
               int32_t op_errno, struct iatt *buf)
 {
-        wb_local_t   *local   = NULL;
-        wb_request_t *request = NULL;
-        wb_file_t    *file    = NULL;
-        int32_t       ret     = -1;
+        wb_local_t   *local    = NULL;
+        wb_request_t *request  = NULL;
+        wb_inode_t   *wb_inode = NULL;
+        int32_t       ret      = -1;
 
         GF_ASSERT (frame);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
 
         request = local->request;
-        if ((file != NULL) && (request != NULL)) {
+        if ((wb_inode != NULL) && (request != NULL)) {
                 wb_request_unref (request);
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         if (errno == ENOMEM) {
                                 op_ret = -1;
@@ -855,13 +989,15 @@ wb_fstat (call_frame_t *frame, xlator_t *this, fd_t *fd)
         frame->local = local;
 
         if (file) {
+                local->wb_inode = file->wb_inode;
+
                 stub = fop_fstat_stub (frame, wb_fstat_helper, fd);
                 if (stub == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (file->wb_inode, file, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
@@ -870,7 +1006,7 @@ wb_fstat (call_frame_t *frame, xlator_t *this, fd_t *fd)
                 /*
                   FIXME:should the request queue be emptied in case of error?
                 */
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -900,18 +1036,17 @@ wb_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 {
         wb_local_t   *local         = NULL;
         wb_request_t *request       = NULL;
-        wb_file_t    *file          = NULL;
+        wb_inode_t   *wb_inode      = NULL;
         call_frame_t *process_frame = NULL;
         int32_t       ret           = -1;
-        fd_t         *fd            = NULL;
 
         GF_ASSERT (frame);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
         request = local->request;
 
-        if ((request != NULL) && (file != NULL)) {
+        if ((request != NULL) && (wb_inode != NULL)) {
                 process_frame = copy_frame (frame);
                 if (process_frame == NULL) {
                         op_ret = -1;
@@ -927,15 +1062,10 @@ wb_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         if (process_frame != NULL) {
-                ret = wb_process_queue (process_frame, file);
+                ret = wb_process_queue (process_frame, wb_inode);
                 if (ret == -1) {
-                        if ((errno == ENOMEM) && (file != NULL)) {
-                                LOCK (&file->lock);
-                                {
-                                        file->op_ret = -1;
-                                        file->op_errno = ENOMEM;
-                                }
-                                UNLOCK (&file->lock);
+                        if (errno == ENOMEM) {
+                                wb_inode_set_error (wb_inode, ENOMEM);
                         }
 
                         gf_log (this->name, GF_LOG_WARNING,
@@ -945,16 +1075,6 @@ wb_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 STACK_DESTROY (process_frame->root);
         }
 
-        if (file) {
-                LOCK (&file->lock);
-                {
-                        fd = file->fd;
-                }
-                UNLOCK (&file->lock);
-
-                fd_unref (fd);
-        }
-
         return 0;
 }
 
@@ -976,10 +1096,8 @@ wb_truncate_helper (call_frame_t *frame, xlator_t *this, loc_t *loc,
 int32_t
 wb_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
 {
-        wb_file_t    *file     = NULL;
-        fd_t         *iter_fd  = NULL;
+        wb_inode_t   *wb_inode = NULL;
         wb_local_t   *local    = NULL;
-        uint64_t      tmp_file = 0;
         call_stub_t  *stub     = NULL;
         wb_request_t *request  = NULL;
         int32_t       ret      = -1, op_errno = EINVAL;
@@ -988,20 +1106,7 @@ wb_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
         GF_VALIDATE_OR_GOTO (frame->this->name, this, unwind);
         GF_VALIDATE_OR_GOTO (frame->this->name, loc, unwind);
 
-        if (loc->inode) {
-                /*
-                  FIXME: fd_lookup extends life of fd till the execution of
-                  truncate_cbk
-                */
-                iter_fd = fd_lookup (loc->inode, frame->root->pid);
-                if (iter_fd) {
-                        if (!fd_ctx_get (iter_fd, this, &tmp_file)){
-                                file = (wb_file_t *)(long)tmp_file;
-                        } else {
-                                fd_unref (iter_fd);
-                        }
-                }
-        }
+        wb_inode = wb_inode_ctx_get (this, loc->inode);
 
         local = GF_CALLOC (1, sizeof (*local),
                            gf_wb_mt_wb_local_t);
@@ -1010,10 +1115,10 @@ wb_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
                 goto unwind;
         }
 
-        local->file = file;
+        local->wb_inode = wb_inode;
 
         frame->local = local;
-        if (file) {
+        if (wb_inode) {
                 stub = fop_truncate_stub (frame, wb_truncate_helper, loc,
                                           offset);
                 if (stub == NULL) {
@@ -1021,13 +1126,13 @@ wb_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (wb_inode, NULL, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -1055,20 +1160,20 @@ wb_ftruncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                   int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
                   struct iatt *postbuf)
 {
-        wb_local_t   *local   = NULL;
-        wb_request_t *request = NULL;
-        wb_file_t    *file    = NULL;
-        int32_t       ret     = -1;
+        wb_local_t   *local    = NULL;
+        wb_request_t *request  = NULL;
+        wb_inode_t   *wb_inode = NULL;
+        int32_t       ret      = -1;
 
         GF_ASSERT (frame);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
         request = local->request;
 
-        if ((request != NULL) && (file != NULL)) {
+        if ((request != NULL) && (wb_inode != NULL)) {
                 wb_request_unref (request);
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         if (errno == ENOMEM) {
                                 op_ret = -1;
@@ -1138,6 +1243,8 @@ wb_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset)
         frame->local = local;
 
         if (file) {
+                local->wb_inode = file->wb_inode;
+
                 stub = fop_ftruncate_stub (frame, wb_ftruncate_helper, fd,
                                            offset);
                 if (stub == NULL) {
@@ -1145,13 +1252,13 @@ wb_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset)
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (file->wb_inode, file, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -1182,14 +1289,13 @@ wb_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         wb_local_t   *local         = NULL;
         wb_request_t *request       = NULL;
         call_frame_t *process_frame = NULL;
-        wb_file_t    *file          = NULL;
+        wb_inode_t   *wb_inode      = NULL;
         int32_t       ret           = -1;
-        fd_t         *fd            = NULL;
 
         GF_ASSERT (frame);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
         request = local->request;
 
         if (request) {
@@ -1208,15 +1314,10 @@ wb_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         if (request && (process_frame != NULL)) {
-                ret = wb_process_queue (process_frame, file);
+                ret = wb_process_queue (process_frame, wb_inode);
                 if (ret == -1) {
-                        if ((errno == ENOMEM) && (file != NULL)) {
-                                LOCK (&file->lock);
-                                {
-                                        file->op_ret = -1;
-                                        file->op_errno = ENOMEM;
-                                }
-                                UNLOCK (&file->lock);
+                        if ((errno == ENOMEM) && (wb_inode != NULL)) {
+                                wb_inode_set_error (wb_inode, ENOMEM);
                         }
 
                         gf_log (this->name, GF_LOG_WARNING,
@@ -1226,16 +1327,6 @@ wb_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 STACK_DESTROY (process_frame->root);
         }
 
-        if (file) {
-                LOCK (&file->lock);
-                {
-                        fd = file->fd;
-                }
-                UNLOCK (&file->lock);
-
-                fd_unref (fd);
-        }
-
         return 0;
 }
 
@@ -1257,10 +1348,8 @@ int32_t
 wb_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
             struct iatt *stbuf, int32_t valid)
 {
-        wb_file_t    *file     = NULL;
-        fd_t         *iter_fd  = NULL;
+        wb_inode_t   *wb_inode = NULL;
         wb_local_t   *local    = NULL;
-        uint64_t      tmp_file = 0;
         call_stub_t  *stub     = NULL;
         wb_request_t *request  = NULL;
         int32_t       ret      = -1, op_errno = EINVAL;
@@ -1284,25 +1373,11 @@ wb_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
 
-        if (loc->inode) {
-                /*
-                  FIXME: fd_lookup extends life of fd till the execution
-                  of wb_utimens_cbk
-                */
-                iter_fd = fd_lookup (loc->inode, frame->root->pid);
-                if (iter_fd) {
-                        if (!fd_ctx_get (iter_fd, this, &tmp_file)) {
-                                file = (wb_file_t *)(long)tmp_file;
-                        } else {
-                                fd_unref (iter_fd);
-                        }
-                }
+        wb_inode = wb_inode_ctx_get (this, loc->inode);
 
-        }
+        local->wb_inode = wb_inode;
 
-        local->file = file;
-
-        if (file) {
+        if (wb_inode) {
                 stub = fop_setattr_stub (frame, wb_setattr_helper, loc, stbuf,
                                          valid);
                 if (stub == NULL) {
@@ -1310,13 +1385,13 @@ wb_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (wb_inode, NULL, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -1369,7 +1444,7 @@ wb_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                         goto out;
                 }
 
-                LOCK (&file->lock);
+                LOCK (&file->wb_inode->lock);
                 {
                         /* If O_DIRECT then, we disable chaching */
                         if (((flags & O_DIRECT) == O_DIRECT)
@@ -1383,7 +1458,7 @@ wb_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                                 file->disabled = 1;
                         }
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&file->wb_inode->lock);
         }
 
 out:
@@ -1447,7 +1522,7 @@ wb_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         goto out;
                 }
 
-                LOCK (&file->lock);
+                LOCK (&file->wb_inode->lock);
                 {
                         /* If O_DIRECT then, we disable chaching */
                         if (frame->local) {
@@ -1459,7 +1534,7 @@ wb_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                 }
                         }
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&file->wb_inode->lock);
         }
 
         frame->local = NULL;
@@ -1502,7 +1577,8 @@ unwind:
  * will fit into a single write call to server.
  */
 size_t
-__wb_mark_wind_all (wb_file_t *file, list_head_t *list, list_head_t *winds)
+__wb_mark_wind_all (wb_inode_t *wb_inode, list_head_t *list,
+                    list_head_t *winds)
 {
         wb_request_t *request         = NULL;
         size_t        size            = 0;
@@ -1511,11 +1587,11 @@ __wb_mark_wind_all (wb_file_t *file, list_head_t *list, list_head_t *winds)
         wb_conf_t    *conf            = NULL;
         int           count           = 0;
 
-        GF_VALIDATE_OR_GOTO ("write-behind", file, out);
-        GF_VALIDATE_OR_GOTO (file->this->name, list, out);
-        GF_VALIDATE_OR_GOTO (file->this->name, winds, out);
+        GF_VALIDATE_OR_GOTO ("write-behind", wb_inode, out);
+        GF_VALIDATE_OR_GOTO (wb_inode->this->name, list, out);
+        GF_VALIDATE_OR_GOTO (wb_inode->this->name, winds, out);
 
-        conf = file->this->private;
+        conf = wb_inode->this->private;
 
         list_for_each_entry (request, list, list)
         {
@@ -1535,7 +1611,7 @@ __wb_mark_wind_all (wb_file_t *file, list_head_t *list, list_head_t *winds)
                                 break;
                         }
 
-                        if ((file->flags & O_APPEND)
+                        if ((request->file->flags & O_APPEND)
                             && (((size + request->write_size)
                                  > conf->aggregate_size)
                                 || ((count + request->stub->args.writev.count)
@@ -1545,7 +1621,7 @@ __wb_mark_wind_all (wb_file_t *file, list_head_t *list, list_head_t *winds)
 
                         size += request->write_size;
                         offset_expected += request->write_size;
-                        file->aggregate_current -= request->write_size;
+                        wb_inode->aggregate_current -= request->write_size;
                         count += request->stub->args.writev.count;
 
                         request->flags.write_request.stack_wound = 1;
@@ -1626,7 +1702,7 @@ __wb_mark_winds (list_head_t *list, list_head_t *winds, size_t aggregate_conf,
         char          incomplete_writes      = 0;
         char          non_contiguous_writes  = 0;
         wb_request_t *request                = NULL;
-        wb_file_t    *file                   = NULL;
+        wb_inode_t   *wb_inode               = NULL;
         char          wind_all               = 0;
         int32_t       ret                    = 0;
 
@@ -1638,13 +1714,13 @@ __wb_mark_winds (list_head_t *list, list_head_t *winds, size_t aggregate_conf,
         }
 
         request = list_entry (list->next, typeof (*request), list);
-        file = request->file;
+        wb_inode = request->wb_inode;
 
         ret = __wb_can_wind (list, &other_fop_in_queue,
                              &non_contiguous_writes, &incomplete_writes,
                              &wind_all);
         if (ret == -1) {
-                gf_log (file->this->name, GF_LOG_WARNING,
+                gf_log (wb_inode->this->name, GF_LOG_WARNING,
                         "cannot decide whether to wind or not");
                 goto out;
         }
@@ -1652,9 +1728,9 @@ __wb_mark_winds (list_head_t *list, list_head_t *winds, size_t aggregate_conf,
         if (!incomplete_writes && ((enable_trickling_writes)
                                    || (wind_all) || (non_contiguous_writes)
                                    || (other_fop_in_queue)
-                                   || (file->aggregate_current
+                                   || (wb_inode->aggregate_current
                                        >= aggregate_conf))) {
-                size = __wb_mark_wind_all (file, list, winds);
+                size = __wb_mark_wind_all (wb_inode, list, winds);
         }
 
 out:
@@ -1667,14 +1743,14 @@ __wb_mark_unwind_till (list_head_t *list, list_head_t *unwinds, size_t size)
 {
         size_t        written_behind = 0;
         wb_request_t *request        = NULL;
-        wb_file_t    *file           = NULL;
+        wb_inode_t   *wb_inode       = NULL;
 
         if (list_empty (list)) {
                 goto out;
         }
 
         request = list_entry (list->next, typeof (*request), list);
-        file = request->file;
+        wb_inode = request->wb_inode;
 
         list_for_each_entry (request, list, list)
         {
@@ -1685,12 +1761,21 @@ __wb_mark_unwind_till (list_head_t *list, list_head_t *unwinds, size_t size)
 
                 if (written_behind <= size) {
                         if (!request->flags.write_request.write_behind) {
+                                /* fds with a zero window get their writes
+                                 * acknowledged only after the server has
+                                 * replied.
+                                 */
+                                if ((request->file->window_conf == 0)
+                                    && !request->flags.write_request.got_reply) {
+                                        continue;
+                                }
+
                                 written_behind += request->write_size;
                                 request->flags.write_request.write_behind = 1;
                                 list_add_tail (&request->unwinds, unwinds);
 
                                 if (!request->flags.write_request.got_reply) {
-                                        file->window_current
+                                        wb_inode->window_current
                                                 += request->write_size;
                                 }
                         }
@@ -1707,8 +1792,8 @@ out:
 void
 __wb_mark_unwinds (list_head_t *list, list_head_t *unwinds)
 {
-        wb_request_t *request = NULL;
-        wb_file_t    *file    = NULL;
+        wb_request_t *request  = NULL;
+        wb_inode_t   *wb_inode = NULL;
 
         GF_VALIDATE_OR_GOTO ("write-behind", list, out);
         GF_VALIDATE_OR_GOTO ("write-behind", unwinds, out);
@@ -1718,12 +1803,12 @@ __wb_mark_unwinds (list_head_t *list, list_head_t *unwinds)
         }
 
         request = list_entry (list->next, typeof (*request), list);
-        file = request->file;
+        wb_inode = request->wb_inode;
 
-        if (file->window_current <= file->window_conf) {
+        if (wb_inode->window_current <= wb_inode->window_conf) {
                 __wb_mark_unwind_till (list, unwinds,
-                                       file->window_conf
-                                       - file->window_current);
+                                       wb_inode->window_conf
+                                       - wb_inode->window_current);
         }
 
 out:
@@ -1731,27 +1816,96 @@ out:
 }
 
 
+/* Tells whether a non-write request has to wait for the writes queued before
+ * it, @writes_end being the highest offset touched by the ones not yet
+ * acknowledged by the server. A read conflicts with any write ending beyond
+ * its offset, even without the ranges overlapping, since such a write can
+ * move the end of the file into the range being read. A truncate commutes
+ * with writes ending at or below the new size. Everything else conflicts.
+ */
+static int
+__wb_request_conflicts (wb_request_t *request, off_t writes_end)
+{
+        int conflicts = 1;
+
+        switch (request->stub->fop) {
+        case GF_FOP_READ:
+                conflicts = (request->stub->args.readv.off < writes_end);
+                break;
+
+        case GF_FOP_TRUNCATE:
+                conflicts = (request->stub->args.truncate.off < writes_end);
+                break;
+
+        case GF_FOP_FTRUNCATE:
+                conflicts = (request->stub->args.ftruncate.off < writes_end);
+                break;
+
+        default:
+                break;
+        }
+
+        return conflicts;
+}
+
+
+/* Picks the non-write requests which can be resumed. A request queued behind
+ * writes still in progress is let through if none of them can change its
+ * outcome. Stops at a non-write which is in progress or has to wait, so that
+ * non-write requests are still resumed in order.
+ */
 uint32_t
 __wb_get_other_requests (list_head_t *list, list_head_t *other_requests)
 {
-        wb_request_t *request = NULL;
-        uint32_t      count   = 0;
+        wb_request_t *request        = NULL;
+        uint32_t      count          = 0;
+        off_t         end            = 0, writes_end = 0;
+        char          writes_pending = 0, append_pending = 0;
 
         GF_VALIDATE_OR_GOTO ("write-behind", list, out);
         GF_VALIDATE_OR_GOTO ("write-behind", other_requests, out);
 
         list_for_each_entry (request, list, list) {
-                if ((request->stub == NULL)
-                    || (request->stub->fop == GF_FOP_WRITE)) {
+                if (request->stub == NULL) {
                         break;
                 }
 
-                if (!request->flags.other_requests.marked_for_resume) {
-                        request->flags.other_requests.marked_for_resume = 1;
-                        list_add_tail (&request->other_requests,
-                                       other_requests);
-                        count++;
+                if (request->stub->fop == GF_FOP_WRITE) {
+                        if (request->flags.write_request.got_reply) {
+                                continue;
+                        }
+
+                        /* offset of an O_APPEND write is where the client
+                         * thinks the end of file is, not where the data
+                         * lands.
+                         */
+                        if (request->file->flags & O_APPEND) {
+                                append_pending = 1;
+                        }
+
+                        end = request->stub->args.writev.off
+                                + request->write_size;
+                        if (end > writes_end) {
+                                writes_end = end;
+                        }
+
+                        writes_pending = 1;
+                        continue;
+                }
+
+                if (request->flags.other_requests.marked_for_resume) {
+                        continue;
                 }
+
+                if (writes_pending
+                    && (append_pending
+                        || __wb_request_conflicts (request, writes_end))) {
+                        break;
+                }
+
+                request->flags.other_requests.marked_for_resume = 1;
+                list_add_tail (&request->other_requests, other_requests);
+                count++;
         }
 
 out:
@@ -1789,7 +1943,7 @@ out:
 
 
 int32_t
-wb_resume_other_requests (call_frame_t *frame, wb_file_t *file,
+wb_resume_other_requests (call_frame_t *frame, wb_inode_t *wb_inode,
                           list_head_t *other_requests)
 {
         int32_t       ret          = -1;
@@ -1798,9 +1952,9 @@ wb_resume_other_requests (call_frame_t *frame, wb_file_t *file,
         char          wind         = 0;
         call_stub_t  *stub         = NULL;
 
-        GF_VALIDATE_OR_GOTO ((file ? file->this->name : "write-behind"), frame,
-                             out);
-        GF_VALIDATE_OR_GOTO (frame->this->name, file, out);
+        GF_VALIDATE_OR_GOTO ((wb_inode ? wb_inode->this->name
+                              : "write-behind"), frame, out);
+        GF_VALIDATE_OR_GOTO (frame->this->name, wb_inode, out);
         GF_VALIDATE_OR_GOTO (frame->this->name, other_requests, out);
 
         if (list_empty (other_requests)) {
@@ -1813,11 +1967,11 @@ wb_resume_other_requests (call_frame_t *frame, wb_file_t *file,
                 wind = request->stub->wind;
                 stub = request->stub;
 
-                LOCK (&file->lock);
+                LOCK (&wb_inode->lock);
                 {
                         request->stub = NULL;
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&wb_inode->lock);
 
                 if (!wind) {
                         wb_request_unref (request);
@@ -1830,7 +1984,7 @@ wb_resume_other_requests (call_frame_t *frame, wb_file_t *file,
         ret = 0;
 
         if (fops_removed > 0) {
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         gf_log (frame->this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -1843,26 +1997,26 @@ out:
 
 
 int32_t
-wb_do_ops (call_frame_t *frame, wb_file_t *file, list_head_t *winds,
+wb_do_ops (call_frame_t *frame, wb_inode_t *wb_inode, list_head_t *winds,
            list_head_t *unwinds, list_head_t *other_requests)
 {
         int32_t ret = -1, write_requests_removed = 0;
 
-        GF_VALIDATE_OR_GOTO ((file ? file->this->name : "write-behind"),
-                             frame, out);
-        GF_VALIDATE_OR_GOTO (frame->this->name, file, out);
+        GF_VALIDATE_OR_GOTO ((wb_inode ? wb_inode->this->name
+                              : "write-behind"), frame, out);
+        GF_VALIDATE_OR_GOTO (frame->this->name, wb_inode, out);
 
         ret = wb_stack_unwind (unwinds);
 
         write_requests_removed = ret;
 
-        ret = wb_sync (frame, file, winds);
+        ret = wb_sync (frame, wb_inode, winds);
         if (ret == -1) {
                 gf_log (frame->this->name, GF_LOG_WARNING,
                         "syncing of write requests failed");
         }
 
-        ret = wb_resume_other_requests (frame, file, other_requests);
+        ret = wb_resume_other_requests (frame, wb_inode, other_requests);
         if (ret == -1) {
                 gf_log (frame->this->name, GF_LOG_WARNING,
                         "cannot resume non-write requests in request queue");
@@ -1874,7 +2028,7 @@ wb_do_ops (call_frame_t *frame, wb_file_t *file, list_head_t *winds,
          * blocked on the writes just unwound.
          */
         if (write_requests_removed > 0) {
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         gf_log (frame->this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -1886,16 +2040,24 @@ out:
 }
 
 
+/* copies data of @request into the buffer of @holder at the offset it maps
+ * to, @request having to start within or right at the end of @holder.
+ */
 inline int
 __wb_copy_into_holder (wb_request_t *holder, wb_request_t *request)
 {
-        char          *ptr    = NULL;
-        struct iobuf  *iobuf  = NULL;
-        struct iobref *iobref = NULL;
-        int            ret    = -1;
+        char          *ptr         = NULL;
+        struct iobuf  *iobuf       = NULL;
+        struct iobref *iobref      = NULL;
+        wb_inode_t    *wb_inode    = NULL;
+        off_t          request_end = 0;
+        size_t         new_size    = 0, overlap = 0;
+        int            ret         = -1;
+
+        wb_inode = request->wb_inode;
 
         if (holder->flags.write_request.virgin) {
-                iobuf = iobuf_get (request->file->this->ctx->iobuf_pool);
+                iobuf = iobuf_get (wb_inode->this->ctx->iobuf_pool);
                 if (iobuf == NULL) {
                         goto out;
                 }
@@ -1910,7 +2072,7 @@ __wb_copy_into_holder (wb_request_t *holder, wb_request_t *request)
                 if (ret != 0) {
                         iobuf_unref (iobuf);
                         iobref_unref (iobref);
-                        gf_log (request->file->this->name, GF_LOG_WARNING,
+                        gf_log (wb_inode->this->name, GF_LOG_WARNING,
                                 "cannot add iobuf (%p) into iobref (%p)",
                                 iobuf, iobref);
                         goto out;
@@ -1919,6 +2081,9 @@ __wb_copy_into_holder (wb_request_t *holder, wb_request_t *request)
                 iov_unload (iobuf->ptr, holder->stub->args.writev.vector,
                             holder->stub->args.writev.count);
                 holder->stub->args.writev.vector[0].iov_base = iobuf->ptr;
+                holder->stub->args.writev.vector[0].iov_len
+                        = holder->write_size;
+                holder->stub->args.writev.count = 1;
 
                 iobref_unref (holder->stub->args.writev.iobref);
                 holder->stub->args.writev.iobref = iobref;
@@ -1928,16 +2093,31 @@ __wb_copy_into_holder (wb_request_t *holder, wb_request_t *request)
                 holder->flags.write_request.virgin = 0;
         }
 
-        ptr = holder->stub->args.writev.vector[0].iov_base + holder->write_size;
+        ptr = holder->stub->args.writev.vector[0].iov_base
+                + (request->stub->args.writev.off
+                   - holder->stub->args.writev.off);
 
         iov_unload (ptr, request->stub->args.writev.vector,
                     request->stub->args.writev.count);
 
-        holder->stub->args.writev.vector[0].iov_len += request->write_size;
-        holder->write_size += request->write_size;
+        new_size = holder->write_size;
+        request_end = request->stub->args.writev.off + request->write_size;
+        if (request_end > (holder->stub->args.writev.off + new_size)) {
+                new_size = request_end - holder->stub->args.writev.off;
+        }
+
+        /* the part of @request overwriting data already in @holder is not
+         * going to be sent, take it off the window and aggregate counts.
+         */
+        overlap = request->write_size - (new_size - holder->write_size);
+        wb_inode->window_current -= overlap;
+        wb_inode->aggregate_current -= overlap;
+
+        holder->stub->args.writev.vector[0].iov_len = new_size;
+        holder->write_size = new_size;
 
         request->flags.write_request.stack_wound = 1;
-        list_move_tail (&request->list, &request->file->passive_requests);
+        list_move_tail (&request->list, &wb_inode->passive_requests);
 
         ret = 0;
 out:
@@ -1945,14 +2125,39 @@ out:
 }
 
 
-/* this procedure assumes that write requests have only one vector to write */
+static int
+__wb_can_collapse (wb_request_t *holder, wb_request_t *request)
+{
+        off_t holder_end = 0;
+
+        if (!wb_requests_mergeable (holder, request)) {
+                return 0;
+        }
+
+        holder_end = holder->stub->args.writev.off + holder->write_size;
+
+        if (request->file->flags & O_APPEND) {
+                return (request->stub->args.writev.off == holder_end);
+        }
+
+        return ((request->stub->args.writev.off
+                 >= holder->stub->args.writev.off)
+                && (request->stub->args.writev.off <= holder_end));
+}
+
+
+/* Packs written-behind requests into the buffer of the write request
+ * preceding them, when they start within or right after it. Overlapping
+ * writes are folded into one, later data overwriting earlier, so that a
+ * region rewritten over and over goes to the server just once.
+ */
 void
 __wb_collapse_write_bufs (list_head_t *requests, size_t page_size)
 {
-        off_t         offset_expected = 0;
-        size_t        space_left      = 0;
-        wb_request_t *request         = NULL, *tmp = NULL, *holder = NULL;
-        int           ret             = 0;
+        off_t         holder_end  = 0, request_end = 0;
+        size_t        required    = 0;
+        wb_request_t *request     = NULL, *tmp = NULL, *holder = NULL;
+        int           ret         = 0;
 
         GF_VALIDATE_OR_GOTO ("write-behind", requests, out);
 
@@ -1970,17 +2175,20 @@ __wb_collapse_write_bufs (list_head_t *requests, size_t page_size)
                                 continue;
                         }
 
-                        offset_expected = holder->stub->args.writev.off
-                                + holder->write_size;
-
-                        if (request->stub->args.writev.off != offset_expected) {
+                        if (!__wb_can_collapse (holder, request)) {
                                 holder = request;
                                 continue;
                         }
 
-                        space_left = page_size - holder->write_size;
+                        holder_end = holder->stub->args.writev.off
+                                + holder->write_size;
+                        request_end = request->stub->args.writev.off
+                                + request->write_size;
+
+                        required = max (holder_end, request_end)
+                                - holder->stub->args.writev.off;
 
-                        if (space_left >= request->write_size) {
+                        if (required <= page_size) {
                                 ret = __wb_copy_into_holder (holder, request);
                                 if (ret != 0) {
                                         break;
@@ -2001,27 +2209,26 @@ out:
 
 
 int32_t
-wb_process_queue (call_frame_t *frame, wb_file_t *file)
+wb_process_queue (call_frame_t *frame, wb_inode_t *wb_inode)
 {
         list_head_t winds  = {0, }, unwinds = {0, }, other_requests = {0, };
         size_t      size   = 0;
         wb_conf_t  *conf   = NULL;
-        uint32_t    count  = 0;
         int32_t     ret    = -1;
 
         INIT_LIST_HEAD (&winds);
         INIT_LIST_HEAD (&unwinds);
         INIT_LIST_HEAD (&other_requests);
 
-        GF_VALIDATE_OR_GOTO ((file ? file->this->name : "write-behind"), frame,
-                             out);
-        GF_VALIDATE_OR_GOTO (file->this->name, frame, out);
+        GF_VALIDATE_OR_GOTO ((wb_inode ? wb_inode->this->name
+                              : "write-behind"), frame, out);
+        GF_VALIDATE_OR_GOTO (frame->this->name, wb_inode, out);
 
-        conf = file->this->private;
-        GF_VALIDATE_OR_GOTO (file->this->name, conf, out);
+        conf = wb_inode->this->private;
+        GF_VALIDATE_OR_GOTO (wb_inode->this->name, conf, out);
 
         size = conf->aggregate_size;
-        LOCK (&file->lock);
+        LOCK (&wb_inode->lock);
         {
                 /*
                  * make sure requests are marked for unwinding and adjacent
@@ -2029,23 +2236,23 @@ wb_process_queue (call_frame_t *frame, wb_file_t *file)
                  * an iobuf) are packed properly so that iobufs are filled to
                  * their maximum capacity, before calling __wb_mark_winds.
                  */
-                __wb_mark_unwinds (&file->request, &unwinds);
+                __wb_mark_unwinds (&wb_inode->request, &unwinds);
 
-                __wb_collapse_write_bufs (&file->request,
-                                          file->this->ctx->page_size);
+                __wb_collapse_write_bufs (&wb_inode->request,
+                                          wb_inode->this->ctx->page_size);
 
-                count = __wb_get_other_requests (&file->request,
-                                                 &other_requests);
-
-                if (count == 0) {
-                        __wb_mark_winds (&file->request, &winds, size,
-                                         conf->enable_trickling_writes);
-                }
+                /* non-write requests resumed here may be sitting behind
+                 * writes, which are to be wound in the same pass.
+                 */
+                __wb_get_other_requests (&wb_inode->request,
+                                         &other_requests);
 
+                __wb_mark_winds (&wb_inode->request, &winds, size,
+                                 conf->enable_trickling_writes);
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
-        ret = wb_do_ops (frame, file, &winds, &unwinds, &other_requests);
+        ret = wb_do_ops (frame, wb_inode, &winds, &unwinds, &other_requests);
 
 out:
         return ret;
@@ -2109,7 +2316,7 @@ wb_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
         }
 
         if (file != NULL) {
-                LOCK (&file->lock);
+                LOCK (&file->wb_inode->lock);
                 {
                         op_ret = file->op_ret;
                         op_errno = file->op_errno;
@@ -2126,7 +2333,7 @@ wb_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
                                 wb_disabled = 1;
                         }
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&file->wb_inode->lock);
         } else {
                 wb_disabled = 1;
         }
@@ -2159,6 +2366,7 @@ wb_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
 
         frame->local = local;
         local->file = file;
+        local->wb_inode = file->wb_inode;
 
         stub = fop_writev_stub (frame, NULL, fd, vector, count, offset, iobref);
         if (stub == NULL) {
@@ -2166,13 +2374,13 @@ wb_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
                 goto unwind;
         }
 
-        request = wb_enqueue (file, stub);
+        request = wb_enqueue (file->wb_inode, file, stub);
         if (request == NULL) {
                 op_errno = ENOMEM;
                 goto unwind;
         }
 
-        ret = wb_process_queue (process_frame, file);
+        ret = wb_process_queue (process_frame, file->wb_inode);
         if (ret == -1) {
                 gf_log (this->name, GF_LOG_WARNING,
                         "request queue processing failed");
@@ -2202,21 +2410,21 @@ wb_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
               int32_t op_errno, struct iovec *vector, int32_t count,
               struct iatt *stbuf, struct iobref *iobref)
 {
-        wb_local_t   *local   = NULL;
-        wb_file_t    *file    = NULL;
-        wb_request_t *request = NULL;
-        int32_t       ret     = 0;
+        wb_local_t   *local    = NULL;
+        wb_inode_t   *wb_inode = NULL;
+        wb_request_t *request  = NULL;
+        int32_t       ret      = 0;
 
         GF_ASSERT (frame);
 
         local = frame->local;
-        file = local->file;
+        wb_inode = local->wb_inode;
         request = local->request;
 
-        if ((request != NULL) && (file != NULL)) {
+        if ((request != NULL) && (wb_inode != NULL)) {
                 wb_request_unref (request);
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, wb_inode);
                 if (ret == -1) {
                         if (errno == ENOMEM) {
                                 op_ret = -1;
@@ -2285,6 +2493,8 @@ wb_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 
         frame->local = local;
         if (file) {
+                local->wb_inode = file->wb_inode;
+
                 stub = fop_readv_stub (frame, wb_readv_helper, fd, size,
                                        offset);
                 if (stub == NULL) {
@@ -2292,14 +2502,14 @@ wb_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (file->wb_inode, file, stub);
                 if (request == NULL) {
                         call_stub_destroy (stub);
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -2340,7 +2550,7 @@ wb_ffr_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
         file = local->file;
 
         if (file != NULL) {
-                LOCK (&file->lock);
+                LOCK (&file->wb_inode->lock);
                 {
                         if (file->op_ret == -1) {
                                 op_ret = file->op_ret;
@@ -2349,7 +2559,7 @@ wb_ffr_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                                 file->op_ret = 0;
                         }
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&file->wb_inode->lock);
         }
 
         STACK_UNWIND_STRICT (flush, frame, op_ret, op_errno);
@@ -2376,12 +2586,12 @@ wb_flush_helper (call_frame_t *frame, xlator_t *this, fd_t *fd)
         local = frame->local;
         file = local->file;
 
-        LOCK (&file->lock);
+        LOCK (&file->wb_inode->lock);
         {
                 op_ret = file->op_ret;
                 op_errno = file->op_errno;
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&file->wb_inode->lock);
 
         if (local && local->request) {
                 process_frame = copy_frame (frame);
@@ -2408,7 +2618,7 @@ wb_flush_helper (call_frame_t *frame, xlator_t *this, fd_t *fd)
         }
 
         if (process_frame != NULL) {
-                ret = wb_process_queue (process_frame, file);
+                ret = wb_process_queue (process_frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -2429,6 +2639,189 @@ unwind:
 }
 
 
+int32_t
+wb_flush_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int32_t op_ret, int32_t op_errno, compound_args_t *args)
+{
+        wb_local_t   *local       = NULL;
+        call_frame_t *flush_frame = NULL;
+        int32_t       write_ret   = 0, write_errno = 0;
+        int32_t       flush_ret   = -1, flush_errno = op_errno;
+        int32_t       i           = 0;
+
+        local = frame->local;
+        flush_frame = local->frame;
+
+        if (op_ret == -1) {
+                write_ret = -1;
+                write_errno = op_errno;
+        } else {
+                for (i = 0; i < (args->count - 1); i++) {
+                        if (args->fops[i].op_ret == -1) {
+                                write_ret = -1;
+                                write_errno = args->fops[i].op_errno;
+                                break;
+                        }
+                }
+
+                flush_ret = args->fops[args->count - 1].op_ret;
+                flush_errno = args->fops[args->count - 1].op_errno;
+        }
+
+        compound_args_destroy (args);
+
+        /* the writes are accounted like any other sync, which also records
+         * a failure on the files of the inode for the flush to report.
+         */
+        wb_sync_cbk (frame, cookie, this, write_ret, write_errno, NULL, NULL);
+
+        if (flush_frame != NULL) {
+                wb_ffr_cbk (flush_frame, NULL, this, flush_ret, flush_errno);
+        }
+
+        return 0;
+}
+
+
+/* when all that is queued on the inode are writes of this fd yet to be
+ * synced, send them along with the flush as a single compound call instead
+ * of syncing them and flushing after they complete. Returns -1 if the flush
+ * has to take the usual path.
+ */
+int32_t
+wb_flush_compound (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                   wb_file_t *file)
+{
+        wb_conf_t       *conf       = NULL;
+        wb_inode_t      *wb_inode   = NULL;
+        wb_local_t      *local      = NULL;
+        wb_request_t    *request    = NULL;
+        compound_args_t *args       = NULL;
+        compound_fop_t  *cfop       = NULL;
+        call_frame_t    *sync_frame = NULL;
+        size_t           size       = 0;
+        int32_t          count      = 0, op_ret = 0, op_errno = 0;
+        int32_t          ret        = -1;
+
+        conf = this->private;
+        wb_inode = file->wb_inode;
+
+        sync_frame = copy_frame (frame);
+        if (sync_frame == NULL) {
+                goto out;
+        }
+
+        local = GF_CALLOC (1, sizeof (*local), gf_wb_mt_wb_local_t);
+        if (local == NULL) {
+                goto out;
+        }
+
+        INIT_LIST_HEAD (&local->winds);
+
+        LOCK (&wb_inode->lock);
+        {
+                __wb_collapse_write_bufs (&wb_inode->request,
+                                          this->ctx->page_size);
+
+                list_for_each_entry (request, &wb_inode->request, list) {
+                        if ((request->stub == NULL)
+                            || (request->stub->fop != GF_FOP_WRITE)
+                            || (request->file != file)
+                            || request->flags.write_request.stack_wound) {
+                                goto unlock;
+                        }
+
+                        size += request->write_size;
+                        count++;
+                }
+
+                if ((count == 0) || (count > WB_COMPOUND_MAX_OPS)
+                    || (size > conf->aggregate_size)) {
+                        goto unlock;
+                }
+
+                args = compound_args_new (count + 1);
+                if (args == NULL) {
+                        goto unlock;
+                }
+
+                args->iobref = iobref_new ();
+                if (args->iobref == NULL) {
+                        goto unlock;
+                }
+
+                cfop = args->fops;
+                list_for_each_entry (request, &wb_inode->request, list) {
+                        cfop->fop = GF_FOP_WRITE;
+                        cfop->offset = request->stub->args.writev.off;
+                        cfop->count = request->stub->args.writev.count;
+                        cfop->vector = iov_dup (request->stub->args.writev.vector,
+                                                cfop->count);
+                        if (cfop->vector == NULL) {
+                                goto unlock;
+                        }
+
+                        if (request->stub->args.writev.iobref) {
+                                iobref_merge (args->iobref,
+                                              request->stub->args.writev.iobref);
+                        }
+
+                        cfop++;
+                }
+
+                cfop->fop = GF_FOP_FLUSH;
+
+                list_for_each_entry (request, &wb_inode->request, list) {
+                        request->flags.write_request.stack_wound = 1;
+                        wb_inode->aggregate_current -= request->write_size;
+                        list_add_tail (&request->winds, &local->winds);
+                }
+
+                op_ret = file->op_ret;
+                op_errno = file->op_errno;
+
+                ret = 0;
+        }
+unlock:
+        UNLOCK (&wb_inode->lock);
+
+        if (ret == -1) {
+                goto out;
+        }
+
+        local->wb_inode = wb_inode;
+        local->file = file;
+        local->fd = fd_ref (fd);
+        if (!conf->flush_behind) {
+                local->frame = frame;
+        }
+
+        sync_frame->local = local;
+
+        STACK_WIND (sync_frame, wb_flush_compound_cbk, FIRST_CHILD(this),
+                    FIRST_CHILD(this)->fops->compound, fd, args);
+
+        if (conf->flush_behind) {
+                STACK_UNWIND_STRICT (flush, frame, op_ret, op_errno);
+        }
+
+        return 0;
+
+out:
+        compound_args_destroy (args);
+
+        if (local != NULL) {
+                GF_FREE (local);
+        }
+
+        if (sync_frame != NULL) {
+                STACK_DESTROY (sync_frame->root);
+        }
+
+        return -1;
+}
+
+
 int32_t
 wb_flush (call_frame_t *frame, xlator_t *this, fd_t *fd)
 {
@@ -2470,23 +2863,28 @@ wb_flush (call_frame_t *frame, xlator_t *this, fd_t *fd)
                 }
 
                 local->file = file;
+                local->wb_inode = file->wb_inode;
 
                 frame->local = local;
 
+                if (wb_flush_compound (frame, this, fd, file) == 0) {
+                        return 0;
+                }
+
                 stub = fop_flush_stub (frame, wb_flush_helper, fd);
                 if (stub == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (file->wb_inode, file, stub);
                 if (request == NULL) {
                         call_stub_destroy (stub);
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -2534,7 +2932,7 @@ wb_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
         request = local->request;
 
         if (file != NULL) {
-                LOCK (&file->lock);
+                LOCK (&file->wb_inode->lock);
                 {
                         if (file->op_ret == -1) {
                                 op_ret = file->op_ret;
@@ -2543,11 +2941,11 @@ wb_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                                 file->op_ret = 0;
                         }
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&file->wb_inode->lock);
 
                 if (request) {
                         wb_request_unref (request);
-                        ret = wb_process_queue (frame, file);
+                        ret = wb_process_queue (frame, file->wb_inode);
                         if (ret == -1) {
                                 if (errno == ENOMEM) {
                                         op_ret = -1;
@@ -2616,20 +3014,22 @@ wb_fsync (call_frame_t *frame, xlator_t *this, fd_t *fd, int32_t datasync)
         frame->local = local;
 
         if (file) {
+                local->wb_inode = file->wb_inode;
+
                 stub = fop_fsync_stub (frame, wb_fsync_helper, fd, datasync);
                 if (stub == NULL) {
                         op_errno = ENOMEM;
                         goto unwind;
                 }
 
-                request = wb_enqueue (file, stub);
+                request = wb_enqueue (file->wb_inode, file, stub);
                 if (request == NULL) {
                         op_errno = ENOMEM;
                         call_stub_destroy (stub);
                         goto unwind;
                 }
 
-                ret = wb_process_queue (frame, file);
+                ret = wb_process_queue (frame, file->wb_inode);
                 if (ret == -1) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "request queue processing failed");
@@ -2660,13 +3060,36 @@ wb_release (xlator_t *this, fd_t *fd)
         file = (wb_file_t *) (long) file_ptr;
 
         if (file != NULL) {
-                LOCK (&file->lock);
+                wb_file_destroy (file);
+        }
+
+out:
+        return 0;
+}
+
+
+int32_t
+wb_forget (xlator_t *this, inode_t *inode)
+{
+        uint64_t    tmp_wb_inode = 0;
+        wb_inode_t *wb_inode     = NULL;
+
+        GF_VALIDATE_OR_GOTO ("write-behind", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, inode, out);
+
+        inode_ctx_del (inode, this, &tmp_wb_inode);
+        wb_inode = (wb_inode_t *)(long)tmp_wb_inode;
+
+        if (wb_inode != NULL) {
+                LOCK (&wb_inode->lock);
                 {
-                        GF_ASSERT (list_empty (&file->request));
+                        GF_ASSERT (list_empty (&wb_inode->request));
+                        GF_ASSERT (list_empty (&wb_inode->files));
                 }
-                UNLOCK (&file->lock);
+                UNLOCK (&wb_inode->lock);
 
-                wb_file_destroy (file);
+                LOCK_DESTROY (&wb_inode->lock);
+                GF_FREE (wb_inode);
         }
 
 out:
@@ -2745,6 +3168,10 @@ __wb_dump_requests (struct list_head *head, char *prefix, char passive)
                         gf_proc_dump_write (key, "%"PRId64,
                                             request->stub->args.writev.off);
 
+                        gf_proc_dump_build_key (key, key_prefix, "fd");
+                        gf_proc_dump_write (key, "%p",
+                                            request->stub->args.writev.fd);
+
                         flag = request->flags.write_request.write_behind;
                         gf_proc_dump_build_key (key, key_prefix,
                                                 "write_behind");
@@ -2774,11 +3201,12 @@ __wb_dump_requests (struct list_head *head, char *prefix, char passive)
 int
 wb_file_dump (xlator_t *this, fd_t *fd)
 {
-        wb_file_t *file                            = NULL;
-        uint64_t   tmp_file                        = 0;
-        int32_t    ret                             = -1;
-        char       key[GF_DUMP_MAX_BUF_LEN]        = {0, };
-        char       key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
+        wb_file_t  *file                            = NULL;
+        wb_inode_t *wb_inode                        = NULL;
+        uint64_t    tmp_file                        = 0;
+        int32_t     ret                             = -1;
+        char        key[GF_DUMP_MAX_BUF_LEN]        = {0, };
+        char        key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
 
         if ((fd == NULL) || (this == NULL)) {
                 ret = 0;
@@ -2814,37 +3242,45 @@ wb_file_dump (xlator_t *this, fd_t *fd)
         gf_proc_dump_build_key (key, key_prefix, "window_conf");
         gf_proc_dump_write (key, "%"GF_PRI_SIZET, file->window_conf);
 
-        gf_proc_dump_build_key (key, key_prefix, "window_current");
-        gf_proc_dump_write (key, "%"GF_PRI_SIZET, file->window_current);
-
         gf_proc_dump_build_key (key, key_prefix, "flags");
         gf_proc_dump_write (key, "%s", (file->flags & O_APPEND) ? "O_APPEND"
                             : "!O_APPEND");
 
-        gf_proc_dump_build_key (key, key_prefix, "aggregate_current");
-        gf_proc_dump_write (key, "%"GF_PRI_SIZET, file->aggregate_current);
-
-        gf_proc_dump_build_key (key, key_prefix, "refcount");
-        gf_proc_dump_write (key, "%d", file->refcount);
-
         gf_proc_dump_build_key (key, key_prefix, "op_ret");
         gf_proc_dump_write (key, "%d", file->op_ret);
 
         gf_proc_dump_build_key (key, key_prefix, "op_errno");
         gf_proc_dump_write (key, "%d", file->op_errno);
 
-        LOCK (&file->lock);
+        wb_inode = file->wb_inode;
+
+        gf_proc_dump_build_key (key, key_prefix, "wb_inode");
+        gf_proc_dump_write (key, "%p", wb_inode);
+
+        LOCK (&wb_inode->lock);
         {
-                if (!list_empty (&file->request)) {
-                        __wb_dump_requests (&file->request, key_prefix, 0);
+                gf_proc_dump_build_key (key, key_prefix, "inode_window_conf");
+                gf_proc_dump_write (key, "%"GF_PRI_SIZET,
+                                    wb_inode->window_conf);
+
+                gf_proc_dump_build_key (key, key_prefix, "window_current");
+                gf_proc_dump_write (key, "%"GF_PRI_SIZET,
+                                    wb_inode->window_current);
+
+                gf_proc_dump_build_key (key, key_prefix, "aggregate_current");
+                gf_proc_dump_write (key, "%"GF_PRI_SIZET,
+                                    wb_inode->aggregate_current);
+
+                if (!list_empty (&wb_inode->request)) {
+                        __wb_dump_requests (&wb_inode->request, key_prefix, 0);
                 }
 
-                if (!list_empty (&file->passive_requests)) {
-                        __wb_dump_requests (&file->passive_requests, key_prefix,
-                                            1);
+                if (!list_empty (&wb_inode->passive_requests)) {
+                        __wb_dump_requests (&wb_inode->passive_requests,
+                                            key_prefix, 1);
                 }
         }
-        UNLOCK (&file->lock);
+        UNLOCK (&wb_inode->lock);
 
 out:
         return ret;
@@ -2901,13 +3337,32 @@ out:
         return ret;
 }
 
+/* the server reads the payload of a write into a single iobuf, so a sync
+ * can not carry more than a page worth of data.
+ */
+static int
+wb_aggregate_size_check (xlator_t *this, uint64_t aggregate_size)
+{
+        if (aggregate_size > this->ctx->page_size) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "aggregate-size (%"PRIu64") cannot be more than the "
+                        "iobuf page size (%"GF_PRI_SIZET")",
+                        aggregate_size, this->ctx->page_size);
+                return -1;
+        }
+
+        return 0;
+}
+
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
-        char      *str         = NULL;
-        uint64_t   window_size = 0;
-        wb_conf_t *conf        = NULL;
-        int        ret         = 0;
+        char      *str            = NULL;
+        uint64_t   window_size    = 0;
+        uint64_t   aggregate_size = 0;
+        wb_conf_t *conf           = NULL;
+        int        ret            = 0;
 
         conf = this->private;
 
@@ -2946,6 +3401,41 @@ reconfigure (xlator_t *this, dict_t *options)
                 conf->window_size = WB_WINDOW_SIZE;
         }
 
+        ret = dict_get_str (options, "aggregate-size", &str);
+        if (ret == 0) {
+                ret = gf_string2bytesize (str, &aggregate_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfiguration "
+                                "'option aggregate-size %s' failed, Invalid "
+                                "number format, Defaulting to old value "
+                                "(%"PRIu64")", str, conf->aggregate_size);
+                        goto out;
+                }
+
+                ret = wb_aggregate_size_check (this, aggregate_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfiguration "
+                                "'option aggregate-size %s' failed, "
+                                "Defaulting to old value (%"PRIu64")", str,
+                                conf->aggregate_size);
+                        goto out;
+                }
+        } else {
+                aggregate_size = WB_AGGREGATE_SIZE;
+        }
+
+        if (aggregate_size > conf->window_size) {
+                gf_log (this->name, GF_LOG_ERROR, "Reconfiguration "
+                        "'option aggregate-size' failed, aggregate-size "
+                        "(%"PRIu64") cannot be more than window-size "
+                        "(%"PRIu64"), Defaulting to old value (%"PRIu64")",
+                        aggregate_size, conf->window_size,
+                        conf->aggregate_size);
+                goto out;
+        }
+
+        conf->aggregate_size = aggregate_size;
+
         ret = dict_get_str (options, "flush-behind", &str);
         if (ret == 0) {
                 ret = gf_string2boolean (str, &conf->flush_behind);
@@ -3010,8 +3500,23 @@ init (xlator_t *this)
                 }
         }
 
-        /* configure 'options aggregate-size <size>' */
+        /* configure 'option aggregate-size <size>' */
         conf->aggregate_size = WB_AGGREGATE_SIZE;
+        ret = dict_get_str (options, "aggregate-size", &str);
+        if (ret == 0) {
+                ret = gf_string2bytesize (str, &conf->aggregate_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format \"%s\" of \"option "
+                                "aggregate-size\"", str);
+                        goto out;
+                }
+        }
+
+        ret = wb_aggregate_size_check (this, conf->aggregate_size);
+        if (ret != 0)
+                goto out;
+
         conf->disable_till = 0;
         ret = dict_get_str (options, "disable-for-first-nbytes", &str);
         if (ret == 0) {
@@ -3161,7 +3666,8 @@ struct xlator_fops fops = {
 };
 
 struct xlator_cbks cbks = {
-        .release  = wb_release
+        .release  = wb_release,
+        .forget   = wb_forget,
 };
 
 struct xlator_dumpops dumpops = {
@@ -3187,6 +3693,18 @@ struct volume_options options[] = {
           .description = "Size of the per-file write-behind buffer. "
 
         },
+        { .key = {"aggregate-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 4 * GF_UNIT_KB,
+          .max  = 128 * GF_UNIT_KB,
+          .default_value = "128KB",
+          .description = "Maximum amount of data written to the server in a "
+                         "single call, after coalescing the writes queued "
+                         "on a file. The transport receives the payload of "
+                         "a write into one iobuf and rejects larger "
+                         "payloads, so this can not be more than the iobuf "
+                         "page size (128KB)."
+        },
         { .key = {"disable-for-first-nbytes"},
           .type = GF_OPTION_TYPE_SIZET,
           .min = 1,
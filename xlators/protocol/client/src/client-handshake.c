@@ -52,8 +52,10 @@ rpc_client_ping_timer_expired (void *data)
         struct rpc_clnt         *clnt               = NULL;
         xlator_t                *this               = NULL;
         clnt_conf_t             *conf               = NULL;
+        clnt_conn_t             *cconn              = NULL;
 
-        this = data;
+        cconn = data;
+        this = (cconn) ? cconn->this : NULL;
 
         if (!this || !this->private) {
                 gf_log ("", GF_LOG_WARNING, "xlator initialization not done");
@@ -62,7 +64,7 @@ rpc_client_ping_timer_expired (void *data)
 
         conf = this->private;
 
-        clnt = conf->rpc;
+        clnt = cconn->rpc;
         if (!clnt) {
                 gf_log (this->name, GF_LOG_WARNING, "rpc not initialized");
                 goto out;
@@ -100,7 +102,7 @@ rpc_client_ping_timer_expired (void *data)
                         conn->ping_timer =
                                 gf_timer_call_after (this->ctx, timeout,
                                                      rpc_client_ping_timer_expired,
-                                                     (void *) this);
+                                                     (void *) cconn);
                         if (conn->ping_timer == NULL)
                                 gf_log (trans->name, GF_LOG_WARNING,
                                         "unable to setup ping timer");
@@ -132,24 +134,26 @@ client_start_ping (void *data)
 {
         xlator_t                *this        = NULL;
         clnt_conf_t             *conf        = NULL;
+        clnt_conn_t             *cconn       = NULL;
         rpc_clnt_connection_t   *conn        = NULL;
         int32_t                  ret         = -1;
         struct timeval           timeout     = {0, };
         call_frame_t            *frame       = NULL;
         int                      frame_count = 0;
 
-        this = data;
+        cconn = data;
+        this = (cconn) ? cconn->this : NULL;
         if (!this || !this->private) {
                 gf_log ("", GF_LOG_WARNING, "xlator not initialized");
                 goto fail;
         }
 
         conf  = this->private;
-        if (!conf->rpc) {
+        if (!cconn->rpc) {
                 gf_log (this->name, GF_LOG_WARNING, "rpc not initialized");
                 goto fail;
         }
-        conn = &conf->rpc->conn;
+        conn = &cconn->rpc->conn;
 
         if (conf->opt.ping_timeout == 0) {
                 gf_log (this->name, GF_LOG_INFO, "ping timeout is 0, returning");
@@ -195,7 +199,7 @@ client_start_ping (void *data)
                 conn->ping_timer =
                         gf_timer_call_after (this->ctx, timeout,
                                              rpc_client_ping_timer_expired,
-                                             (void *) this);
+                                             (void *) cconn);
 
                 if (conn->ping_timer == NULL) {
                         gf_log (this->name, GF_LOG_WARNING,
@@ -210,9 +214,12 @@ client_start_ping (void *data)
         if (!frame)
                 goto fail;
 
-        ret = client_submit_request (this, NULL, frame, conf->handshake,
-                                     GF_HNDSK_PING, client_ping_cbk, NULL, NULL,
-                                     NULL, 0, NULL, 0, NULL);
+        frame->cookie = cconn;
+
+        ret = client_submit_request_conn (this, cconn, NULL, frame,
+                                          conf->handshake, GF_HNDSK_PING,
+                                          client_ping_cbk, NULL, NULL, NULL, 0,
+                                          NULL, 0, NULL);
         if (ret)
                 goto fail;
 
@@ -237,6 +244,7 @@ client_ping_cbk (struct rpc_req *req, struct iovec *iov, int count,
         struct timeval         timeout = {0, };
         call_frame_t          *frame   = NULL;
         clnt_conf_t           *conf    = NULL;
+        clnt_conn_t           *cconn   = NULL;
 
         if (!myframe) {
                 gf_log ("", GF_LOG_WARNING, "frame with the request is NULL");
@@ -250,7 +258,8 @@ client_ping_cbk (struct rpc_req *req, struct iovec *iov, int count,
         }
 
         conf = this->private;
-        conn = &conf->rpc->conn;
+        cconn = frame->cookie;
+        conn = &cconn->rpc->conn;
 
         if (req->rpc_status == -1) {
                 if (conn->ping_timer != NULL) {
@@ -276,7 +285,7 @@ client_ping_cbk (struct rpc_req *req, struct iovec *iov, int count,
 
                 conn->ping_timer =
                         gf_timer_call_after (this->ctx, timeout,
-                                             client_start_ping, (void *)this);
+                                             client_start_ping, (void *)cconn);
 
                 if (conn->ping_timer == NULL)
                         gf_log (this->name, GF_LOG_WARNING,
@@ -468,6 +477,8 @@ client3_1_reopen_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 if (ret < 0) {
                         gf_log (frame->this->name, GF_LOG_DEBUG,
                                 "lock recovery not attempted on fd");
+                        decrement_reopen_fd_count (frame->this, conf);
+                        ret = 0;
                 } else {
                         gf_log (frame->this->name, GF_LOG_INFO,
                                 "need to attempt lock recovery on %"PRIu64
@@ -482,7 +493,7 @@ out:
                 client_fdctx_destroy (frame->this, fdctx);
 
         if ((ret < 0) && frame && frame->this && conf)
-                decrement_reopen_fd_count (frame->this, conf);
+                client_reopen_failed (frame->this, conf);
 
         frame->local = NULL;
         STACK_DESTROY (frame->root);
@@ -567,7 +578,7 @@ out:
                 client_fdctx_destroy (frame->this, fdctx);
 
         if ((ret < 0) && frame && frame->this && conf)
-                decrement_reopen_fd_count (frame->this, conf);
+                client_reopen_failed (frame->this, conf);
 
         if (frame) {
                 frame->local = NULL;
@@ -628,11 +639,12 @@ protocol_client_reopendir (xlator_t *this, clnt_fd_ctx_t *fdctx)
 
         frame->local = local; local = NULL;
 
-        ret = client_submit_request (this, &req, frame, conf->fops,
-                                     GFS3_OP_OPENDIR,
-                                     client3_1_reopendir_cbk, NULL,
-                                     xdr_from_opendir_req, NULL, 0, NULL, 0,
-                                     NULL);
+        ret = client_submit_request_conn (this, client_conn_get (this, inode),
+                                          &req, frame, conf->fops,
+                                          GFS3_OP_OPENDIR,
+                                          client3_1_reopendir_cbk, NULL,
+                                          xdr_from_opendir_req, NULL, 0, NULL,
+                                          0, NULL);
         if (ret)
                 goto out;
 
@@ -652,7 +664,7 @@ out:
         if (path)
                 GF_FREE (path);
         if ((ret < 0) && this && conf) {
-                decrement_reopen_fd_count (this, conf);
+                client_reopen_failed (this, conf);
         }
 
         return 0;
@@ -710,9 +722,11 @@ protocol_client_reopen (xlator_t *this, clnt_fd_ctx_t *fdctx)
                 "attempting reopen on %s", local->loc.path);
 
         local = NULL;
-        ret = client_submit_request (this, &req, frame, conf->fops,
-                                     GFS3_OP_OPEN, client3_1_reopen_cbk, NULL,
-                                     xdr_from_open_req, NULL, 0, NULL, 0, NULL);
+        ret = client_submit_request_conn (this, client_conn_get (this, inode),
+                                          &req, frame, conf->fops,
+                                          GFS3_OP_OPEN, client3_1_reopen_cbk,
+                                          NULL, xdr_from_open_req, NULL, 0,
+                                          NULL, 0, NULL);
         if (ret)
                 goto out;
 
@@ -733,7 +747,7 @@ out:
                 GF_FREE (path);
 
         if ((ret < 0) && this && conf) {
-                decrement_reopen_fd_count (this, conf);
+                client_reopen_failed (this, conf);
         }
 
         return 0;
@@ -741,13 +755,73 @@ out:
 }
 
 
+/* Sends the reopens of the queued fds while fewer than reopen-window fds are
+ * being recovered. @done is the number of fds whose recovery just finished.
+ * Only one thread sends at a time, the others leave their slots to it.
+ */
+void
+client_reopen_dispatch (xlator_t *this, int done)
+{
+        clnt_conf_t            *conf = NULL;
+        clnt_fd_ctx_t          *fdctx = NULL;
+
+        conf = this->private;
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                conf->reopen_inflight -= done;
+                if (conf->reopen_dispatching) {
+                        pthread_mutex_unlock (&conf->lock);
+                        return;
+                }
+
+                conf->reopen_dispatching = 1;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        for (;;) {
+                fdctx = NULL;
+
+                pthread_mutex_lock (&conf->lock);
+                {
+                        if ((conf->reopen_inflight < conf->reopen_window)
+                            && !list_empty (&conf->reopen_fds)) {
+                                fdctx = list_entry (conf->reopen_fds.next,
+                                                    clnt_fd_ctx_t, sfd_pos);
+                                list_del_init (&fdctx->sfd_pos);
+                                conf->reopen_queued--;
+                                conf->reopen_inflight++;
+                        } else {
+                                conf->reopen_dispatching = 0;
+                        }
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (!fdctx)
+                        break;
+
+                if (fdctx->released) {
+                        /* closed while waiting, nothing to reopen */
+                        inode_unref (fdctx->inode);
+                        GF_FREE (fdctx);
+                        decrement_reopen_fd_count (this, conf);
+                        continue;
+                }
+
+                if (fdctx->is_dir)
+                        protocol_client_reopendir (this, fdctx);
+                else
+                        protocol_client_reopen (this, fdctx);
+        }
+}
+
+
 int
 client_post_handshake (call_frame_t *frame, xlator_t *this)
 {
         clnt_conf_t            *conf = NULL;
         clnt_fd_ctx_t          *tmp = NULL;
         clnt_fd_ctx_t          *fdctx = NULL;
-        struct list_head        reopen_head;
 
         int count = 0;
 
@@ -755,7 +829,6 @@ client_post_handshake (call_frame_t *frame, xlator_t *this)
                 goto out;
 
         conf = this->private;
-        INIT_LIST_HEAD (&reopen_head);
 
         pthread_mutex_lock (&conf->lock);
         {
@@ -765,28 +838,26 @@ client_post_handshake (call_frame_t *frame, xlator_t *this)
                                 continue;
 
                         list_del_init (&fdctx->sfd_pos);
-                        list_add_tail (&fdctx->sfd_pos, &reopen_head);
+                        list_add_tail (&fdctx->sfd_pos, &conf->reopen_fds);
+                        conf->reopen_queued++;
                         count++;
                 }
+
+                /* before any of them can be dispatched */
+                if (count > 0)
+                        client_save_number_fds (conf, count);
         }
         pthread_mutex_unlock (&conf->lock);
 
         /* Delay notifying CHILD_UP to parents
-           until all locks are recovered */
+           until all locks are recovered. Fops on the fds reopened
+           meanwhile go through as soon as their reopen is done. */
         if (count > 0) {
                 gf_log (this->name, GF_LOG_INFO,
-                        "%d fds open - Delaying child_up until they are re-opened",
-                        count);
-                client_save_number_fds (conf, count);
-
-                list_for_each_entry_safe (fdctx, tmp, &reopen_head, sfd_pos) {
-                        list_del_init (&fdctx->sfd_pos);
-
-                        if (fdctx->is_dir)
-                                protocol_client_reopendir (this, fdctx);
-                        else
-                                protocol_client_reopen (this, fdctx);
-                }
+                        "%d fds open - Delaying child_up until they are "
+                        "re-opened (%d at a time)", count,
+                        conf->reopen_window);
+                client_reopen_dispatch (this, 0);
         } else {
                 gf_log (this->name, GF_LOG_DEBUG,
                         "no open fds - notifying all parents child up");
@@ -796,6 +867,139 @@ out:
         return 0;
 }
 
+/* The fds are reopened, and CHILD_UP sent, once SETVOLUME succeeded on all
+   the connections */
+int
+client_conns_check (xlator_t *this)
+{
+        clnt_conf_t *conf  = NULL;
+        int          ready = 1;
+        int          i     = 0;
+
+        conf = this->private;
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                if (conf->conns_attached)
+                        ready = 0;
+
+                for (i = 0; i < conf->conn_count; i++) {
+                        if (!conf->conns[i].attached)
+                                ready = 0;
+                }
+
+                if (ready)
+                        conf->conns_attached = 1;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        if (ready)
+                client_post_handshake (NULL, this);
+
+        return 0;
+}
+
+
+/* SETVOLUME succeeded on the first connection: the others connect to the
+   port it was given by the portmapper */
+int
+client_conns_attach (xlator_t *this)
+{
+        clnt_conf_t            *conf   = NULL;
+        clnt_conn_t            *cconn  = NULL;
+        struct rpc_clnt_config  config = {0, };
+        int                     i      = 0;
+
+        conf = this->private;
+
+        config.remote_port = conf->rpc->conn.config.remote_port;
+
+        for (i = 1; i < conf->conn_count; i++) {
+                cconn = &conf->conns[i];
+
+                rpc_clnt_reconfig (cconn->rpc, &config);
+                if (!cconn->started) {
+                        cconn->started = 1;
+                        rpc_clnt_start (cconn->rpc);
+                }
+        }
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                conf->conns[0].attached = 1;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        return client_conns_check (this);
+}
+
+
+int
+client_conn_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                           void *myframe)
+{
+        call_frame_t         *frame    = NULL;
+        clnt_conf_t          *conf     = NULL;
+        clnt_conn_t          *cconn    = NULL;
+        xlator_t             *this     = NULL;
+        gf_setvolume_rsp      rsp      = {0,};
+        int                   ret      = 0;
+        int32_t               op_ret   = -1;
+        int32_t               op_errno = 0;
+
+        frame = myframe;
+        this  = frame->this;
+        conf  = this->private;
+        cconn = frame->cookie;
+
+        if (-1 == req->rpc_status) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "received RPC status error");
+                goto out;
+        }
+
+        ret = xdr_to_setvolume_rsp (*iov, &rsp);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
+                goto out;
+        }
+
+        op_ret   = rsp.op_ret;
+        op_errno = gf_error_to_errno (rsp.op_errno);
+        if (-1 == op_ret) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "SETVOLUME on connection %d failed (%s)",
+                        cconn->index, (op_errno) ? strerror (op_errno) : "--");
+                goto out;
+        }
+
+        gf_log (this->name, GF_LOG_DEBUG, "connection %d attached",
+                cconn->index);
+
+        rpc_clnt_set_connected (&cconn->rpc->conn);
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                cconn->attached = 1;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        client_conns_check (this);
+
+out:
+        /* retried on the next connect */
+        if (-1 == op_ret)
+                rpc_transport_disconnect (cconn->rpc->conn.trans);
+
+        if (rsp.dict.dict_val)
+                free (rsp.dict.dict_val);
+
+        STACK_DESTROY (frame->root);
+
+        return 0;
+}
+
+
 int
 client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *myframe)
 {
@@ -810,6 +1014,7 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
         int                   ret           = 0;
         int32_t               op_ret        = 0;
         int32_t               op_errno        = 0;
+        int32_t               compound_fops = 0;
 
         frame = myframe;
         this  = frame->this;
@@ -907,6 +1112,10 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
         }
         */
 
+        /* servers which do not know about compound requests do not say so */
+        ret = dict_get_int32 (reply, "compound-fops", &compound_fops);
+        conf->compound_fops = ((ret == 0) && compound_fops);
+
         gf_log (this->name, GF_LOG_INFO,
                 "Connected to %s, attached to remote volume '%s'.",
                 conf->rpc->conn.trans->peerinfo.identifier,
@@ -921,7 +1130,7 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
         conf->need_different_port = 0;
 
         /* TODO: more to test */
-        client_post_handshake (frame, frame->this);
+        client_conns_attach (this);
 
 out:
 
@@ -958,7 +1167,9 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
         call_frame_t     *fr              = NULL;
         char             *process_uuid_xl = NULL;
         clnt_conf_t      *conf            = NULL;
+        clnt_conn_t      *cconn           = NULL;
         dict_t           *options         = NULL;
+        int               i               = 0;
 
         struct rpc_clnt_config config = {0, };
 
@@ -966,6 +1177,12 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
         options = this->options;
         conf    = this->private;
 
+        cconn = &conf->conns[0];
+        for (i = 1; i < conf->conn_count; i++) {
+                if (conf->conns[i].rpc == rpc)
+                        cconn = &conf->conns[i];
+        }
+
         if (conf->fops) {
                 ret = dict_set_int32 (options, "fops-version",
                                       conf->fops->prognum);
@@ -1037,14 +1254,19 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
         if (!fr)
                 goto fail;
 
-        ret = client_submit_request (this, &req, fr, conf->handshake,
-                                     GF_HNDSK_SETVOLUME, client_setvolume_cbk,
-                                     NULL, xdr_from_setvolume_req, NULL, 0,
-                                     NULL, 0, NULL);
+        fr->cookie = cconn;
+
+        ret = client_submit_request_conn (this, cconn, &req, fr,
+                                          conf->handshake, GF_HNDSK_SETVOLUME,
+                                          (cconn->index == 0) ?
+                                          client_setvolume_cbk :
+                                          client_conn_setvolume_cbk,
+                                          NULL, xdr_from_setvolume_req, NULL,
+                                          0, NULL, 0, NULL);
 
 fail:
 
-        if (ret) {
+        if (ret && (cconn == &conf->conns[0])) {
                 config.remote_port = -1;
                 rpc_clnt_reconfig (conf->rpc, &config);
         }
@@ -525,6 +525,8 @@ client_save_number_fds (clnt_conf_t *conf, int count)
         LOCK (&conf->rec_lock);
         {
                 conf->reopen_fd_count = count;
+                conf->reopen_total = count;
+                conf->reopen_failed = 0;
         }
         UNLOCK (&conf->rec_lock);
 }
@@ -612,6 +614,9 @@ decrement_reopen_fd_count (xlator_t *this, clnt_conf_t *conf)
         }
         UNLOCK (&conf->rec_lock);
 
+        /* The fd is done with, let the next one be reopened */
+        client_reopen_dispatch (this, 1);
+
         if (fd_count == 0) {
                 gf_log (this->name, GF_LOG_INFO,
                         "last fd open'd/lock-self-heal'd - notifying CHILD-UP");
@@ -621,6 +626,18 @@ decrement_reopen_fd_count (xlator_t *this, clnt_conf_t *conf)
         return fd_count;
 }
 
+uint64_t
+client_reopen_failed (xlator_t *this, clnt_conf_t *conf)
+{
+        LOCK (&conf->rec_lock);
+        {
+                conf->reopen_failed++;
+        }
+        UNLOCK (&conf->rec_lock);
+
+        return decrement_reopen_fd_count (this, conf);
+}
+
 int32_t
 client_remove_reserve_lock_cbk (call_frame_t *frame,
                                 void *cookie,
@@ -37,10 +37,74 @@ extern rpc_clnt_prog_t clnt_dump_prog;
 extern struct rpcclnt_cb_program gluster_cbk_prog;
 
 int client_handshake (xlator_t *this, struct rpc_clnt *rpc);
+int client_setvolume (xlator_t *this, struct rpc_clnt *rpc);
 void client_start_ping (void *data);
 int client_init_rpc (xlator_t *this);
 int client_destroy_rpc (xlator_t *this);
 
+/* inode of the fop being sent by this thread, if any */
+static pthread_key_t  client_inode_key;
+static pthread_once_t client_inode_key_once = PTHREAD_ONCE_INIT;
+
+static void
+client_inode_key_init (void)
+{
+        pthread_key_create (&client_inode_key, NULL);
+}
+
+
+/* All the fops on an inode go through the same connection, so that they
+   reach the brick in the order they were sent, and fds and locks are only
+   used on the connection they were obtained on. */
+clnt_conn_t *
+client_conn_get (xlator_t *this, inode_t *inode)
+{
+        clnt_conf_t *conf = NULL;
+
+        conf = this->private;
+
+        if ((conf->conn_count <= 1) || !inode)
+                return &conf->conns[0];
+
+        return &conf->conns[((uintptr_t)inode / sizeof (*inode))
+                            % conf->conn_count];
+}
+
+
+clnt_conn_t *
+client_conn_current (xlator_t *this)
+{
+        return client_conn_get (this, pthread_getspecific (client_inode_key));
+}
+
+
+static int
+client_proc_fn (rpc_clnt_procedure_t *proc, call_frame_t *frame,
+                xlator_t *this, clnt_args_t *args)
+{
+        inode_t *inode = NULL;
+        void    *saved = NULL;
+        int      ret   = -1;
+
+        if (args->fd)
+                inode = args->fd->inode;
+        else if (args->loc)
+                inode = (args->loc->inode) ? args->loc->inode
+                        : args->loc->parent;
+        else if (args->oldloc)
+                inode = args->oldloc->inode;
+
+        saved = pthread_getspecific (client_inode_key);
+        pthread_setspecific (client_inode_key, inode);
+
+        ret = proc->fn (frame, this, args);
+
+        pthread_setspecific (client_inode_key, saved);
+
+        return ret;
+}
+
+
 int
 client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                        rpc_clnt_prog_t *prog, int procnum, fop_cbk_fn_t cbk,
@@ -48,6 +112,23 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                        struct iovec *rsphdr, int rsphdr_count,
                        struct iovec *rsp_payload, int rsp_payload_count,
                        struct iobref *rsp_iobref)
+{
+        return client_submit_request_conn (this, client_conn_current (this),
+                                           req, frame, prog, procnum, cbk,
+                                           iobref, sfunc, rsphdr, rsphdr_count,
+                                           rsp_payload, rsp_payload_count,
+                                           rsp_iobref);
+}
+
+
+int
+client_submit_request_conn (xlator_t *this, clnt_conn_t *conn, void *req,
+                            call_frame_t *frame, rpc_clnt_prog_t *prog,
+                            int procnum, fop_cbk_fn_t cbk,
+                            struct iobref *iobref, gfs_serialize_t sfunc,
+                            struct iovec *rsphdr, int rsphdr_count,
+                            struct iovec *rsp_payload, int rsp_payload_count,
+                            struct iobref *rsp_iobref)
 {
         int            ret         = -1;
         clnt_conf_t   *conf        = NULL;
@@ -66,7 +147,7 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
         /* If 'setvolume' is not successful, we should not send frames to
            server, mean time we should be able to send 'DUMP' and 'SETVOLUME'
            call itself even if its not connected */
-        if (!(conf->connected ||
+        if (!((conf->connected && ((conn->index == 0) || conn->attached)) ||
               ((prog->prognum == GLUSTER_DUMP_PROGRAM) ||
                (prog->prognum == GLUSTER_PMAP_PROGRAM) ||
                ((prog->prognum == GLUSTER_HNDSK_PROGRAM) &&
@@ -121,7 +202,7 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                 count = 1;
         }
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbk, &iov, count, NULL,
+        ret = rpc_clnt_submit (conn->rpc, prog, procnum, cbk, &iov, count, NULL,
                                0, new_iobref, frame, rsphdr, rsphdr_count,
                                rsp_payload, rsp_payload_count, rsp_iobref);
 
@@ -130,17 +211,17 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
         }
 
         if (ret == 0) {
-                pthread_mutex_lock (&conf->rpc->conn.lock);
+                pthread_mutex_lock (&conn->rpc->conn.lock);
                 {
-                        if (!conf->rpc->conn.ping_started) {
+                        if (!conn->rpc->conn.ping_started) {
                                 start_ping = 1;
                         }
                 }
-                pthread_mutex_unlock (&conf->rpc->conn.lock);
+                pthread_mutex_unlock (&conn->rpc->conn.lock);
         }
 
         if (start_ping)
-                client_start_ping ((void *) this);
+                client_start_ping ((void *) conn);
 
         ret = 0;
 out:
@@ -188,7 +269,7 @@ client_releasedir (xlator_t *this, fd_t *fd)
                 if (!frame) {
                         goto out;
                 }
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
         }
 out:
         if (ret)
@@ -223,7 +304,7 @@ client_release (xlator_t *this, fd_t *fd)
                 if (!frame) {
                         goto out;
                 }
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
         }
 out:
         if (ret)
@@ -257,7 +338,7 @@ client_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         /* think of avoiding a missing frame */
         if (ret)
@@ -290,7 +371,7 @@ client_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (stat, frame, -1, ENOTCONN, NULL);
@@ -322,7 +403,7 @@ client_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc, off_t offset)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (truncate, frame, -1, ENOTCONN, NULL, NULL);
@@ -355,7 +436,7 @@ client_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (ftruncate, frame, -1, ENOTCONN, NULL, NULL);
@@ -388,7 +469,7 @@ client_access (call_frame_t *frame, xlator_t *this, loc_t *loc, int32_t mask)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (access, frame, -1, ENOTCONN);
@@ -422,7 +503,7 @@ client_readlink (call_frame_t *frame, xlator_t *this, loc_t *loc, size_t size)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (readlink, frame, -1, ENOTCONN, NULL, NULL);
@@ -457,7 +538,7 @@ client_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (mknod, frame, -1, ENOTCONN,
@@ -492,7 +573,7 @@ client_mkdir (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (mkdir, frame, -1, ENOTCONN,
@@ -525,7 +606,7 @@ client_unlink (call_frame_t *frame, xlator_t *this, loc_t *loc)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (unlink, frame, -1, ENOTCONN,
@@ -557,7 +638,7 @@ client_rmdir (call_frame_t *frame, xlator_t *this, loc_t *loc, int flags)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         /* think of avoiding a missing frame */
         if (ret)
@@ -593,7 +674,7 @@ client_symlink (call_frame_t *frame, xlator_t *this, const char *linkpath,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (symlink, frame, -1, ENOTCONN,
@@ -627,7 +708,7 @@ client_rename (call_frame_t *frame, xlator_t *this, loc_t *oldloc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (rename, frame, -1, ENOTCONN,
@@ -662,7 +743,7 @@ client_link (call_frame_t *frame, xlator_t *this, loc_t *oldloc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (link, frame, -1, ENOTCONN,
@@ -700,7 +781,7 @@ client_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (create, frame, -1, ENOTCONN,
@@ -737,7 +818,7 @@ client_open (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 
 out:
         if (ret)
@@ -773,7 +854,7 @@ client_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 
 out:
         if (ret)
@@ -814,7 +895,7 @@ client_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (writev, frame, -1, ENOTCONN, NULL, NULL);
@@ -846,7 +927,7 @@ client_flush (call_frame_t *frame, xlator_t *this, fd_t *fd)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (flush, frame, -1, ENOTCONN);
@@ -880,7 +961,7 @@ client_fsync (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fsync, frame, -1, ENOTCONN, NULL, NULL);
@@ -912,7 +993,7 @@ client_fstat (call_frame_t *frame, xlator_t *this, fd_t *fd)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fstat, frame, -1, ENOTCONN, NULL);
@@ -945,7 +1026,7 @@ client_opendir (call_frame_t *frame, xlator_t *this, loc_t *loc, fd_t *fd)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (opendir, frame, -1, ENOTCONN, NULL);
@@ -978,7 +1059,7 @@ client_fsyncdir (call_frame_t *frame, xlator_t *this, fd_t *fd, int32_t flags)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fsyncdir, frame, -1, ENOTCONN);
@@ -1010,7 +1091,7 @@ client_statfs (call_frame_t *frame, xlator_t *this, loc_t *loc)
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (statfs, frame, -1, ENOTCONN, NULL);
@@ -1199,7 +1280,7 @@ client_setxattr (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *dict,
                 goto out;
         }
         if (proc->fn) {
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
                 if (ret) {
                         need_unwind = 1;
                 }
@@ -1238,7 +1319,7 @@ client_fsetxattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fsetxattr, frame, -1, ENOTCONN);
@@ -1273,7 +1354,7 @@ client_fgetxattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fgetxattr, frame, -1, ENOTCONN, NULL);
@@ -1307,7 +1388,7 @@ client_getxattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (getxattr, frame, -1, ENOTCONN, NULL);
@@ -1342,7 +1423,7 @@ client_xattrop (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (xattrop, frame, -1, ENOTCONN, NULL);
@@ -1377,7 +1458,7 @@ client_fxattrop (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fxattrop, frame, -1, ENOTCONN, NULL);
@@ -1411,7 +1492,7 @@ client_removexattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (removexattr, frame, -1, ENOTCONN);
@@ -1445,7 +1526,7 @@ client_lk (call_frame_t *frame, xlator_t *this, fd_t *fd, int32_t cmd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (lk, frame, -1, ENOTCONN, NULL);
@@ -1480,7 +1561,7 @@ client_inodelk (call_frame_t *frame, xlator_t *this, const char *volume,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (inodelk, frame, -1, ENOTCONN);
@@ -1516,7 +1597,7 @@ client_finodelk (call_frame_t *frame, xlator_t *this, const char *volume,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (finodelk, frame, -1, ENOTCONN);
@@ -1553,7 +1634,7 @@ client_entrylk (call_frame_t *frame, xlator_t *this, const char *volume,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (entrylk, frame, -1, ENOTCONN);
@@ -1591,7 +1672,7 @@ client_fentrylk (call_frame_t *frame, xlator_t *this, const char *volume,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fentrylk, frame, -1, ENOTCONN);
@@ -1625,7 +1706,7 @@ client_rchecksum (call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (rchecksum, frame, -1, ENOTCONN, 0, NULL);
@@ -1658,7 +1739,7 @@ client_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (readdir, frame, -1, ENOTCONN, NULL);
@@ -1692,7 +1773,7 @@ client_readdirp (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (readdirp, frame, -1, ENOTCONN, NULL);
@@ -1726,7 +1807,7 @@ client_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (setattr, frame, -1, ENOTCONN, NULL, NULL);
@@ -1759,7 +1840,7 @@ client_fsetattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 goto out;
         }
         if (proc->fn)
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
 out:
         if (ret)
                 STACK_UNWIND_STRICT (fsetattr, frame, -1, ENOTCONN, NULL, NULL);
@@ -1768,6 +1849,39 @@ out:
 }
 
 
+int32_t
+client_compound (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                 compound_args_t *compound)
+{
+        int          ret  = -1;
+        clnt_conf_t *conf = NULL;
+        rpc_clnt_procedure_t *proc = NULL;
+        clnt_args_t  args = {0,};
+
+        conf = this->private;
+        if (!conf || !conf->fops)
+                goto out;
+
+        args.fd       = fd;
+        args.compound = compound;
+
+        proc = &conf->fops->proctable[GF_FOP_COMPOUND];
+        if (!proc) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "rpc procedure not found for %s",
+                        gf_fop_list[GF_FOP_COMPOUND]);
+                goto out;
+        }
+        if (proc->fn)
+                ret = client_proc_fn (proc, frame, this, &args);
+out:
+        if (ret)
+                STACK_UNWIND_STRICT (compound, frame, -1, ENOTCONN, compound);
+
+	return 0;
+}
+
+
 int32_t
 client_getspec (call_frame_t *frame, xlator_t *this, const char *key,
                 int32_t flags)
@@ -1794,7 +1908,7 @@ client_getspec (call_frame_t *frame, xlator_t *this, const char *key,
         }
         if (proc->fn) {
                 /* But at protocol level, this is handshake */
-                ret = proc->fn (frame, this, &args);
+                ret = client_proc_fn (proc, frame, this, &args);
         }
 out:
         if (ret)
@@ -1818,6 +1932,10 @@ client_mark_fd_bad (xlator_t *this)
                                           sfd_pos) {
                         fdctx->remote_fd = -1;
                 }
+
+                /* reopens not sent yet wait for the next connection */
+                list_splice_init (&conf->reopen_fds, &conf->saved_fds);
+                conf->reopen_queued = 0;
         }
         pthread_mutex_unlock (&conf->lock);
 
@@ -1833,6 +1951,8 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
         char *handshake = NULL;
         clnt_conf_t  *conf = NULL;
         int ret = 0;
+        int i = 0;
+        clnt_conn_t *cconn = NULL;
 
         this = mydata;
         if (!this || !this->private) {
@@ -1877,6 +1997,21 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
 
                 client_mark_fd_bad (this);
 
+                pthread_mutex_lock (&conf->lock);
+                {
+                        conf->conns[0].attached = 0;
+                        conf->conns_attached = 0;
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                /* the fds get reopened on all the connections, and the
+                   brick must not keep the old ones open on the others */
+                for (i = 1; i < conf->conn_count; i++) {
+                        cconn = &conf->conns[i];
+                        if (cconn->started)
+                                rpc_transport_disconnect (cconn->rpc->conn.trans);
+                }
+
                 if (!conf->skip_notify) {
                         if (conf->connected)
                                 gf_log (this->name, GF_LOG_INFO,
@@ -1918,6 +2053,66 @@ out:
 }
 
 
+/* Events of the connections other than the first one */
+int
+client_conn_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
+                    void *data)
+{
+        xlator_t     *this       = NULL;
+        clnt_conf_t  *conf       = NULL;
+        clnt_conn_t  *cconn      = NULL;
+        int           disconnect = 0;
+        int           ret        = 0;
+
+        cconn = mydata;
+        this  = cconn->this;
+        conf  = this->private;
+
+        switch (event) {
+        case RPC_CLNT_CONNECT:
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "got RPC_CLNT_CONNECT on connection %d", cconn->index);
+
+                ret = client_setvolume (this, rpc);
+                if (ret)
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "handshake on connection %d returned %d",
+                                cconn->index, ret);
+                break;
+
+        case RPC_CLNT_DISCONNECT:
+                pthread_mutex_lock (&conf->lock);
+                {
+                        if (cconn->attached)
+                                gf_log (this->name, GF_LOG_INFO,
+                                        "connection %d disconnected",
+                                        cconn->index);
+                        cconn->attached = 0;
+
+                        /* the fds and locks obtained through it are gone on
+                           the brick: start over on all the connections */
+                        if (conf->conns_attached) {
+                                conf->conns_attached = 0;
+                                disconnect = 1;
+                        }
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (disconnect && conf->rpc)
+                        rpc_transport_disconnect (conf->rpc->conn.trans);
+                break;
+
+        default:
+                gf_log (this->name, GF_LOG_TRACE,
+                        "got some other RPC event %d on connection %d",
+                        event, cconn->index);
+                break;
+        }
+
+        return 0;
+}
+
+
 int
 notify (xlator_t *this, int32_t event, void *data, ...)
 {
@@ -1955,6 +2150,7 @@ build_client_config (xlator_t *this, clnt_conf_t *conf)
 {
         int                     ret = -1;
         char                    *def_val = NULL;
+        char                    *handshake = NULL;
 
         if (!conf)
                 goto out;
@@ -2014,6 +2210,59 @@ build_client_config (xlator_t *this, clnt_conf_t *conf)
                         "setting ping-timeout to %d", conf->opt.ping_timeout);
         }
 
+        if (xlator_get_volopt_info (&this->volume_options, "reopen-window",
+                                    &def_val, NULL)) {
+                gf_log (this->name, GF_LOG_ERROR, "Default value of "
+                         "reopen-window not found");
+                ret = -1;
+                goto out;
+        } else {
+                if (gf_string2int32 (def_val, &conf->reopen_window)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Default value of "
+                                 "reopen-window corrupt");
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        ret = dict_get_int32 (this->options, "reopen-window",
+                              &conf->reopen_window);
+        if (ret >= 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "setting reopen-window to %d", conf->reopen_window);
+        }
+
+        if (xlator_get_volopt_info (&this->volume_options, "connection-count",
+                                    &def_val, NULL)) {
+                gf_log (this->name, GF_LOG_ERROR, "Default value of "
+                         "connection-count not found");
+                ret = -1;
+                goto out;
+        } else {
+                if (gf_string2int32 (def_val, &conf->conn_count)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Default value of "
+                                 "connection-count corrupt");
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        ret = dict_get_int32 (this->options, "connection-count",
+                              &conf->conn_count);
+        if (ret >= 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "setting connection-count to %d", conf->conn_count);
+        }
+
+        /* only the first connection would be usable without SETVOLUME */
+        ret = dict_get_str (this->options, "disable-handshake", &handshake);
+        if ((ret == 0) && !strcasecmp (handshake, "on") &&
+            (conf->conn_count > 1)) {
+                gf_log (this->name, GF_LOG_WARNING, "handshake disabled, "
+                        "using a single connection");
+                conf->conn_count = 1;
+        }
+
         ret = dict_get_str (this->options, "remote-subvolume",
                             &conf->opt.remote_subvolume);
         if (ret) {
@@ -2053,6 +2302,7 @@ int
 client_destroy_rpc (xlator_t *this)
 {
         int          ret  = -1;
+        int          i    = 0;
         clnt_conf_t *conf = NULL;
 
         conf = this->private;
@@ -2060,7 +2310,16 @@ client_destroy_rpc (xlator_t *this)
                 goto out;
 
         if (conf->rpc) {
+                for (i = 1; i < conf->conn_count; i++) {
+                        if (conf->conns[i].rpc)
+                                rpc_clnt_unref (conf->conns[i].rpc);
+                        conf->conns[i].rpc = NULL;
+                        conf->conns[i].started = 0;
+                        conf->conns[i].attached = 0;
+                }
+
                 conf->rpc = rpc_clnt_unref (conf->rpc);
+                conf->conns[0].rpc = conf->rpc;
                 ret = 0;
                 gf_log (this->name, GF_LOG_DEBUG,
                         "Client rpc conn destroyed");
@@ -2078,8 +2337,10 @@ out:
 int
 client_init_rpc (xlator_t *this)
 {
-        int          ret  = -1;
-        clnt_conf_t *conf = NULL;
+        int          ret   = -1;
+        int          i     = 0;
+        clnt_conf_t *conf  = NULL;
+        clnt_conn_t *cconn = NULL;
 
         conf = this->private;
 
@@ -2112,6 +2373,31 @@ client_init_rpc (xlator_t *this)
                 goto out;
         }
 
+        conf->conns[0].rpc = conf->rpc;
+
+        /* the others are started once the first one found the brick */
+        for (i = 1; i < conf->conn_count; i++) {
+                cconn = &conf->conns[i];
+
+                cconn->rpc = rpc_clnt_new (this->options, this->ctx,
+                                           this->name);
+                if (!cconn->rpc) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "failed to initialize RPC of connection %d", i);
+                        ret = -1;
+                        goto out;
+                }
+
+                ret = rpc_clnt_register_notify (cconn->rpc, client_conn_notify,
+                                                cconn);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "failed to register notify of connection %d",
+                                i);
+                        goto out;
+                }
+        }
+
         ret = 0;
 
         gf_log (this->name, GF_LOG_DEBUG, "client init successful");
@@ -2156,6 +2442,7 @@ reconfigure (xlator_t *this, dict_t *options)
 	int          timeout_ret       = 0;
 	int          ping_timeout      = 0;
 	int          frame_timeout     = 0;
+        int          reopen_window     = 0;
         int          subvol_ret        = 0;
         char        *old_remote_subvol = NULL;
         char        *new_remote_subvol = NULL;
@@ -2220,6 +2507,31 @@ reconfigure (xlator_t *this, dict_t *options)
         else
                 conf->opt.ping_timeout = GF_UNIVERSAL_ANSWER;
 
+        ret = dict_get_int32 (options, "reopen-window", &reopen_window);
+        if (ret == 0) {
+                if (reopen_window < 1) {
+                        gf_log (this->name, GF_LOG_WARNING, "Reconfiguration"
+                                " 'option reopen-window %d' failed, Min value"
+                                " can be 1, Defaulting to old value (%d)",
+                                reopen_window, conf->reopen_window);
+                        ret = 0;
+                        goto out;
+                }
+
+                gf_log (this->name, GF_LOG_DEBUG, "Reconfiguring "
+                        "'option reopen-window' to %d", reopen_window);
+
+                pthread_mutex_lock (&conf->lock);
+                {
+                        conf->reopen_window = reopen_window;
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                /* a larger window lets queued reopens go now */
+                client_reopen_dispatch (this, 0);
+        }
+        ret = 0;
+
         subvol_ret = dict_get_str (this->options, "remote-host",
                                    &old_remote_host);
 
@@ -2261,6 +2573,7 @@ int
 init (xlator_t *this)
 {
         int          ret = -1;
+        int          i   = 0;
         clnt_conf_t *conf = NULL;
 
         /* */
@@ -2282,6 +2595,15 @@ init (xlator_t *this)
 
         pthread_mutex_init (&conf->lock, NULL);
         INIT_LIST_HEAD (&conf->saved_fds);
+        INIT_LIST_HEAD (&conf->reopen_fds);
+
+        for (i = 0; i < CLIENT_MAX_CONNECTIONS; i++) {
+                conf->conns[i].this  = this;
+                conf->conns[i].index = i;
+        }
+        conf->conn_count = 1;
+
+        pthread_once (&client_inode_key_once, client_inode_key_init);
 
         LOCK_INIT (&conf->rec_lock);
 
@@ -2317,6 +2639,7 @@ void
 fini (xlator_t *this)
 {
         clnt_conf_t *conf = NULL;
+        int          i    = 0;
 
         conf = this->private;
         this->private = NULL;
@@ -2325,6 +2648,11 @@ fini (xlator_t *this)
                 if (conf->rpc)
                        rpc_clnt_unref (conf->rpc);
 
+                for (i = 1; i < conf->conn_count; i++) {
+                        if (conf->conns[i].rpc)
+                                rpc_clnt_unref (conf->conns[i].rpc);
+                }
+
                 /* Saved Fds */
                 /* TODO: */
 
@@ -2341,6 +2669,7 @@ client_priv_dump (xlator_t *this)
         clnt_conf_t    *conf = NULL;
         int             ret   = -1;
         clnt_fd_ctx_t  *tmp = NULL;
+        rpc_transport_t *trans = NULL;
         int             i = 0;
         char            key[GF_DUMP_MAX_BUF_LEN];
         char            key_prefix[GF_DUMP_MAX_BUF_LEN];
@@ -2375,6 +2704,24 @@ client_priv_dump (xlator_t *this)
 
         gf_proc_dump_build_key(key, key_prefix, "connecting");
         gf_proc_dump_write(key, "%d", conf->connecting);
+
+        LOCK (&conf->rec_lock);
+        {
+                gf_proc_dump_build_key(key, key_prefix, "reopen.total");
+                gf_proc_dump_write(key, "%"PRIu64, conf->reopen_total);
+                gf_proc_dump_build_key(key, key_prefix, "reopen.pending");
+                gf_proc_dump_write(key, "%"PRIu64, conf->reopen_fd_count);
+                gf_proc_dump_build_key(key, key_prefix, "reopen.failed");
+                gf_proc_dump_write(key, "%"PRIu64, conf->reopen_failed);
+        }
+        UNLOCK (&conf->rec_lock);
+
+        gf_proc_dump_build_key(key, key_prefix, "reopen.queued");
+        gf_proc_dump_write(key, "%d", conf->reopen_queued);
+        gf_proc_dump_build_key(key, key_prefix, "reopen.inflight");
+        gf_proc_dump_write(key, "%d", conf->reopen_inflight);
+        gf_proc_dump_build_key(key, key_prefix, "reopen.window");
+        gf_proc_dump_write(key, "%d", conf->reopen_window);
         gf_proc_dump_build_key(key, key_prefix, "last_sent");
         gf_proc_dump_write(key, "%s", ctime(&conf->last_sent.tv_sec));
         gf_proc_dump_build_key(key, key_prefix, "last_received");
@@ -2388,6 +2735,36 @@ client_priv_dump (xlator_t *this)
                 gf_proc_dump_build_key(key, key_prefix, "total_bytes_written");
                 gf_proc_dump_write(key, "%"PRIu64,
                                    conf->rpc->conn.trans->total_bytes_write);
+
+                trans = conf->rpc->conn.trans;
+                gf_proc_dump_build_key(key, key_prefix, "total_read_calls");
+                gf_proc_dump_write(key, "%"PRIu64, trans->total_read_calls);
+                gf_proc_dump_build_key(key, key_prefix, "total_rpcs_read");
+                gf_proc_dump_write(key, "%"PRIu64, trans->total_records_read);
+                gf_proc_dump_build_key(key, key_prefix, "read_calls_per_rpc");
+                gf_proc_dump_write(key, "%.2f", (trans->total_records_read) ?
+                                   ((double)trans->total_read_calls
+                                    / trans->total_records_read) : 0.0);
+        }
+
+        gf_proc_dump_build_key(key, key_prefix, "connection_count");
+        gf_proc_dump_write(key, "%d", conf->conn_count);
+
+        for (i = 1; i < conf->conn_count; i++) {
+                trans = (conf->conns[i].rpc) ? conf->conns[i].rpc->conn.trans
+                        : NULL;
+                if (!trans)
+                        continue;
+
+                gf_proc_dump_build_key(key, key_prefix,
+                                       "conn.%d.attached", i);
+                gf_proc_dump_write(key, "%d", conf->conns[i].attached);
+                gf_proc_dump_build_key(key, key_prefix,
+                                       "conn.%d.total_bytes_read", i);
+                gf_proc_dump_write(key, "%"PRIu64, trans->total_bytes_read);
+                gf_proc_dump_build_key(key, key_prefix,
+                                       "conn.%d.total_bytes_written", i);
+                gf_proc_dump_write(key, "%"PRIu64, trans->total_bytes_write);
         }
         pthread_mutex_unlock(&conf->lock);
 
@@ -2473,6 +2850,7 @@ struct xlator_fops fops = {
         .setattr     = client_setattr,
         .fsetattr    = client_fsetattr,
         .getspec     = client_getspec,
+        .compound    = client_compound,
 };
 
 
@@ -2521,5 +2899,21 @@ struct volume_options options[] = {
         { .key   = {"client-bind-insecure"},
           .type  = GF_OPTION_TYPE_BOOL
         },
+        { .key   = {"reopen-window"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 65536,
+          .default_value = "64",
+          .description = "Maximum number of fds reopened, with their locks "
+                         "recovered, at the same time after a reconnect."
+        },
+        { .key   = {"connection-count"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = CLIENT_MAX_CONNECTIONS,
+          .default_value = "1",
+          .description = "Number of connections opened to the brick. All the "
+                         "fops on an inode go through the same one."
+        },
         { .key   = {NULL} },
 };
@@ -35,13 +35,34 @@
 #define CLIENT_CMD_DISCONNECT "trusted.glusterfs.client-disconnect"
 #define CLIENT_DUMP_LOCKS     "trusted.glusterfs.clientlk-dump"
 
+/* largest write payload sent inside one compound request */
+#define CLIENT_COMPOUND_MAX_PAYLOAD (64 * GF_UNIT_KB)
+
+/* upper limit of 'option connection-count' */
+#define CLIENT_MAX_CONNECTIONS 16
+
 struct clnt_options {
         char *remote_subvolume;
         int   ping_timeout;
 };
 
+/* One of the connections to the brick. The first one is conf->rpc, which
+   alone carries the handshake, the management and the callback programs;
+   the others only carry fops. */
+typedef struct clnt_conn {
+        struct rpc_clnt       *rpc;
+        xlator_t              *this;
+        int                    index;
+        char                   started;    /* rpc_clnt_start () done */
+        char                   attached;   /* SETVOLUME succeeded on it */
+} clnt_conn_t;
+
 typedef struct clnt_conf {
         struct rpc_clnt       *rpc;
+        clnt_conn_t            conns[CLIENT_MAX_CONNECTIONS];
+        int                    conn_count;
+        char                   conns_attached; /* post handshake done once
+                                                  all connections attached */
         struct clnt_options    opt;
         struct rpc_clnt_config rpc_conf;
 	struct list_head       saved_fds;
@@ -58,7 +79,19 @@ typedef struct clnt_conf {
 
         uint64_t               reopen_fd_count; /* Count of fds reopened after a
                                                    connection is established */
+        uint64_t               reopen_total;    /* fds to recover after the
+                                                   last handshake */
+        uint64_t               reopen_failed;   /* of which could not be
+                                                   reopened */
         gf_lock_t              rec_lock;
+
+        struct list_head       reopen_fds;      /* fds waiting for their reopen
+                                                   to be sent */
+        int                    reopen_queued;
+        int                    reopen_inflight; /* fds being reopened or having
+                                                   their locks recovered */
+        int                    reopen_window;   /* max reopen_inflight */
+        char                   reopen_dispatching;
         int                    skip_notify;
 
         int                    last_sent_event; /* Flag used to make sure we are
@@ -69,6 +102,8 @@ typedef struct clnt_conf {
         char                   need_different_port; /* flag used to change the
                                                        portmap path in case of
                                                        'tcp,rdma' on server */
+        char                   compound_fops; /* server accepts compound
+                                                 requests */
 } clnt_conf_t;
 
 typedef struct _client_fd_ctx {
@@ -115,6 +150,7 @@ typedef struct client_local {
         int32_t              cmd;
         struct list_head     lock_list;
         pthread_mutex_t      mutex;
+        compound_args_t     *compound;
 } clnt_local_t;
 
 typedef struct client_args {
@@ -148,6 +184,7 @@ typedef struct client_args {
         gf_xattrop_flags_t  optype;
         int32_t             valid;
         int32_t             len;
+        compound_args_t    *compound;
 } clnt_args_t;
 
 typedef ssize_t (*gfs_serialize_t) (struct iovec outmsg, void *args);
@@ -158,6 +195,15 @@ void this_fd_set_ctx (fd_t *file, xlator_t *this, loc_t *loc,
                       clnt_fd_ctx_t *ctx);
 
 int client_local_wipe (clnt_local_t *local);
+clnt_conn_t *client_conn_get (xlator_t *this, inode_t *inode);
+clnt_conn_t *client_conn_current (xlator_t *this);
+int client_submit_request_conn (xlator_t *this, clnt_conn_t *conn, void *req,
+                                call_frame_t *frame, rpc_clnt_prog_t *prog,
+                                int procnum, fop_cbk_fn_t cbk,
+                                struct iobref *iobref, gfs_serialize_t sfunc,
+                                struct iovec *rsphdr, int rsphdr_count,
+                                struct iovec *rsp_payload, int rsp_count,
+                                struct iobref *rsp_iobref);
 int client_submit_request (xlator_t *this, void *req,
                            call_frame_t *frame, rpc_clnt_prog_t *prog,
                            int procnum, fop_cbk_fn_t cbk,
@@ -179,6 +225,8 @@ int32_t delete_granted_locks_owner (fd_t *fd, uint64_t owner);
 int client_add_lock_for_recovery (fd_t *fd, struct gf_flock *flock, uint64_t owner,
                                   int32_t cmd);
 uint64_t decrement_reopen_fd_count (xlator_t *this, clnt_conf_t *conf);
+uint64_t client_reopen_failed (xlator_t *this, clnt_conf_t *conf);
+void client_reopen_dispatch (xlator_t *this, int done);
 int32_t delete_granted_locks_fd (clnt_fd_ctx_t *fdctx);
 int32_t client_cmd_to_gf_cmd (int32_t cmd, int32_t *gf_cmd);
 void client_save_number_fds (clnt_conf_t *conf, int count);
@@ -188,5 +236,7 @@ int32_t is_client_dump_locks_cmd (char *name);
 int32_t client_dump_locks (char *name, inode_t *inode,
                            dict_t *dict);
 int client_fdctx_destroy (xlator_t *this, clnt_fd_ctx_t *fdctx);
+int client_conns_attach (xlator_t *this);
+int client_conns_check (xlator_t *this);
 
 #endif /* !_CLIENT_H */
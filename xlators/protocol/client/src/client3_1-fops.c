@@ -26,6 +26,7 @@
 #include "glusterfs3-xdr.h"
 #include "glusterfs3.h"
 #include "compat-errno.h"
+#include "defaults.h"
 
 int32_t client3_getspec (call_frame_t *frame, xlator_t *this, void *data);
 void client_start_ping (void *data);
@@ -38,7 +39,7 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
                            struct iobref *iobref, gfs_serialize_t sfunc)
 {
         int            ret        = 0;
-        clnt_conf_t   *conf       = NULL;
+        clnt_conn_t   *conn       = NULL;
         struct iovec   iov        = {0, };
         struct iobuf  *iobuf      = NULL;
         int            count      = 0;
@@ -47,7 +48,7 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
 
         start_ping = 0;
 
-        conf = this->private;
+        conn = client_conn_current (this);
 
         iobuf = iobuf_get (this->ctx->iobuf_pool);
         if (!iobuf) {
@@ -92,7 +93,7 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
                 count = 1;
         }
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbk, &iov, count,
+        ret = rpc_clnt_submit (conn->rpc, prog, procnum, cbk, &iov, count,
                                payload, payloadcnt, new_iobref, frame, NULL, 0,
                                NULL, 0, NULL);
         if (ret < 0) {
@@ -100,17 +101,17 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
         }
 
         if (ret == 0) {
-                pthread_mutex_lock (&conf->rpc->conn.lock);
+                pthread_mutex_lock (&conn->rpc->conn.lock);
                 {
-                        if (!conf->rpc->conn.ping_started) {
+                        if (!conn->rpc->conn.ping_started) {
                                 start_ping = 1;
                         }
                 }
-                pthread_mutex_unlock (&conf->rpc->conn.lock);
+                pthread_mutex_unlock (&conn->rpc->conn.lock);
         }
 
         if (start_ping)
-                client_start_ping ((void *) this);
+                client_start_ping ((void *) conn);
 
 out:
         if (new_iobref != NULL) {
@@ -785,6 +786,133 @@ out:
         return 0;
 }
 
+/* records the remote fd opened by the create of a compound request, the
+   way client3_1_create_cbk does for a plain create */
+static int
+client3_1_compound_fdctx_set (xlator_t *this, clnt_local_t *local,
+                              int64_t remote_fd)
+{
+        clnt_conf_t   *conf  = NULL;
+        clnt_fd_ctx_t *fdctx = NULL;
+
+        conf = this->private;
+
+        fdctx = GF_CALLOC (1, sizeof (*fdctx), gf_client_mt_clnt_fdctx_t);
+        if (!fdctx)
+                return -1;
+
+        fdctx->remote_fd = remote_fd;
+        fdctx->inode     = inode_ref (local->loc.inode);
+        fdctx->flags     = local->flags;
+
+        INIT_LIST_HEAD (&fdctx->sfd_pos);
+        INIT_LIST_HEAD (&fdctx->lock_list);
+
+        this_fd_set_ctx (local->fd, this, &local->loc, fdctx);
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                list_add_tail (&fdctx->sfd_pos, &conf->saved_fds);
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        return 0;
+}
+
+int
+client3_1_compound_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                        void *myframe)
+{
+        gfs3_compound_rsp     rsp      = {0,};
+        gfs3_compound_op_rsp *reply    = NULL;
+        compound_fop_t       *cfop     = NULL;
+        compound_args_t      *compound = NULL;
+        call_frame_t         *frame    = NULL;
+        clnt_local_t         *local    = NULL;
+        xlator_t             *this     = NULL;
+        int                   ret      = 0;
+        int                   i        = 0;
+
+        this = THIS;
+
+        frame = myframe;
+        local = frame->local;
+        compound = local->compound;
+
+        if (-1 == req->rpc_status) {
+                rsp.op_ret   = -1;
+                rsp.op_errno = ENOTCONN;
+                goto out;
+        }
+
+        ret = xdr_to_compound_rsp (*iov, &rsp);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "error");
+                rsp.op_ret   = -1;
+                rsp.op_errno = EINVAL;
+                goto out;
+        }
+
+        if (rsp.op_ret == -1)
+                goto out;
+
+        for (i = 0; i < compound->count; i++) {
+                cfop = &compound->fops[i];
+
+                if (i >= rsp.replies.replies_len) {
+                        cfop->op_ret = -1;
+                        cfop->op_errno = EIO;
+                        continue;
+                }
+
+                reply = &rsp.replies.replies_val[i];
+                cfop->op_ret = reply->op_ret;
+                cfop->op_errno = gf_error_to_errno (reply->op_errno);
+                if (cfop->op_ret == -1)
+                        continue;
+
+                gf_stat_to_iatt (&reply->prestat, &cfop->prebuf);
+                gf_stat_to_iatt (&reply->poststat, &cfop->postbuf);
+
+                if (cfop->fop == GF_FOP_CREATE) {
+                        gf_stat_to_iatt (&rsp.stat, &cfop->buf);
+
+                        ret = client3_1_compound_fdctx_set (this, local,
+                                                            rsp.fd);
+                        if (ret) {
+                                cfop->op_ret = -1;
+                                cfop->op_errno = ENOMEM;
+                        }
+                }
+
+                if (cfop->fop == GF_FOP_FLUSH) {
+                        /* Delete all saved locks of the owner issuing flush */
+                        ret = delete_granted_locks_owner (local->fd,
+                                                          local->owner);
+                        gf_log (this->name, GF_LOG_DEBUG,
+                                "deleting locks of owner (%llu) returned %d",
+                                (long long unsigned) local->owner, ret);
+                }
+        }
+
+out:
+        if (rsp.op_ret == -1) {
+                gf_log (this->name, GF_LOG_INFO, "remote operation failed: %s",
+                        strerror (gf_error_to_errno (rsp.op_errno)));
+        }
+
+        frame->local = NULL;
+        client_local_wipe (local);
+
+        STACK_UNWIND_STRICT (compound, frame, rsp.op_ret,
+                             gf_error_to_errno (rsp.op_errno), compound);
+
+        if (rsp.replies.replies_val)
+                free (rsp.replies.replies_val);
+
+        return 0;
+}
+
 int
 client3_1_setxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         void *myframe)
@@ -2336,8 +2464,9 @@ client3_1_releasedir_cbk (struct rpc_req *req, struct iovec *iov, int count,
 int
 client_fdctx_destroy (xlator_t *this, clnt_fd_ctx_t *fdctx)
 {
-        call_frame_t *fr = NULL;
-        int32_t       ret = -1;
+        call_frame_t *fr   = NULL;
+        clnt_conn_t  *conn = NULL;
+        int32_t       ret  = -1;
 
         if (!fdctx)
                 goto out;
@@ -2349,24 +2478,30 @@ client_fdctx_destroy (xlator_t *this, clnt_fd_ctx_t *fdctx)
 
         fr = create_frame (this, this->ctx->pool);
 
+        /* the fd is only known on the connection it was opened on */
+        conn = client_conn_get (this, fdctx->inode);
+
         if (fdctx->is_dir) {
                 gfs3_releasedir_req  req = {{0,},};
                 req.fd = fdctx->remote_fd;
                 gf_log (this->name, GF_LOG_INFO, "sending releasedir on fd");
-                ret = client_submit_request (this, &req, fr, &clnt3_1_fop_prog,
-                                             GFS3_OP_RELEASEDIR,
-                                             client3_1_releasedir_cbk,
-                                             NULL, xdr_from_releasedir_req,
-                                             NULL, 0, NULL, 0, NULL);
+                ret = client_submit_request_conn (this, conn, &req, fr,
+                                                  &clnt3_1_fop_prog,
+                                                  GFS3_OP_RELEASEDIR,
+                                                  client3_1_releasedir_cbk,
+                                                  NULL,
+                                                  xdr_from_releasedir_req,
+                                                  NULL, 0, NULL, 0, NULL);
         } else {
                 gfs3_release_req  req = {{0,},};
                 req.fd = fdctx->remote_fd;
                 gf_log (this->name, GF_LOG_INFO, "sending release on fd");
-                ret = client_submit_request (this, &req, fr, &clnt3_1_fop_prog,
-                                             GFS3_OP_RELEASE,
-                                             client3_1_release_cbk, NULL,
-                                             xdr_from_release_req, NULL, 0,
-                                             NULL, 0, NULL);
+                ret = client_submit_request_conn (this, conn, &req, fr,
+                                                  &clnt3_1_fop_prog,
+                                                  GFS3_OP_RELEASE,
+                                                  client3_1_release_cbk, NULL,
+                                                  xdr_from_release_req, NULL,
+                                                  0, NULL, 0, NULL);
         }
 
 out:
@@ -3753,6 +3888,221 @@ unwind:
 }
 
 
+static int
+client3_1_compound_op (glusterfs_fop_t fop)
+{
+        switch (fop) {
+        case GF_FOP_CREATE:
+                return GFS3_OP_CREATE;
+        case GF_FOP_WRITE:
+                return GFS3_OP_WRITE;
+        case GF_FOP_FLUSH:
+                return GFS3_OP_FLUSH;
+        case GF_FOP_FSYNC:
+                return GFS3_OP_FSYNC;
+        default:
+                return -1;
+        }
+}
+
+
+int32_t
+client3_1_compound (call_frame_t *frame, xlator_t *this,
+                    void *data)
+{
+        clnt_args_t       *args     = NULL;
+        compound_args_t   *compound = NULL;
+        compound_fop_t    *cfop     = NULL;
+        gfs3_compound_req  req      = {{0,},};
+        clnt_fd_ctx_t     *fdctx    = NULL;
+        clnt_conf_t       *conf     = NULL;
+        clnt_local_t      *local    = NULL;
+        struct iovec      *payload  = NULL;
+        int                payloadcnt = 0;
+        size_t             size     = 0;
+        size_t             dict_len = 0;
+        int                create   = 0;
+        int                op_errno = ESTALE;
+        int                ret      = 0;
+        int                i        = 0;
+
+        if (!frame || !this || !data)
+                goto unwind;
+
+        args = data;
+        conf = this->private;
+        compound = args->compound;
+        create = (compound->fops[0].fop == GF_FOP_CREATE);
+
+        /* the request travels as a single record, which the server reads
+           into one iobuf; anything which does not fit, or which an older
+           server does not understand, goes as separate fops */
+        if (!conf->compound_fops)
+                goto split;
+
+        for (i = 0; i < compound->count; i++) {
+                cfop = &compound->fops[i];
+                if (client3_1_compound_op (cfop->fop) == -1)
+                        goto split;
+                if ((cfop->fop == GF_FOP_CREATE) && (i > 0))
+                        goto split;
+                if (cfop->fop == GF_FOP_WRITE) {
+                        size += iov_length (cfop->vector, cfop->count);
+                        payloadcnt += cfop->count;
+                }
+        }
+
+        if (size > CLIENT_COMPOUND_MAX_PAYLOAD)
+                goto split;
+
+        if (create) {
+                /* the fd is opened by the create at the head of the list */
+                cfop = &compound->fops[0];
+                if (!(cfop->loc.parent && cfop->loc.path && cfop->loc.name)) {
+                        op_errno = EINVAL;
+                        goto unwind;
+                }
+
+                if (!uuid_is_null (cfop->loc.parent->gfid))
+                        memcpy (req.pargfid, cfop->loc.parent->gfid, 16);
+                else
+                        memcpy (req.pargfid, cfop->loc.pargfid, 16);
+
+                req.path  = (char *)cfop->loc.path;
+                req.bname = (char *)cfop->loc.name;
+                req.mode  = cfop->mode;
+                if (cfop->params) {
+                        ret = dict_allocate_and_serialize (cfop->params,
+                                                           &req.dict.dict_val,
+                                                           &dict_len);
+                        if (ret < 0) {
+                                gf_log (this->name, GF_LOG_WARNING,
+                                        "failed to get serialized length of "
+                                        "dict");
+                                op_errno = EINVAL;
+                                goto unwind;
+                        }
+                }
+                req.dict.dict_len = dict_len;
+        } else {
+                pthread_mutex_lock (&conf->lock);
+                {
+                        fdctx = this_fd_get_ctx (args->fd, this);
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (fdctx == NULL) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "(%"PRId64"): failed to get fd ctx. EBADFD",
+                                args->fd->inode->ino);
+                        op_errno = EBADFD;
+                        goto unwind;
+                }
+
+                if (fdctx->remote_fd == -1) {
+                        gf_log (this->name, GF_LOG_WARNING, "(%"PRId64"): "
+                                "failed to get fd ctx. EBADFD",
+                                args->fd->inode->ino);
+                        op_errno = EBADFD;
+                        goto unwind;
+                }
+
+                req.fd    = fdctx->remote_fd;
+                req.path  = "";
+                req.bname = "";
+        }
+
+        op_errno = ENOMEM;
+
+        req.ops.ops_val = GF_CALLOC (compound->count, sizeof (gfs3_compound_op),
+                                     gf_client_mt_compound_op_t);
+        if (!req.ops.ops_val)
+                goto unwind;
+        req.ops.ops_len = compound->count;
+
+        if (payloadcnt) {
+                payload = GF_CALLOC (payloadcnt, sizeof (*payload),
+                                     gf_client_mt_compound_op_t);
+                if (!payload)
+                        goto unwind;
+        }
+
+        payloadcnt = 0;
+        for (i = 0; i < compound->count; i++) {
+                cfop = &compound->fops[i];
+
+                req.ops.ops_val[i].fop = client3_1_compound_op (cfop->fop);
+                req.ops.ops_val[i].offset = cfop->offset;
+                req.ops.ops_val[i].flags = cfop->datasync;
+                if (cfop->fop == GF_FOP_CREATE)
+                        req.ops.ops_val[i].flags
+                                = gf_flags_from_flags (cfop->flags);
+
+                if (cfop->fop != GF_FOP_WRITE)
+                        continue;
+
+                req.ops.ops_val[i].size = iov_length (cfop->vector,
+                                                      cfop->count);
+                memcpy (&payload[payloadcnt], cfop->vector,
+                        cfop->count * sizeof (*payload));
+                payloadcnt += cfop->count;
+        }
+
+        local = GF_CALLOC (1, sizeof (*local), gf_client_mt_clnt_local_t);
+        if (!local)
+                goto unwind;
+
+        local->fd = fd_ref (args->fd);
+        local->owner = frame->root->lk_owner;
+        local->compound = compound;
+        frame->local = local;
+
+        if (create) {
+                loc_copy (&local->loc, &compound->fops[0].loc);
+                local->flags = compound->fops[0].flags;
+        }
+
+        ret = client_submit_vec_request (this, &req, frame, conf->fops,
+                                         GFS3_OP_COMPOUND,
+                                         client3_1_compound_cbk,
+                                         payload, payloadcnt,
+                                         compound->iobref,
+                                         xdr_from_compound_req);
+        if (ret) {
+                op_errno = ENOTCONN;
+                goto unwind;
+        }
+
+        GF_FREE (req.ops.ops_val);
+        if (payload)
+                GF_FREE (payload);
+        if (req.dict.dict_val)
+                GF_FREE (req.dict.dict_val);
+
+        return 0;
+
+split:
+        return default_compound (frame, this, args->fd, compound);
+
+unwind:
+        gf_log (this->name, GF_LOG_WARNING, "failed to send the fop: %s", strerror (op_errno));
+        if (req.ops.ops_val)
+                GF_FREE (req.ops.ops_val);
+        if (payload)
+                GF_FREE (payload);
+        if (req.dict.dict_val)
+                GF_FREE (req.dict.dict_val);
+
+        local = frame->local;
+        frame->local = NULL;
+        if (local)
+                client_local_wipe (local);
+
+        STACK_UNWIND_STRICT (compound, frame, -1, op_errno, compound);
+        return 0;
+}
+
+
 
 int32_t
 client3_1_fstat (call_frame_t *frame, xlator_t *this,
@@ -5486,6 +5836,7 @@ rpc_clnt_procedure_t clnt3_1_fop_actors[GF_FOP_MAXVALUE] = {
         [GF_FOP_RELEASE]     = { "RELEASE",     client3_1_release },
         [GF_FOP_RELEASEDIR]  = { "RELEASEDIR",  client3_1_releasedir },
         [GF_FOP_GETSPEC]     = { "GETSPEC",     client3_getspec },
+        [GF_FOP_COMPOUND]    = { "COMPOUND",    client3_1_compound },
 };
 
 /* Used From RPC-CLNT library to log proper name of procedure based on number */
@@ -5533,6 +5884,7 @@ char *clnt3_1_fop_names[GFS3_OP_MAXVALUE] = {
         [GFS3_OP_READDIRP]    = "READDIRP",
         [GFS3_OP_RELEASE]     = "RELEASE",
         [GFS3_OP_RELEASEDIR]  = "RELEASEDIR",
+        [GFS3_OP_COMPOUND]    = "COMPOUND",
 };
 
 rpc_clnt_prog_t clnt3_1_fop_prog = {
@@ -593,6 +593,11 @@ server_setvolume (rpcsvc_request_t *req)
                 gf_log (this->name, GF_LOG_DEBUG,
                         "failed to set 'transport-ptr'");
 
+        ret = dict_set_int32 (reply, "compound-fops", 1);
+        if (ret)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "failed to set 'compound-fops'");
+
 fail:
         rsp.dict.dict_len = dict_serialized_length (reply);
         if (rsp.dict.dict_len < 0) {
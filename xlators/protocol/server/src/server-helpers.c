@@ -97,6 +97,9 @@ server_resolve_wipe (server_resolve_t *resolve)
 void
 free_state (server_state_t *state)
 {
+        if (state->sched_admitted)
+                server_sched_done (state);
+
         if (state->conn) {
                 //xprt_svc_unref (state->conn);
                 state->conn = NULL;
@@ -131,6 +134,11 @@ free_state (server_state_t *state)
                 state->dict = NULL;
         }
 
+        if (state->compound) {
+                compound_args_destroy (state->compound);
+                state->compound = NULL;
+        }
+
         if (state->volume)
                 GF_FREE ((void *)state->volume);
 
@@ -580,6 +588,11 @@ server_connection_cleanup (xlator_t *this, server_connection_t *conn)
         }
         pthread_mutex_unlock (&conn->lock);
 
+        /* the queue belongs to the client process, not to the transport
+           going away; other transports of it may still be live */
+        if (do_cleanup)
+                server_sched_flush (this, conn);
+
         if (do_cleanup && conn->bound_xl)
                 ret = do_connection_cleanup (this, conn, ltable, fdentries, fd_count);
 
@@ -813,6 +826,8 @@ server_connection_get (xlator_t *this, const char *id)
                 conn->ltable  = gf_lock_table_new ();
                 conn->this    = this;
                 pthread_mutex_init (&conn->lock, NULL);
+                INIT_LIST_HEAD (&conn->sched_list);
+                INIT_LIST_HEAD (&conn->sched_queue);
 
                 list_add (&conn->list, &conf->conns);
 
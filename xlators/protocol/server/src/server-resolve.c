@@ -648,6 +648,10 @@ resolve_and_resume (call_frame_t *frame, server_resume_fn_t fn)
         state = CALL_STATE (frame);
         state->resume_fn = fn;
 
+        /* waits for its turn when fair queuing is on */
+        if (server_sched_submit (frame) == 0)
+                return 0;
+
         server_resolve_all (frame);
 
         return 0;
@@ -0,0 +1,701 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+
+#include "server.h"
+#include "server-helpers.h"
+#include "statedump.h"
+#include "event.h"
+
+/* what a request costs on top of its payload, so that metadata operations
+   get their share of the round too */
+#define SERVER_SCHED_OP_COST      4096
+
+/* how long a dispatch held back by the rate limits waits (usecs) */
+#define SERVER_SCHED_RETRY        10000
+
+
+static int64_t
+server_sched_elapsed (struct timeval *from, struct timeval *to)
+{
+        return ((int64_t)(to->tv_sec - from->tv_sec) * 1000000)
+                + (to->tv_usec - from->tv_usec);
+}
+
+
+static void
+server_bucket_reset (server_bucket_t *bucket, uint64_t rate,
+                     struct timeval *now)
+{
+        bucket->credit = rate * 1000000;
+        bucket->last = *now;
+}
+
+
+static void
+server_bucket_refill (server_bucket_t *bucket, uint64_t rate,
+                      struct timeval *now)
+{
+        int64_t elapsed = 0;
+
+        if (!rate)
+                return;
+
+        elapsed = server_sched_elapsed (&bucket->last, now);
+        bucket->last = *now;
+        if (elapsed <= 0)
+                return;
+
+        if (elapsed > 1000000)
+                elapsed = 1000000;
+
+        bucket->credit += elapsed * rate;
+        if (bucket->credit > (int64_t)(rate * 1000000))
+                bucket->credit = rate * 1000000;
+}
+
+
+/* A request may go as long as the bucket is not in debt; a large one then
+   leaves it in debt for the following ones. */
+static int
+server_bucket_ready (server_bucket_t *bucket, uint64_t rate)
+{
+        return (!rate || (bucket->credit > 0));
+}
+
+
+static void
+server_bucket_take (server_bucket_t *bucket, uint64_t rate, uint64_t units)
+{
+        if (rate)
+                bucket->credit -= units * 1000000;
+}
+
+
+static int
+__server_sched_allowed (server_sched_t *sched, server_connection_t *conn,
+                        struct timeval *now)
+{
+        server_bucket_refill (&sched->iops, sched->volume_iops, now);
+        server_bucket_refill (&sched->bw, sched->volume_bw, now);
+        server_bucket_refill (&conn->sched_iops, sched->client_iops, now);
+        server_bucket_refill (&conn->sched_bw, sched->client_bw, now);
+
+        return (server_bucket_ready (&sched->iops, sched->volume_iops)
+                && server_bucket_ready (&sched->bw, sched->volume_bw)
+                && server_bucket_ready (&conn->sched_iops, sched->client_iops)
+                && server_bucket_ready (&conn->sched_bw, sched->client_bw));
+}
+
+
+static void
+__server_sched_admit (server_sched_t *sched, server_connection_t *conn,
+                      server_state_t *state, struct timeval *now)
+{
+        uint64_t wait = 0;
+
+        list_del_init (&state->sched_list);
+        conn->sched_queued--;
+        conn->sched_deficit -= state->sched_cost;
+
+        server_bucket_take (&sched->iops, sched->volume_iops, 1);
+        server_bucket_take (&sched->bw, sched->volume_bw, state->sched_bytes);
+        server_bucket_take (&conn->sched_iops, sched->client_iops, 1);
+        server_bucket_take (&conn->sched_bw, sched->client_bw,
+                            state->sched_bytes);
+
+        state->sched_admitted = 1;
+        sched->inflight++;
+        conn->sched_inflight++;
+
+        wait = server_sched_elapsed (&state->sched_queued_at, now);
+        conn->sched_served++;
+        conn->sched_wait_total += wait;
+        if (wait > conn->sched_wait_max)
+                conn->sched_wait_max = wait;
+
+        if (list_empty (&conn->sched_queue)) {
+                list_del_init (&conn->sched_list);
+                sched->active_count--;
+                conn->sched_deficit = 0;
+        }
+}
+
+
+/* Deficit round robin over the connections with requests queued: each one
+   in turn sends requests as long as their cost is covered by its deficit,
+   which grows by a quantum every time it is found short. Connections held
+   by the rate limits are skipped until the timer tries again. */
+static void
+__server_sched_pick (server_sched_t *sched, struct list_head *runq)
+{
+        server_connection_t *conn    = NULL;
+        server_state_t      *state   = NULL;
+        struct timeval       now     = {0, };
+        int                  blocked = 0;
+
+        gettimeofday (&now, NULL);
+
+        while (!list_empty (&sched->active)) {
+                if (sched->enabled && sched->depth &&
+                    (sched->inflight >= sched->depth))
+                        break;
+
+                if (blocked >= sched->active_count)
+                        break;
+
+                conn = list_entry (sched->active.next, server_connection_t,
+                                   sched_list);
+                state = list_entry (conn->sched_queue.next, server_state_t,
+                                    sched_list);
+
+                if (sched->enabled) {
+                        if (!__server_sched_allowed (sched, conn, &now)) {
+                                list_move_tail (&conn->sched_list,
+                                                &sched->active);
+                                blocked++;
+                                continue;
+                        }
+
+                        if (state->sched_cost > conn->sched_deficit) {
+                                conn->sched_deficit += sched->quantum;
+                                list_move_tail (&conn->sched_list,
+                                                &sched->active);
+                                continue;
+                        }
+                } else {
+                        /* turned off: let the queued requests go */
+                        conn->sched_deficit = state->sched_cost;
+                }
+
+                __server_sched_admit (sched, conn, state, &now);
+                list_add_tail (&state->sched_list, runq);
+                blocked = 0;
+        }
+}
+
+
+/* Queued requests are resolved and wound from the poller thread, where
+   requests arriving from the transports are: the timer thread and the
+   threads sending replies only ask it for a dispatch through the wakeup
+   pipe. */
+static void
+server_sched_kick (server_sched_t *sched)
+{
+        char    wake = 0;
+        ssize_t ret  = 0;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                if (!sched->stopped && !sched->wakeup_pending) {
+                        sched->wakeup_pending = 1;
+                        wake = 1;
+                }
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        if (!wake)
+                return;
+
+        ret = write (sched->wakeup[1], "", 1);
+        if (ret != 1) {
+                gf_log (sched->this->name, GF_LOG_WARNING,
+                        "failed to wake up the request path (%s)",
+                        strerror (errno));
+
+                pthread_mutex_lock (&sched->lock);
+                {
+                        sched->wakeup_pending = 0;
+                }
+                pthread_mutex_unlock (&sched->lock);
+        }
+}
+
+
+static int
+server_sched_wakeup_handler (int fd, int idx, void *data, int poll_in,
+                             int poll_out, int poll_err)
+{
+        server_sched_t *sched = NULL;
+        char            buf[64];
+
+        sched = data;
+
+        while (read (fd, buf, sizeof (buf)) > 0)
+                ;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                sched->wakeup_pending = 0;
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        server_sched_dispatch (sched);
+
+        return 0;
+}
+
+
+static void
+server_sched_timer (void *data)
+{
+        server_sched_t *sched = NULL;
+
+        sched = data;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                sched->timer = NULL;
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        server_sched_kick (sched);
+}
+
+
+/* Only one thread dispatches at a time; the others just ask it for another
+   round, which also keeps requests completing inline from recursing. */
+void
+server_sched_dispatch (server_sched_t *sched)
+{
+        struct list_head  runq;
+        server_state_t   *state = NULL;
+        server_state_t   *tmp   = NULL;
+        struct timeval    delay = {0, };
+        char              again = 0;
+
+        INIT_LIST_HEAD (&runq);
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                if (sched->dispatching) {
+                        sched->redispatch = 1;
+                        pthread_mutex_unlock (&sched->lock);
+                        return;
+                }
+                sched->dispatching = 1;
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        do {
+                pthread_mutex_lock (&sched->lock);
+                {
+                        sched->redispatch = 0;
+                        __server_sched_pick (sched, &runq);
+
+                        /* held by the rate limits only */
+                        if (!list_empty (&sched->active) && !sched->timer &&
+                            !sched->stopped && (!sched->depth ||
+                             (sched->inflight < sched->depth))) {
+                                delay.tv_usec = SERVER_SCHED_RETRY;
+                                sched->timer =
+                                        gf_timer_call_after (sched->this->ctx,
+                                                             delay,
+                                                             server_sched_timer,
+                                                             sched);
+                        }
+                }
+                pthread_mutex_unlock (&sched->lock);
+
+                list_for_each_entry_safe (state, tmp, &runq, sched_list) {
+                        list_del_init (&state->sched_list);
+                        server_resolve_all (state->sched_frame);
+                }
+
+                pthread_mutex_lock (&sched->lock);
+                {
+                        again = sched->redispatch;
+                        if (!again)
+                                sched->dispatching = 0;
+                }
+                pthread_mutex_unlock (&sched->lock);
+        } while (again);
+}
+
+
+/* Queues the request behind the others of its connection. Returns -1 when
+   fair queuing is off, the request is then to be resolved right away. */
+int
+server_sched_submit (call_frame_t *frame)
+{
+        server_state_t      *state = NULL;
+        server_connection_t *conn  = NULL;
+        server_conf_t       *conf  = NULL;
+        server_sched_t      *sched = NULL;
+
+        state = CALL_STATE (frame);
+        conn  = state->conn;
+        conf  = frame->this->private;
+        sched = &conf->sched;
+
+        if (!sched->enabled)
+                return -1;
+
+        if ((frame->root->op == GF_FOP_WRITE) ||
+            (frame->root->op == GF_FOP_READ))
+                state->sched_bytes = state->size;
+
+        state->sched_cost  = SERVER_SCHED_OP_COST + state->sched_bytes;
+        state->sched_frame = frame;
+        gettimeofday (&state->sched_queued_at, NULL);
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                if (list_empty (&conn->sched_queue)) {
+                        list_add_tail (&conn->sched_list, &sched->active);
+                        sched->active_count++;
+                }
+
+                list_add_tail (&state->sched_list, &conn->sched_queue);
+                conn->sched_queued++;
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        server_sched_dispatch (sched);
+
+        return 0;
+}
+
+
+/* called when the reply to an admitted request is sent */
+void
+server_sched_done (server_state_t *state)
+{
+        server_connection_t *conn  = NULL;
+        server_conf_t       *conf  = NULL;
+        server_sched_t      *sched = NULL;
+        char                 queued = 0;
+
+        conn  = state->conn;
+        conf  = conn->this->private;
+        sched = &conf->sched;
+
+        state->sched_admitted = 0;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                sched->inflight--;
+                conn->sched_inflight--;
+                queued = !list_empty (&sched->active);
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        if (queued)
+                server_sched_kick (sched);
+}
+
+
+/* The requests still queued when their client goes away fail with
+   ENOTCONN instead of running after its locks and fds are cleaned up. */
+void
+server_sched_flush (xlator_t *this, server_connection_t *conn)
+{
+        server_conf_t    *conf  = NULL;
+        server_sched_t   *sched = NULL;
+        server_state_t   *state = NULL;
+        server_state_t   *tmp   = NULL;
+        struct list_head  queue;
+
+        conf  = this->private;
+        sched = &conf->sched;
+
+        INIT_LIST_HEAD (&queue);
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                if (!list_empty (&conn->sched_queue)) {
+                        list_splice_init (&conn->sched_queue, &queue);
+                        list_del_init (&conn->sched_list);
+                        sched->active_count--;
+                        conn->sched_queued = 0;
+                        conn->sched_deficit = 0;
+                }
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        list_for_each_entry_safe (state, tmp, &queue, sched_list) {
+                list_del_init (&state->sched_list);
+
+                state->resolve.op_ret   = -1;
+                state->resolve.op_errno = ENOTCONN;
+                server_resolve_done (state->sched_frame);
+        }
+}
+
+
+static int
+server_sched_get_size (xlator_t *this, dict_t *options, char *key,
+                       uint64_t *size)
+{
+        char *str = NULL;
+        int   ret = 0;
+
+        if (dict_get_str (options, key, &str))
+                return 0;
+
+        ret = gf_string2bytesize (str, size);
+        if (ret)
+                gf_log (this->name, GF_LOG_ERROR,
+                        "invalid number format \"%s\" of \"option %s\"",
+                        str, key);
+
+        return ret;
+}
+
+
+static int
+server_sched_configure (xlator_t *this, server_sched_t *sched,
+                        dict_t *options)
+{
+        struct timeval  now         = {0, };
+        int32_t         depth       = 0;
+        int32_t         client_iops = 0;
+        int32_t         volume_iops = 0;
+        uint64_t        quantum     = 128 * GF_UNIT_KB;
+        uint64_t        client_bw   = 0;
+        uint64_t        volume_bw   = 0;
+        int             ret         = -1;
+
+        if (dict_get_int32 (options, "fair-queue-depth", &depth))
+                depth = 0;
+        if (dict_get_int32 (options, "client-iops-limit", &client_iops))
+                client_iops = 0;
+        if (dict_get_int32 (options, "volume-iops-limit", &volume_iops))
+                volume_iops = 0;
+
+        if ((depth < 0) || (client_iops < 0) || (volume_iops < 0)) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "fair queuing limits cannot be negative");
+                goto out;
+        }
+
+        if ((client_iops > SERVER_SCHED_MAX_IOPS) ||
+            (volume_iops > SERVER_SCHED_MAX_IOPS)) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "iops limits cannot be more than %d",
+                        SERVER_SCHED_MAX_IOPS);
+                goto out;
+        }
+
+        if (server_sched_get_size (this, options, "fair-queue-quantum",
+                                   &quantum) ||
+            server_sched_get_size (this, options, "client-bandwidth-limit",
+                                   &client_bw) ||
+            server_sched_get_size (this, options, "volume-bandwidth-limit",
+                                   &volume_bw))
+                goto out;
+
+        if ((client_bw > SERVER_SCHED_MAX_BW) ||
+            (volume_bw > SERVER_SCHED_MAX_BW)) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "bandwidth limits cannot be more than %llu",
+                        SERVER_SCHED_MAX_BW);
+                goto out;
+        }
+
+        if (quantum < SERVER_SCHED_OP_COST)
+                quantum = SERVER_SCHED_OP_COST;
+
+        gettimeofday (&now, NULL);
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                sched->depth       = depth;
+                sched->quantum     = quantum;
+                sched->client_iops = client_iops;
+                sched->client_bw   = client_bw;
+
+                if (sched->volume_iops != volume_iops)
+                        server_bucket_reset (&sched->iops, volume_iops, &now);
+                if (sched->volume_bw != volume_bw)
+                        server_bucket_reset (&sched->bw, volume_bw, &now);
+                sched->volume_iops = volume_iops;
+                sched->volume_bw   = volume_bw;
+
+                sched->enabled = (depth || client_iops || client_bw ||
+                                  volume_iops || volume_bw);
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        gf_log (this->name, GF_LOG_DEBUG, "fair queuing %s (depth %d, quantum "
+                "%"PRIu64", client %d iops %"PRIu64" B/s, volume %d iops "
+                "%"PRIu64" B/s)", (sched->enabled) ? "on" : "off", depth,
+                quantum, client_iops, client_bw, volume_iops, volume_bw);
+
+        /* what the new limits let go */
+        server_sched_kick (sched);
+        ret = 0;
+out:
+        return ret;
+}
+
+
+int
+server_sched_reconf (xlator_t *this, dict_t *options)
+{
+        server_conf_t *conf = NULL;
+
+        conf = this->private;
+
+        return server_sched_configure (this, &conf->sched, options);
+}
+
+
+int
+server_sched_init (xlator_t *this, server_conf_t *conf)
+{
+        server_sched_t *sched = NULL;
+        int             ret   = -1;
+
+        sched = &conf->sched;
+
+        pthread_mutex_init (&sched->lock, NULL);
+        INIT_LIST_HEAD (&sched->active);
+        sched->this = this;
+        sched->wakeup[0] = -1;
+        sched->wakeup[1] = -1;
+        sched->wakeup_idx = -1;
+
+        ret = pipe (sched->wakeup);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "could not create the wakeup pipe (%s)",
+                        strerror (errno));
+                goto out;
+        }
+
+        ret = fcntl (sched->wakeup[0], F_SETFL, O_NONBLOCK);
+        if (ret != -1)
+                ret = fcntl (sched->wakeup[1], F_SETFL, O_NONBLOCK);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "could not set the wakeup pipe non-blocking (%s)",
+                        strerror (errno));
+                goto out;
+        }
+
+        sched->wakeup_idx = event_register (this->ctx->event_pool,
+                                            sched->wakeup[0],
+                                            server_sched_wakeup_handler,
+                                            sched, 1, 0);
+        if (sched->wakeup_idx == -1) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "could not register the wakeup pipe");
+                ret = -1;
+                goto out;
+        }
+
+        ret = server_sched_configure (this, sched, this->options);
+out:
+        if (ret)
+                server_sched_fini (this, conf);
+
+        return ret;
+}
+
+
+void
+server_sched_fini (xlator_t *this, server_conf_t *conf)
+{
+        server_sched_t *sched = NULL;
+        gf_timer_t     *timer = NULL;
+
+        sched = &conf->sched;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                sched->stopped = 1;
+                timer = sched->timer;
+                sched->timer = NULL;
+        }
+        pthread_mutex_unlock (&sched->lock);
+
+        if (timer)
+                gf_timer_call_cancel (this->ctx, timer);
+
+        if (sched->wakeup_idx != -1)
+                event_unregister (this->ctx->event_pool, sched->wakeup[0],
+                                  sched->wakeup_idx);
+
+        if (sched->wakeup[0] != -1)
+                close (sched->wakeup[0]);
+        if (sched->wakeup[1] != -1)
+                close (sched->wakeup[1]);
+
+        sched->wakeup_idx = -1;
+        sched->wakeup[0] = -1;
+        sched->wakeup[1] = -1;
+}
+
+
+/* caller holds conf->mutex */
+void
+server_sched_dump (xlator_t *this)
+{
+        server_conf_t       *conf  = NULL;
+        server_sched_t      *sched = NULL;
+        server_connection_t *conn  = NULL;
+        char                 key[GF_DUMP_MAX_BUF_LEN];
+        int                  i     = 0;
+
+        conf  = this->private;
+        sched = &conf->sched;
+
+        pthread_mutex_lock (&sched->lock);
+        {
+                gf_proc_dump_build_key (key, "server", "sched.enabled");
+                gf_proc_dump_write (key, "%d", sched->enabled);
+                gf_proc_dump_build_key (key, "server", "sched.inflight");
+                gf_proc_dump_write (key, "%d", sched->inflight);
+
+                list_for_each_entry (conn, &conf->conns, list) {
+                        gf_proc_dump_build_key (key, "server", "conn.%d.id",
+                                                i);
+                        gf_proc_dump_write (key, "%s", conn->id);
+                        gf_proc_dump_build_key (key, "server",
+                                                "conn.%d.queued", i);
+                        gf_proc_dump_write (key, "%d", conn->sched_queued);
+                        gf_proc_dump_build_key (key, "server",
+                                                "conn.%d.inflight", i);
+                        gf_proc_dump_write (key, "%d", conn->sched_inflight);
+                        gf_proc_dump_build_key (key, "server",
+                                                "conn.%d.served", i);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            conn->sched_served);
+                        gf_proc_dump_build_key (key, "server",
+                                                "conn.%d.wait_avg_usecs", i);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            (conn->sched_served) ?
+                                            (conn->sched_wait_total
+                                             / conn->sched_served) : 0);
+                        gf_proc_dump_build_key (key, "server",
+                                                "conn.%d.wait_max_usecs", i);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            conn->sched_wait_max);
+                        i++;
+                }
+        }
+        pthread_mutex_unlock (&sched->lock);
+}
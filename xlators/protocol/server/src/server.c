@@ -236,6 +236,8 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        uint64_t          total_calls = 0;
+        uint64_t          total_records = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -247,6 +249,8 @@ server_priv (xlator_t *this)
         list_for_each_entry (xprt, &conf->xprt_list, list) {
                 total_read  += xprt->total_bytes_read;
                 total_write += xprt->total_bytes_write;
+                total_calls += xprt->total_read_calls;
+                total_records += xprt->total_records_read;
         }
 
         gf_proc_dump_build_key(key, "server", "total-bytes-read");
@@ -255,6 +259,22 @@ server_priv (xlator_t *this)
         gf_proc_dump_build_key(key, "server", "total-bytes-write");
         gf_proc_dump_write(key, "%"PRIu64, total_write);
 
+        gf_proc_dump_build_key(key, "server", "total-read-calls");
+        gf_proc_dump_write(key, "%"PRIu64, total_calls);
+
+        gf_proc_dump_build_key(key, "server", "total-rpcs-read");
+        gf_proc_dump_write(key, "%"PRIu64, total_records);
+
+        gf_proc_dump_build_key(key, "server", "read-calls-per-rpc");
+        gf_proc_dump_write(key, "%.2f", (total_records) ?
+                           ((double)total_calls / total_records) : 0.0);
+
+        pthread_mutex_lock (&conf->mutex);
+        {
+                server_sched_dump (this);
+        }
+        pthread_mutex_unlock (&conf->mutex);
+
         ret = 0;
 out:
         return ret;
@@ -599,6 +619,10 @@ reconfigure (xlator_t *this, dict_t *options)
                 goto out;
         }
 
+        ret = server_sched_reconf (this, options);
+        if (ret)
+                goto out;
+
         (void) rpcsvc_set_allow_insecure (rpc_conf, options);
         list_for_each_entry (listeners, &(rpc_conf->listeners), list) {
                 if (listeners->trans != NULL) {
@@ -649,6 +673,10 @@ init (xlator_t *this)
         if (ret)
                 goto out;
 
+        ret = server_sched_init (this, conf);
+        if (ret)
+                goto out;
+
         ret = dict_get_str (this->options, "config-directory", &conf->conf_dir);
         if (ret)
                 conf->conf_dir = CONFDIR;
@@ -765,11 +793,13 @@ out:
 void
 fini (xlator_t *this)
 {
-#if 0
         server_conf_t *conf = NULL;
 
         conf = this->private;
 
+        if (conf)
+                server_sched_fini (this, conf);
+#if 0
         if (conf) {
                 if (conf->rpc) {
                         /* TODO: memory leak here, have to free RPC */
@@ -857,6 +887,55 @@ struct volume_options options[] = {
         { .key   = {"rpc-auth-allow-insecure"},
           .type  = GF_OPTION_TYPE_BOOL,
         },
+        { .key   = {"fair-queue-depth"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 0,
+          .max   = 65536,
+          .default_value = "0",
+          .description = "Number of requests executed at the same time, "
+                         "taken from the queues of the clients in turn. 0 "
+                         "for no limit."
+        },
+        { .key   = {"fair-queue-quantum"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 4 * GF_UNIT_KB,
+          .max   = 16 * GF_UNIT_MB,
+          .default_value = "128KB",
+          .description = "Bytes of requests a client gets to send in each "
+                         "round of the fair queuing."
+        },
+        { .key   = {"client-iops-limit"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 0,
+          .max   = SERVER_SCHED_MAX_IOPS,
+          .default_value = "0",
+          .description = "Requests per second executed for each client. 0 "
+                         "for no limit."
+        },
+        { .key   = {"client-bandwidth-limit"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 0,
+          .max   = SERVER_SCHED_MAX_BW,
+          .default_value = "0",
+          .description = "Bytes per second read or written by each client. "
+                         "0 for no limit."
+        },
+        { .key   = {"volume-iops-limit"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 0,
+          .max   = SERVER_SCHED_MAX_IOPS,
+          .default_value = "0",
+          .description = "Requests per second executed for all the clients "
+                         "of the volume. 0 for no limit."
+        },
+        { .key   = {"volume-bandwidth-limit"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 0,
+          .max   = SERVER_SCHED_MAX_BW,
+          .default_value = "0",
+          .description = "Bytes per second read or written by all the "
+                         "clients of the volume. 0 for no limit."
+        },
 
         /* XXX These are synthetic options which are actually recognized and *
          *     validated in addr.c, added here to get visibiliity in         *
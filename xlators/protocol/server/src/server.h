@@ -25,6 +25,7 @@
 #include "rpcsvc.h"
 
 #include "fd.h"
+#include "timer.h"
 #include "protocol-common.h"
 #include "server-mem-types.h"
 #include "glusterfs3.h"
@@ -34,6 +35,13 @@
 
 typedef struct _server_state server_state_t;
 
+/* a token bucket, refilled at a rate given in units per second, holding at
+   most one second worth of them */
+typedef struct {
+        int64_t         credit;         /* in millionths of a unit */
+        struct timeval  last;
+} server_bucket_t;
+
 struct _locker {
         struct list_head  lockers;
         char             *volume;
@@ -64,6 +72,18 @@ struct _server_connection {
         struct _lock_table *ltable;
         xlator_t           *bound_xl;
         xlator_t           *this;
+
+        /* fair queuing, under the scheduler lock */
+        struct list_head    sched_list;       /* in the active connections */
+        struct list_head    sched_queue;      /* requests waiting their turn */
+        int                 sched_queued;
+        int                 sched_inflight;
+        uint64_t            sched_deficit;
+        server_bucket_t     sched_iops;
+        server_bucket_t     sched_bw;
+        uint64_t            sched_served;
+        uint64_t            sched_wait_total; /* usecs */
+        uint64_t            sched_wait_max;
 };
 
 typedef struct _server_connection server_connection_t;
@@ -80,6 +100,43 @@ server_connection_cleanup (xlator_t *this, server_connection_t *conn);
 
 int server_null (rpcsvc_request_t *req);
 
+/* highest rates accepted, which keep the token buckets (credit is counted
+   in millionths of a request or byte) within 64 bits */
+#define SERVER_SCHED_MAX_IOPS     (1000000)
+#define SERVER_SCHED_MAX_BW       (GF_UNIT_TB)
+
+/* Requests are admitted to resolve and the bound xlator at most 'depth' at
+   a time, taken from per connection queues in deficit round robin, within
+   the per client and per volume rate limits. */
+typedef struct {
+        pthread_mutex_t         lock;
+        xlator_t               *this;
+        struct list_head        active;       /* connections with requests
+                                                 queued */
+        int                     active_count;
+        int                     inflight;
+        char                    enabled;
+        char                    dispatching;
+        char                    redispatch;
+        gf_timer_t             *timer;        /* retries a dispatch held by
+                                                 the rate limits */
+        int                     wakeup[2];    /* pipe polled with the
+                                                 transports, to dispatch
+                                                 from the request path */
+        int                     wakeup_idx;
+        char                    wakeup_pending;
+        char                    stopped;
+
+        int                     depth;        /* 0 for no limit */
+        uint64_t                quantum;      /* bytes */
+        uint64_t                client_iops;  /* rates are 0 for no limit */
+        uint64_t                client_bw;
+        uint64_t                volume_iops;
+        uint64_t                volume_bw;
+        server_bucket_t         iops;
+        server_bucket_t         bw;
+} server_sched_t;
+
 struct _volfile_ctx {
         struct _volfile_ctx *next;
         char                *key;
@@ -99,6 +156,7 @@ struct server_conf {
         pthread_mutex_t         mutex;
         struct list_head        conns;
         struct list_head        xprt_list;
+        server_sched_t          sched;
 };
 typedef struct server_conf server_conf_t;
 
@@ -142,6 +200,10 @@ typedef int (*server_resume_fn_t) (call_frame_t *frame, xlator_t *bound_xl);
 
 int
 resolve_and_resume (call_frame_t *frame, server_resume_fn_t fn);
+int
+server_resolve_all (call_frame_t *frame);
+int
+server_resolve_done (call_frame_t *frame);
 
 struct _server_state {
         server_connection_t  *conn;
@@ -187,6 +249,15 @@ struct _server_state {
         struct gf_flock      flock;
         const char       *volume;
         dir_entry_t      *entry;
+        compound_args_t  *compound;
+
+        /* fair queuing */
+        struct list_head  sched_list;
+        call_frame_t     *sched_frame;
+        struct timeval    sched_queued_at;
+        uint64_t          sched_cost;
+        uint64_t          sched_bytes;
+        char              sched_admitted;
 };
 
 extern struct rpcsvc_program gluster_handshake_prog;
@@ -203,6 +274,15 @@ server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
 int xdr_to_glusterfs_req (rpcsvc_request_t *req, void *arg,
                           gfs_serialize_t sfunc);
 
+int server_sched_init (xlator_t *this, server_conf_t *conf);
+int server_sched_reconf (xlator_t *this, dict_t *options);
+int server_sched_submit (call_frame_t *frame);
+void server_sched_dispatch (server_sched_t *sched);
+void server_sched_done (server_state_t *state);
+void server_sched_flush (xlator_t *this, server_connection_t *conn);
+void server_sched_dump (xlator_t *this);
+void server_sched_fini (xlator_t *this, server_conf_t *conf);
+
 int gf_server_check_setxattr_cmd (call_frame_t *frame, dict_t *dict);
 int gf_server_check_getxattr_cmd (call_frame_t *frame, const char *name);
 
@@ -1247,6 +1247,115 @@ server_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 }
 
 
+/* links the file made by the create of a compound request and hands its fd
+   to the connection, as server_create_cbk does for a plain create */
+static int64_t
+server_compound_link (call_frame_t *frame, compound_fop_t *cfop)
+{
+        server_connection_t *conn       = NULL;
+        server_state_t      *state      = NULL;
+        inode_t             *link_inode = NULL;
+        fd_t                *fd         = NULL;
+        int64_t              fd_no      = -1;
+
+        conn = SERVER_CONNECTION (frame);
+        state = CALL_STATE (frame);
+        fd = state->fd;
+
+        link_inode = inode_link (state->loc.inode, state->loc.parent,
+                                 state->loc.name, &cfop->buf);
+        if (!link_inode)
+                goto out;
+
+        if (link_inode != fd->inode) {
+                /* racy, see server_create_cbk */
+                inode_unref (fd->inode);
+                fd->inode = inode_ref (link_inode);
+        }
+
+        inode_lookup (link_inode);
+        inode_unref (link_inode);
+
+        fd_bind (fd);
+
+        fd_no = gf_fd_unused_get (conn->fdtable, fd);
+        if (fd_no >= 0)
+                fd_ref (fd);
+out:
+        return fd_no;
+}
+
+
+int
+server_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, compound_args_t *args)
+{
+        gfs3_compound_rsp     rsp   = {0,};
+        gfs3_compound_op_rsp *reply = NULL;
+        compound_fop_t       *cfop  = NULL;
+        server_state_t       *state = NULL;
+        rpcsvc_request_t     *req   = NULL;
+        int64_t               fd_no = 0;
+        int                   i     = 0;
+
+        req           = frame->local;
+
+        state = CALL_STATE(frame);
+        if (op_ret < 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "%"PRId64": COMPOUND %"PRId64" (%"PRId64") ==> %"PRId32" (%s)",
+                        frame->root->unique, state->resolve.fd_no,
+                        state->fd ? state->fd->inode->ino : 0, op_ret,
+                        strerror (op_errno));
+                goto out;
+        }
+
+        rsp.replies.replies_val = GF_CALLOC (args->count, sizeof (*reply),
+                                             gf_server_mt_compound_t);
+        if (!rsp.replies.replies_val) {
+                op_ret = -1;
+                op_errno = ENOMEM;
+                goto out;
+        }
+        rsp.replies.replies_len = args->count;
+
+        for (i = 0; i < args->count; i++) {
+                cfop = &args->fops[i];
+                reply = &rsp.replies.replies_val[i];
+
+                if ((cfop->fop == GF_FOP_CREATE) && (cfop->op_ret >= 0)) {
+                        fd_no = server_compound_link (frame, cfop);
+                        if (fd_no < 0) {
+                                cfop->op_ret = -1;
+                                cfop->op_errno = ENOENT;
+                        } else {
+                                rsp.fd = fd_no;
+                                gf_stat_from_iatt (&rsp.stat, &cfop->buf);
+                        }
+                }
+
+                reply->op_ret = cfop->op_ret;
+                reply->op_errno = gf_errno_to_error (cfop->op_errno);
+                if (cfop->op_ret >= 0) {
+                        gf_stat_from_iatt (&reply->prestat, &cfop->prebuf);
+                        gf_stat_from_iatt (&reply->poststat, &cfop->postbuf);
+                }
+        }
+
+out:
+        rsp.op_ret    = op_ret;
+        rsp.op_errno  = gf_errno_to_error (op_errno);
+
+        server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
+                             xdr_serialize_compound_rsp);
+
+        if (rsp.replies.replies_val)
+                GF_FREE (rsp.replies.replies_val);
+
+        return 0;
+}
+
+
 int
 server_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                   int32_t op_ret, int32_t op_errno,
@@ -2478,6 +2587,43 @@ err:
 }
 
 
+int
+server_compound_resume (call_frame_t *frame, xlator_t *bound_xl)
+{
+        server_state_t   *state = NULL;
+        compound_fop_t   *cfop  = NULL;
+
+        state = CALL_STATE (frame);
+
+        if (state->resolve.op_ret != 0)
+                goto err;
+
+        cfop = &state->compound->fops[0];
+        if (cfop->fop == GF_FOP_CREATE) {
+                state->loc.inode = inode_new (state->itable);
+
+                state->fd = fd_create (state->loc.inode, frame->root->pid);
+                state->fd->flags = state->flags;
+
+                loc_copy (&cfop->loc, &state->loc);
+                cfop->flags = state->flags;
+                cfop->mode = state->mode;
+                if (state->params)
+                        cfop->params = dict_ref (state->params);
+        }
+
+        STACK_WIND (frame, server_compound_cbk,
+                    bound_xl, bound_xl->fops->compound,
+                    state->fd, state->compound);
+
+        return 0;
+err:
+        server_compound_cbk (frame, NULL, frame->this, state->resolve.op_ret,
+                             state->resolve.op_errno, state->compound);
+        return 0;
+}
+
+
 int
 server_readv_resume (call_frame_t *frame, xlator_t *bound_xl)
 {
@@ -3115,6 +3261,202 @@ server_writev_vec (rpcsvc_request_t *req, struct iovec *payload,
 }
 
 
+/* hands out the next 'size' bytes of the request payload to a write of a
+   compound request */
+static int
+server_compound_take_payload (server_state_t *state, compound_fop_t *cfop,
+                              size_t size, int *idx, size_t *off)
+{
+        struct iovec *payload = NULL;
+
+        cfop->vector = GF_CALLOC (state->payload_count + 1,
+                                  sizeof (struct iovec),
+                                  gf_server_mt_compound_t);
+        if (!cfop->vector)
+                return -1;
+
+        while (size > 0) {
+                if (*idx >= state->payload_count)
+                        return -1;
+
+                payload = &state->payload_vector[*idx];
+
+                cfop->vector[cfop->count].iov_base = payload->iov_base + *off;
+                cfop->vector[cfop->count].iov_len
+                        = min (size, payload->iov_len - *off);
+
+                size -= cfop->vector[cfop->count].iov_len;
+                *off += cfop->vector[cfop->count].iov_len;
+                cfop->count++;
+
+                if (*off == payload->iov_len) {
+                        (*idx)++;
+                        *off = 0;
+                }
+        }
+
+        return 0;
+}
+
+
+int
+server_compound (rpcsvc_request_t *req)
+{
+        server_state_t      *state    = NULL;
+        call_frame_t        *frame    = NULL;
+        compound_args_t     *compound = NULL;
+        compound_fop_t      *cfop     = NULL;
+        gfs3_compound_req    args     = {{0,},};
+        dict_t              *params   = NULL;
+        char                *buf      = NULL;
+        ssize_t              len      = 0;
+        size_t               off      = 0;
+        int                  idx      = 0;
+        int                  i        = 0;
+        int                  ret      = -1;
+
+        if (!req)
+                return ret;
+
+        len = xdr_to_compound_req (req->msg[0], &args);
+        if ((len == 0) || (args.ops.ops_len == 0)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        frame = get_frame_from_request (req);
+        if (!frame) {
+                // something wrong, mostly insufficient memory
+                req->rpc_err = GARBAGE_ARGS; /* TODO */
+                goto out;
+        }
+        frame->root->op = GF_FOP_COMPOUND;
+
+        state = CALL_STATE (frame);
+        if (!state->conn->bound_xl) {
+                /* auth failure, request on subvolume without setvolume */
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        if (args.ops.ops_val[0].fop == GFS3_OP_CREATE) {
+                /* the fd of the compound is the one the create opens */
+                if (args.dict.dict_len) {
+                        params = dict_new ();
+
+                        buf = memdup (args.dict.dict_val, args.dict.dict_len);
+                        if (buf == NULL) {
+                                goto out;
+                        }
+
+                        ret = dict_unserialize (buf, args.dict.dict_len,
+                                                &params);
+                        if (ret < 0) {
+                                gf_log (state->conn->bound_xl->name,
+                                        GF_LOG_ERROR, "%"PRId64": %s: failed "
+                                        "to unserialize req-buffer to "
+                                        "dictionary", frame->root->unique,
+                                        args.path);
+                                goto out;
+                        }
+
+                        state->params = params;
+
+                        params->extra_free = buf;
+
+                        buf = NULL;
+                        params = NULL;
+                }
+
+                state->resolve.type   = RESOLVE_NOT;
+                state->resolve.path   = gf_strdup (args.path);
+                state->resolve.bname  = gf_strdup (args.bname);
+                state->mode           = args.mode;
+                state->flags = gf_flags_to_flags (args.ops.ops_val[0].flags);
+                memcpy (state->resolve.pargfid, args.pargfid, 16);
+        } else {
+                state->resolve.type  = RESOLVE_MUST;
+                state->resolve.fd_no = args.fd;
+        }
+
+        if (len < req->msg[0].iov_len) {
+                state->payload_vector[0].iov_base
+                        = (req->msg[0].iov_base + len);
+                state->payload_vector[0].iov_len
+                        = req->msg[0].iov_len - len;
+                state->payload_count = 1;
+        }
+
+        for (i = 1; i < req->count; i++) {
+                state->payload_vector[state->payload_count++]
+                        = req->msg[i];
+        }
+
+        compound = compound_args_new (args.ops.ops_len);
+        if (!compound) {
+                req->rpc_err = GARBAGE_ARGS; /* TODO */
+                goto out;
+        }
+        state->compound = compound;
+        compound->iobref = iobref_ref (req->iobref);
+
+        for (i = 0; i < compound->count; i++) {
+                cfop = &compound->fops[i];
+
+                cfop->offset   = args.ops.ops_val[i].offset;
+                cfop->datasync = args.ops.ops_val[i].flags;
+
+                switch (args.ops.ops_val[i].fop) {
+                case GFS3_OP_CREATE:
+                        /* set up by server_compound_resume */
+                        cfop->fop = (i == 0) ? GF_FOP_CREATE : GF_FOP_NULL;
+                        break;
+                case GFS3_OP_WRITE:
+                        cfop->fop = GF_FOP_WRITE;
+                        ret = server_compound_take_payload
+                                (state, cfop, args.ops.ops_val[i].size,
+                                 &idx, &off);
+                        if (ret) {
+                                req->rpc_err = GARBAGE_ARGS;
+                                goto out;
+                        }
+                        break;
+                case GFS3_OP_FLUSH:
+                        cfop->fop = GF_FOP_FLUSH;
+                        break;
+                case GFS3_OP_FSYNC:
+                        cfop->fop = GF_FOP_FSYNC;
+                        break;
+                default:
+                        /* answered with ENOTSUP by default_compound */
+                        cfop->fop = GF_FOP_NULL;
+                        break;
+                }
+        }
+
+        ret = 0;
+        resolve_and_resume (frame, server_compound_resume);
+out:
+        /* memory allocated by libc, don't use GF_FREE */
+        if (args.ops.ops_val)
+                free (args.ops.ops_val);
+        if (args.path)
+                free (args.path);
+        if (args.bname)
+                free (args.bname);
+        if (args.dict.dict_val)
+                free (args.dict.dict_val);
+
+        if (params)
+                dict_unref (params);
+        if (buf)
+                GF_FREE (buf);
+
+        return ret;
+}
+
+
 int
 server_release (rpcsvc_request_t *req)
 {
@@ -5184,6 +5526,7 @@ rpcsvc_actor_t glusterfs3_1_fop_actors[] = {
         [GFS3_OP_READDIRP]    = { "READDIRP",   GFS3_OP_READDIRP, server_readdirp, NULL, NULL },
         [GFS3_OP_RELEASE]     = { "RELEASE",    GFS3_OP_RELEASE, server_release, NULL, NULL },
         [GFS3_OP_RELEASEDIR]  = { "RELEASEDIR", GFS3_OP_RELEASEDIR, server_releasedir, NULL, NULL },
+        [GFS3_OP_COMPOUND]    = { "COMPOUND",   GFS3_OP_COMPOUND, server_compound, NULL, NULL },
 };
 
 
@@ -2663,6 +2663,28 @@ err:
 }
 
 
+/* the transport hands us write payloads at the start of an iobuf, so
+   in the common case the vectors are already fit for O_DIRECT and can be
+   written in place */
+static int
+__posix_vector_aligned (struct iovec *vector, int count, off_t offset,
+                        int align)
+{
+        int             idx = 0;
+
+        if (offset & (align - 1))
+                return 0;
+
+        for (idx = 0; idx < count; idx++) {
+                if (((unsigned long)vector[idx].iov_base & (align - 1))
+                    || (vector[idx].iov_len & (align - 1)))
+                        return 0;
+        }
+
+        return 1;
+}
+
+
 int32_t
 __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
                 int odirect)
@@ -2680,6 +2702,9 @@ __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
         if (!odirect)
                 return __posix_pwritev (fd, vector, count, startoff);
 
+        if (__posix_vector_aligned (vector, count, startoff, align))
+                return __posix_pwritev (fd, vector, count, startoff);
+
         for (idx = 0; idx < count; idx++) {
                 if (max_buf_size < vector[idx].iov_len)
                         max_buf_size = vector[idx].iov_len;